@@ -0,0 +1,242 @@
+// PrefixProgram.h
+// Compiled form of a prefix expression. The text is split into tokens once
+// and decoded, already in right-to-left order, into small instructions that
+// run in one pass over a stack of numbers; prefixEvaluation.cpp compiles each
+// line it reads this way and runs the program.
+//
+// Reading the program backwards gives the prefix expression again. Each
+// operator pops its operands the way the evaluator always has: the operand
+// written first ends up on top of the stack and is the right-hand one, so
+// "- 10 2" is 2 - 10 = -8. Values are doubles as in the evaluator; truth
+// values are 1 and 0, and any nonzero value counts as true. Division of any
+// kind by zero gives 0, the evaluator's rule.
+//
+// Besides numbers and + - * /, programs can read variables (by slot number)
+// and use the rest of the Pascal expression operators, so parsed Pascal
+// expressions can be lowered into the same form (PascalCompiler/ExpressionLowering.h).
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+enum PrefixOp : uint8_t
+{
+    PREFIX_CONSTANT, // pushes value
+    PREFIX_VARIABLE, // pushes variables[slot]
+    PREFIX_NEGATE,
+    PREFIX_NOT,
+    PREFIX_ADD,
+    PREFIX_SUBTRACT,
+    PREFIX_MULTIPLY,
+    PREFIX_DIVIDE,
+    PREFIX_DIV,
+    PREFIX_MOD,
+    PREFIX_AND,
+    PREFIX_OR,
+    PREFIX_EQUAL,
+    PREFIX_NOT_EQUAL,
+    PREFIX_LESS,
+    PREFIX_LESS_EQUAL,
+    PREFIX_GREATER,
+    PREFIX_GREATER_EQUAL,
+    PREFIX_OP_COUNT
+};
+
+// Spelling in prefix text; "neg" is unary minus, since "-" is always binary there
+inline const char *prefixOpName(int op)
+{
+    static const char *names[PREFIX_OP_COUNT] = {"", "",    "neg", "not", "+", "-",  "*", "/",  "div",
+                                                 "mod", "and", "or",  "=",   "<>", "<", "<=", ">", ">="};
+    return names[op];
+}
+
+inline bool isUnaryPrefixOp(int op) { return op == PREFIX_NEGATE || op == PREFIX_NOT; }
+
+struct PrefixInstruction
+{
+    PrefixOp op;
+    uint32_t slot;
+    double value;
+};
+
+struct PrefixProgram
+{
+    vector<PrefixInstruction> code; // prefix order reversed
+    uint32_t maxStack = 0;
+};
+
+// Stack depth the program needs; throws if it does not leave exactly one value
+inline uint32_t prefixStackDepth(const PrefixProgram &program)
+{
+    uint32_t depth = 0, deepest = 0;
+    for (const PrefixInstruction &instruction : program.code)
+    {
+        if (instruction.op == PREFIX_CONSTANT || instruction.op == PREFIX_VARIABLE)
+        {
+            if (++depth > deepest)
+                deepest = depth;
+        }
+        else
+        {
+            uint32_t operands = isUnaryPrefixOp(instruction.op) ? 1 : 2;
+            if (depth < operands)
+                throw runtime_error(string("Missing operand for ") + prefixOpName(instruction.op));
+            depth -= operands - 1;
+        }
+    }
+    if (depth != 1)
+        throw runtime_error(depth == 0 ? "Empty prefix expression" : "Too many operands in prefix expression");
+    return deepest;
+}
+
+// first is the operand below the top of the stack, second the one on top
+inline double applyPrefixOp(int op, double first, double second)
+{
+    switch (op)
+    {
+    case PREFIX_ADD:
+        return first + second;
+    case PREFIX_SUBTRACT:
+        return first - second;
+    case PREFIX_MULTIPLY:
+        return first * second;
+    case PREFIX_DIVIDE:
+        return second == 0 ? 0 : first / second;
+    case PREFIX_DIV:
+        return second == 0 ? 0 : trunc(first / second);
+    case PREFIX_MOD:
+        return second == 0 ? 0 : fmod(first, second);
+    case PREFIX_AND:
+        return (first != 0 && second != 0) ? 1 : 0;
+    case PREFIX_OR:
+        return (first != 0 || second != 0) ? 1 : 0;
+    case PREFIX_EQUAL:
+        return first == second ? 1 : 0;
+    case PREFIX_NOT_EQUAL:
+        return first != second ? 1 : 0;
+    case PREFIX_LESS:
+        return first < second ? 1 : 0;
+    case PREFIX_LESS_EQUAL:
+        return first <= second ? 1 : 0;
+    case PREFIX_GREATER:
+        return first > second ? 1 : 0;
+    case PREFIX_GREATER_EQUAL:
+        return first >= second ? 1 : 0;
+    default:
+        return 0;
+    }
+}
+
+// variables must hold every slot the program reads
+inline double runPrefix(const PrefixProgram &program, const double *variables = nullptr)
+{
+    double local[64];
+    vector<double> heap;
+    double *stack = local;
+    if (program.maxStack > 64)
+    {
+        heap.resize(program.maxStack);
+        stack = heap.data();
+    }
+    size_t top = 0; // number of values on the stack
+    for (const PrefixInstruction &instruction : program.code)
+    {
+        switch (instruction.op)
+        {
+        case PREFIX_CONSTANT:
+            stack[top++] = instruction.value;
+            break;
+        case PREFIX_VARIABLE:
+            stack[top++] = variables[instruction.slot];
+            break;
+        case PREFIX_NEGATE:
+            stack[top - 1] = -stack[top - 1];
+            break;
+        case PREFIX_NOT:
+            stack[top - 1] = stack[top - 1] == 0 ? 1 : 0;
+            break;
+        default:
+            stack[top - 2] = applyPrefixOp(instruction.op, stack[top - 2], stack[top - 1]);
+            top--;
+            break;
+        }
+    }
+    return top == 1 ? stack[0] : 0;
+}
+
+// Compiles prefix text such as "+ * 2 x 3". Brackets and commas are skipped as
+// by the evaluator. A word starting with a digit, '.' or '-' (other than "-"
+// itself) is a number; any other word that is not an operator is a variable,
+// and its slot is its index in variables (new names are appended).
+inline PrefixProgram compilePrefix(const string &expression, vector<string> &variables)
+{
+    vector<string> tokens;
+    stringstream stream(expression);
+    string token;
+    while (stream >> token)
+    {
+        if (token != "(" && token != ")" && token != "[" && token != "]" && token != "{" && token != "}" &&
+            token != ",")
+            tokens.push_back(token);
+    }
+
+    PrefixProgram program;
+    for (size_t i = tokens.size(); i-- > 0;)
+    {
+        const string &t = tokens[i];
+        PrefixInstruction instruction{PREFIX_CONSTANT, 0, 0};
+        int op = PREFIX_NEGATE;
+        while (op < PREFIX_OP_COUNT && t != prefixOpName(op))
+            op++;
+        if (op < PREFIX_OP_COUNT)
+            instruction.op = (PrefixOp)op;
+        else if ((t[0] >= '0' && t[0] <= '9') || t[0] == '.' || t[0] == '-')
+        {
+            size_t used = 0;
+            instruction.value = stod(t, &used);
+            if (used != t.size())
+                throw runtime_error("Invalid number: " + t);
+        }
+        else
+        {
+            instruction.op = PREFIX_VARIABLE;
+            while (instruction.slot < variables.size() && variables[instruction.slot] != t)
+                instruction.slot++;
+            if (instruction.slot == variables.size())
+                variables.push_back(t);
+        }
+        program.code.push_back(instruction);
+    }
+    program.maxStack = prefixStackDepth(program);
+    return program;
+}
+
+// Prefix text of a program, with variables written as $slot
+inline string prefixText(const PrefixProgram &program)
+{
+    ostringstream out;
+    for (size_t i = program.code.size(); i-- > 0;)
+    {
+        const PrefixInstruction &instruction = program.code[i];
+        if (i + 1 != program.code.size())
+            out << ' ';
+        if (instruction.op == PREFIX_CONSTANT)
+        {
+            // Shortest spelling that reads back as the same double
+            char number[32];
+            out.write(number, to_chars(number, number + sizeof number, instruction.value).ptr - number);
+        }
+        else if (instruction.op == PREFIX_VARIABLE)
+            out << '$' << instruction.slot;
+        else
+            out << prefixOpName(instruction.op);
+    }
+    return out.str();
+}
@@ -0,0 +1,172 @@
+// Libraries
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <iomanip>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "DirectoryListing.h"
+
+using namespace std;
+using namespace std::filesystem;
+
+// End-to-end benchmark of FileHandling.cpp.
+// Runs the analyzer binary over each corpus at 1, 2, 4, ... N threads and
+// records wall time, throughput and peak RSS of the child process.
+// Corpora come from CorpusGenerator.cpp.
+//
+// Usage:
+//   AnalysisBenchmark <FileHandling binary> <results.csv> <corpus folder>... [--threads N] [--runs R]
+
+// Structs
+struct BenchmarkRun
+{
+    string corpus;
+    unsigned threads;
+    double seconds;
+    double megabytesPerSecond;
+    long peakRssKb;
+};
+
+// Function Prototypes
+uint64_t corpusBytes(const string &corpusPath);
+bool runAnalyzer(const string &binary, const string &corpus, const string &report, unsigned threads,
+                 double &seconds, long &peakRssKb);
+void writeResults(const vector<BenchmarkRun> &runs, const string &csvPath);
+
+// Main Function
+int main(int argc, char *argv[])
+{
+    try
+    {
+        if (argc < 4)
+        {
+            cout << "Usage: AnalysisBenchmark <FileHandling binary> <results.csv> <corpus folder>..."
+                 << " [--threads N] [--runs R]" << endl;
+            return 1;
+        }
+        const string binary = argv[1];
+        const string csvPath = argv[2];
+        vector<string> corpora;
+        unsigned maxThreads = max(1u, thread::hardware_concurrency());
+        int repetitions = 3;
+        for (int i = 3; i < argc; i++)
+        {
+            string argument = argv[i];
+            if (argument == "--threads" && i + 1 < argc)
+                maxThreads = max(1u, (unsigned)stoul(argv[++i]));
+            else if (argument == "--runs" && i + 1 < argc)
+                repetitions = max(1, stoi(argv[++i]));
+            else
+                corpora.push_back(argument);
+        }
+
+        vector<BenchmarkRun> runs;
+        const string report = temp_directory_path().string() + "/analysis_benchmark_report.txt";
+        cout << left << setw(30) << "Corpus" << right << setw(8) << "Threads" << setw(12) << "Seconds"
+             << setw(12) << "MB/s" << setw(14) << "Peak RSS KB" << endl;
+        for (const string &corpus : corpora)
+        {
+            const double megabytes = corpusBytes(corpus) / (1024.0 * 1024.0);
+            vector<unsigned> threadCounts;
+            for (unsigned t = 1; t < maxThreads; t *= 2)
+                threadCounts.push_back(t);
+            threadCounts.push_back(maxThreads);
+
+            for (unsigned threads : threadCounts)
+            {
+                // Keep the best of several runs; the first run also warms the page cache
+                double best = 0;
+                long rss = 0;
+                for (int r = 0; r < repetitions; r++)
+                {
+                    double seconds;
+                    long peakRssKb;
+                    if (!runAnalyzer(binary, corpus, report, threads, seconds, peakRssKb))
+                    {
+                        cerr << "Analyzer failed on " << corpus << endl;
+                        return 1;
+                    }
+                    if (r == 0 || seconds < best)
+                        best = seconds;
+                    rss = max(rss, peakRssKb);
+                }
+                BenchmarkRun run{corpus, threads, best, best > 0 ? megabytes / best : 0, rss};
+                runs.push_back(run);
+                cout << left << setw(30) << path(corpus).filename().string() << right << setw(8) << threads
+                     << setw(12) << fixed << setprecision(3) << run.seconds << setw(12) << setprecision(1)
+                     << run.megabytesPerSecond << setw(14) << run.peakRssKb << endl;
+            }
+        }
+        writeResults(runs, csvPath);
+        remove(report);
+        remove(report + ".prom");
+        return 0;
+    }
+    catch (exception &e)
+    {
+        cout << "Error occurred: " << e.what() << endl;
+        return 1;
+    }
+}
+
+// Bytes of the files the analyzer itself lists, whatever their extension;
+// compressed files count with their size on disk
+uint64_t corpusBytes(const string &corpusPath)
+{
+    vector<uint64_t> fileSizes;
+    getFileNamesInDirectory(corpusPath, nullptr, &fileSizes);
+    uint64_t total = 0;
+    for (uint64_t size : fileSizes)
+        total += size;
+    return total;
+}
+
+// Run the analyzer in batch mode as a child process; wait4 gives us its peak RSS
+bool runAnalyzer(const string &binary, const string &corpus, const string &report, unsigned threads,
+                 double &seconds, long &peakRssKb)
+{
+    const string threadArgument = to_string(threads);
+    auto start = chrono::steady_clock::now();
+    pid_t child = fork();
+    if (child < 0)
+        return false;
+    if (child == 0)
+    {
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDOUT_FILENO);
+        execl(binary.c_str(), binary.c_str(), corpus.c_str(), report.c_str(), threadArgument.c_str(), (char *)nullptr);
+        _exit(127);
+    }
+    int status = 0;
+    struct rusage usage;
+    if (wait4(child, &status, 0, &usage) < 0)
+        return false;
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    peakRssKb = usage.ru_maxrss;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+void writeResults(const vector<BenchmarkRun> &runs, const string &csvPath)
+{
+    ofstream fileOutput(csvPath, ios::out);
+    if (!fileOutput)
+    {
+        cerr << "Results file could not be created!" << endl;
+        return;
+    }
+    fileOutput << "corpus,threads,seconds,mb_per_second,peak_rss_kb" << endl;
+    for (const BenchmarkRun &run : runs)
+    {
+        fileOutput << run.corpus << "," << run.threads << "," << run.seconds << ","
+                   << run.megabytesPerSecond << "," << run.peakRssKb << endl;
+    }
+    cout << "Results written to: " << csvPath << endl;
+}
@@ -0,0 +1,218 @@
+// AnalysisMetrics.h
+// Per-file and per-phase timing for the file analysis in FileHandling.cpp.
+//
+// Every worker owns one AnalysisMetrics and records into it without locking.
+// The worker metrics are merged once at the end of the run and exported as a
+// Prometheus text file plus a short summary table.
+//
+// Build with -DFILE_ANALYSIS_METRICS=0 to compile the instrumentation out:
+// the timers turn into empty statements and the exporters do nothing.
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#ifndef FILE_ANALYSIS_METRICS
+#define FILE_ANALYSIS_METRICS 1
+#endif
+
+using namespace std;
+
+// Phases of the analysis of a single file, in the order they run
+enum AnalysisPhase
+{
+    PHASE_OPEN,
+    PHASE_READ,
+    PHASE_DECOMPRESS,
+    PHASE_CLASSIFY,
+    PHASE_TOKENIZE,
+    PHASE_COUNT,
+    PHASE_TOPK,
+    PHASE_TOTAL
+};
+
+inline const char *phaseName(int phase)
+{
+    static const char *names[PHASE_TOTAL] = {"open", "read", "decompress", "classify", "tokenize", "count", "topk"};
+    return names[phase];
+}
+
+#if FILE_ANALYSIS_METRICS
+
+// Latency histogram with power-of-two nanosecond buckets.
+// Bucket i holds samples in [2^i, 2^(i+1)) ns, so recording is one bit scan.
+struct LatencyHistogram
+{
+    static const int bucketCount = 48;
+    uint64_t buckets[bucketCount] = {};
+    uint64_t samples = 0;
+    uint64_t totalNanos = 0;
+
+    void record(uint64_t nanos)
+    {
+        int bucket = nanos == 0 ? 0 : 63 - __builtin_clzll(nanos);
+        if (bucket >= bucketCount)
+            bucket = bucketCount - 1;
+        buckets[bucket]++;
+        samples++;
+        totalNanos += nanos;
+    }
+
+    void merge(const LatencyHistogram &other)
+    {
+        for (int i = 0; i < bucketCount; i++)
+            buckets[i] += other.buckets[i];
+        samples += other.samples;
+        totalNanos += other.totalNanos;
+    }
+
+    // Upper bound of the bucket that contains the requested quantile
+    uint64_t percentile(double quantile) const
+    {
+        if (samples == 0)
+            return 0;
+        uint64_t rank = (uint64_t)(quantile * (samples - 1)) + 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < bucketCount; i++)
+        {
+            seen += buckets[i];
+            if (seen >= rank)
+                return (uint64_t)2 << i;
+        }
+        return (uint64_t)2 << (bucketCount - 1);
+    }
+};
+
+struct AnalysisMetrics
+{
+    LatencyHistogram phases[PHASE_TOTAL];
+    LatencyHistogram fileLatency;
+    uint64_t bytesProcessed = 0;
+    uint64_t filesProcessed = 0;
+    double wallSeconds = 0;
+
+    void merge(const AnalysisMetrics &other)
+    {
+        for (int i = 0; i < PHASE_TOTAL; i++)
+            phases[i].merge(other.phases[i]);
+        fileLatency.merge(other.fileLatency);
+        bytesProcessed += other.bytesProcessed;
+        filesProcessed += other.filesProcessed;
+    }
+};
+
+inline uint64_t metricsNow()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(
+               chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Records the time between construction and destruction into a histogram
+class ScopedPhaseTimer
+{
+public:
+    explicit ScopedPhaseTimer(LatencyHistogram &target) : histogram(target), start(metricsNow()) {}
+    ~ScopedPhaseTimer() { histogram.record(metricsNow() - start); }
+
+private:
+    LatencyHistogram &histogram;
+    uint64_t start;
+};
+
+#define METRICS_CONCAT_INNER(a, b) a##b
+#define METRICS_CONCAT(a, b) METRICS_CONCAT_INNER(a, b)
+#define METRICS_TIME_PHASE(metrics, phase) \
+    ScopedPhaseTimer METRICS_CONCAT(phaseTimer, __LINE__)((metrics).phases[phase])
+#define METRICS_TIME_FILE(metrics) \
+    ScopedPhaseTimer METRICS_CONCAT(fileTimer, __LINE__)((metrics).fileLatency)
+#define METRICS_ADD_BYTES(metrics, bytes) ((metrics).bytesProcessed += (bytes), (metrics).filesProcessed++)
+
+inline void writeHistogram(ofstream &out, const string &name, const string &labels, const LatencyHistogram &h)
+{
+    // Every bucket is written, empty or not, so each export has the same le labels
+    string separator = labels.empty() ? "" : ",";
+    uint64_t cumulative = 0;
+    for (int i = 0; i < LatencyHistogram::bucketCount; i++)
+    {
+        cumulative += h.buckets[i];
+        out << name << "_bucket{" << labels << separator << "le=\"" << ((uint64_t)2 << i) * 1e-9 << "\"} "
+            << cumulative << "\n";
+    }
+    out << name << "_bucket{" << labels << separator << "le=\"+Inf\"} " << h.samples << "\n";
+    out << name << "_sum" << (labels.empty() ? "" : "{" + labels + "}") << " " << h.totalNanos * 1e-9 << "\n";
+    out << name << "_count" << (labels.empty() ? "" : "{" + labels + "}") << " " << h.samples << "\n";
+}
+
+// Export the merged metrics in Prometheus text exposition format
+inline void writePrometheusMetrics(const AnalysisMetrics &metrics, const string &path)
+{
+    ofstream out(path, ios::out);
+    if (!out)
+    {
+        cerr << "Metrics file could not be created!" << endl;
+        return;
+    }
+    out << "# HELP file_analysis_files_total Files analyzed.\n";
+    out << "# TYPE file_analysis_files_total counter\n";
+    out << "file_analysis_files_total " << metrics.filesProcessed << "\n";
+    out << "# HELP file_analysis_bytes_total Bytes read from analyzed files.\n";
+    out << "# TYPE file_analysis_bytes_total counter\n";
+    out << "file_analysis_bytes_total " << metrics.bytesProcessed << "\n";
+    out << "# HELP file_analysis_wall_seconds Wall time of the whole analysis.\n";
+    out << "# TYPE file_analysis_wall_seconds gauge\n";
+    out << "file_analysis_wall_seconds " << metrics.wallSeconds << "\n";
+    out << "# HELP file_analysis_phase_seconds Time spent per file in each analysis phase.\n";
+    out << "# TYPE file_analysis_phase_seconds histogram\n";
+    for (int i = 0; i < PHASE_TOTAL; i++)
+        writeHistogram(out, "file_analysis_phase_seconds", string("phase=\"") + phaseName(i) + "\"", metrics.phases[i]);
+    out << "# HELP file_analysis_file_seconds Total time spent per file.\n";
+    out << "# TYPE file_analysis_file_seconds histogram\n";
+    writeHistogram(out, "file_analysis_file_seconds", "", metrics.fileLatency);
+}
+
+inline void printMetricsSummary(const AnalysisMetrics &metrics, ostream &out)
+{
+    double megabytes = metrics.bytesProcessed / (1024.0 * 1024.0);
+    out << "Files: " << metrics.filesProcessed << "  Bytes: " << metrics.bytesProcessed
+        << "  Wall: " << fixed << setprecision(3) << metrics.wallSeconds << " s"
+        << "  Throughput: " << (metrics.wallSeconds > 0 ? megabytes / metrics.wallSeconds : 0.0) << " MB/s"
+        << "  p99 file latency: " << metrics.fileLatency.percentile(0.99) / 1000.0 << " us" << endl;
+    out << left << setw(10) << "Phase" << right << setw(14) << "Total (ms)" << setw(12) << "Share"
+        << setw(14) << "p50 (us)" << setw(14) << "p99 (us)" << endl;
+    uint64_t total = 0;
+    for (int i = 0; i < PHASE_TOTAL; i++)
+        total += metrics.phases[i].totalNanos;
+    for (int i = 0; i < PHASE_TOTAL; i++)
+    {
+        const LatencyHistogram &h = metrics.phases[i];
+        out << left << setw(10) << phaseName(i) << right << setw(14) << h.totalNanos / 1e6
+            << setw(11) << (total == 0 ? 0.0 : 100.0 * h.totalNanos / total) << "%"
+            << setw(14) << h.percentile(0.5) / 1000.0 << setw(14) << h.percentile(0.99) / 1000.0 << endl;
+    }
+    out << defaultfloat << setprecision(6);
+}
+
+#else
+
+struct AnalysisMetrics
+{
+    double wallSeconds = 0;
+    void merge(const AnalysisMetrics &) {}
+};
+
+inline uint64_t metricsNow() { return 0; }
+
+// The arguments are still named, so a metrics parameter is not left unused
+#define METRICS_TIME_PHASE(metrics, phase) ((void)(metrics))
+#define METRICS_TIME_FILE(metrics) ((void)(metrics))
+#define METRICS_ADD_BYTES(metrics, bytes) ((void)(metrics), (void)(bytes))
+
+inline void writePrometheusMetrics(const AnalysisMetrics &, const string &) {}
+inline void printMetricsSummary(const AnalysisMetrics &, ostream &) {}
+
+#endif
@@ -0,0 +1,130 @@
+// AnalysisProgress.h
+// Progress line and Ctrl+C handling for long analyses in FileHandling.cpp.
+//
+// Workers only bump two relaxed atomic counters per file. The report writer
+// thread, which polls anyway, calls tick() and redraws the line on stderr at
+// most a few times a second: in place on a terminal, as separate lines when
+// stderr is redirected.
+//
+// The first SIGINT only sets a flag: workers finish the files they are on and
+// stop claiming new ones. A second SIGINT terminates as usual.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+inline volatile sig_atomic_t &analysisCancelFlag()
+{
+    static volatile sig_atomic_t cancelled = 0;
+    return cancelled;
+}
+
+inline bool analysisCancelled() { return analysisCancelFlag() != 0; }
+
+extern "C" inline void onAnalysisInterrupt(int)
+{
+    analysisCancelFlag() = 1;
+    signal(SIGINT, SIG_DFL);
+}
+
+inline void installCancelHandler()
+{
+    analysisCancelFlag() = 0;
+    signal(SIGINT, onAnalysisInterrupt);
+}
+
+inline void removeCancelHandler() { signal(SIGINT, SIG_DFL); }
+
+class AnalysisProgress
+{
+public:
+    AnalysisProgress() : start(chrono::steady_clock::now()), lastPrint(start)
+    {
+#ifdef _WIN32
+        terminal = _isatty(_fileno(stderr)) != 0;
+#else
+        terminal = isatty(fileno(stderr)) != 0;
+#endif
+    }
+
+    void setTotals(uint64_t files, uint64_t bytes)
+    {
+        totalFiles = files;
+        totalBytes = bytes;
+    }
+
+    // Any thread
+    void fileDone(uint64_t bytes)
+    {
+        filesDone.fetch_add(1, memory_order_relaxed);
+        bytesDone.fetch_add(bytes, memory_order_relaxed);
+    }
+
+    // One thread only
+    void tick()
+    {
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        if (now - lastPrint < (terminal ? chrono::milliseconds(250) : chrono::milliseconds(2000)))
+            return;
+        lastPrint = now;
+        print(now, false);
+    }
+
+    void finish()
+    {
+        if (totalFiles > 0)
+            print(chrono::steady_clock::now(), true);
+    }
+
+private:
+    void print(chrono::steady_clock::time_point now, bool last)
+    {
+        uint64_t files = filesDone.load(memory_order_relaxed);
+        uint64_t bytes = bytesDone.load(memory_order_relaxed);
+        double seconds = chrono::duration<double>(now - start).count();
+        double bytesPerSecond = seconds > 0 ? bytes / seconds : 0;
+        ostringstream line;
+        line << fixed << setprecision(1) << files << "/" << totalFiles << " files  "
+             << (seconds > 0 ? files / seconds : 0.0) << " files/s  "
+             << bytesPerSecond / (1024.0 * 1024.0) << " MB/s  ETA ";
+        if (bytes >= totalBytes)
+            line << "0s";
+        else if (bytesPerSecond <= 0)
+            line << "?";
+        else
+        {
+            uint64_t eta = (uint64_t)((totalBytes - bytes) / bytesPerSecond);
+            if (eta >= 3600)
+                line << eta / 3600 << "h";
+            if (eta >= 60)
+                line << (eta / 60) % 60 << "m";
+            line << eta % 60 << "s";
+        }
+        if (terminal)
+            cerr << "\r" << line.str() << "\033[K" << (last ? "\n" : "") << flush;
+        else
+            cerr << line.str() << "\n";
+    }
+
+    atomic<uint64_t> filesDone{0};
+    atomic<uint64_t> bytesDone{0};
+    uint64_t totalFiles = 0;
+    uint64_t totalBytes = 0;
+    chrono::steady_clock::time_point start;
+    chrono::steady_clock::time_point lastPrint;
+    bool terminal;
+};
@@ -0,0 +1,120 @@
+// CompactStrings.h
+// Interned strings for the file analysis in FileHandling.cpp, so a run over
+// millions of files does not allocate a string per file name and per top word.
+//
+// PathArena keeps every file name of a run in one buffer; a name is referred
+// to by its 32-bit offset. WordDictionary maps each distinct top word to a
+// 32-bit id shared by all files and threads. It is split into stripes with
+// their own lock, so workers interning words rarely wait for each other.
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+class PathArena
+{
+public:
+    // Names are stored NUL-terminated, one after another
+    uint32_t add(string_view name)
+    {
+        if (text.size() + name.size() + 1 > UINT32_MAX)
+            throw runtime_error("Too many file names for the path arena");
+        uint32_t offset = (uint32_t)text.size();
+        text.append(name.data(), name.size());
+        text += '\0';
+        offsets.push_back(offset);
+        return offset;
+    }
+
+    size_t size() const { return offsets.size(); }
+    uint32_t offset(size_t index) const { return offsets[index]; }
+    const char *at(uint32_t offset) const { return text.data() + offset; }
+    const char *operator[](size_t index) const { return at(offsets[index]); }
+
+private:
+    string text;
+    vector<uint32_t> offsets;
+};
+
+class WordDictionary
+{
+public:
+    WordDictionary() : stripes(new Stripe[stripeCount]) {}
+    WordDictionary(const WordDictionary &) = delete;
+    WordDictionary &operator=(const WordDictionary &) = delete;
+
+    // Any thread; the low bits of an id name its stripe
+    uint32_t intern(string_view word)
+    {
+        unsigned index = (unsigned)(hash<string_view>()(word) % stripeCount);
+        Stripe &stripe = stripes[index];
+        lock_guard<mutex> guard(stripe.lock);
+        auto found = stripe.ids.find(word);
+        if (found != stripe.ids.end())
+            return found->second;
+        string_view stored = stripe.store(word);
+        uint32_t id = (uint32_t)(stripe.words.size() * stripeCount + index);
+        stripe.words.push_back(stored);
+        stripe.ids.emplace(stored, id);
+        return id;
+    }
+
+    string_view word(uint32_t id) const
+    {
+        const Stripe &stripe = stripes[id % stripeCount];
+        lock_guard<mutex> guard(stripe.lock);
+        return stripe.words[id / stripeCount];
+    }
+
+private:
+    static const unsigned stripeCount = 16;
+    static const size_t blockSize = 64 * 1024;
+
+    // Words are copied into fixed blocks, so the views handed out stay valid
+    struct Stripe
+    {
+        mutable mutex lock;
+        unordered_map<string_view, uint32_t> ids;
+        vector<string_view> words;
+        vector<unique_ptr<char[]>> blocks;
+        char *blockNext = nullptr;
+        size_t blockLeft = 0;
+
+        string_view store(string_view word)
+        {
+            char *target;
+            if (word.size() > blockSize / 4)
+            {
+                // Long words get a block of their own; the current one stays open
+                blocks.emplace_back(new char[word.size()]);
+                target = blocks.back().get();
+            }
+            else
+            {
+                if (word.size() > blockLeft)
+                {
+                    blocks.emplace_back(new char[blockSize]);
+                    blockNext = blocks.back().get();
+                    blockLeft = blockSize;
+                }
+                target = blockNext;
+                blockNext += word.size();
+                blockLeft -= word.size();
+            }
+            memcpy(target, word.data(), word.size());
+            return string_view(target, word.size());
+        }
+    };
+
+    unique_ptr<Stripe[]> stripes;
+};
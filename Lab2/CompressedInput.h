@@ -0,0 +1,193 @@
+// CompressedInput.h
+// Transparent decompression of .gz and .zst files for FileHandling.cpp.
+//
+// Support is opt-in because it needs the system libraries at link time:
+//   g++ ... -DFILE_ANALYSIS_ZLIB -lz      for .gz
+//   g++ ... -DFILE_ANALYSIS_ZSTD -lzstd   for .zst
+// Without them compressed files are not listed for analysis at all.
+//
+// BoundedQueue hands decompressed files from the decompression threads to the
+// analysis workers; its capacity bounds how much decompressed text is in memory.
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+
+#ifdef FILE_ANALYSIS_ZLIB
+#include <zlib.h>
+#endif
+#ifdef FILE_ANALYSIS_ZSTD
+#include <fstream>
+#include <vector>
+#include <zstd.h>
+#endif
+
+using namespace std;
+
+inline bool hasSuffix(const string &text, const string &suffix)
+{
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+inline bool isCompressedName(const string &name)
+{
+#ifdef FILE_ANALYSIS_ZLIB
+    if (hasSuffix(name, ".gz"))
+        return true;
+#endif
+#ifdef FILE_ANALYSIS_ZSTD
+    if (hasSuffix(name, ".zst"))
+        return true;
+#endif
+    (void)name;
+    return false;
+}
+
+// Decompress a whole file into content; compressedBytes receives the on-disk size
+inline bool readCompressedFile(const string &path, string &content, size_t &compressedBytes)
+{
+    const size_t chunkSize = 256 * 1024;
+    content.clear();
+    compressedBytes = 0;
+#ifdef FILE_ANALYSIS_ZLIB
+    if (hasSuffix(path, ".gz"))
+    {
+        gzFile file = gzopen(path.c_str(), "rb");
+        if (!file)
+            return false;
+        gzbuffer(file, chunkSize);
+        bool ok = true;
+        for (;;)
+        {
+            size_t used = content.size();
+            content.resize(used + chunkSize);
+            int count = gzread(file, &content[used], chunkSize);
+            if (count <= 0)
+            {
+                content.resize(used);
+                // A stream cut short also ends in 0; gzerror tells it from a clean end
+                int error = Z_OK;
+                gzerror(file, &error);
+                ok = count == 0 && error == Z_OK;
+                break;
+            }
+            content.resize(used + count);
+        }
+        compressedBytes = (size_t)gzoffset(file);
+        // gzclose reports a truncated stream (Z_BUF_ERROR) or a bad CRC (Z_DATA_ERROR)
+        if (gzclose(file) != Z_OK)
+            ok = false;
+        return ok;
+    }
+#endif
+#ifdef FILE_ANALYSIS_ZSTD
+    if (hasSuffix(path, ".zst"))
+    {
+        ifstream fileRead(path, ios::in | ios::binary);
+        if (!fileRead)
+            return false;
+        ZSTD_DStream *stream = ZSTD_createDStream();
+        ZSTD_initDStream(stream);
+        vector<char> input(ZSTD_DStreamInSize());
+        const size_t outputChunk = ZSTD_DStreamOutSize();
+        // 0 once a frame is complete; anything else at the end of the file means it was cut short
+        size_t result = 0;
+        bool ok = true;
+        for (bool atEnd = false; ok && !atEnd;)
+        {
+            fileRead.read(input.data(), input.size());
+            size_t count = (size_t)fileRead.gcount();
+            atEnd = count == 0;
+            if (atEnd && result == 0)
+                break;
+            ZSTD_inBuffer in = {input.data(), count, 0};
+            compressedBytes += count;
+            // A full output buffer may leave decoded bytes inside the stream even
+            // once the input is used up; at the end of the file the empty input
+            // flushes them until the frame is complete or nothing more comes out
+            for (;;)
+            {
+                size_t used = content.size();
+                content.resize(used + outputChunk);
+                ZSTD_outBuffer out = {&content[used], outputChunk, 0};
+                result = ZSTD_decompressStream(stream, &out, &in);
+                content.resize(used + out.pos);
+                if (ZSTD_isError(result))
+                {
+                    ok = false;
+                    break;
+                }
+                if (in.pos < in.size)
+                    continue;
+                if (result == 0 || (out.pos < out.size && (!atEnd || out.pos == 0)))
+                    break;
+            }
+        }
+        ZSTD_freeDStream(stream);
+        return ok && result == 0;
+    }
+#endif
+    (void)path;
+    (void)chunkSize;
+    return false;
+}
+
+// Fixed-capacity blocking queue; close() wakes every waiting consumer
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t limit) : capacity(limit == 0 ? 1 : limit) {}
+
+    void push(T item)
+    {
+        unique_lock<mutex> guard(lock);
+        notFull.wait(guard, [&]
+                     { return items.size() < capacity; });
+        items.push_back(move(item));
+        notEmpty.notify_one();
+    }
+
+    // Non-blocking; returns false if nothing is ready yet
+    bool tryPop(T &item)
+    {
+        lock_guard<mutex> guard(lock);
+        if (items.empty())
+            return false;
+        item = move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    // Blocks until an item arrives; returns false once closed and drained
+    bool pop(T &item)
+    {
+        unique_lock<mutex> guard(lock);
+        notEmpty.wait(guard, [&]
+                      { return !items.empty() || closed; });
+        if (items.empty())
+            return false;
+        item = move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        lock_guard<mutex> guard(lock);
+        closed = true;
+        notEmpty.notify_all();
+    }
+
+private:
+    size_t capacity;
+    deque<T> items;
+    bool closed = false;
+    mutex lock;
+    condition_variable notEmpty;
+    condition_variable notFull;
+};
@@ -0,0 +1,638 @@
+// ContentSearch.h
+// Matchers for the search mode of FileHandling.cpp.
+//
+//   LiteralMatcher       one literal; SSE2 first/last byte prefilter, then memcmp
+//   MultiLiteralMatcher  several literals at once with an Aho-Corasick automaton
+//   RegexMatcher         regular expressions with a lazily built DFA
+//
+// Every matcher reports each occurrence as (byte offset, byte length), in
+// increasing offset order, so callers can count lines as they go.
+// RegexMatcher builds its DFA while scanning, so each thread needs its own
+// matcher; makeMatcher is cheap enough to call once per worker.
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+typedef function<void(size_t offset, size_t length)> HitCallback;
+
+class ContentMatcher
+{
+public:
+    virtual ~ContentMatcher() {}
+    virtual void findAll(const char *data, size_t size, const HitCallback &onHit) const = 0;
+};
+
+class LiteralMatcher : public ContentMatcher
+{
+public:
+    explicit LiteralMatcher(const string &literal) : needle(literal)
+    {
+        if (needle.empty())
+            throw invalid_argument("Search pattern must not be empty");
+    }
+
+    void findAll(const char *data, size_t size, const HitCallback &onHit) const override
+    {
+        const size_t m = needle.size();
+        if (size < m)
+            return;
+        if (m == 1)
+        {
+            for (const char *p = data; (p = (const char *)memchr(p, needle[0], data + size - p)) != nullptr; p++)
+                onHit(p - data, 1);
+            return;
+        }
+        size_t i = 0;
+#ifdef __SSE2__
+        // Candidates are positions where both the first and the last byte match;
+        // only those are verified with memcmp
+        const __m128i first = _mm_set1_epi8(needle[0]);
+        const __m128i last = _mm_set1_epi8(needle[m - 1]);
+        for (; i + 16 + m - 1 <= size; i += 16)
+        {
+            __m128i blockFirst = _mm_loadu_si128((const __m128i *)(data + i));
+            __m128i blockLast = _mm_loadu_si128((const __m128i *)(data + i + m - 1));
+            unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, blockFirst),
+                                                            _mm_cmpeq_epi8(last, blockLast)));
+            while (mask != 0)
+            {
+                unsigned bit = __builtin_ctz(mask);
+                if (memcmp(data + i + bit + 1, needle.data() + 1, m - 2) == 0)
+                    onHit(i + bit, m);
+                mask &= mask - 1;
+            }
+        }
+#endif
+        for (; i + m <= size; i++)
+        {
+            if (data[i] == needle[0] && memcmp(data + i, needle.data(), m) == 0)
+                onHit(i, m);
+        }
+    }
+
+private:
+    string needle;
+};
+
+class MultiLiteralMatcher : public ContentMatcher
+{
+public:
+    explicit MultiLiteralMatcher(const vector<string> &literals)
+    {
+        addState();
+        for (size_t id = 0; id < literals.size(); id++)
+        {
+            if (literals[id].empty())
+                throw invalid_argument("Search pattern must not be empty");
+            int state = 0;
+            for (unsigned char c : literals[id])
+            {
+                if (next[state][c] < 0)
+                {
+                    int child = addState();
+                    next[state][c] = child;
+                }
+                state = next[state][c];
+            }
+            patternLength[state] = literals[id].size();
+            maxLength = max(maxLength, literals[id].size());
+        }
+
+        // Breadth-first pass: failure links, output links, and the missing
+        // transitions filled in so scanning is a single table lookup per byte
+        vector<int> queue;
+        for (int c = 0; c < 256; c++)
+        {
+            if (next[0][c] < 0)
+                next[0][c] = 0;
+            else
+                queue.push_back(next[0][c]);
+        }
+        for (size_t head = 0; head < queue.size(); head++)
+        {
+            int state = queue[head];
+            int failure = fail[state];
+            outputLink[state] = patternLength[failure] > 0 ? failure : outputLink[failure];
+            for (int c = 0; c < 256; c++)
+            {
+                int child = next[state][c];
+                if (child < 0)
+                {
+                    next[state][c] = next[failure][c];
+                    continue;
+                }
+                fail[child] = next[failure][c];
+                queue.push_back(child);
+            }
+        }
+    }
+
+    // The automaton finds matches where they end, so a short pattern inside a
+    // long one (b in abc) is found before the long one starts. Hits wait in a
+    // heap until no later match can start before them.
+    void findAll(const char *data, size_t size, const HitCallback &onHit) const override
+    {
+        typedef pair<size_t, size_t> Hit;
+        priority_queue<Hit, vector<Hit>, greater<Hit>> pending;
+        int state = 0;
+        for (size_t i = 0; i < size; i++)
+        {
+            state = next[state][(unsigned char)data[i]];
+            for (int s = state; s > 0; s = outputLink[s])
+            {
+                if (patternLength[s] > 0)
+                    pending.emplace(i + 1 - patternLength[s], patternLength[s]);
+            }
+            // Matches ending after i start at i + 2 - maxLength or later
+            while (!pending.empty() && pending.top().first + maxLength <= i + 1)
+            {
+                onHit(pending.top().first, pending.top().second);
+                pending.pop();
+            }
+        }
+        while (!pending.empty())
+        {
+            onHit(pending.top().first, pending.top().second);
+            pending.pop();
+        }
+    }
+
+private:
+    vector<array<int, 256>> next;
+    vector<int> fail;
+    vector<int> outputLink;
+    vector<size_t> patternLength;
+    size_t maxLength = 0;
+
+    int addState()
+    {
+        array<int, 256> row;
+        row.fill(-1);
+        next.push_back(row);
+        fail.push_back(0);
+        outputLink.push_back(0);
+        patternLength.push_back(0);
+        return (int)next.size() - 1;
+    }
+};
+
+// Supported syntax: literals, '.', [a-z] and [^...] classes, \d \w \s and
+// escaped metacharacters, grouping, '|', '*', '+', '?', and '^' / '$' at the
+// ends of the pattern. The anchors apply to the whole pattern, so an anchored
+// pattern must keep any '|' inside parentheses. Matching is per line, like
+// grep, and as with grep -o empty matches are only reported by ^$.
+//
+// A line is first tested with the unanchored DFA. On a matching line a second
+// NFA, built from the pattern read backwards, is run once from the line end to
+// mark every position where a match starts; the anchored DFA then runs only
+// from those rather than from every byte of the line.
+class RegexMatcher : public ContentMatcher
+{
+public:
+    explicit RegexMatcher(const string &expression) : pattern(expression)
+    {
+        size_t begin = 0, end = pattern.size();
+        if (begin < end && pattern[begin] == '^')
+        {
+            anchorStart = true;
+            begin++;
+        }
+        if (end > begin && pattern[end - 1] == '$' && (end < 2 || pattern[end - 2] != '\\'))
+        {
+            anchorEnd = true;
+            end--;
+        }
+        pattern = pattern.substr(begin, end - begin);
+        position = 0;
+        Fragment whole = parseAlternation();
+        if (position != pattern.size())
+            throw invalid_argument("Unbalanced ')' in regular expression");
+        if ((anchorStart || anchorEnd) && topLevelAlternation)
+            throw invalid_argument("'^' and '$' apply to the whole expression; put the alternatives in parentheses");
+        reversed = true;
+        position = 0;
+        Fragment backwards = parseAlternation();
+        searchDfa.nfaStart = anchoredDfa.nfaStart = whole.start;
+        searchDfa.nfaMatch = anchoredDfa.nfaMatch = whole.end;
+        reverseDfa.nfaStart = backwards.start;
+        reverseDfa.nfaMatch = backwards.end;
+        searchDfa.unanchored = true;
+        // Matches may end anywhere unless the pattern ends in '$'
+        reverseDfa.unanchored = !anchorEnd;
+        resetDfa(searchDfa);
+        resetDfa(anchoredDfa);
+        resetDfa(reverseDfa);
+    }
+
+    void findAll(const char *data, size_t size, const HitCallback &onHit) const override
+    {
+        size_t lineStart = 0;
+        while (lineStart <= size)
+        {
+            const char *newline = (const char *)memchr(data + lineStart, '\n', size - lineStart);
+            size_t lineEnd = newline ? newline - data : size;
+            if (lineMatches(data + lineStart, lineEnd - lineStart))
+                reportLineMatches(data + lineStart, lineEnd - lineStart, lineStart, onHit);
+            if (!newline || lineEnd + 1 == size)
+                break;
+            lineStart = lineEnd + 1;
+        }
+    }
+
+private:
+    enum NfaType
+    {
+        NFA_EPSILON,
+        NFA_SPLIT,
+        NFA_CHAR
+    };
+
+    struct NfaState
+    {
+        NfaType type;
+        int out1;
+        int out2;
+        int charClass;
+    };
+
+    struct Fragment
+    {
+        int start;
+        int end;
+    };
+
+    // Lazily built DFA; each state is a set of NFA states
+    struct Dfa
+    {
+        bool unanchored = false;
+        vector<vector<int>> sets;
+        map<vector<int>, int> ids;
+        vector<array<int, 256>> next;
+        vector<char> accepting;
+        vector<char> dead;
+        int start = 0;
+        int nfaStart = 0;
+        int nfaMatch = 0;
+    };
+
+    static const size_t maxDfaStates = 4096;
+
+    string pattern;
+    size_t position = 0;
+    bool anchorStart = false;
+    bool anchorEnd = false;
+    bool reversed = false; // parse with concatenations back to front
+    int depth = 0;
+    bool topLevelAlternation = false;
+    vector<NfaState> nfa;
+    vector<bitset<256>> classes;
+    mutable Dfa searchDfa;
+    mutable Dfa anchoredDfa;
+    mutable Dfa reverseDfa;
+    mutable vector<char> matchStarts;
+
+    // ---------- Parser (Thompson construction) ----------
+    int addNfaState(NfaType type, int out1 = -1, int out2 = -1, int charClass = -1)
+    {
+        nfa.push_back({type, out1, out2, charClass});
+        return (int)nfa.size() - 1;
+    }
+
+    Fragment charFragment(const bitset<256> &set)
+    {
+        classes.push_back(set);
+        int end = addNfaState(NFA_EPSILON);
+        int start = addNfaState(NFA_CHAR, end, -1, (int)classes.size() - 1);
+        return {start, end};
+    }
+
+    Fragment parseAlternation()
+    {
+        Fragment left = parseConcatenation();
+        while (position < pattern.size() && pattern[position] == '|')
+        {
+            topLevelAlternation |= depth == 0;
+            position++;
+            Fragment right = parseConcatenation();
+            int end = addNfaState(NFA_EPSILON);
+            int start = addNfaState(NFA_SPLIT, left.start, right.start);
+            nfa[left.end].out1 = end;
+            nfa[right.end].out1 = end;
+            left = {start, end};
+        }
+        return left;
+    }
+
+    Fragment parseConcatenation()
+    {
+        int empty = addNfaState(NFA_EPSILON);
+        Fragment result = {empty, empty};
+        while (position < pattern.size() && pattern[position] != '|' && pattern[position] != ')')
+        {
+            Fragment next = parseRepetition();
+            if (reversed)
+            {
+                nfa[next.end].out1 = result.start;
+                result.start = next.start;
+            }
+            else
+            {
+                nfa[result.end].out1 = next.start;
+                result.end = next.end;
+            }
+        }
+        return result;
+    }
+
+    Fragment parseRepetition()
+    {
+        Fragment atom = parseAtom();
+        while (position < pattern.size() &&
+               (pattern[position] == '*' || pattern[position] == '+' || pattern[position] == '?'))
+        {
+            char op = pattern[position++];
+            int end = addNfaState(NFA_EPSILON);
+            int split = addNfaState(NFA_SPLIT, atom.start, end);
+            if (op == '?')
+            {
+                nfa[atom.end].out1 = end;
+                atom = {split, end};
+            }
+            else
+            {
+                nfa[atom.end].out1 = split;
+                atom = {op == '*' ? split : atom.start, end};
+            }
+        }
+        return atom;
+    }
+
+    Fragment parseAtom()
+    {
+        if (position >= pattern.size())
+            throw invalid_argument("Regular expression ends unexpectedly");
+        char c = pattern[position++];
+        if (c == '(')
+        {
+            depth++;
+            Fragment inner = parseAlternation();
+            depth--;
+            if (position >= pattern.size() || pattern[position] != ')')
+                throw invalid_argument("Missing ')' in regular expression");
+            position++;
+            return inner;
+        }
+        if (c == '*' || c == '+' || c == '?')
+            throw invalid_argument("Nothing to repeat in regular expression");
+        bitset<256> set;
+        if (c == '.')
+        {
+            set.set();
+            set.reset('\n');
+        }
+        else if (c == '[')
+            set = parseClass();
+        else if (c == '\\')
+            set = parseEscape();
+        else
+            set.set((unsigned char)c);
+        return charFragment(set);
+    }
+
+    bitset<256> parseEscape()
+    {
+        if (position >= pattern.size())
+            throw invalid_argument("Trailing '\\' in regular expression");
+        char c = pattern[position++];
+        bitset<256> set;
+        if (c == 'd' || c == 'w' || c == 's')
+        {
+            for (int b = 0; b < 256; b++)
+            {
+                if ((c == 'd' && isdigit(b)) || (c == 'w' && (isalnum(b) || b == '_')) ||
+                    (c == 's' && isspace(b)))
+                    set.set(b);
+            }
+        }
+        else if (c == 't')
+            set.set('\t');
+        else
+            set.set((unsigned char)c);
+        return set;
+    }
+
+    bitset<256> parseClass()
+    {
+        bitset<256> set;
+        bool negate = position < pattern.size() && pattern[position] == '^';
+        if (negate)
+            position++;
+        bool first = true;
+        while (position < pattern.size() && (pattern[position] != ']' || first))
+        {
+            first = false;
+            unsigned char low = pattern[position++];
+            if (low == '\\')
+            {
+                set |= parseEscape();
+                continue;
+            }
+            unsigned char high = low;
+            if (position + 1 < pattern.size() && pattern[position] == '-' && pattern[position + 1] != ']')
+            {
+                high = pattern[position + 1];
+                position += 2;
+            }
+            for (int b = low; b <= high; b++)
+                set.set(b);
+        }
+        if (position >= pattern.size())
+            throw invalid_argument("Missing ']' in regular expression");
+        position++;
+        if (negate)
+        {
+            set.flip();
+            set.reset('\n');
+        }
+        return set;
+    }
+
+    // ---------- Lazy DFA ----------
+    void closure(vector<int> &states, int nfaMatch) const
+    {
+        vector<int> stack(states.begin(), states.end());
+        vector<char> seen(nfa.size(), 0);
+        states.clear();
+        while (!stack.empty())
+        {
+            int s = stack.back();
+            stack.pop_back();
+            if (s < 0 || seen[s])
+                continue;
+            seen[s] = 1;
+            const NfaState &state = nfa[s];
+            if (state.type == NFA_CHAR || s == nfaMatch)
+                states.push_back(s);
+            if (state.type != NFA_CHAR)
+            {
+                stack.push_back(state.out1);
+                stack.push_back(state.out2);
+            }
+        }
+        sort(states.begin(), states.end());
+    }
+
+    int dfaState(Dfa &dfa, vector<int> &set) const
+    {
+        auto found = dfa.ids.find(set);
+        if (found != dfa.ids.end())
+            return found->second;
+        int id = (int)dfa.sets.size();
+        dfa.ids[set] = id;
+        dfa.sets.push_back(set);
+        array<int, 256> row;
+        row.fill(-1);
+        dfa.next.push_back(row);
+        dfa.accepting.push_back(binary_search(set.begin(), set.end(), dfa.nfaMatch));
+        dfa.dead.push_back(set.empty() && !dfa.unanchored);
+        return id;
+    }
+
+    void resetDfa(Dfa &dfa) const
+    {
+        dfa.sets.clear();
+        dfa.ids.clear();
+        dfa.next.clear();
+        dfa.accepting.clear();
+        dfa.dead.clear();
+        vector<int> start = {dfa.nfaStart};
+        closure(start, dfa.nfaMatch);
+        dfa.start = dfaState(dfa, start);
+    }
+
+    int step(Dfa &dfa, int state, unsigned char byte) const
+    {
+        int cached = dfa.next[state][byte];
+        if (cached >= 0)
+            return cached;
+        if (dfa.sets.size() >= maxDfaStates)
+        {
+            // Cache full: start over, keeping only the state we are in
+            vector<int> current = dfa.sets[state];
+            resetDfa(dfa);
+            state = dfaState(dfa, current);
+        }
+        vector<int> target;
+        for (int s : dfa.sets[state])
+        {
+            if (nfa[s].type == NFA_CHAR && classes[nfa[s].charClass].test(byte))
+                target.push_back(nfa[s].out1);
+        }
+        if (dfa.unanchored)
+            target.push_back(dfa.nfaStart);
+        closure(target, dfa.nfaMatch);
+        int id = dfaState(dfa, target);
+        dfa.next[state][byte] = id;
+        return id;
+    }
+
+    // Fast yes/no test over one line with the unanchored DFA
+    bool lineMatches(const char *line, size_t length) const
+    {
+        Dfa &dfa = anchorStart ? anchoredDfa : searchDfa;
+        int state = dfa.start;
+        if (dfa.accepting[state] && !anchorEnd)
+            return true;
+        for (size_t i = 0; i < length; i++)
+        {
+            state = step(dfa, state, (unsigned char)line[i]);
+            if (dfa.dead[state])
+                return false;
+            if (dfa.accepting[state] && !anchorEnd)
+                return true;
+        }
+        return dfa.accepting[state];
+    }
+
+    // Leftmost-longest matches on a line already known to match
+    void reportLineMatches(const char *line, size_t length, size_t lineOffset, const HitCallback &onHit) const
+    {
+        // Backwards over the line: after reading line[i..] the reverse DFA
+        // accepts exactly when some match starts at i
+        matchStarts.assign(length + 1, 0);
+        int state = reverseDfa.start;
+        matchStarts[length] = reverseDfa.accepting[state];
+        for (size_t i = length; i-- > 0;)
+        {
+            state = step(reverseDfa, state, (unsigned char)line[i]);
+            if (reverseDfa.dead[state])
+                break;
+            matchStarts[i] = reverseDfa.accepting[state];
+        }
+
+        const bool reportEmpty = anchorStart && anchorEnd;
+        size_t start = 0;
+        const size_t lastStart = anchorStart ? 0 : length;
+        while (start <= lastStart)
+        {
+            const char *next = (const char *)memchr(matchStarts.data() + start, 1, lastStart + 1 - start);
+            if (next == nullptr)
+                break;
+            start = next - matchStarts.data();
+            state = anchoredDfa.start;
+            long longest = anchoredDfa.accepting[state] && (!anchorEnd || start == length) ? 0 : -1;
+            for (size_t i = start; i < length; i++)
+            {
+                state = step(anchoredDfa, state, (unsigned char)line[i]);
+                if (anchoredDfa.dead[state])
+                    break;
+                if (anchoredDfa.accepting[state] && (!anchorEnd || i + 1 == length))
+                    longest = (long)(i + 1 - start);
+            }
+            if (longest > 0 || (longest == 0 && reportEmpty))
+                onHit(lineOffset + start, (size_t)longest);
+            start += longest > 0 ? (size_t)longest : 1;
+        }
+    }
+};
+
+inline unique_ptr<ContentMatcher> makeMatcher(const vector<string> &patterns, bool useRegex)
+{
+    if (patterns.empty())
+        throw invalid_argument("No search pattern given");
+    if (useRegex)
+    {
+        // Several expressions are searched as one alternation. Anchors are
+        // taken from the ends of the whole pattern only, so they cannot apply
+        // to one alternative of it.
+        for (size_t i = 0; i < patterns.size() && patterns.size() > 1; i++)
+        {
+            const string &p = patterns[i];
+            if (!p.empty() && (p[0] == '^' || (p.back() == '$' && (p.size() < 2 || p[p.size() - 2] != '\\'))))
+                throw invalid_argument("'^' and '$' need a single regular expression: " + p);
+        }
+        string combined;
+        for (size_t i = 0; i < patterns.size(); i++)
+            combined += (i ? "|(" : "(") + patterns[i] + ")";
+        return unique_ptr<ContentMatcher>(new RegexMatcher(patterns.size() == 1 ? patterns[0] : combined));
+    }
+    if (patterns.size() == 1)
+        return unique_ptr<ContentMatcher>(new LiteralMatcher(patterns[0]));
+    return unique_ptr<ContentMatcher>(new MultiLiteralMatcher(patterns));
+}
@@ -0,0 +1,166 @@
+// ContentSniffer.h
+// Decides whether a file is text by looking only at its first 4 KB, so
+// .log, .md, .csv and extensionless files are analyzed and binaries are
+// skipped without reading them in full.
+//
+// A file is text when its sample has no NUL byte and is valid UTF-8 (a
+// sequence cut off by the end of a truncated sample is allowed). Both checks
+// run 16 bytes at a time with SSE2 over the ASCII parts of the sample and
+// only fall back to a byte-by-byte UTF-8 decoder around non-ASCII bytes.
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "CompressedInput.h"
+
+using namespace std;
+
+enum SniffResult
+{
+    SNIFF_TEXT,
+    SNIFF_COMPRESSED,
+    SNIFF_NUL_BYTES,
+    SNIFF_INVALID_UTF8,
+    SNIFF_UNSUPPORTED_COMPRESSION,
+    SNIFF_UNREADABLE,
+    SNIFF_RESULT_COUNT
+};
+
+inline const char *sniffResultName(int result)
+{
+    static const char *names[SNIFF_RESULT_COUNT] = {
+        "text", "compressed", "binary (NUL bytes)", "invalid UTF-8", "compressed (format not supported by this build)", "unreadable"};
+    return names[result];
+}
+
+const size_t sniffSampleSize = 4096;
+
+// Counts of accepted and rejected files by reason
+struct SniffSummary
+{
+    size_t counts[SNIFF_RESULT_COUNT] = {};
+
+    size_t accepted() const { return counts[SNIFF_TEXT] + counts[SNIFF_COMPRESSED]; }
+
+    size_t rejected() const
+    {
+        size_t total = 0;
+        for (int i = SNIFF_NUL_BYTES; i < SNIFF_RESULT_COUNT; i++)
+            total += counts[i];
+        return total;
+    }
+};
+
+inline bool sampleHasNul(const unsigned char *data, size_t size)
+{
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i *)(data + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(block, zero)) != 0)
+            return true;
+    }
+#endif
+    return memchr(data + i, 0, size - i) != nullptr;
+}
+
+// Validates one multi-byte sequence starting at data[i]; returns its length,
+// 0 if it is invalid, or size - i if the sample ends in the middle of it
+inline size_t utf8SequenceLength(const unsigned char *data, size_t i, size_t size, bool truncated)
+{
+    unsigned char lead = data[i];
+    size_t length;
+    unsigned char low = 0x80, high = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF)
+        length = 2;
+    else if (lead >= 0xE0 && lead <= 0xEF)
+    {
+        length = 3;
+        if (lead == 0xE0)
+            low = 0xA0; // overlong
+        if (lead == 0xED)
+            high = 0x9F; // surrogates
+    }
+    else if (lead >= 0xF0 && lead <= 0xF4)
+    {
+        length = 4;
+        if (lead == 0xF0)
+            low = 0x90; // overlong
+        if (lead == 0xF4)
+            high = 0x8F; // above U+10FFFF
+    }
+    else
+        return 0;
+
+    for (size_t k = 1; k < length; k++)
+    {
+        if (i + k >= size)
+            return truncated ? size - i : 0;
+        unsigned char c = data[i + k];
+        if (k == 1 ? (c < low || c > high) : (c < 0x80 || c > 0xBF))
+            return 0;
+    }
+    return length;
+}
+
+inline bool sampleIsUtf8(const unsigned char *data, size_t size, bool truncated)
+{
+    size_t i = 0;
+    while (i < size)
+    {
+#ifdef __SSE2__
+        // Skip whole blocks of ASCII: the high bit of every byte is clear
+        while (i + 16 <= size && _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(data + i))) == 0)
+            i += 16;
+#endif
+        if (i >= size)
+            break;
+        if (data[i] < 0x80)
+        {
+            i++;
+            continue;
+        }
+        size_t length = utf8SequenceLength(data, i, size, truncated);
+        if (length == 0)
+            return false;
+        i += length;
+    }
+    return true;
+}
+
+inline SniffResult sniffSample(const unsigned char *data, size_t size, bool truncated)
+{
+    if (sampleHasNul(data, size))
+        return SNIFF_NUL_BYTES;
+    if (!sampleIsUtf8(data, size, truncated))
+        return SNIFF_INVALID_UTF8;
+    return SNIFF_TEXT;
+}
+
+inline SniffResult sniffFile(const string &path, const string &name)
+{
+    ifstream fileRead(path, ios::in | ios::binary);
+    if (!fileRead)
+        return SNIFF_UNREADABLE;
+    unsigned char sample[sniffSampleSize + 1];
+    fileRead.read((char *)sample, sniffSampleSize + 1);
+    size_t size = (size_t)fileRead.gcount();
+    bool truncated = size > sniffSampleSize;
+    if (truncated)
+        size = sniffSampleSize;
+
+    bool gzipMagic = size >= 2 && sample[0] == 0x1F && sample[1] == 0x8B;
+    bool zstdMagic = size >= 4 && sample[0] == 0x28 && sample[1] == 0xB5 && sample[2] == 0x2F && sample[3] == 0xFD;
+    if (gzipMagic || zstdMagic)
+        return isCompressedName(name) ? SNIFF_COMPRESSED : SNIFF_UNSUPPORTED_COMPRESSION;
+    return sniffSample(sample, size, truncated);
+}
@@ -0,0 +1,247 @@
+// Libraries
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+using namespace std::filesystem;
+
+// Deterministic synthetic corpus for FileHandling.cpp.
+// The same options and seed always produce the same files with the same C
+// math library, because the generator uses its own RNG and distributions
+// instead of the implementation-defined ones in <random>. The lognormal file
+// sizes, the Zipf table and the word lengths still go through log, cos, exp
+// and pow, whose last bits may differ between libms, so another platform can
+// give slightly different files.
+//
+// Usage:
+//   CorpusGenerator <output folder> [option=value ...]
+// Options (defaults in brackets):
+//   files=N          number of files [100]
+//   size=BYTES       mean file size [65536]
+//   dist=NAME        file size distribution: fixed, uniform or lognormal [lognormal]
+//   sigma=X          spread of the lognormal distribution [1.0]
+//   vocab=N          vocabulary size [50000]
+//   zipf=S           Zipf exponent of word frequencies [1.1]
+//   line=N           mean line length in bytes [72]
+//   utf8=P           share of words containing non-ASCII UTF-8 letters [0.05]
+//   seed=N           RNG seed [1]
+
+// Structs
+struct CorpusOptions
+{
+    size_t fileCount = 100;
+    size_t meanSize = 65536;
+    string sizeDistribution = "lognormal";
+    double sigma = 1.0;
+    size_t vocabularySize = 50000;
+    double zipfExponent = 1.1;
+    size_t lineLength = 72;
+    double utf8Share = 0.05;
+    uint64_t seed = 1;
+};
+
+// SplitMix64: tiny, fast and identical everywhere
+struct CorpusRandom
+{
+    uint64_t state;
+
+    explicit CorpusRandom(uint64_t seed) : state(seed) {}
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform double in [0, 1)
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+    // Standard normal via Box-Muller
+    double normal()
+    {
+        double u1 = uniform(), u2 = uniform();
+        if (u1 < 1e-300)
+            u1 = 1e-300;
+        return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+    }
+};
+
+// Function Prototypes
+bool parseOptions(int argc, char *argv[], CorpusOptions &options);
+vector<string> buildVocabulary(const CorpusOptions &options, CorpusRandom &random);
+vector<double> buildZipfTable(size_t vocabularySize, double exponent);
+size_t pickFileSize(const CorpusOptions &options, CorpusRandom &random);
+size_t writeCorpusFile(const string &path, size_t targetSize, const CorpusOptions &options,
+                       const vector<string> &vocabulary, const vector<double> &zipf, CorpusRandom &random);
+
+// Main Function
+int main(int argc, char *argv[])
+{
+    try
+    {
+        CorpusOptions options;
+        if (argc < 2 || !parseOptions(argc, argv, options))
+        {
+            cout << "Usage: CorpusGenerator <output folder> [files=N] [size=BYTES] [dist=fixed|uniform|lognormal]"
+                 << " [sigma=X] [vocab=N] [zipf=S] [line=N] [utf8=P] [seed=N]" << endl;
+            return 1;
+        }
+        const string outputPath = argv[1];
+        create_directories(outputPath);
+
+        CorpusRandom random(options.seed);
+        const vector<string> vocabulary = buildVocabulary(options, random);
+        const vector<double> zipf = buildZipfTable(vocabulary.size(), options.zipfExponent);
+
+        size_t totalBytes = 0;
+        for (size_t i = 0; i < options.fileCount; i++)
+        {
+            // Every file gets its own stream so file i does not depend on the sizes of earlier files
+            CorpusRandom fileRandom(options.seed * 1000003 + i);
+            size_t size = pickFileSize(options, fileRandom);
+            string name = "file" + to_string(i) + ".txt";
+            totalBytes += writeCorpusFile(outputPath + "/" + name, size, options, vocabulary, zipf, fileRandom);
+        }
+        cout << "Generated " << options.fileCount << " files, " << totalBytes << " bytes, in " << outputPath << endl;
+        return 0;
+    }
+    catch (exception &e)
+    {
+        cout << "Error occurred: " << e.what() << endl;
+        return 1;
+    }
+}
+
+bool parseOptions(int argc, char *argv[], CorpusOptions &options)
+{
+    for (int i = 2; i < argc; i++)
+    {
+        string argument = argv[i];
+        size_t equals = argument.find('=');
+        if (equals == string::npos)
+            return false;
+        string key = argument.substr(0, equals);
+        string value = argument.substr(equals + 1);
+        if (key == "files")
+            options.fileCount = stoul(value);
+        else if (key == "size")
+            options.meanSize = stoul(value);
+        else if (key == "dist")
+            options.sizeDistribution = value;
+        else if (key == "sigma")
+            options.sigma = stod(value);
+        else if (key == "vocab")
+            options.vocabularySize = max<size_t>(1, stoul(value));
+        else if (key == "zipf")
+            options.zipfExponent = stod(value);
+        else if (key == "line")
+            options.lineLength = max<size_t>(8, stoul(value));
+        else if (key == "utf8")
+            options.utf8Share = stod(value);
+        else if (key == "seed")
+            options.seed = stoull(value);
+        else
+            return false;
+    }
+    return options.sizeDistribution == "fixed" || options.sizeDistribution == "uniform" ||
+           options.sizeDistribution == "lognormal";
+}
+
+// Pronounceable pseudo-words; a share of them carry a multi-byte UTF-8 letter
+vector<string> buildVocabulary(const CorpusOptions &options, CorpusRandom &random)
+{
+    static const char *consonants = "bcdfghjklmnprstvwz";
+    static const char *vowels = "aeiou";
+    static const char *wideLetters[] = {"\xC3\xA9", "\xC3\xBC", "\xC3\xB1", "\xD0\xB6", "\xCE\xBB", "\xE4\xB8\xAD"};
+
+    vector<string> vocabulary;
+    vocabulary.reserve(options.vocabularySize);
+    for (size_t i = 0; i < options.vocabularySize; i++)
+    {
+        // Frequent words are short, like in natural text
+        size_t syllables = 1 + (size_t)log2(2.0 + i) / 4 + random.next() % 2;
+        string word;
+        for (size_t s = 0; s < syllables; s++)
+        {
+            word += consonants[random.next() % 18];
+            word += vowels[random.next() % 5];
+        }
+        if (random.uniform() < options.utf8Share)
+            word.insert(random.next() % (word.size() + 1), wideLetters[random.next() % 6]);
+        // Suffix with the rank in base 26 so every word is unique
+        for (size_t rank = i; rank > 0; rank /= 26)
+            word += (char)('a' + rank % 26);
+        vocabulary.push_back(word);
+    }
+    return vocabulary;
+}
+
+// Cumulative distribution of word ranks: P(rank k) ~ 1 / k^s
+vector<double> buildZipfTable(size_t vocabularySize, double exponent)
+{
+    vector<double> cumulative(vocabularySize);
+    double sum = 0;
+    for (size_t k = 0; k < vocabularySize; k++)
+    {
+        sum += 1.0 / pow((double)(k + 1), exponent);
+        cumulative[k] = sum;
+    }
+    for (double &value : cumulative)
+        value /= sum;
+    return cumulative;
+}
+
+size_t pickFileSize(const CorpusOptions &options, CorpusRandom &random)
+{
+    if (options.sizeDistribution == "fixed")
+        return options.meanSize;
+    if (options.sizeDistribution == "uniform")
+        return (size_t)(random.uniform() * 2.0 * options.meanSize);
+    // Lognormal with the requested mean: mu = ln(mean) - sigma^2 / 2
+    double mu = log((double)max<size_t>(1, options.meanSize)) - options.sigma * options.sigma / 2;
+    return (size_t)exp(mu + options.sigma * random.normal());
+}
+
+// Returns the bytes written: the last word and line break overshoot the target
+size_t writeCorpusFile(const string &path, size_t targetSize, const CorpusOptions &options,
+                       const vector<string> &vocabulary, const vector<double> &zipf, CorpusRandom &random)
+{
+    string content;
+    content.reserve(targetSize + 64);
+    size_t lineStart = 0;
+    // Line lengths vary between half and one and a half times the mean
+    size_t lineTarget = options.lineLength / 2 + random.next() % (options.lineLength + 1);
+    while (content.size() < targetSize)
+    {
+        size_t rank = lower_bound(zipf.begin(), zipf.end(), random.uniform()) - zipf.begin();
+        const string &word = vocabulary[min(rank, vocabulary.size() - 1)];
+        if (content.size() > lineStart)
+            content += ' ';
+        content += word;
+        if (random.next() % 16 == 0)
+            content += (random.next() % 2) ? ',' : '.';
+        if (content.size() - lineStart >= lineTarget)
+        {
+            content += '\n';
+            lineStart = content.size();
+            lineTarget = options.lineLength / 2 + random.next() % (options.lineLength + 1);
+        }
+    }
+
+    ofstream fileOutput(path, ios::out | ios::binary);
+    if (!fileOutput)
+    {
+        cerr << "Corpus file could not be created: " << path << endl;
+        return 0;
+    }
+    fileOutput.write(content.data(), content.size());
+    return fileOutput ? content.size() : 0;
+}
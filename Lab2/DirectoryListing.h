@@ -0,0 +1,89 @@
+// DirectoryListing.h
+// The directory walk of FileHandling.cpp, shared with the Pascal compiler
+// driver (PascalCompiler/CompileDriver.cpp).
+//
+// By default it lists the files directly inside a folder whose first 4 KB
+// look like text, plus compressed files. DirectoryListing can ask for the
+// whole tree below the folder, for one extension only, and for no sniffing.
+// Names are relative to the folder, with '/' between directories, so
+// folder + "/" + name is always the file's path.
+#pragma once
+
+#include <cctype>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "CompactStrings.h"
+#include "ContentSniffer.h"
+
+using namespace std;
+
+struct DirectoryListing
+{
+    bool recursive = false;
+    string extension;  // such as ".pas", compared ignoring case; empty for every file
+    bool sniff = true; // keep only text and compressed files
+};
+
+inline bool hasExtension(const string &name, const string &extension)
+{
+    if (name.size() < extension.size())
+        return false;
+    size_t start = name.size() - extension.size();
+    for (size_t i = 0; i < extension.size(); i++)
+    {
+        if (tolower((unsigned char)name[start + i]) != tolower((unsigned char)extension[i]))
+            return false;
+    }
+    return true;
+}
+
+// Lists the files worth analyzing: anything whose first 4 KB looks like text,
+// whatever its extension, plus compressed files we can decompress
+inline PathArena getFileNamesInDirectory(string directoryPath, SniffSummary *summary = nullptr,
+                                         vector<uint64_t> *fileSizes = nullptr,
+                                         const DirectoryListing &listing = DirectoryListing())
+{
+    PathArena fileNames;
+    auto visit = [&](const filesystem::directory_entry &checkName) {
+        if (!checkName.is_regular_file())
+            return;
+        const string name = listing.recursive
+                                ? checkName.path().lexically_relative(directoryPath).generic_string()
+                                : checkName.path().filename().string();
+        if (!listing.extension.empty() && !hasExtension(name, listing.extension))
+            return;
+        if (listing.sniff)
+        {
+            SniffResult result = sniffFile(checkName.path().string(), name);
+            if (summary)
+                summary->counts[result]++;
+            if (result != SNIFF_TEXT && result != SNIFF_COMPRESSED)
+                return;
+        }
+        fileNames.add(name);
+        if (fileSizes)
+            fileSizes->push_back(checkName.file_size());
+    };
+    try
+    {
+        if (listing.recursive)
+        {
+            for (const auto &checkName : filesystem::recursive_directory_iterator(
+                     directoryPath, filesystem::directory_options::skip_permission_denied))
+                visit(checkName);
+        }
+        else
+        {
+            for (const auto &checkName : filesystem::directory_iterator(directoryPath))
+                visit(checkName);
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << "Error reading directory: " << e.what() << '\n';
+    }
+    return fileNames;
+}
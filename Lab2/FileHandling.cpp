@@ -5,40 +5,222 @@
 #include <vector>
 #include <unordered_map>
 #include <algorithm>
-#include <unordered_set>
+#include <sstream>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <memory>
+#include "AnalysisMetrics.h"
+#include "AnalysisProgress.h"
+#include "CompactStrings.h"
+#include "CompressedInput.h"
+#include "ContentSearch.h"
+#include "ContentSniffer.h"
+#include "DirectoryListing.h"
+#include "MappedFile.h"
+#include "ResultQueue.h"
+#include "StopWords.h"
 
 using namespace std;
 using namespace std::filesystem;
 
+// Number of most common words kept per file
+const size_t topWordCount = 5;
+
+// Results a worker collects before publishing them to the report writer
+const size_t resultBatchSize = 8;
+
+// Lengths kept exactly in the histograms; longer ones share the last bucket
+const size_t wordLengthLimit = 64;
+const size_t lineLengthLimit = 256;
+
 // Structs
+// Histogram of lengths in a fixed array, so a file's analysis allocates
+// nothing: counts[i] is how many items had length i, and counts[Limit] how
+// many had Limit or more. The sum is of the real lengths, so the mean stays
+// exact. Histograms of different files or threads combine with merge(); a
+// single file counts in 32 bits, totals over many files in 64.
+template <typename Count, size_t Limit>
+struct BasicLengthHistogram
+{
+    static const size_t limit = Limit;
+    Count counts[Limit + 1] = {};
+    Count total = 0;
+    Count sum = 0;
+
+    void record(size_t length)
+    {
+        counts[min(length, Limit)]++;
+        total++;
+        sum += (Count)length;
+    }
+
+    template <typename Other>
+    void merge(const BasicLengthHistogram<Other, Limit> &other)
+    {
+        for (size_t i = 0; i <= Limit; i++)
+            counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+    }
+
+    double mean() const { return total == 0 ? 0.0 : (double)sum / total; }
+
+    // Nearest-rank percentile, e.g. 0.5 for the median; Limit means Limit or more
+    size_t percentile(double quantile) const
+    {
+        if (total == 0)
+            return 0;
+        uint64_t rank = max<uint64_t>(1, (uint64_t)ceil(quantile * total));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < Limit; i++)
+        {
+            seen += counts[i];
+            if (seen >= rank)
+                return i;
+        }
+        return Limit;
+    }
+
+    // "64+" for the last bucket
+    static string label(size_t length) { return to_string(length) + (length == Limit ? "+" : ""); }
+};
+
+typedef BasicLengthHistogram<uint32_t, wordLengthLimit> FileWordLengths;
+typedef BasicLengthHistogram<uint32_t, lineLengthLimit> FileLineLengths;
+typedef BasicLengthHistogram<uint64_t, wordLengthLimit> WordLengths;
+typedef BasicLengthHistogram<uint64_t, lineLengthLimit> LineLengths;
+
+struct TopWord
+{
+    uint32_t wordId; // into the run's WordDictionary
+    uint32_t count;
+};
+
+// A file is analyzed in memory and must be smaller than 4 GB, so all of its
+// counters fit in 32 bits. The name is an offset into the run's PathArena.
 struct FileAnalysis
 {
-    string fileName;
-    size_t lineCount;
-    size_t wordCount;
-    vector<pair<string, int>> commonWords;
-    size_t avgWordLength;
-    size_t charCount;
-    size_t vowelCount;
-    size_t consonantCount;
+    uint32_t nameOffset = 0;
+    uint32_t lineCount = 0;
+    uint32_t wordCount = 0;
+    uint32_t charCount = 0;
+    uint32_t vowelCount = 0;
+    uint32_t consonantCount = 0;
+    uint8_t commonWordCount = 0;
+    bool analyzed = false;
+    TopWord commonWords[topWordCount];
+    FileWordLengths wordLengths;
+    FileLineLengths lineLengths;
+};
+
+// Writes the report one file at a time as results arrive, so a result can be
+// freed as soon as it is written instead of waiting for the whole folder.
+// Text or JSON is chosen by the report extension, as before. Every entry is
+// also appended to <report>.checkpoint, from which an interrupted run resumes.
+class ReportWriter
+{
+public:
+    bool open(const string &path, const string &folder);
+    void begin(const PathArena &fileNames, const WordDictionary &dictionary);
+    void write(const FileAnalysis &analysis);
+    void finish(size_t failedCount, size_t cancelledCount);
+
+private:
+    string reportPath;
+    ofstream fileOutput;
+    ofstream checkpoint;
+    const PathArena *names = nullptr;
+    const WordDictionary *words = nullptr;
+    bool json = false;
+    size_t written = 0;
+    WordLengths allWords;
+    LineLengths allLines;
 };
 
 // Function Prototypes
 char checkTasks();
 string getStringInput(string text);
 void openFileForDisplay(string path);
-vector<FileAnalysis> performFileAnalysis(string path);
-vector<string> getFileNamesInDirectory(string directoryPath);
-void reportResults(const vector<FileAnalysis> &results, string reportPath);
+bool analyzeFile(const string &filePath, uint32_t nameOffset, const StopWordTable &stopWords,
+                 WordDictionary &dictionary, FileAnalysis &analysis, AnalysisMetrics &metrics);
+void analyzeContent(const string &content, uint32_t nameOffset, const StopWordTable &stopWords,
+                    WordDictionary &dictionary, FileAnalysis &analysis, AnalysisMetrics &metrics);
+void performFileAnalysis(string path, AnalysisMetrics &metrics, unsigned threadCount,
+                         const StopWordTable &stopWords, WordDictionary &dictionary,
+                         unordered_map<string, FileAnalysis> &restored, ReportWriter &report);
+void runAnalysis(string pathForAnalysis, string pathForReport, unsigned threadCount, string stopWordPath,
+                 bool resume);
+void printSniffSummary(const SniffSummary &summary, ostream &out);
+template <typename Count, size_t Limit>
+void writeHistogramText(ofstream &fileOutput, const string &label, const BasicLengthHistogram<Count, Limit> &histogram);
+template <typename Count, size_t Limit>
+void writeHistogramJson(ofstream &fileOutput, const string &key, const BasicLengthHistogram<Count, Limit> &histogram,
+                        const string &indent);
+string jsonEscape(string_view text);
+string checkpointPathFor(const string &reportPath);
+void writeCheckpointEntry(ofstream &out, const FileAnalysis &analysis, const char *fileName,
+                          const WordDictionary &dictionary);
+bool loadCheckpoint(const string &checkpointPath, const string &folder, WordDictionary &dictionary,
+                    unordered_map<string, FileAnalysis> &restored);
+size_t searchFile(const string &filePath, const string &name, const ContentMatcher &matcher,
+                  ostream &out, mutex &outputLock);
+void performSearch(string path, const vector<string> &patterns, bool useRegex, unsigned threadCount, ostream &out);
 
 // Main Function
-int main()
+// Run without arguments for the interactive menu, or as
+//   FileHandling <folder> <report> [threads] [--stopwords <language pack>] [--resume]
+// to analyze a folder directly (used by AnalysisBenchmark.cpp), or as
+//   FileHandling --search <folder> [--regex] [--threads N] <pattern>...
+// to list every match as file:line:column. Files/Search holds overlapping
+// patterns of different lengths; SearchCheck.cpp checks the 33 matches of
+// abc b he she his hers there, the sum of grep -o -c over the patterns.
+int main(int argc, char *argv[])
 {
     try
     {
+        if (argc >= 4 && string(argv[1]) == "--search")
+        {
+            bool useRegex = false;
+            unsigned threadCount = thread::hardware_concurrency();
+            vector<string> patterns;
+            for (int i = 3; i < argc; i++)
+            {
+                string argument = argv[i];
+                if (argument == "--regex")
+                    useRegex = true;
+                else if (argument == "--threads" && i + 1 < argc)
+                    threadCount = (unsigned)stoul(argv[++i]);
+                else
+                    patterns.push_back(argument);
+            }
+            performSearch(argv[2], patterns, useRegex, threadCount, cout);
+            return 0;
+        }
+        if (argc >= 3)
+        {
+            unsigned threadCount = thread::hardware_concurrency();
+            string stopWordPath;
+            bool resume = false;
+            for (int i = 3; i < argc; i++)
+            {
+                string argument = argv[i];
+                if (argument == "--stopwords" && i + 1 < argc)
+                    stopWordPath = argv[++i];
+                else if (argument == "--resume")
+                    resume = true;
+                else
+                    threadCount = (unsigned)stoul(argument);
+            }
+            runAnalysis(argv[1], argv[2], threadCount, stopWordPath, resume);
+            return 0;
+        }
         const string rootPath = "E:/Compiler Construction Lab/Compiler Construction/Lab2/";
         char option = checkTasks();
-        if (option == '3')
+        if (option == '4')
         {
             cout << "Exiting the program." << endl;
             return 0;
@@ -52,8 +234,15 @@ int main()
         {
             string pathForAnalysis = getStringInput("Enter the folder path for analysis(Absolute): ");
             string pathForReport = getStringInput("Enter the file path for report(Absolute): ");
-            const vector<FileAnalysis> analysisResults = performFileAnalysis(pathForAnalysis);
-            reportResults(analysisResults, pathForReport);
+            runAnalysis(pathForAnalysis, pathForReport, thread::hardware_concurrency(), "", false);
+        }
+        else if (option == '3')
+        {
+            string pathForSearch = getStringInput("Enter the folder path for search(Absolute): ");
+            string pattern = getStringInput("Enter the text to search for: ");
+            string regexAnswer = getStringInput("Treat it as a regular expression? (y/n): ");
+            performSearch(pathForSearch, {pattern}, regexAnswer == "y" || regexAnswer == "Y",
+                          thread::hardware_concurrency(), cout);
         }
         return 0;
     }
@@ -63,6 +252,45 @@ int main()
     }
 }
 
+// An empty stopWordPath keeps the built-in English stop words. With resume,
+// files recorded in the checkpoint of an interrupted run are not analyzed again.
+void runAnalysis(string pathForAnalysis, string pathForReport, unsigned threadCount, string stopWordPath,
+                 bool resume)
+{
+    AnalysisMetrics metrics;
+    StopWordTable stopWords;
+    if (!stopWordPath.empty())
+    {
+        stopWords.loadFromFile(stopWordPath);
+        cout << "Loaded " << stopWords.size() << " stop words from: " << stopWordPath << endl;
+    }
+    WordDictionary dictionary;
+    const string checkpointPath = checkpointPathFor(pathForReport);
+    unordered_map<string, FileAnalysis> restored;
+    if (resume && loadCheckpoint(checkpointPath, pathForAnalysis, dictionary, restored))
+        cout << "Resuming: " << restored.size() << " files restored from: " << checkpointPath << endl;
+    ReportWriter report;
+    if (!report.open(pathForReport, pathForAnalysis))
+    {
+        cerr << "Report file could not be created!" << endl;
+        return;
+    }
+    installCancelHandler();
+    performFileAnalysis(pathForAnalysis, metrics, threadCount, stopWords, dictionary, restored, report);
+    removeCancelHandler();
+    if (analysisCancelled())
+    {
+        cout << "Analysis cancelled; the report is partial. Run again with --resume to continue." << endl;
+    }
+    else
+    {
+        error_code ignored;
+        remove(checkpointPath, ignored);
+    }
+    writePrometheusMetrics(metrics, pathForReport + ".prom");
+    printMetricsSummary(metrics, cout);
+}
+
 char checkTasks()
 {
     bool check = true;
@@ -72,10 +300,11 @@ char checkTasks()
         cout << "Choose an option: " << endl;
         cout << "1. Read from file and Display" << endl;
         cout << "2. File Analysis" << endl;
-        cout << "3. Exit" << endl;
+        cout << "3. Search in Files" << endl;
+        cout << "4. Exit" << endl;
         cin >> option;
         cin.ignore(numeric_limits<streamsize>::max(), '\n');
-        if (option == '1' || option == '2' || option == '3')
+        if (option == '1' || option == '2' || option == '3' || option == '4')
         {
             check = false;
         }
@@ -116,171 +345,623 @@ string getStringInput(string text)
     return value;
 }
 
-vector<string> getFileNamesInDirectory(string directoryPath)
+void printSniffSummary(const SniffSummary &summary, ostream &out)
 {
-    vector<string> fileNames;
-    try
+    out << "Accepted " << summary.accepted() << " files (" << summary.counts[SNIFF_TEXT] << " text, "
+        << summary.counts[SNIFF_COMPRESSED] << " compressed), rejected " << summary.rejected();
+    bool first = true;
+    for (int i = SNIFF_NUL_BYTES; i < SNIFF_RESULT_COUNT; i++)
+    {
+        if (summary.counts[i] == 0)
+            continue;
+        out << (first ? ": " : ", ") << summary.counts[i] << " " << sniffResultName(i);
+        first = false;
+    }
+    out << endl;
+}
+
+// Analyze one file, timing each phase into the worker's metrics
+bool analyzeFile(const string &filePath, uint32_t nameOffset, const StopWordTable &stopWords,
+                 WordDictionary &dictionary, FileAnalysis &analysis, AnalysisMetrics &metrics)
+{
+    METRICS_TIME_FILE(metrics);
+    ifstream fileRead;
+    {
+        METRICS_TIME_PHASE(metrics, PHASE_OPEN);
+        fileRead.open(filePath, ios::in | ios::binary);
+    }
+    if (!fileRead)
+    {
+        cerr << "File could not be opened!" << endl;
+        return false;
+    }
+
+    // Read the whole file at once so the scans below run over one buffer
+    string content;
     {
-        for (const auto &checkName : directory_iterator(directoryPath))
+        METRICS_TIME_PHASE(metrics, PHASE_READ);
+        fileRead.seekg(0, ios::end);
+        streamoff size = fileRead.tellg();
+        fileRead.seekg(0, ios::beg);
+        content.resize(size > 0 ? (size_t)size : 0);
+        fileRead.read(&content[0], content.size());
+        content.resize(fileRead.gcount());
+        fileRead.close();
+    }
+    analyzeContent(content, nameOffset, stopWords, dictionary, analysis, metrics);
+    return analysis.analyzed;
+}
+
+// Everything after reading: shared by plain files and decompressed ones
+void analyzeContent(const string &content, uint32_t nameOffset, const StopWordTable &stopWords,
+                    WordDictionary &dictionary, FileAnalysis &analysis, AnalysisMetrics &metrics)
+{
+    analysis.nameOffset = nameOffset;
+    if (content.size() > UINT32_MAX)
+    {
+        cerr << "File is too large to analyze (4 GB limit)!" << endl;
+        return;
+    }
+    METRICS_ADD_BYTES(metrics, content.size());
+    uint32_t lineCounter = 0;
+    uint32_t vowelCounter = 0;
+    uint32_t consonantCounter = 0;
+    uint32_t charCounter = 0;
+    {
+        // Word and line lengths are collected in the same pass; a word is a run
+        // of letters and digits, so punctuation inside it does not count
+        METRICS_TIME_PHASE(metrics, PHASE_CLASSIFY);
+        size_t wordLength = 0;
+        size_t lineLength = 0;
+        for (char c : content)
         {
-            if (is_regular_file(checkName) && checkName.path().extension() == ".txt")
+            if (c == '\n')
+            {
+                lineCounter++;
+                analysis.lineLengths.record(lineLength);
+                lineLength = 0;
+                if (wordLength > 0)
+                    analysis.wordLengths.record(wordLength);
+                wordLength = 0;
+                continue;
+            }
+            lineLength++;
+            if (isalpha((unsigned char)c))
+            {
+                if (c == 'a' || c == 'e' || c == 'i' || c == 'o' || c == 'u' ||
+                    c == 'A' || c == 'E' || c == 'I' || c == 'O' || c == 'U')
+                    vowelCounter++;
+                else
+                    consonantCounter++;
+                charCounter++;
+                wordLength++;
+            }
+            else if (isdigit((unsigned char)c))
+            {
+                charCounter++;
+                wordLength++;
+            }
+            else if (isspace((unsigned char)c))
+            {
+                if (wordLength > 0)
+                    analysis.wordLengths.record(wordLength);
+                wordLength = 0;
+            }
+            else
             {
-                fileNames.push_back(checkName.path().filename().string());
+                charCounter++;
             }
         }
+        if (wordLength > 0)
+            analysis.wordLengths.record(wordLength);
+        // The last line has no trailing newline
+        if (!content.empty() && content.back() != '\n')
+        {
+            lineCounter++;
+            analysis.lineLengths.record(lineLength);
+        }
+    }
+
+    // Words are runs of letters and digits separated by whitespace, lowercased
+    // (the rule in StopWords.h, which pack entries are folded by too)
+    vector<string> words;
+    {
+        METRICS_TIME_PHASE(metrics, PHASE_TOKENIZE);
+        string singleWord;
+        for (char c : content)
+        {
+            if (isWordByte(c))
+            {
+                singleWord.push_back(foldWordByte(c));
+            }
+            else if (isWordBreak(c) && !singleWord.empty())
+            {
+                words.push_back(singleWord);
+                singleWord.clear();
+            }
+        }
+        if (!singleWord.empty())
+            words.push_back(singleWord);
+    }
+
+    unordered_map<string, int> wordCount;
+    {
+        METRICS_TIME_PHASE(metrics, PHASE_COUNT);
+        for (const string &word : words)
+        {
+            if (word.empty() || stopWords.contains(word))
+                continue;
+            wordCount[word]++;
+        }
     }
-    catch (const exception &e)
+
     {
-        cerr << "Error reading directory: " << e.what() << '\n';
+        METRICS_TIME_PHASE(metrics, PHASE_TOPK);
+        vector<pair<string, int>> commonWords(wordCount.begin(), wordCount.end());
+        size_t k = min(topWordCount, commonWords.size());
+        partial_sort(commonWords.begin(), commonWords.begin() + k, commonWords.end(),
+                     [](const pair<string, int> &a, const pair<string, int> &b)
+                     { return b.second < a.second; });
+        for (size_t i = 0; i < k; i++)
+            analysis.commonWords[i] = {dictionary.intern(commonWords[i].first), (uint32_t)commonWords[i].second};
+        analysis.commonWordCount = (uint8_t)k;
     }
-    return fileNames;
+
+    analysis.lineCount = lineCounter;
+    analysis.wordCount = (uint32_t)words.size();
+    analysis.vowelCount = vowelCounter;
+    analysis.consonantCount = consonantCounter;
+    analysis.charCount = charCounter;
+    analysis.analyzed = true;
 }
 
-vector<FileAnalysis> performFileAnalysis(string path)
+// Stops claiming new files once Ctrl+C is pressed; files already being
+// analyzed are finished and reported, the rest are left for --resume
+void performFileAnalysis(string path, AnalysisMetrics &metrics, unsigned threadCount,
+                         const StopWordTable &stopWords, WordDictionary &dictionary,
+                         unordered_map<string, FileAnalysis> &restored, ReportWriter &report)
 {
-    vector<FileAnalysis> fileData;
-    const unordered_set<string> stopWords = {
-        "the", "and", "in", "of", "on", "a", "an", "is", "it", "to", "for", "with",
-        "at", "by", "from", "that", "this", "these", "those", "as", "be", "been",
-        "are", "was", "were", "or", "but", "if", "then", "so", "because"," "};
     try
     {
         cout << "Performing file analysis on: " << path << endl;
-        vector<string> fileNames = getFileNamesInDirectory(path);
-        for (const string &name : fileNames)
+        const uint64_t startTime = metricsNow();
+        SniffSummary sniffed;
+        vector<uint64_t> fileSizes;
+        PathArena fileNames = getFileNamesInDirectory(path, &sniffed, &fileSizes);
+        printSniffSummary(sniffed, cout);
+        report.begin(fileNames, dictionary);
+
+        // Workers claim files through a shared index. Each keeps its results in
+        // its own shard and publishes them in batches through a lock-free queue
+        // to a single writer thread, which puts them back in directory order
+        // and streams them into the report. Only results that arrive ahead of
+        // an unfinished file wait in memory.
+        // Compressed files are decompressed on separate threads and handed to the
+        // analysis workers through a bounded queue, so decompressing the next file
+        // overlaps with analyzing the current one.
+        // Files restored from a checkpoint go straight to the writer.
+        typedef ResultShard<FileAnalysis> Shard;
+        MpscQueue<Shard::Batch> results;
+        Shard::Batch restoredBatch;
+        vector<size_t> plainFiles, compressedFiles;
+        uint64_t remainingBytes = 0;
+        for (size_t i = 0; i < fileNames.size(); i++)
         {
-            cout << "Found text file: " << name << endl;
-            const string filePath = path + "/" + name;
-            vector<string> words;
-            ifstream fileRead(filePath, ios::in);
-            if (!fileRead)
+            auto found = restored.find(fileNames[i]);
+            if (found != restored.end())
             {
-                cerr << "File could not be opened!" << endl;
+                found->second.nameOffset = fileNames.offset(i);
+                restoredBatch.emplace_back(i, move(found->second));
                 continue;
             }
+            (isCompressedName(fileNames[i]) ? compressedFiles : plainFiles).push_back(i);
+            remainingBytes += fileSizes[i];
+        }
+        restored.clear();
+        if (!restoredBatch.empty())
+            results.push(move(restoredBatch));
+        AnalysisProgress progress;
+        progress.setTotals(plainFiles.size() + compressedFiles.size(), remainingBytes);
 
-            FileAnalysis analysis;
-            analysis.fileName = name;
-            int lineCounter = 0;
-            int wordCounter = 0;
-            int vowelCounter = 0;
-            int consonantCounter = 0;
-            int charCounter = 0;
-            string line = "";
-
-            while (getline(fileRead, line))
+        threadCount = max(1u, min<unsigned>(threadCount, fileNames.size()));
+        unsigned decompressCount = compressedFiles.empty() ? 0 : max(1u, min<unsigned>(threadCount / 2, compressedFiles.size()));
+        vector<AnalysisMetrics> workerMetrics(threadCount + decompressCount);
+        atomic<size_t> nextPlain(0);
+        atomic<size_t> nextCompressed(0);
+        atomic<unsigned> decompressorsLeft(decompressCount);
+        atomic<unsigned> workersLeft(threadCount);
+        BoundedQueue<pair<size_t, string>> decompressed(2 * threadCount);
+
+        auto writer = [&]()
+        {
+            map<size_t, FileAnalysis> pending;
+            size_t nextToWrite = 0;
+            size_t writtenCount = 0;
+            size_t failedCount = 0;
+            Shard::Batch batch;
+            auto writeFirstPending = [&]()
             {
-                lineCounter++;
-                for (char c : line)
+                const FileAnalysis &analysis = pending.begin()->second;
+                if (analysis.analyzed)
+                    report.write(analysis);
+                else
+                    failedCount++;
+                writtenCount++;
+                nextToWrite = pending.begin()->first + 1;
+                pending.erase(pending.begin());
+            };
+            for (;;)
+            {
+                // Read before draining: once it is zero every batch is already queued
+                bool done = workersLeft.load(memory_order_acquire) == 0;
+                bool received = false;
+                while (results.tryPop(batch))
                 {
-                    vector<char> singleWord;
-                    if (isalpha(c))
-                    {
-                        if (c == 'a' || c == 'e' || c == 'i' || c == 'o' || c == 'u' ||
-                            c == 'A' || c == 'E' || c == 'I' || c == 'O' || c == 'U')
-                        {
-                            singleWord.push_back(c);
-                            vowelCounter++;
-                            charCounter++;
-                        }
-                        else
-                        {
-                            singleWord.push_back(c);
-                            consonantCounter++;
-                            charCounter++;
-                        }
-                    }
-                    else if (isdigit(c))
-                    {
-                        singleWord.push_back(c);
-                        charCounter++;
-                    }
-                    else if (isspace(c))
-                    {
-                        words.push_back(string(singleWord.begin(), singleWord.end()));
-                        wordCounter++;
-                        singleWord.clear();
-                    }
-                    else
-                    {
-                        charCounter++;
-                    }
+                    received = true;
+                    for (pair<size_t, FileAnalysis> &entry : batch)
+                        pending.emplace(entry.first, move(entry.second));
+                    while (!pending.empty() && pending.begin()->first == nextToWrite)
+                        writeFirstPending();
+                    progress.tick();
                 }
+                if (done)
+                    break;
+                progress.tick();
+                if (!received)
+                    this_thread::sleep_for(chrono::microseconds(200));
             }
-
-            unordered_map<string, int> wordCount;
-            for (const string &word : words)
+            // After a cancellation the files that were never claimed leave gaps
+            while (!pending.empty())
+                writeFirstPending();
+            progress.finish();
+            report.finish(failedCount, fileNames.size() - writtenCount);
+        };
+        auto decompressor = [&](unsigned id)
+        {
+            for (size_t j = nextCompressed++; j < compressedFiles.size() && !analysisCancelled(); j = nextCompressed++)
             {
-                if(word.empty() || stopWords.find(word) != stopWords.end())
+                size_t i = compressedFiles[j];
+                string content;
+                size_t compressedBytes = 0;
+                bool ok;
+                {
+                    METRICS_TIME_PHASE(workerMetrics[id], PHASE_DECOMPRESS);
+                    ok = readCompressedFile(path + "/" + fileNames[i], content, compressedBytes);
+                }
+                if (!ok)
+                {
+                    cerr << "File could not be decompressed: " << fileNames[i] << endl;
+                    progress.fileDone(fileSizes[i]);
+                    // The writer still has to skip past this file
+                    FileAnalysis failed;
+                    failed.nameOffset = fileNames.offset(i);
+                    results.push(Shard::Batch(1, make_pair(i, move(failed))));
                     continue;
-                wordCount[word]++;
+                }
+                decompressed.push(make_pair(i, move(content)));
+            }
+            if (--decompressorsLeft == 0)
+                decompressed.close();
+        };
+        auto analyzeDecompressed = [&](pair<size_t, string> &item, unsigned id, Shard &shard)
+        {
+            FileAnalysis analysis;
+            {
+                METRICS_TIME_FILE(workerMetrics[id]);
+                analyzeContent(item.second, fileNames.offset(item.first), stopWords, dictionary, analysis,
+                               workerMetrics[id]);
             }
+            string().swap(item.second);
+            progress.fileDone(fileSizes[item.first]);
+            shard.add(item.first, move(analysis));
+        };
+        auto worker = [&](unsigned id)
+        {
+            {
+                Shard shard(results, resultBatchSize);
+                pair<size_t, string> item;
+                for (size_t j = nextPlain++; j < plainFiles.size() && !analysisCancelled(); j = nextPlain++)
+                {
+                    // Decompressed files are taken first so the decompressors never stall
+                    while (decompressed.tryPop(item))
+                        analyzeDecompressed(item, id, shard);
+                    size_t i = plainFiles[j];
+                    FileAnalysis analysis;
+                    analyzeFile(path + "/" + fileNames[i], fileNames.offset(i), stopWords, dictionary, analysis,
+                                workerMetrics[id]);
+                    progress.fileDone(fileSizes[i]);
+                    shard.add(i, move(analysis));
+                }
+                while (decompressCount > 0 && decompressed.pop(item))
+                    analyzeDecompressed(item, id, shard);
+            }
+            workersLeft.fetch_sub(1, memory_order_acq_rel);
+        };
+        vector<thread> workers;
+        thread writerThread(writer);
+        for (unsigned id = 0; id < decompressCount; id++)
+            workers.emplace_back(decompressor, threadCount + id);
+        for (unsigned id = 1; id < threadCount; id++)
+            workers.emplace_back(worker, id);
+        worker(0);
+        for (thread &t : workers)
+            t.join();
+        writerThread.join();
 
-            analysis.commonWords.assign(wordCount.begin(), wordCount.end());
-            sort(analysis.commonWords.begin(), analysis.commonWords.end(), [](const pair<string, int> &a, const pair<string, int> &b)
-                 { return b.second < a.second; });
-
-            analysis.lineCount = lineCounter;
-            analysis.wordCount = wordCounter;
-            analysis.vowelCount = vowelCounter;
-            analysis.consonantCount = consonantCounter;
-            analysis.charCount = charCounter;
-            analysis.avgWordLength = (wordCounter == 0) ? 0 : charCounter / wordCounter;
-            fileRead.close();
-            fileData.push_back(analysis);
-        }
+        for (const AnalysisMetrics &m : workerMetrics)
+            metrics.merge(m);
+        metrics.wallSeconds = (metricsNow() - startTime) * 1e-9;
     }
     catch (exception &e)
     {
         cout << "Unable to Open file: " << e.what() << endl;
     }
-    return fileData;
 }
 
-void reportResults(const vector<FileAnalysis> &results, string reportPath)
+// Search one mapped file and stream its hits as name:line:column: text.
+// Hits are buffered per file and flushed in chunks so lines from different
+// files never interleave.
+size_t searchFile(const string &filePath, const string &name, const ContentMatcher &matcher,
+                  ostream &out, mutex &outputLock)
 {
-    try
+    MappedFile file;
+    if (!file.open(filePath))
     {
-        // const string filePath = reportPath + "/\report.txt";
-        const int n = 5;
-        ofstream fileOutput(reportPath, ios::out);
-        if (!fileOutput)
+        cerr << "File could not be opened: " << filePath << endl;
+        return 0;
+    }
+    const char *data = file.data();
+    const size_t size = file.size();
+    size_t hits = 0;
+    size_t lineNumber = 1;
+    size_t lineStart = 0;
+    size_t scanned = 0;
+    string buffer;
+    matcher.findAll(data, size, [&](size_t offset, size_t)
+                    {
+        // Hits arrive in increasing order, so line numbers are counted incrementally
+        const char *newline;
+        while ((newline = (const char *)memchr(data + scanned, '\n', offset - scanned)) != nullptr)
         {
-
-            cerr << "Report file could not be created!" << endl;
-            return;
+            lineNumber++;
+            scanned = newline - data + 1;
+            lineStart = scanned;
         }
-        fileOutput << "Total Number of Files: " << results.size() << endl;
-        fileOutput << "{" << endl;
-        for (const FileAnalysis &analysis : results)
+        scanned = offset;
+        const char *lineEnd = (const char *)memchr(data + lineStart, '\n', size - lineStart);
+        size_t lineLength = (lineEnd ? lineEnd - data : size) - lineStart;
+        buffer += name + ":" + to_string(lineNumber) + ":" + to_string(offset - lineStart + 1) + ": ";
+        buffer.append(data + lineStart, lineLength);
+        buffer += '\n';
+        hits++;
+        if (buffer.size() >= 64 * 1024)
         {
+            lock_guard<mutex> guard(outputLock);
+            out << buffer;
+            buffer.clear();
+        } });
+    if (!buffer.empty())
+    {
+        lock_guard<mutex> guard(outputLock);
+        out << buffer;
+    }
+    return hits;
+}
 
-            fileOutput << "{";
-            fileOutput << " File Name: " << analysis.fileName << "," << endl;
-            fileOutput << " Line Count: " << analysis.lineCount << "," << endl;
-            fileOutput << " Word Count: " << analysis.wordCount << "," << endl;
-            fileOutput << " Most Common Words: ";
-            for (int i = 0; i < n && i < analysis.commonWords.size(); i++)
+void performSearch(string path, const vector<string> &patterns, bool useRegex, unsigned threadCount, ostream &out)
+{
+    try
+    {
+        // Build once up front so a bad pattern is reported before any thread starts
+        makeMatcher(patterns, useRegex);
+        SniffSummary sniffed;
+        PathArena fileNames = getFileNamesInDirectory(path, &sniffed);
+        printSniffSummary(sniffed, cerr);
+        threadCount = max(1u, min<unsigned>(threadCount, fileNames.size()));
+        atomic<size_t> nextFile(0);
+        atomic<size_t> totalHits(0);
+        atomic<size_t> matchingFiles(0);
+        mutex outputLock;
+        auto worker = [&]()
+        {
+            unique_ptr<ContentMatcher> matcher = makeMatcher(patterns, useRegex);
+            for (size_t i = nextFile++; i < fileNames.size(); i = nextFile++)
             {
-                fileOutput << "{\"" << analysis.commonWords[i].first << "\","
-                           << analysis.commonWords[i].second << "}";
-                if (i < n - 1 && i < analysis.commonWords.size() - 1)
-                    fileOutput << ",";
+                size_t hits = searchFile(path + "/" + fileNames[i], fileNames[i], *matcher, out, outputLock);
+                totalHits += hits;
+                if (hits > 0)
+                    matchingFiles++;
             }
-            fileOutput << " Average Word Length: " << analysis.avgWordLength << "," << endl;
-            fileOutput << " Vowel to Consonant Ratio: 1 : "
-                       << (analysis.vowelCount == 0 ? 0.0
-                                                    : analysis.consonantCount / analysis.vowelCount)
-                       << endl;
+        };
+        vector<thread> workers;
+        for (unsigned id = 1; id < threadCount; id++)
+            workers.emplace_back(worker);
+        worker();
+        for (thread &t : workers)
+            t.join();
+        out.flush();
+        cerr << totalHits << " matches in " << matchingFiles << " of " << fileNames.size() << " files" << endl;
+    }
+    catch (exception &e)
+    {
+        cout << "Unable to search: " << e.what() << endl;
+    }
+}
+
+template <typename Count, size_t Limit>
+void writeHistogramText(ofstream &fileOutput, const string &label, const BasicLengthHistogram<Count, Limit> &histogram)
+{
+    fileOutput << " Median " << label << " Length: " << histogram.label(histogram.percentile(0.5)) << "," << endl;
+    fileOutput << " 95th Percentile " << label << " Length: " << histogram.label(histogram.percentile(0.95)) << ","
+               << endl;
+    fileOutput << " " << label << " Length Histogram: {";
+    bool first = true;
+    for (size_t i = 0; i <= Limit; i++)
+    {
+        if (histogram.counts[i] == 0)
+            continue;
+        fileOutput << (first ? "" : ", ") << histogram.label(i) << ": " << histogram.counts[i];
+        first = false;
+    }
+    fileOutput << "}," << endl;
+}
+
+// The median and p95 stay numbers; a value of Limit there means Limit or more
+template <typename Count, size_t Limit>
+void writeHistogramJson(ofstream &fileOutput, const string &key, const BasicLengthHistogram<Count, Limit> &histogram,
+                        const string &indent)
+{
+    fileOutput << indent << "\"" << key << "\": {\"mean\": " << histogram.mean()
+               << ", \"median\": " << histogram.percentile(0.5)
+               << ", \"p95\": " << histogram.percentile(0.95) << ", \"counts\": {";
+    bool first = true;
+    for (size_t i = 0; i <= Limit; i++)
+    {
+        if (histogram.counts[i] == 0)
+            continue;
+        fileOutput << (first ? "" : ", ") << "\"" << histogram.label(i) << "\": " << histogram.counts[i];
+        first = false;
+    }
+    fileOutput << "}}";
+}
+
+string jsonEscape(string_view text)
+{
+    string escaped;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+bool ReportWriter::open(const string &path, const string &folder)
+{
+    reportPath = path;
+    json = hasSuffix(path, ".json");
+    fileOutput.open(path, ios::out);
+    checkpoint.open(checkpointPathFor(path), ios::out | ios::binary);
+    if (checkpoint)
+        checkpoint << "FileHandling checkpoint 2\n"
+                   << folder << "\n";
+    return (bool)fileOutput;
+}
 
-            fileOutput << " Consonant Count: " << analysis.consonantCount << "," << endl;
-            fileOutput << " Character Count: " << analysis.charCount << "," << endl;
-            fileOutput << "}," << endl;
+void ReportWriter::begin(const PathArena &fileNames, const WordDictionary &dictionary)
+{
+    names = &fileNames;
+    words = &dictionary;
+    if (json)
+    {
+        fileOutput << "{" << endl;
+        fileOutput << "  \"files\": [";
+        return;
+    }
+    fileOutput << "Total Number of Files: " << fileNames.size() << endl;
+    fileOutput << "{" << endl;
+}
 
-            cout << "Reporting analysis for file: " << analysis.fileName << endl;
+// JSON entries follow the layout of Lab2/report.json
+void ReportWriter::write(const FileAnalysis &analysis)
+{
+    const int n = analysis.commonWordCount;
+    const char *fileName = names->at(analysis.nameOffset);
+    allWords.merge(analysis.wordLengths);
+    allLines.merge(analysis.lineLengths);
+    if (json)
+    {
+        fileOutput << (written ? "," : "") << endl;
+        fileOutput << "    {" << endl;
+        fileOutput << "      \"file_name\": \"" << jsonEscape(fileName) << "\"," << endl;
+        fileOutput << "      \"lines\": " << analysis.lineCount << "," << endl;
+        fileOutput << "      \"words\": " << analysis.wordCount << "," << endl;
+        fileOutput << "      \"average_word_length\": " << analysis.wordLengths.mean() << "," << endl;
+        fileOutput << "      \"vowel_consonant_ratio\": "
+                   << (analysis.consonantCount == 0 ? 0.0 : (double)analysis.vowelCount / analysis.consonantCount)
+                   << "," << endl;
+        fileOutput << "      \"top_words\": [";
+        for (int i = 0; i < n; i++)
+        {
+            fileOutput << (i ? ", " : "") << "{\"word\": \"" << jsonEscape(words->word(analysis.commonWords[i].wordId))
+                       << "\", \"count\": " << analysis.commonWords[i].count << "}";
+        }
+        fileOutput << "]," << endl;
+        writeHistogramJson(fileOutput, "word_lengths", analysis.wordLengths, "      ");
+        fileOutput << "," << endl;
+        writeHistogramJson(fileOutput, "line_lengths", analysis.lineLengths, "      ");
+        fileOutput << endl
+                   << "    }";
+    }
+    else
+    {
+        fileOutput << "{";
+        fileOutput << " File Name: " << fileName << "," << endl;
+        fileOutput << " Line Count: " << analysis.lineCount << "," << endl;
+        fileOutput << " Word Count: " << analysis.wordCount << "," << endl;
+        fileOutput << " Most Common Words: ";
+        for (int i = 0; i < n; i++)
+        {
+            fileOutput << "{\"" << words->word(analysis.commonWords[i].wordId) << "\","
+                       << analysis.commonWords[i].count << "}";
+            if (i < n - 1)
+                fileOutput << ",";
+        }
+        fileOutput << " Average Word Length: " << analysis.wordLengths.mean() << "," << endl;
+        fileOutput << " Vowel to Consonant Ratio: 1 : "
+                   << (analysis.vowelCount == 0 ? 0.0
+                                                : analysis.consonantCount / analysis.vowelCount)
+                   << endl;
+
+        fileOutput << " Consonant Count: " << analysis.consonantCount << "," << endl;
+        fileOutput << " Character Count: " << analysis.charCount << "," << endl;
+        writeHistogramText(fileOutput, "Word", analysis.wordLengths);
+        writeHistogramText(fileOutput, "Line", analysis.lineLengths);
+        fileOutput << "}," << endl;
+    }
+    written++;
+    if (checkpoint)
+        writeCheckpointEntry(checkpoint, analysis, fileName, *words);
+}
+
+// Files that could not be read, or were not reached before a cancellation,
+// are left out; the footer says how many
+void ReportWriter::finish(size_t failedCount, size_t cancelledCount)
+{
+    try
+    {
+        if (json)
+        {
+            fileOutput << endl
+                       << "  ]," << endl;
+            fileOutput << "  \"summary\": {" << endl;
+            fileOutput << "    \"total_files_analyzed\": " << written << "," << endl;
+            if (failedCount > 0)
+                fileOutput << "    \"files_not_analyzed\": " << failedCount << "," << endl;
+            if (cancelledCount > 0)
+                fileOutput << "    \"files_cancelled\": " << cancelledCount << "," << endl;
+            writeHistogramJson(fileOutput, "word_lengths", allWords, "    ");
+            fileOutput << "," << endl;
+            writeHistogramJson(fileOutput, "line_lengths", allLines, "    ");
+            fileOutput << endl
+                       << "  }" << endl;
+            fileOutput << "}" << endl;
+        }
+        else
+        {
+            fileOutput << "}" << endl;
+            fileOutput << "All Files:" << endl;
+            if (failedCount > 0)
+                fileOutput << " Files Not Analyzed: " << failedCount << "," << endl;
+            if (cancelledCount > 0)
+                fileOutput << " Files Cancelled: " << cancelledCount << "," << endl;
+            fileOutput << " Average Word Length: " << allWords.mean() << "," << endl;
+            writeHistogramText(fileOutput, "Word", allWords);
+            writeHistogramText(fileOutput, "Line", allLines);
         }
-        fileOutput << "}" << endl;
         fileOutput.close();
+        checkpoint.close();
         cout << "Report generated at: " << reportPath << endl;
     }
     catch (exception &e)
@@ -288,3 +969,102 @@ void reportResults(const vector<FileAnalysis> &results, string reportPath)
         cout << "Unable to write report: " << e.what() << endl;
     }
 }
+
+string checkpointPathFor(const string &reportPath)
+{
+    return reportPath + ".checkpoint";
+}
+
+// A histogram as its sum, the number of non-empty buckets and those buckets;
+// the sum is kept because the last bucket does not say the lengths it holds
+template <typename Count, size_t Limit>
+void writeCheckpointHistogram(ofstream &out, const BasicLengthHistogram<Count, Limit> &histogram)
+{
+    size_t used = count_if(begin(histogram.counts), end(histogram.counts), [](Count c)
+                           { return c != 0; });
+    out << " " << histogram.sum << " " << used;
+    for (size_t i = 0; i <= Limit; i++)
+    {
+        if (histogram.counts[i] != 0)
+            out << " " << i << " " << histogram.counts[i];
+    }
+}
+
+template <typename Count, size_t Limit>
+bool readCheckpointHistogram(istream &in, BasicLengthHistogram<Count, Limit> &histogram)
+{
+    size_t used = 0, length;
+    Count count;
+    if (!(in >> histogram.sum >> used))
+        return false;
+    for (size_t i = 0; i < used; i++)
+    {
+        if (!(in >> length >> count) || length > Limit)
+            return false;
+        histogram.counts[length] = count;
+        histogram.total += count;
+    }
+    return true;
+}
+
+// One line per reported file: the name (length-prefixed, as it may contain
+// spaces), the counters, the top words and the two histograms
+void writeCheckpointEntry(ofstream &out, const FileAnalysis &analysis, const char *fileName,
+                          const WordDictionary &dictionary)
+{
+    out << strlen(fileName) << " " << fileName << " " << analysis.lineCount << " " << analysis.wordCount << " "
+        << analysis.charCount << " " << analysis.vowelCount << " " << analysis.consonantCount << " "
+        << (int)analysis.commonWordCount;
+    for (int i = 0; i < analysis.commonWordCount; i++)
+        out << " " << dictionary.word(analysis.commonWords[i].wordId) << " " << analysis.commonWords[i].count;
+    writeCheckpointHistogram(out, analysis.wordLengths);
+    writeCheckpointHistogram(out, analysis.lineLengths);
+    out << "\n";
+}
+
+// Returns false if there is no usable checkpoint for this folder. A line cut
+// off by the interruption ends the list.
+bool loadCheckpoint(const string &checkpointPath, const string &folder, WordDictionary &dictionary,
+                    unordered_map<string, FileAnalysis> &restored)
+{
+    ifstream in(checkpointPath, ios::in | ios::binary);
+    string header, checkpointFolder;
+    if (!in || !getline(in, header) || header != "FileHandling checkpoint 2" || !getline(in, checkpointFolder))
+    {
+        cout << "No checkpoint to resume from at: " << checkpointPath << endl;
+        return false;
+    }
+    if (checkpointFolder != folder)
+    {
+        cout << "Checkpoint belongs to another folder (" << checkpointFolder << "); starting over." << endl;
+        return false;
+    }
+    string line;
+    while (getline(in, line))
+    {
+        istringstream entry(line);
+        size_t nameLength;
+        if (!(entry >> nameLength) || entry.get() != ' ' || nameLength > line.size())
+            break;
+        string name(nameLength, '\0');
+        entry.read(&name[0], nameLength);
+        FileAnalysis analysis;
+        int wordCount;
+        if (!(entry >> analysis.lineCount >> analysis.wordCount >> analysis.charCount >> analysis.vowelCount >>
+              analysis.consonantCount >> wordCount) ||
+            wordCount < 0 || wordCount > (int)topWordCount)
+            break;
+        analysis.commonWordCount = (uint8_t)wordCount;
+        string word;
+        for (int i = 0; i < wordCount && entry >> word >> analysis.commonWords[i].count; i++)
+            analysis.commonWords[i].wordId = dictionary.intern(word);
+        if (!readCheckpointHistogram(entry, analysis.wordLengths) ||
+            !readCheckpointHistogram(entry, analysis.lineLengths))
+            break;
+        if (!entry)
+            break;
+        analysis.analyzed = true;
+        restored[name] = move(analysis);
+    }
+    return true;
+}
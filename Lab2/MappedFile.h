@@ -0,0 +1,91 @@
+// MappedFile.h
+// Read-only view of a whole file. Uses mmap on POSIX systems so large files
+// are paged in on demand instead of being copied into a string; on Windows
+// it falls back to reading the file into memory.
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+class MappedFile
+{
+public:
+    MappedFile() {}
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile() { close(); }
+
+    bool open(const string &path)
+    {
+        close();
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        length = (size_t)info.st_size;
+        if (length > 0)
+        {
+            void *mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED)
+            {
+                ::close(fd);
+                length = 0;
+                return false;
+            }
+            madvise(mapping, length, MADV_SEQUENTIAL);
+            bytes = (const char *)mapping;
+            mapped = true;
+        }
+        ::close(fd);
+        return true;
+#else
+        ifstream fileRead(path, ios::in | ios::binary);
+        if (!fileRead)
+            return false;
+        fileRead.seekg(0, ios::end);
+        fallback.resize((size_t)fileRead.tellg());
+        fileRead.seekg(0, ios::beg);
+        fileRead.read(&fallback[0], fallback.size());
+        bytes = fallback.data();
+        length = fallback.size();
+        return true;
+#endif
+    }
+
+    void close()
+    {
+#ifndef _WIN32
+        if (mapped)
+            munmap((void *)bytes, length);
+#endif
+        mapped = false;
+        bytes = nullptr;
+        length = 0;
+        fallback.clear();
+    }
+
+    const char *data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const char *bytes = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    string fallback;
+};
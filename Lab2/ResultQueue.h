@@ -0,0 +1,102 @@
+// ResultQueue.h
+// Lock-free hand-off of analysis results from the worker threads to the single
+// report writer thread in FileHandling.cpp.
+//
+// Each worker collects results in its own ResultShard and publishes a whole
+// batch at a time, so the shared queue is touched once per batch instead of
+// once per file. MpscQueue is Dmitry Vyukov's intrusive multi-producer /
+// single-consumer queue: a push is one atomic exchange plus one store, a pop
+// never blocks, and neither side takes a lock.
+#pragma once
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue() : head(&stub), tail(&stub) {}
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    ~MpscQueue()
+    {
+        T value;
+        while (tryPop(value))
+        {
+        }
+        if (tail != &stub)
+            delete tail;
+    }
+
+    // Any thread
+    void push(T value)
+    {
+        Node *node = new Node;
+        node->value = move(value);
+        Node *previous = head.exchange(node, memory_order_acq_rel);
+        previous->next.store(node, memory_order_release);
+    }
+
+    // Consumer thread only. May briefly report empty while a push is between
+    // its exchange and its store; the caller simply tries again later.
+    bool tryPop(T &value)
+    {
+        Node *current = tail;
+        Node *next = current->next.load(memory_order_acquire);
+        if (next == nullptr)
+            return false;
+        value = move(next->value);
+        tail = next;
+        if (current != &stub)
+            delete current;
+        return true;
+    }
+
+private:
+    struct Node
+    {
+        atomic<Node *> next{nullptr};
+        T value;
+    };
+
+    Node stub;
+    atomic<Node *> head;
+    Node *tail;
+};
+
+// Per-worker batch of (file index, result) pairs
+template <typename T>
+class ResultShard
+{
+public:
+    typedef vector<pair<size_t, T>> Batch;
+
+    ResultShard(MpscQueue<Batch> &target, size_t size) : queue(target), batchSize(size) {}
+    ~ResultShard() { flush(); }
+
+    void add(size_t index, T result)
+    {
+        batch.emplace_back(index, move(result));
+        if (batch.size() >= batchSize)
+            flush();
+    }
+
+    void flush()
+    {
+        if (batch.empty())
+            return;
+        queue.push(move(batch));
+        batch = Batch();
+        batch.reserve(batchSize);
+    }
+
+private:
+    MpscQueue<Batch> &queue;
+    size_t batchSize;
+    Batch batch;
+};
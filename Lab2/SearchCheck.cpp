@@ -0,0 +1,121 @@
+// Libraries
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <stdexcept>
+#include "MappedFile.h"
+#include "ContentSearch.h"
+
+using namespace std;
+
+// Checks the matchers of ContentSearch.h against fixed expectations and exits
+// non-zero on the first one that fails:
+//   - Files/Search/Overlap.txt searched for abc b he she his hers gives the 33
+//     hits of grep -o -c summed over the patterns, in increasing offset order,
+//     and the same hits as searching for each pattern on its own
+//   - regular expressions report no empty matches except for ^$
+//   - '^' and '$' are refused where they would apply to one alternative only
+//   - a long line matching only at its end is searched in linear time
+//
+// Usage:
+//   SearchCheck [Files/Search]
+
+// Function Prototypes
+vector<pair<size_t, size_t>> collectHits(const ContentMatcher &matcher, const string &text);
+size_t countRegex(const string &expression, const string &text);
+bool refused(const vector<string> &patterns);
+void expect(bool condition, const string &what);
+
+// Main Function
+int main(int argc, char *argv[])
+{
+    try
+    {
+        string folder = argc > 1 ? argv[1] : "Files/Search";
+        MappedFile file;
+        if (!file.open(folder + "/Overlap.txt"))
+        {
+            cerr << "File could not be opened: " << folder << "/Overlap.txt" << endl;
+            return 1;
+        }
+        string overlap(file.data(), file.size());
+
+        vector<string> literals = {"abc", "b", "he", "she", "his", "hers"};
+        vector<pair<size_t, size_t>> hits = collectHits(*makeMatcher(literals, false), overlap);
+        expect(hits.size() == 33, "Overlap.txt has 33 hits for abc b he she his hers, found " + to_string(hits.size()));
+        for (size_t i = 1; i < hits.size(); i++)
+            expect(hits[i - 1].first <= hits[i].first, "hits are reported in increasing offset order");
+        vector<pair<size_t, size_t>> separate;
+        for (const string &literal : literals)
+        {
+            vector<pair<size_t, size_t>> one = collectHits(*makeMatcher({literal}, false), overlap);
+            separate.insert(separate.end(), one.begin(), one.end());
+        }
+        sort(separate.begin(), separate.end());
+        vector<pair<size_t, size_t>> sorted = hits;
+        sort(sorted.begin(), sorted.end());
+        expect(sorted == separate, "the patterns together find what they find one at a time");
+
+        expect(countRegex("x*", overlap) == 1, "x* reports only the nonempty x of Overlap.txt");
+        expect(countRegex("x*", "a\n\nxx y xxx\n") == 2, "x* reports no empty matches");
+        expect(countRegex("^$", "a\n\nb\n\n") == 2, "^$ reports each empty line");
+        expect(countRegex("h[a-z]*s", overlap) == 5, "h[a-z]*s matches as grep -o does");
+        expect(countRegex("^t.*d$", overlap) == 1, "^t.*d$ matches one whole line");
+
+        expect(refused({"^a", "b"}), "'^' in one of several expressions is refused");
+        expect(refused({"a", "b$"}), "'$' in one of several expressions is refused");
+        expect(refused({"^a|b"}), "'^' before a top-level '|' is refused");
+        expect(!refused({"^(a|b)$"}), "'^' and '$' around a group are accepted");
+
+        string line(1000000, 'x');
+        line += 'y';
+        auto start = chrono::steady_clock::now();
+        size_t lineHits = countRegex("x*z|y", line);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        expect(lineHits == 1, "x*z|y matches once on a line of x ending in y");
+        expect(seconds < 1, "a 1 MB line is searched in linear time, took " + to_string(seconds) + " s");
+
+        cout << "All search checks passed" << endl;
+        return 0;
+    }
+    catch (exception &e)
+    {
+        cout << "Error occurred: " << e.what() << endl;
+        return 1;
+    }
+}
+
+vector<pair<size_t, size_t>> collectHits(const ContentMatcher &matcher, const string &text)
+{
+    vector<pair<size_t, size_t>> hits;
+    matcher.findAll(text.data(), text.size(), [&](size_t offset, size_t length)
+                    { hits.emplace_back(offset, length); });
+    return hits;
+}
+
+size_t countRegex(const string &expression, const string &text)
+{
+    return collectHits(*makeMatcher({expression}, true), text).size();
+}
+
+bool refused(const vector<string> &patterns)
+{
+    try
+    {
+        makeMatcher(patterns, true);
+        return false;
+    }
+    catch (invalid_argument &)
+    {
+        return true;
+    }
+}
+
+void expect(bool condition, const string &what)
+{
+    if (!condition)
+        throw runtime_error("check failed: " + what);
+}
@@ -0,0 +1,264 @@
+// StopWords.h
+// Stop-word lookup for FileHandling.cpp through a minimal-probe perfect hash.
+//
+// Keys are placed with hash-and-displace: a word's 64-bit FNV-1a hash picks a
+// bucket, and every bucket stores the displacement d that sends all of its words
+// to free slots (slot = (a + d * b) & mask, with a and b taken from the hash).
+// A lookup is one hash, one displacement load and one string compare.
+//
+// The built-in English list is laid out at compile time. Language packs
+// (one word per line, '#' starts a comment) are laid out at load time by the
+// same code and queried through the same StopWordTable.
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// How the analyzer turns text into words: letters and digits are kept,
+// lowercased; whitespace ends a word; any other byte is dropped. Pack entries
+// are folded by the same rule, so they match the words they are compared
+// with. The bytes of a multi-byte UTF-8 letter are none of these, so both the
+// text and a pack read "f\xC3\xBCr" as "fr".
+inline bool isWordByte(char c) { return isalnum((unsigned char)c) != 0; }
+inline bool isWordBreak(char c) { return isspace((unsigned char)c) != 0; }
+inline char foldWordByte(char c) { return (char)tolower((unsigned char)c); }
+
+// Largest table a language pack may grow to while it is laid out
+constexpr uint32_t maxStopWordSlots = 1u << 24;
+
+constexpr uint64_t stopWordHash(string_view word)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : word)
+    {
+        hash ^= (unsigned char)c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+constexpr uint32_t stopWordSlot(uint64_t hash, uint32_t displacement, uint32_t slotMask)
+{
+    return ((uint32_t)hash + displacement * ((uint32_t)(hash >> 32) | 1u)) & slotMask;
+}
+
+constexpr uint32_t stopWordBucket(uint64_t hash, uint32_t bucketCount)
+{
+    return (uint32_t)((hash >> 40) % bucketCount);
+}
+
+// Lays out words into slots/displacements. Works on plain pointers so the same
+// code runs in a constexpr context and on vectors at run time. The scratch
+// arrays hold bucketCount + 1, wordCount and bucketCount entries. Returns false
+// if some bucket found no displacement (the caller then retries with more slots).
+constexpr bool layoutStopWords(const string_view *words, size_t wordCount, string_view *slots, uint32_t slotCount,
+                               uint16_t *displacements, uint32_t bucketCount,
+                               uint32_t *bucketStart, uint32_t *members, uint32_t *order)
+{
+    for (uint32_t i = 0; i < slotCount; i++)
+        slots[i] = string_view();
+
+    // Counting sort of the words by bucket: members[bucketStart[b] .. bucketStart[b + 1])
+    for (uint32_t b = 0; b <= bucketCount; b++)
+        bucketStart[b] = 0;
+    for (size_t i = 0; i < wordCount; i++)
+        bucketStart[stopWordBucket(stopWordHash(words[i]), bucketCount) + 1]++;
+    for (uint32_t b = 0; b < bucketCount; b++)
+        bucketStart[b + 1] += bucketStart[b];
+    for (uint32_t b = 0; b < bucketCount; b++)
+    {
+        displacements[b] = 0;
+        order[b] = bucketStart[b];
+    }
+    for (size_t i = 0; i < wordCount; i++)
+        members[order[stopWordBucket(stopWordHash(words[i]), bucketCount)]++] = (uint32_t)i;
+
+    // Place the largest buckets first; they are the hardest to fit
+    for (uint32_t b = 0; b < bucketCount; b++)
+        order[b] = b;
+    for (uint32_t i = 0; i < bucketCount; i++)
+    {
+        uint32_t best = i;
+        for (uint32_t j = i + 1; j < bucketCount; j++)
+        {
+            if (bucketStart[order[j] + 1] - bucketStart[order[j]] > bucketStart[order[best] + 1] - bucketStart[order[best]])
+                best = j;
+        }
+        uint32_t swap = order[i];
+        order[i] = order[best];
+        order[best] = swap;
+    }
+
+    const uint32_t slotMask = slotCount - 1;
+    for (uint32_t k = 0; k < bucketCount; k++)
+    {
+        const uint32_t b = order[k];
+        const uint32_t first = bucketStart[b], last = bucketStart[b + 1];
+        if (first == last)
+            break;
+        bool placed = false;
+        for (uint32_t d = 0; d < 65535 && !placed; d++)
+        {
+            placed = true;
+            for (uint32_t i = first; i < last && placed; i++)
+            {
+                uint32_t slot = stopWordSlot(stopWordHash(words[members[i]]), d, slotMask);
+                if (!slots[slot].empty())
+                    placed = false;
+                // Two words of this bucket landing on the same slot
+                for (uint32_t j = first; j < i && placed; j++)
+                {
+                    if (stopWordSlot(stopWordHash(words[members[j]]), d, slotMask) == slot)
+                        placed = false;
+                }
+            }
+            if (placed)
+            {
+                displacements[b] = (uint16_t)d;
+                for (uint32_t i = first; i < last; i++)
+                    slots[stopWordSlot(stopWordHash(words[members[i]]), d, slotMask)] = words[members[i]];
+            }
+        }
+        if (!placed)
+            return false;
+    }
+    return true;
+}
+
+// Compile-time table over a fixed word list
+template <size_t WordCount, uint32_t SlotCount, uint32_t BucketCount>
+struct StaticStopWordLayout
+{
+    array<string_view, SlotCount> slots{};
+    array<uint16_t, BucketCount> displacements{};
+    bool ok = false;
+};
+
+template <uint32_t SlotCount, uint32_t BucketCount, size_t WordCount>
+constexpr StaticStopWordLayout<WordCount, SlotCount, BucketCount> buildStaticStopWords(const array<string_view, WordCount> &words)
+{
+    StaticStopWordLayout<WordCount, SlotCount, BucketCount> layout;
+    array<uint32_t, BucketCount + 1> bucketStart{};
+    array<uint32_t, WordCount> members{};
+    array<uint32_t, BucketCount> order{};
+    layout.ok = layoutStopWords(words.data(), WordCount, layout.slots.data(), SlotCount, layout.displacements.data(),
+                                BucketCount, bucketStart.data(), members.data(), order.data());
+    return layout;
+}
+
+constexpr array<string_view, 31> builtinStopWordList = {
+    "the", "and", "in", "of", "on", "a", "an", "is", "it", "to", "for", "with",
+    "at", "by", "from", "that", "this", "these", "those", "as", "be", "been",
+    "are", "was", "were", "or", "but", "if", "then", "so", "because"};
+
+constexpr auto builtinStopWords = buildStaticStopWords<64, 16>(builtinStopWordList);
+static_assert(builtinStopWords.ok, "Built-in stop words do not fit the perfect hash table");
+
+class StopWordTable
+{
+public:
+    // The built-in English list; no work at run time
+    StopWordTable()
+        : slots(builtinStopWords.slots.data()), displacements(builtinStopWords.displacements.data()),
+          slotMask((uint32_t)builtinStopWords.slots.size() - 1), bucketCount((uint32_t)builtinStopWords.displacements.size()),
+          wordCount(builtinStopWordList.size())
+    {
+    }
+
+    StopWordTable(const StopWordTable &) = delete;
+    StopWordTable &operator=(const StopWordTable &) = delete;
+
+    // Replace the list with a language pack file. A line holding several
+    // words, once folded, adds each of them.
+    void loadFromFile(const string &path)
+    {
+        ifstream fileRead(path, ios::in);
+        if (!fileRead)
+            throw runtime_error("Stop word file could not be opened: " + path);
+        ownedText.clear();
+        vector<size_t> starts, lengths;
+        string line;
+        while (getline(fileRead, line))
+        {
+            size_t begin = line.find_first_not_of(" \t\r");
+            if (begin == string::npos || line[begin] == '#')
+                continue;
+            size_t start = ownedText.size();
+            for (size_t i = begin; i <= line.size(); i++)
+            {
+                if (i == line.size() || isWordBreak(line[i]))
+                {
+                    if (ownedText.size() > start)
+                    {
+                        starts.push_back(start);
+                        lengths.push_back(ownedText.size() - start);
+                    }
+                    start = ownedText.size();
+                }
+                else if (isWordByte(line[i]))
+                    ownedText += foldWordByte(line[i]);
+            }
+        }
+
+        vector<string_view> words;
+        for (size_t i = 0; i < starts.size(); i++)
+            words.push_back(string_view(ownedText.data() + starts[i], lengths[i]));
+        sort(words.begin(), words.end());
+        words.erase(unique(words.begin(), words.end()), words.end());
+
+        // Load factor 1/2 and about four words per bucket; grow if a layout fails.
+        // Two words with the same 64-bit hash never lay out, so growth stops at
+        // maxStopWordSlots and the pack is rejected.
+        uint32_t slotCount = 16;
+        while (slotCount < 2 * words.size() && slotCount < maxStopWordSlots)
+            slotCount *= 2;
+        for (;; slotCount *= 2)
+        {
+            if (slotCount > maxStopWordSlots || slotCount < 2 * words.size())
+                throw runtime_error("Stop word file could not be laid out in " + to_string(maxStopWordSlots) +
+                                    " slots: " + path);
+            uint32_t buckets = max<uint32_t>(1, (uint32_t)(words.size() + 3) / 4);
+            ownedSlots.assign(slotCount, string_view());
+            ownedDisplacements.assign(buckets, 0);
+            vector<uint32_t> bucketStart(buckets + 1), members(words.size()), order(buckets);
+            if (layoutStopWords(words.data(), words.size(), ownedSlots.data(), slotCount, ownedDisplacements.data(),
+                                buckets, bucketStart.data(), members.data(), order.data()))
+            {
+                bucketCount = buckets;
+                break;
+            }
+        }
+        slots = ownedSlots.data();
+        displacements = ownedDisplacements.data();
+        slotMask = (uint32_t)ownedSlots.size() - 1;
+        wordCount = words.size();
+    }
+
+    bool contains(string_view word) const
+    {
+        uint64_t hash = stopWordHash(word);
+        string_view candidate = slots[stopWordSlot(hash, displacements[stopWordBucket(hash, bucketCount)], slotMask)];
+        return !word.empty() && candidate == word;
+    }
+
+    size_t size() const { return wordCount; }
+
+private:
+    const string_view *slots;
+    const uint16_t *displacements;
+    uint32_t slotMask;
+    uint32_t bucketCount;
+    size_t wordCount;
+    string ownedText;
+    vector<string_view> ownedSlots;
+    vector<uint16_t> ownedDisplacements;
+};
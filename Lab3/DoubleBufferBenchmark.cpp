@@ -0,0 +1,199 @@
+// Libraries
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include "DoubleBufferReader.h"
+#include "../Lab4/PascalSourceGenerator.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Reads a file byte by byte with ifstream::get and with DoubleBufferReader and
+// reports the best of R runs of each. Every byte goes through the same small
+// scanner (lines and words are counted), so the figures include the work the
+// double buffer overlaps with reading.
+//
+// Before each cold run the file is dropped from the page cache with
+// posix_fadvise(POSIX_FADV_DONTNEED), which needs no privileges but only
+// evicts pages that are clean and not mapped elsewhere. Warm runs read it
+// straight from the cache.
+//
+// Usage:
+//   DoubleBufferBenchmark <file> [--size MB] [--runs R] [--half KB]
+// A missing file is first created as a generated Pascal program of MB megabytes.
+
+// Structs
+struct ScanCounts
+{
+    uint64_t bytes = 0;
+    uint64_t lines = 0;
+    uint64_t words = 0;
+
+    bool operator==(const ScanCounts &other) const
+    {
+        return bytes == other.bytes && lines == other.lines && words == other.words;
+    }
+};
+
+// Function Prototypes
+bool dropFromPageCache(const string &path);
+ScanCounts scanWithIfstream(const string &path, double &seconds);
+ScanCounts scanWithDoubleBuffer(const string &path, size_t halfSize, double &seconds);
+
+// Main Function
+int main(int argc, char *argv[])
+{
+    try
+    {
+        string path;
+        size_t sizeMb = 256;
+        size_t halfKb = DoubleBufferReader::defaultHalfSize / 1024;
+        int runs = 3;
+        for (int i = 1; i < argc; i++)
+        {
+            string argument = argv[i];
+            if (argument == "--size" && i + 1 < argc)
+                sizeMb = stoul(argv[++i]);
+            else if (argument == "--runs" && i + 1 < argc)
+                runs = max(1, stoi(argv[++i]));
+            else if (argument == "--half" && i + 1 < argc)
+                halfKb = max<size_t>(4, stoul(argv[++i]));
+            else
+                path = argument;
+        }
+        if (path.empty())
+        {
+            cout << "Usage: DoubleBufferBenchmark file [--size MB] [--runs R] [--half KB]" << endl;
+            return 1;
+        }
+
+        if (!ifstream(path))
+        {
+            string source = PascalSourceGenerator(1).generate(sizeMb * 1024 * 1024);
+            ofstream fileWrite(path, ios::out | ios::binary);
+            fileWrite.write(source.data(), source.size());
+            if (!fileWrite)
+            {
+                cerr << "File could not be created: " << path << endl;
+                return 1;
+            }
+            cout << "Generated " << source.size() << " bytes into " << path << endl;
+        }
+
+        ScanCounts expected;
+        double best[2][2] = {}; // [cold][reader]
+        bool coldWorked = true;
+        for (int r = 0; r < runs; r++)
+        {
+            for (int cold = 1; cold >= 0; cold--)
+            {
+                for (int reader = 0; reader < 2; reader++)
+                {
+                    if (cold)
+                        coldWorked = dropFromPageCache(path) && coldWorked;
+                    double seconds;
+                    ScanCounts counts = reader == 0 ? scanWithIfstream(path, seconds)
+                                                    : scanWithDoubleBuffer(path, halfKb * 1024, seconds);
+                    if (r == 0 && cold && reader == 0)
+                        expected = counts;
+                    else if (!(counts == expected))
+                    {
+                        cerr << "Readers disagree on the contents of " << path << endl;
+                        return 1;
+                    }
+                    if (r == 0 || seconds < best[cold][reader])
+                        best[cold][reader] = seconds;
+                }
+            }
+        }
+
+        double megabytes = expected.bytes / (1024.0 * 1024.0);
+        cout << "File: " << path << ", " << expected.bytes << " bytes, " << expected.lines << " lines, "
+             << expected.words << " words" << endl;
+        if (!coldWorked)
+            cout << "The page cache could not be dropped; cold runs are warm" << endl;
+        static const char *labels[2] = {"ifstream::get     ", "DoubleBufferReader"};
+        for (int cold = 1; cold >= 0; cold--)
+        {
+            for (int reader = 0; reader < 2; reader++)
+            {
+                cout << (cold ? "Cold " : "Warm ") << labels[reader] << "  best of " << runs << ": "
+                     << best[cold][reader] * 1000 << " ms, " << megabytes / best[cold][reader] << " MB/s" << endl;
+            }
+        }
+        return 0;
+    }
+    catch (exception &e)
+    {
+        cout << "Error occurred: " << e.what() << endl;
+        return 1;
+    }
+}
+
+bool dropFromPageCache(const string &path)
+{
+#if !defined(_WIN32) && defined(POSIX_FADV_DONTNEED)
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    fdatasync(fd);
+    bool dropped = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(fd);
+    return dropped;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+// A word is a run of bytes that are not blanks
+struct Scanner
+{
+    ScanCounts counts;
+    bool inWord = false;
+
+    void add(int c)
+    {
+        bool blank = c == ' ' || c == '\n' || c == '\t' || c == '\r';
+        counts.bytes++;
+        counts.lines += c == '\n';
+        counts.words += !blank && !inWord;
+        inWord = !blank;
+    }
+};
+
+ScanCounts scanWithIfstream(const string &path, double &seconds)
+{
+    auto start = chrono::steady_clock::now();
+    ifstream fileRead(path, ios::in | ios::binary);
+    if (!fileRead)
+        throw runtime_error("File could not be opened: " + path);
+    Scanner scanner;
+    char c;
+    while (fileRead.get(c))
+        scanner.add((unsigned char)c);
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return scanner.counts;
+}
+
+ScanCounts scanWithDoubleBuffer(const string &path, size_t halfSize, double &seconds)
+{
+    auto start = chrono::steady_clock::now();
+    DoubleBufferReader reader(halfSize);
+    if (!reader.open(path))
+        throw runtime_error("File could not be opened: " + path);
+    Scanner scanner;
+    for (int c; (c = reader.get()) >= 0;)
+        scanner.add(c);
+    if (reader.error())
+        throw runtime_error("Read error in " + path);
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return scanner.counts;
+}
@@ -0,0 +1,278 @@
+// DoubleBufferReader.h
+// Sentinel-terminated double buffering for scanners, the C++ counterpart of
+// doubleBuffering.py. The file is read into two page-aligned halves by a
+// background thread: while the scanner consumes one half, the other is being
+// filled, so reading overlaps scanning instead of alternating with it.
+//
+// Every filled half is followed by a NUL sentinel. get() only compares the
+// byte with the sentinel; the rare NUL goes to a slow path that tells the end
+// of a half, the end of the file and a NUL inside the data apart. That one
+// compare per byte is all a scanner's hot loop pays for buffering.
+#pragma once
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+class DoubleBufferReader
+{
+public:
+    static const size_t defaultHalfSize = 1 << 20;
+    static const char sentinel = '\0';
+
+    explicit DoubleBufferReader(size_t halfSize = defaultHalfSize)
+    {
+#ifdef _WIN32
+        pageSize = 4096;
+#else
+        pageSize = (size_t)sysconf(_SC_PAGESIZE);
+#endif
+        // Each half is a whole number of pages; the sentinel gets a page of its own
+        capacity = (halfSize + pageSize - 1) / pageSize * pageSize;
+        stride = capacity + pageSize;
+#ifdef _WIN32
+        memory = (char *)_aligned_malloc(2 * stride, pageSize);
+#else
+        void *aligned = nullptr;
+        memory = posix_memalign(&aligned, pageSize, 2 * stride) == 0 ? (char *)aligned : nullptr;
+#endif
+        if (memory == nullptr)
+            throw bad_alloc();
+        halves[0].data = memory;
+        halves[1].data = memory + stride;
+        close();
+    }
+
+    DoubleBufferReader(const DoubleBufferReader &) = delete;
+    DoubleBufferReader &operator=(const DoubleBufferReader &) = delete;
+
+    ~DoubleBufferReader()
+    {
+        close();
+#ifdef _WIN32
+        _aligned_free(memory);
+#else
+        free(memory);
+#endif
+    }
+
+    bool open(const string &path)
+    {
+        close();
+#ifdef _WIN32
+        file.open(path, ios::in | ios::binary);
+        if (!file)
+            return false;
+#else
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+#ifdef POSIX_FADV_SEQUENTIAL
+        // Let the kernel read further ahead than it would for random access
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#endif
+        stopping = false;
+        filler = thread(&DoubleBufferReader::fillHalves, this);
+        unique_lock<mutex> guard(lock);
+        waitForCurrent(guard);
+        return true;
+    }
+
+    void close()
+    {
+        if (filler.joinable())
+        {
+            {
+                lock_guard<mutex> guard(lock);
+                stopping = true;
+            }
+            changed.notify_all();
+            filler.join();
+        }
+#ifdef _WIN32
+        if (file.is_open())
+            file.close();
+#else
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+#endif
+        for (Half &half : halves)
+        {
+            half.full = false;
+            half.length = 0;
+            half.last = false;
+            half.data[0] = sentinel;
+        }
+        current = 0;
+        forward = halves[0].data;
+        limit = forward;
+        atEnd = true;
+        failed = false;
+    }
+
+    // The next byte, or -1 at the end of the file
+    int get()
+    {
+        char c = *forward;
+        if (c != sentinel)
+        {
+            forward++;
+            return (unsigned char)c;
+        }
+        return getAtSentinel();
+    }
+
+    // The next byte without consuming it, or -1 at the end of the file
+    int peek()
+    {
+        char c = *forward;
+        if (c != sentinel)
+            return (unsigned char)c;
+        int next = getAtSentinel();
+        if (next >= 0)
+            forward--;
+        return next;
+    }
+
+    // True when reading stopped because of an I/O error
+    bool error() const { return failed; }
+
+private:
+    struct Half
+    {
+        char *data = nullptr;
+        size_t length = 0;
+        bool full = false; // filled and not yet consumed
+        bool last = false; // nothing follows this half
+    };
+
+    int getAtSentinel()
+    {
+        for (;;)
+        {
+            if (forward != limit)
+                return (unsigned char)*forward++; // a NUL byte in the data
+            if (atEnd)
+                return -1;
+            switchHalf();
+            if (*forward != sentinel)
+                return (unsigned char)*forward++;
+        }
+    }
+
+    // Hands the consumed half back to the filler and waits for the other one
+    void switchHalf()
+    {
+        unique_lock<mutex> guard(lock);
+        halves[current].full = false;
+        changed.notify_all();
+        current ^= 1;
+        waitForCurrent(guard);
+    }
+
+    void waitForCurrent(unique_lock<mutex> &guard)
+    {
+        changed.wait(guard, [this] { return halves[current].full; });
+        forward = halves[current].data;
+        limit = forward + halves[current].length;
+        atEnd = halves[current].last;
+    }
+
+    // Background thread: fills whichever half is free, alternating
+    void fillHalves()
+    {
+        for (int next = 0;; next ^= 1)
+        {
+            Half &half = halves[next];
+            {
+                unique_lock<mutex> guard(lock);
+                changed.wait(guard, [this, &half] { return stopping || !half.full; });
+                if (stopping)
+                    return;
+            }
+            size_t length = 0;
+            bool ioError = false;
+            while (length < capacity)
+            {
+#ifdef _WIN32
+                file.read(half.data + length, capacity - length);
+                size_t count = (size_t)file.gcount();
+                ioError = file.bad();
+#else
+                ssize_t count = ::read(fd, half.data + length, capacity - length);
+                if (count < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    ioError = true;
+                }
+#endif
+                if (count <= 0)
+                    break;
+                length += count;
+            }
+            half.data[length] = sentinel;
+            bool last = length < capacity || ioError;
+#if !defined(_WIN32) && defined(POSIX_FADV_WILLNEED)
+            // Start the disk on the half after this one before it is needed
+            if (!last)
+            {
+                off_t position = lseek(fd, 0, SEEK_CUR);
+                posix_fadvise(fd, position, capacity, POSIX_FADV_WILLNEED);
+            }
+#endif
+            {
+                lock_guard<mutex> guard(lock);
+                half.length = length;
+                half.last = last;
+                half.full = true;
+                failed = failed || ioError;
+            }
+            changed.notify_all();
+            if (last)
+                return;
+        }
+    }
+
+    char *memory = nullptr;
+    size_t pageSize;
+    size_t capacity;
+    size_t stride;
+    Half halves[2];
+
+    // Consumer side
+    int current = 0;
+    const char *forward = nullptr;
+    const char *limit = nullptr; // end of the data in the current half
+    bool atEnd = true;
+
+    // Shared with the filler
+    mutex lock;
+    condition_variable changed;
+    bool stopping = false;
+    bool failed = false;
+    thread filler;
+#ifdef _WIN32
+    ifstream file;
+#else
+    int fd = -1;
+#endif
+};
@@ -0,0 +1,148 @@
+// IdentifierTable.h
+// Interns Pascal identifiers to dense 32-bit ids, so everything after the
+// lexer compares and indexes identifiers by number instead of by string.
+// Identifiers are case-insensitive: Count, COUNT and count get the same id,
+// and name() returns the lowercase spelling.
+//
+// The table is open addressing with linear probing over (hash, id) slots; the
+// names themselves live one after another in a single buffer. Id 0 is never
+// handed out, so it can mean "no identifier".
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+class IdentifierTable
+{
+public:
+    explicit IdentifierTable(size_t expected = 1024)
+    {
+        size_t capacity = 16;
+        while (capacity < expected * 2)
+            capacity *= 2;
+        slots.assign(capacity, Slot{0, 0});
+        ends.push_back(0);
+    }
+
+    // text must hold identifier characters only (letters, digits and '_')
+    uint32_t intern(const char *text, size_t length)
+    {
+        const uint32_t hash = hashFolded(text, length);
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask)
+        {
+            const Slot &slot = slots[i];
+            if (slot.id == 0)
+                break;
+            if (slot.hash == hash && equalsFolded(slot.id, text, length))
+                return slot.id;
+        }
+
+        const uint32_t id = (uint32_t)ends.size();
+        for (size_t i = 0; i < length; i++)
+        {
+            char c = text[i];
+            names += (c >= 'A' && c <= 'Z') ? (char)(c | 0x20) : c;
+        }
+        ends.push_back((uint32_t)names.size());
+        if (ends.size() * 2 > slots.size())
+        {
+            grow();
+            mask = slots.size() - 1;
+        }
+        size_t i = hash & mask;
+        while (slots[i].id != 0)
+            i = (i + 1) & mask;
+        slots[i] = Slot{hash, id};
+        return id;
+    }
+
+    uint32_t intern(string_view text) { return intern(text.data(), text.size()); }
+
+    // Lowercase spelling; valid until the next intern()
+    string_view name(uint32_t id) const { return string_view(names.data() + ends[id - 1], ends[id] - ends[id - 1]); }
+
+    // Ids run from 1 to size()
+    size_t size() const { return ends.size() - 1; }
+
+private:
+    struct Slot
+    {
+        uint32_t hash;
+        uint32_t id;
+    };
+
+    // ORing 0x20 into every byte lowercases letters and leaves digits alone;
+    // '_' becomes 0x7F, which no other identifier character does, so folded
+    // strings are equal exactly when the identifiers are.
+    static const uint64_t foldMask = 0x2020202020202020ull;
+
+    static uint32_t hashFolded(const char *text, size_t length)
+    {
+        uint64_t hash = length * 0x9E3779B97F4A7C15ull;
+        size_t i = 0;
+        for (; i + 8 <= length; i += 8)
+        {
+            uint64_t word;
+            memcpy(&word, text + i, 8);
+            hash = (hash ^ (word | foldMask)) * 0xBF58476D1CE4E5B9ull;
+        }
+        if (i < length)
+        {
+            // Byte by byte: a variable-length memcpy here would be a library call
+            uint64_t word = 0;
+            for (unsigned shift = 0; i < length; i++, shift += 8)
+                word |= (uint64_t)(unsigned char)(text[i] | 0x20) << shift;
+            hash = (hash ^ word) * 0xBF58476D1CE4E5B9ull;
+        }
+        return (uint32_t)(hash ^ (hash >> 29) ^ (hash >> 47));
+    }
+
+    bool equalsFolded(uint32_t id, const char *text, size_t length) const
+    {
+        if (ends[id] - ends[id - 1] != length)
+            return false;
+        const char *stored = names.data() + ends[id - 1];
+        size_t i = 0;
+        for (; i + 8 <= length; i += 8)
+        {
+            uint64_t a, b;
+            memcpy(&a, stored + i, 8);
+            memcpy(&b, text + i, 8);
+            if ((a | foldMask) != (b | foldMask))
+                return false;
+        }
+        for (; i < length; i++)
+        {
+            if ((stored[i] | 0x20) != (text[i] | 0x20))
+                return false;
+        }
+        return true;
+    }
+
+    void grow()
+    {
+        vector<Slot> old(slots.size() * 2, Slot{0, 0});
+        old.swap(slots);
+        const size_t mask = slots.size() - 1;
+        for (const Slot &slot : old)
+        {
+            if (slot.id == 0)
+                continue;
+            size_t i = slot.hash & mask;
+            while (slots[i].id != 0)
+                i = (i + 1) & mask;
+            slots[i] = slot;
+        }
+    }
+
+    vector<Slot> slots;
+    string names;
+    vector<uint32_t> ends; // name of id k is names[ends[k - 1], ends[k])
+};
@@ -0,0 +1,152 @@
+// Libraries
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_set>
+#include <chrono>
+#include <algorithm>
+#include <random>
+#include <cstdint>
+#include "../Lab2/MappedFile.h"
+#include "PascalLexer.h"
+#include "PascalSourceGenerator.h"
+
+using namespace std;
+
+// Times keyword classification alone. Every word of a source file (or of a
+// generated program) is classified by pascalKeyword, the perfect hash the
+// lexer uses, and by the approach of LexicalAnalyzer.py: lowercase a copy and
+// look it up in an unordered_set of the reserved words. Both must agree on
+// every word. --mixed-case changes the case of random letters first, since
+// keywords are case-insensitive.
+//
+// Usage:
+//   KeywordBenchmark [source.pas] [--size MB] [--runs R] [--seed N] [--mixed-case]
+
+// Function Prototypes
+double timeLookups(const vector<string_view> &words, int runs, uint64_t &keywords, bool perfectHash,
+                   const unordered_set<string> &reserved);
+
+// Main Function
+int main(int argc, char *argv[])
+{
+    try
+    {
+        string sourcePath;
+        size_t sizeMb = 16;
+        int runs = 5;
+        uint64_t seed = 1;
+        bool mixedCase = false;
+        for (int i = 1; i < argc; i++)
+        {
+            string argument = argv[i];
+            if (argument == "--size" && i + 1 < argc)
+                sizeMb = stoul(argv[++i]);
+            else if (argument == "--runs" && i + 1 < argc)
+                runs = max(1, stoi(argv[++i]));
+            else if (argument == "--seed" && i + 1 < argc)
+                seed = stoull(argv[++i]);
+            else if (argument == "--mixed-case")
+                mixedCase = true;
+            else
+                sourcePath = argument;
+        }
+
+        MappedFile file;
+        string source;
+        if (!sourcePath.empty())
+        {
+            if (!file.open(sourcePath))
+            {
+                cerr << "File could not be opened: " << sourcePath << endl;
+                return 1;
+            }
+            source.assign(file.data(), file.size());
+        }
+        else
+            source = PascalSourceGenerator(seed).generate(sizeMb * 1024 * 1024);
+        if (mixedCase)
+        {
+            mt19937_64 random(seed);
+            for (char &c : source)
+            {
+                if ((pascalCharClass(c) & CHAR_LETTER) && random() % 3 == 0)
+                    c ^= 0x20;
+            }
+        }
+
+        vector<string_view> words;
+        PascalLexer lexer(source.data(), source.size());
+        for (Token token = lexer.next(); token.kind != TOKEN_EOF; token = lexer.next())
+        {
+            if (token.kind == TOKEN_KEYWORD || token.kind == TOKEN_ID)
+                words.push_back(token.lexeme);
+        }
+
+        unordered_set<string> reserved;
+        for (size_t length = 2; length < 10; length++)
+        {
+            for (const char *k = PascalCharTable::pascalKeywordsByLength[length]; *k; k += length + 1)
+                reserved.insert(string(k, length));
+        }
+
+        uint64_t hashed = 0, looked = 0;
+        double hashSeconds = timeLookups(words, runs, hashed, true, reserved);
+        double setSeconds = timeLookups(words, runs, looked, false, reserved);
+        for (string_view word : words)
+        {
+            string lower(word);
+            for (char &c : lower)
+                c = (char)tolower((unsigned char)c);
+            if (isPascalKeyword(word.data(), word.size()) != (reserved.count(lower) != 0))
+            {
+                cout << "The two lookups disagree on " << word << endl;
+                return 1;
+            }
+        }
+
+        cout << "Words: " << words.size() << ", keywords: " << hashed << (mixedCase ? " (mixed case)" : "") << endl;
+        cout << "Perfect hash: " << hashSeconds * 1e9 / words.size() << " ns per word" << endl;
+        cout << "Lowercase copy and unordered_set: " << setSeconds * 1e9 / words.size() << " ns per word, "
+             << setSeconds / hashSeconds << "x" << endl;
+        return hashed == looked ? 0 : 1;
+    }
+    catch (exception &e)
+    {
+        cout << "Error occurred: " << e.what() << endl;
+        return 1;
+    }
+}
+
+// Best of runs
+double timeLookups(const vector<string_view> &words, int runs, uint64_t &keywords, bool perfectHash,
+                   const unordered_set<string> &reserved)
+{
+    double best = 0;
+    for (int r = 0; r < runs; r++)
+    {
+        uint64_t count = 0;
+        auto start = chrono::steady_clock::now();
+        if (perfectHash)
+        {
+            for (string_view word : words)
+                count += pascalKeyword(word.data(), word.size()) != KEYWORD_NONE;
+        }
+        else
+        {
+            for (string_view word : words)
+            {
+                string lower(word);
+                for (char &c : lower)
+                    c = (char)tolower((unsigned char)c);
+                count += reserved.count(lower);
+            }
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (r == 0 || seconds < best)
+            best = seconds;
+        keywords = count;
+    }
+    return best;
+}
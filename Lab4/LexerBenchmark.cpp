@@ -0,0 +1,207 @@
+// Libraries
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include "../Lab2/MappedFile.h"
+#include "PascalLexer.h"
+#include "PascalSourceGenerator.h"
+
+using namespace std;
+
+// Single-core throughput of PascalLexer.
+// Lexes a source file, or a generated program when no file is given, R times
+// and reports the best run. Tokens are only counted, not printed, so the
+// figure is the cost of scanning alone. For scale, the same buffer is also
+// run through a plain character-class loop (one table lookup per byte, like
+// the Lab2 classify pass), which bounds what a byte-at-a-time scanner can do
+// on the machine. With --intern the lexer also interns identifiers into an
+// IdentifierTable, as the compiler front end has it do.
+//
+// --shape reshapes the generated program to stress one kind of run:
+// "comments" puts a few lines of { } or (* *) prose after every line, and
+// "identifiers" gives every identifier a long suffix. Build once with and
+// once without -mavx2 to compare the block scanners with the scalar ones.
+//
+// Usage:
+//   LexerBenchmark [source.pas] [--size MB] [--runs R] [--seed N] [--intern]
+//                  [--shape code|comments|identifiers] [--dump]
+// --dump writes the (reshaped) source to standard output instead.
+
+// Structs
+struct LexerRun
+{
+    double seconds = 0;
+    uint64_t tokens = 0;
+    uint64_t kinds[TOKEN_KIND_COUNT] = {};
+    uint64_t lexemeBytes = 0;
+};
+
+// Function Prototypes
+LexerRun lexOnce(const char *data, size_t size, bool intern);
+double classifyOnce(const char *data, size_t size, uint64_t &spaces);
+string reshape(const string &source, const string &shape);
+
+// Main Function
+int main(int argc, char *argv[])
+{
+    try
+    {
+        string sourcePath;
+        size_t sizeMb = 64;
+        int runs = 5;
+        uint64_t seed = 1;
+        bool intern = false, dump = false;
+        string shape = "code";
+        for (int i = 1; i < argc; i++)
+        {
+            string argument = argv[i];
+            if (argument == "--size" && i + 1 < argc)
+                sizeMb = stoul(argv[++i]);
+            else if (argument == "--runs" && i + 1 < argc)
+                runs = max(1, stoi(argv[++i]));
+            else if (argument == "--seed" && i + 1 < argc)
+                seed = stoull(argv[++i]);
+            else if (argument == "--intern")
+                intern = true;
+            else if (argument == "--shape" && i + 1 < argc)
+                shape = argv[++i];
+            else if (argument == "--dump")
+                dump = true;
+            else
+                sourcePath = argument;
+        }
+
+        MappedFile file;
+        string generated;
+        const char *data;
+        size_t size;
+        if (!sourcePath.empty())
+        {
+            if (!file.open(sourcePath))
+            {
+                cerr << "File could not be opened: " << sourcePath << endl;
+                return 1;
+            }
+            data = file.data();
+            size = file.size();
+        }
+        else
+        {
+            generated = reshape(PascalSourceGenerator(seed).generate(sizeMb * 1024 * 1024), shape);
+            data = generated.data();
+            size = generated.size();
+        }
+
+        if (dump)
+        {
+            cout.write(data, size);
+            return 0;
+        }
+
+        LexerRun best;
+        double bestClassify = 0;
+        uint64_t spaces = 0;
+        for (int r = 0; r < runs; r++)
+        {
+            LexerRun run = lexOnce(data, size, intern);
+            if (r == 0 || run.seconds < best.seconds)
+                best = run;
+            double seconds = classifyOnce(data, size, spaces);
+            if (r == 0 || seconds < bestClassify)
+                bestClassify = seconds;
+        }
+        double megabytes = size / (1024.0 * 1024.0);
+        cout << "Source: " << (sourcePath.empty() ? "generated, " + shape : sourcePath) << ", " << size << " bytes"
+#if defined(__AVX2__)
+             << ", AVX2 scanning" << endl;
+#else
+             << ", scalar scanning" << endl;
+#endif
+        cout << "Tokens: " << best.tokens << " (";
+        for (int k = 0; k < TOKEN_KIND_COUNT; k++)
+            cout << (k ? ", " : "") << tokenKindName(k) << " " << best.kinds[k];
+        cout << ")" << endl;
+        cout << "Best of " << runs << ": " << best.seconds * 1000 << " ms, " << megabytes / best.seconds
+             << " MB/s, " << best.tokens / best.seconds / 1e6 << " M tokens/s" << endl;
+        cout << "Character-class loop over the same bytes: " << megabytes / bestClassify << " MB/s (" << spaces
+             << " blanks)" << endl;
+        return 0;
+    }
+    catch (exception &e)
+    {
+        cout << "Error occurred: " << e.what() << endl;
+        return 1;
+    }
+}
+
+LexerRun lexOnce(const char *data, size_t size, bool intern)
+{
+    LexerRun run;
+    auto start = chrono::steady_clock::now();
+    IdentifierTable identifiers;
+    PascalLexer lexer(data, size, intern ? &identifiers : nullptr);
+    for (;;)
+    {
+        Token token = lexer.next();
+        run.kinds[token.kind]++;
+        run.lexemeBytes += token.lexeme.size();
+        if (token.kind == TOKEN_EOF)
+            break;
+    }
+    run.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    for (uint64_t count : run.kinds)
+        run.tokens += count;
+    return run;
+}
+
+double classifyOnce(const char *data, size_t size, uint64_t &spaces)
+{
+    auto start = chrono::steady_clock::now();
+    uint64_t count = 0;
+    for (size_t i = 0; i < size; i++)
+        count += pascalCharClass(data[i]) & CHAR_SPACE;
+    spaces = count;
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Rebuilds the source token by token; the shapes keep it a valid program
+string reshape(const string &source, const string &shape)
+{
+    if (shape == "code")
+        return source;
+    if (shape != "comments" && shape != "identifiers")
+        throw runtime_error("unknown shape " + shape);
+    static const char *prose[] = {"the loop below walks the table once and keeps a running total of the entries",
+                                  "every call passes the bound and the accumulator by value, so nothing is shared",
+                                  "the result is only used by the caller when the flag is set"};
+    string out;
+    out.reserve(source.size() * 3);
+    size_t lineNumber = 0;
+    const char *lineEnd = source.data();
+    PascalLexer lexer(source.data(), source.size());
+    for (Token token = lexer.next(); token.kind != TOKEN_EOF; token = lexer.next())
+    {
+        // Copy what lies between tokens, and add a comment after each line
+        for (const char *p = lineEnd; p < token.lexeme.data(); p++)
+        {
+            out += *p;
+            if (*p == '\n' && shape == "comments")
+            {
+                lineNumber++;
+                if (lineNumber % 2 == 0)
+                    out += "{ " + string(prose[lineNumber % 3]) + "\n  " + prose[(lineNumber + 1) % 3] + " }\n";
+                else
+                    out += "(* " + string(prose[lineNumber % 3]) + " *)\n";
+            }
+        }
+        out += token.lexeme;
+        if (token.kind == TOKEN_ID && shape == "identifiers")
+            out += "_of_the_generated_program";
+        lineEnd = token.lexeme.data() + token.lexeme.size();
+    }
+    out.append(lineEnd, source.data() + source.size());
+    return out;
+}
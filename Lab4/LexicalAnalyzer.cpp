@@ -0,0 +1,67 @@
+// Libraries
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "../Lab2/MappedFile.h"
+#include "PascalLexer.h"
+#include "TokenStream.h"
+
+using namespace std;
+
+// Native counterpart of LexicalAnalyzer.py with the same output format.
+// With --binary it writes the tokens as a TokenStream instead, which later
+// tools can map and read back without lexing the source again.
+//
+// Usage:
+//   LexicalAnalyzer <input.pas> <output.txt> [--binary]
+
+// Main Function
+int main(int argc, char *argv[])
+{
+    try
+    {
+        if (argc < 3)
+        {
+            cout << "Usage: LexicalAnalyzer inputfileName outputfileName [--binary]" << endl;
+            return 1;
+        }
+        MappedFile source;
+        if (!source.open(argv[1]))
+        {
+            cerr << "File could not be opened: " << argv[1] << endl;
+            return 1;
+        }
+        ofstream fileOutput(argv[2], ios::out | ios::binary);
+        if (!fileOutput)
+        {
+            cerr << "Output file could not be created: " << argv[2] << endl;
+            return 1;
+        }
+        vector<char> outputBuffer(1 << 20);
+        fileOutput.rdbuf()->pubsetbuf(outputBuffer.data(), outputBuffer.size());
+
+        bool binary = argc > 3 && string(argv[3]) == "--binary";
+        PascalLexer lexer(source.data(), source.size());
+        TokenStreamWriter stream(source.data(), source.size());
+        Token token;
+        do
+        {
+            token = lexer.next();
+            if (binary)
+                stream.add(token);
+            else
+                writeToken(fileOutput, token);
+        } while (token.kind != TOKEN_EOF);
+        if (binary)
+            stream.write(fileOutput);
+        fileOutput.close();
+        cout << "Lexical analysis complete. Tokens written to " << argv[2] << endl;
+        return 0;
+    }
+    catch (exception &e)
+    {
+        cout << "Error occurred: " << e.what() << endl;
+        return 1;
+    }
+}
@@ -0,0 +1,586 @@
+// PascalLexer.h
+// Native lexer for the Pascal subset of Lab4 (Subset_of_Pascal.txt and the
+// lexical conventions in A.4). It recognizes the same tokens as
+// LexicalAnalyzer.py and prints them in the same "TOKEN\tlexeme\tline:col"
+// format.
+//
+// The lexer scans one contiguous buffer (usually a MappedFile) and hands out
+// lexemes as string_views into it, so nothing is copied or allocated per
+// token. Characters are classified through one 256-entry table, the same
+// approach as the classification pass of the Lab2 file analysis. Keywords are
+// found through a perfect hash of the length and the first and last letters.
+//
+// The runs that make up most of a source, identifiers, blanks and comments,
+// are scanned a block at a time: 16 bytes with SSE2 for identifiers, and 32
+// bytes with AVX2 (build with -mavx2 or -march=native) for all three. An AVX2
+// block also yields a mask of its newlines, so lines are counted with popcount
+// and the column base is found from the last newline, without a second pass.
+//
+// Keyword tokens carry their PascalKeyword in Token::id. Given an
+// IdentifierTable, the lexer also interns every identifier and puts its id
+// there, so later passes never hash the same name twice.
+//
+// Differences from LexicalAnalyzer.py: numbers follow A.4 (digits, an
+// optional fraction and an optional exponent, so 3.14 and 1E-5 are one NUM),
+// and only ASCII letters start identifiers.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string_view>
+#include "IdentifierTable.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+enum TokenKind : uint8_t
+{
+    TOKEN_KEYWORD,
+    TOKEN_ID,
+    TOKEN_NUM,
+    TOKEN_OP,
+    TOKEN_DELIM,
+    TOKEN_STRING,
+    TOKEN_UNKNOWN,
+    TOKEN_EOF,
+    TOKEN_KIND_COUNT
+};
+
+inline const char *tokenKindName(int kind)
+{
+    static const char *names[TOKEN_KIND_COUNT] = {"KEYWORD", "ID", "NUM", "OP", "DELIM", "STRING", "UNKNOWN", "EOF"};
+    return names[kind];
+}
+
+struct Token
+{
+    TokenKind kind;
+    string_view lexeme;
+    uint32_t line;
+    uint32_t column;
+    uint32_t id = 0; // PascalKeyword of a KEYWORD; interned id of an ID when the lexer has an IdentifierTable
+};
+
+// Reserved words, in the order of PascalCharTable::pascalKeywordsByLength
+enum PascalKeyword : uint8_t
+{
+    KEYWORD_NONE,
+    KEYWORD_OF,
+    KEYWORD_IF,
+    KEYWORD_DO,
+    KEYWORD_OR,
+    KEYWORD_TO,
+    KEYWORD_VAR,
+    KEYWORD_END,
+    KEYWORD_DIV,
+    KEYWORD_MOD,
+    KEYWORD_AND,
+    KEYWORD_NOT,
+    KEYWORD_FOR,
+    KEYWORD_THEN,
+    KEYWORD_ELSE,
+    KEYWORD_REAL,
+    KEYWORD_BEGIN,
+    KEYWORD_ARRAY,
+    KEYWORD_WHILE,
+    KEYWORD_CONST,
+    KEYWORD_RETURN,
+    KEYWORD_DOWNTO,
+    KEYWORD_PROGRAM,
+    KEYWORD_INTEGER,
+    KEYWORD_FUNCTION,
+    KEYWORD_PROCEDURE
+};
+
+// Character classes
+enum : uint8_t
+{
+    CHAR_SPACE = 1,
+    CHAR_LETTER = 2,
+    CHAR_DIGIT = 4,
+    CHAR_IDENT = 8 // letters, digits and '_'
+};
+
+// What a character starts; next() dispatches on this with one jump
+enum : uint8_t
+{
+    START_OTHER,
+    START_SPACE,
+    START_NEWLINE,
+    START_LETTER,
+    START_DIGIT,
+    START_OPERATOR,    // + - * / =
+    START_LESS,        // < <= <>
+    START_GREATER,     // > >= and : :=
+    START_DELIMITER,   // ; , ) [ ]
+    START_DOT,         // . ..
+    START_PAREN,       // ( or a (* comment *)
+    START_BRACE,       // { comment }
+    START_QUOTE
+};
+
+struct PascalCharTable
+{
+    uint8_t classes[256];
+    uint8_t starts[256];
+    uint8_t keywordSlots[64];   // PascalKeyword by keywordHash, KEYWORD_NONE for free slots
+    const char *keywordText[26]; // by PascalKeyword, lowercase, ending at the next '|'
+    uint8_t keywordLength[26];
+    bool keywordHashCollides;    // checked below; the hash must be perfect for this list
+
+    constexpr PascalCharTable()
+        : classes(), starts(), keywordSlots(), keywordText(), keywordLength(), keywordHashCollides(false)
+    {
+        for (int c = 0; c < 256; c++)
+        {
+            uint8_t bits = 0;
+            uint8_t start = START_OTHER;
+            if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f')
+            {
+                bits |= CHAR_SPACE;
+                start = c == '\n' ? START_NEWLINE : START_SPACE;
+            }
+            if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+            {
+                bits |= CHAR_LETTER | CHAR_IDENT;
+                start = START_LETTER;
+            }
+            if (c >= '0' && c <= '9')
+            {
+                bits |= CHAR_DIGIT | CHAR_IDENT;
+                start = START_DIGIT;
+            }
+            if (c == '_')
+                bits |= CHAR_IDENT;
+            if (c == '+' || c == '-' || c == '*' || c == '/' || c == '=')
+                start = START_OPERATOR;
+            if (c == '<')
+                start = START_LESS;
+            if (c == '>' || c == ':')
+                start = START_GREATER;
+            if (c == ';' || c == ',' || c == ')' || c == '[' || c == ']')
+                start = START_DELIMITER;
+            if (c == '.')
+                start = START_DOT;
+            if (c == '(')
+                start = START_PAREN;
+            if (c == '{')
+                start = START_BRACE;
+            if (c == '\'')
+                start = START_QUOTE;
+            classes[c] = bits;
+            starts[c] = start;
+        }
+        uint8_t keyword = KEYWORD_OF;
+        for (size_t length = 2; length < 10; length++)
+        {
+            for (const char *k = pascalKeywordsByLength[length]; *k; k += length + 1, keyword++)
+            {
+                uint8_t &slot = keywordSlots[keywordHash(length, k[0], k[length - 1])];
+                keywordHashCollides |= slot != KEYWORD_NONE;
+                slot = keyword;
+                keywordText[keyword] = k;
+                keywordLength[keyword] = (uint8_t)length;
+            }
+        }
+    }
+
+    // Case-insensitive: letters are lowered by setting bit 5. The constants
+    // were searched for so that the 25 keywords land in distinct slots.
+    static constexpr unsigned keywordHash(size_t length, char first, char last)
+    {
+        return ((unsigned)(length << 2) + ((unsigned char)(first | 0x20) << 1) + (unsigned char)(last | 0x20) * 7u) & 63;
+    }
+
+    // Lowercase keywords of each length, each followed by '|'
+    static constexpr const char *pascalKeywordsByLength[10] = {
+        "",
+        "",
+        "of|if|do|or|to|",
+        "var|end|div|mod|and|not|for|",
+        "then|else|real|",
+        "begin|array|while|const|",
+        "return|downto|",
+        "program|integer|",
+        "function|",
+        "procedure|"};
+};
+
+constexpr PascalCharTable pascalChars;
+static_assert(!pascalChars.keywordHashCollides, "keywordHash is not perfect for the keyword list");
+
+inline uint8_t pascalCharClass(char c) { return pascalChars.classes[(unsigned char)c]; }
+
+// Keywords are reserved and case-insensitive. One slot of the perfect hash
+// is the only candidate, so an identifier costs a table load, a length check
+// and at most one memcmp against a lowered copy on the stack.
+inline PascalKeyword pascalKeyword(const char *text, size_t length)
+{
+    if (length < 2 || length > 9)
+        return KEYWORD_NONE;
+    const unsigned keyword = pascalChars.keywordSlots[PascalCharTable::keywordHash(length, text[0], text[length - 1])];
+    if (pascalChars.keywordLength[keyword] != length)
+        return KEYWORD_NONE;
+    char lower[9];
+    for (size_t i = 0; i < length; i++)
+        lower[i] = (char)(text[i] | 0x20); // identifier characters only, so this is tolower
+    return memcmp(pascalChars.keywordText[keyword], lower, length) == 0 ? (PascalKeyword)keyword : KEYWORD_NONE;
+}
+
+inline bool isPascalKeyword(const char *text, size_t length) { return pascalKeyword(text, length) != KEYWORD_NONE; }
+
+class PascalLexer
+{
+public:
+    PascalLexer(const char *data, size_t size, IdentifierTable *identifiers = nullptr)
+        : cursor(data), end(data + size), lineStart(data), identifiers(identifiers)
+    {
+    }
+
+    // Continues from a point between tokens, on line atLine, which starts at
+    // atLineStart; used to re-lex the edited part of a file
+    void resume(const char *at, uint32_t atLine, const char *atLineStart)
+    {
+        cursor = at;
+        line = atLine;
+        lineStart = atLineStart;
+    }
+
+    // Returns TOKEN_EOF at the end, and keeps returning it
+    Token next()
+    {
+        const char *p = cursor;
+        for (;;)
+        {
+            // Blanks between tokens are the commonest input; skip them before dispatching
+            while (p < end && *p == ' ')
+                p++;
+            if (p == end)
+            {
+                cursor = p;
+                return Token{TOKEN_EOF, string_view("<EOF>"), line, (uint32_t)(p - lineStart)};
+            }
+            const char *start = p;
+            TokenKind kind;
+            uint32_t id = 0;
+            switch (pascalChars.starts[(unsigned char)*p])
+            {
+            case START_SPACE:
+                p++;
+                continue;
+            case START_NEWLINE:
+                p = skipBlankLines(p);
+                continue;
+            case START_LETTER:
+                p = scanIdentifier(p);
+                id = pascalKeyword(start, p - start);
+                kind = id != KEYWORD_NONE ? TOKEN_KEYWORD : TOKEN_ID;
+                if (kind == TOKEN_ID && identifiers != nullptr)
+                    id = identifiers->intern(start, p - start);
+                break;
+            case START_DIGIT:
+                p = scanNumber(p);
+                kind = TOKEN_NUM;
+                break;
+            case START_OPERATOR:
+                p++;
+                kind = TOKEN_OP;
+                break;
+            case START_LESS:
+                p += (p + 1 < end && (p[1] == '=' || p[1] == '>')) ? 2 : 1;
+                kind = TOKEN_OP;
+                break;
+            case START_GREATER:
+                p += (p + 1 < end && p[1] == '=') ? 2 : 1;
+                kind = TOKEN_OP;
+                break;
+            case START_DELIMITER:
+                p++;
+                kind = TOKEN_DELIM;
+                break;
+            case START_DOT:
+                p += (p + 1 < end && p[1] == '.') ? 2 : 1;
+                kind = TOKEN_DELIM;
+                break;
+            case START_PAREN:
+                if (p + 1 < end && p[1] == '*')
+                {
+                    p = skipParenComment(p);
+                    continue;
+                }
+                p++;
+                kind = TOKEN_DELIM;
+                break;
+            case START_BRACE:
+                p = skipBraceComment(p);
+                continue;
+            case START_QUOTE:
+            {
+                // Lines are counted after the token, whose position is its start
+                const uint32_t startLine = line;
+                const uint32_t startColumn = (uint32_t)(p - lineStart) + 1;
+                p = advanceCountingLines(p, scanString(p));
+                cursor = p;
+                return Token{TOKEN_STRING, string_view(start, p - start), startLine, startColumn};
+            }
+            default:
+                p++;
+                kind = TOKEN_UNKNOWN;
+                break;
+            }
+            cursor = p;
+            return Token{kind, string_view(start, p - start), line, (uint32_t)(start - lineStart) + 1, id};
+        }
+    }
+
+private:
+    void newline(const char *at)
+    {
+        line++;
+        lineStart = at + 1;
+    }
+
+#if defined(__AVX2__)
+    static __m256i load32(const char *p) { return _mm256_loadu_si256((const __m256i *)p); }
+
+    static uint32_t byteMask(__m256i bytes, char c)
+    {
+        return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(c)));
+    }
+
+    // Bit i is set when p[i] is a letter, digit or '_'
+    static uint32_t identifierMask(const char *p)
+    {
+        const __m256i bytes = load32(p);
+        // Shift each range to start at -128 so one signed compare tests it
+        const __m256i lower = _mm256_or_si256(bytes, _mm256_set1_epi8(0x20));
+        const __m256i letter = _mm256_cmpgt_epi8(_mm256_set1_epi8(-128 + 26),
+                                                 _mm256_add_epi8(lower, _mm256_set1_epi8((char)(-128 - 'a'))));
+        const __m256i digit = _mm256_cmpgt_epi8(_mm256_set1_epi8(-128 + 10),
+                                                _mm256_add_epi8(bytes, _mm256_set1_epi8((char)(-128 - '0'))));
+        const __m256i underscore = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('_'));
+        return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(letter, digit), underscore));
+    }
+
+    // Bit i is set when byte i is a space or one of \t \n \v \f \r (9 to 13)
+    static uint32_t blankMask(__m256i bytes)
+    {
+        const __m256i control = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, _mm256_set1_epi8(8)),
+                                                 _mm256_cmpgt_epi8(_mm256_set1_epi8(14), bytes));
+        const __m256i space = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' '));
+        return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(control, space));
+    }
+
+    // Bits below the lowest set bit of a non-zero mask
+    static uint32_t before(uint32_t mask) { return (mask & (0u - mask)) - 1; }
+
+    // Counts the newlines of a block from its mask
+    void newlines(const char *block, uint32_t mask)
+    {
+        if (mask != 0)
+        {
+            line += (uint32_t)__builtin_popcount(mask);
+            lineStart = block + (31 - __builtin_clz(mask)) + 1;
+        }
+    }
+#elif defined(__SSE2__)
+    // Bit i is set when p[i] is a letter, digit or '_'
+    static unsigned identifierMask(const char *p)
+    {
+        const __m128i bytes = _mm_loadu_si128((const __m128i *)p);
+        // Shift each range to start at -128 so one signed compare tests it
+        const __m128i lower = _mm_or_si128(bytes, _mm_set1_epi8(0x20));
+        const __m128i letter = _mm_cmplt_epi8(_mm_add_epi8(lower, _mm_set1_epi8((char)(-128 - 'a'))),
+                                              _mm_set1_epi8(-128 + 26));
+        const __m128i digit = _mm_cmplt_epi8(_mm_add_epi8(bytes, _mm_set1_epi8((char)(-128 - '0'))),
+                                             _mm_set1_epi8(-128 + 10));
+        const __m128i underscore = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('_'));
+        return (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(letter, digit), underscore));
+    }
+#endif
+
+    // Identifiers are measured a block at a time, so the loop runs once for
+    // almost every identifier instead of once per character
+    const char *scanIdentifier(const char *p)
+    {
+        p++;
+#if defined(__AVX2__)
+        while (end - p >= 32)
+        {
+            uint32_t stop = ~identifierMask(p);
+            if (stop != 0)
+                return p + __builtin_ctz(stop);
+            p += 32;
+        }
+#elif defined(__SSE2__)
+        while (end - p >= 16)
+        {
+            unsigned stop = ~identifierMask(p) & 0xFFFF;
+            if (stop != 0)
+                return p + __builtin_ctz(stop);
+            p += 16;
+        }
+#endif
+        while (p < end && (pascalCharClass(*p) & CHAR_IDENT))
+            p++;
+        return p;
+    }
+
+    // A newline and the blanks after it: the indent of the next line, and
+    // any empty lines. One AVX2 block usually covers the whole run.
+    const char *skipBlankLines(const char *p)
+    {
+#if defined(__AVX2__)
+        while (end - p >= 32)
+        {
+            const __m256i bytes = load32(p);
+            const uint32_t stop = ~blankMask(bytes);
+            const uint32_t lineEnds = byteMask(bytes, '\n');
+            if (stop != 0)
+            {
+                newlines(p, lineEnds & before(stop));
+                return p + __builtin_ctz(stop);
+            }
+            newlines(p, lineEnds);
+            p += 32;
+        }
+        // Near the end of the buffer next() takes the rest one blank at a time
+        if (p == end || *p != '\n')
+            return p;
+#endif
+        newline(p++);
+        return p;
+    }
+
+    // Comments and strings may span lines; memchr finds the newlines
+    const char *advanceCountingLines(const char *from, const char *to)
+    {
+        const char *newlineAt;
+        while ((newlineAt = (const char *)memchr(from, '\n', to - from)) != nullptr)
+        {
+            newline(newlineAt);
+            from = newlineAt + 1;
+        }
+        return to;
+    }
+
+    // Looks for the '}' and counts newlines in the same pass
+    const char *skipBraceComment(const char *p)
+    {
+        p++;
+#if defined(__AVX2__)
+        while (end - p >= 32)
+        {
+            const __m256i bytes = load32(p);
+            const uint32_t close = byteMask(bytes, '}');
+            const uint32_t lineEnds = byteMask(bytes, '\n');
+            if (close != 0)
+            {
+                newlines(p, lineEnds & before(close));
+                return p + __builtin_ctz(close) + 1;
+            }
+            newlines(p, lineEnds);
+            p += 32;
+        }
+#endif
+        const char *close = (const char *)memchr(p, '}', end - p);
+        return advanceCountingLines(p, close ? close + 1 : end);
+    }
+
+    // The star after "(" cannot also close the comment, so "(*)" does not
+    const char *skipParenComment(const char *p)
+    {
+        const char *search = p + 2;
+#if defined(__AVX2__)
+        // A second load one byte later lines each '*' up with the byte after it
+        while (end - search >= 33)
+        {
+            const __m256i bytes = load32(search);
+            const uint32_t close = byteMask(bytes, '*') & byteMask(load32(search + 1), ')');
+            const uint32_t lineEnds = byteMask(bytes, '\n');
+            if (close != 0)
+            {
+                newlines(search, lineEnds & before(close));
+                return search + __builtin_ctz(close) + 2;
+            }
+            newlines(search, lineEnds);
+            search += 32;
+        }
+        p = search; // the lines before search are counted
+#endif
+        for (;;)
+        {
+            const char *star = (const char *)memchr(search, '*', end - search);
+            if (star == nullptr || star + 1 == end)
+                return advanceCountingLines(p, end);
+            if (star[1] == ')')
+                return advanceCountingLines(p, star + 2);
+            search = star + 1;
+        }
+    }
+
+    // A quote inside a string is written twice; an unterminated string runs to the end
+    const char *scanString(const char *p)
+    {
+        const char *search = p + 1;
+        for (;;)
+        {
+            const char *quote = (const char *)memchr(search, '\'', end - search);
+            if (quote == nullptr)
+                return end;
+            if (quote + 1 < end && quote[1] == '\'')
+            {
+                search = quote + 2;
+                continue;
+            }
+            return quote + 1;
+        }
+    }
+
+    // digits ( . digits )? ( E (+|-)? digits )?; ".." after digits is a range, not a fraction
+    const char *scanNumber(const char *p)
+    {
+        while (++p < end && (pascalCharClass(*p) & CHAR_DIGIT))
+        {
+        }
+        if (p + 1 < end && *p == '.' && (pascalCharClass(p[1]) & CHAR_DIGIT))
+        {
+            p++;
+            while (++p < end && (pascalCharClass(*p) & CHAR_DIGIT))
+            {
+            }
+        }
+        if (p < end && (*p == 'E' || *p == 'e'))
+        {
+            const char *exponent = p + 1;
+            if (exponent < end && (*exponent == '+' || *exponent == '-'))
+                exponent++;
+            if (exponent < end && (pascalCharClass(*exponent) & CHAR_DIGIT))
+            {
+                p = exponent;
+                while (++p < end && (pascalCharClass(*p) & CHAR_DIGIT))
+                {
+                }
+            }
+        }
+        return p;
+    }
+
+    const char *cursor;
+    const char *end;
+    const char *lineStart;
+    IdentifierTable *identifiers;
+    uint32_t line = 1;
+};
+
+inline void writeToken(ostream &out, const Token &token)
+{
+    out << tokenKindName(token.kind) << '\t' << token.lexeme << '\t' << token.line << ':' << token.column << '\n';
+}
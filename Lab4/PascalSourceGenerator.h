@@ -0,0 +1,261 @@
+// PascalSourceGenerator.h
+// Deterministic, syntactically valid programs in the Pascal subset of
+// Subset_of_Pascal.txt, used as input for the lexer and compiler benchmarks.
+//
+// A program declares a few globals and then repeats functions and procedures
+// with loops, conditionals, array accesses, calls to earlier subprograms and
+// comments until it reaches the requested size. Integer and real expressions
+// are kept apart, and div/mod only divide by non-zero constants.
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+// SplitMix64, as in Lab2/CorpusGenerator.cpp
+struct PascalSourceRandom
+{
+    uint64_t state;
+
+    explicit PascalSourceRandom(uint64_t seed) : state(seed) {}
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    unsigned below(unsigned bound) { return (unsigned)(next() % bound); }
+};
+
+class PascalSourceGenerator
+{
+public:
+    explicit PascalSourceGenerator(uint64_t seed) : random(seed) {}
+
+    string generate(size_t targetBytes)
+    {
+        source.clear();
+        source.reserve(targetBytes + 4096);
+        functionCount = 0;
+        procedureCount = 0;
+        source += "program generated(input, output);\n";
+        source += "var g0, g1, g2, g3, g4, g5, g6, g7 : integer;\n";
+        source += "var r0, r1 : real;\n";
+        source += "var table : array [1..1000] of integer;\n\n";
+        while (source.size() < targetBytes)
+        {
+            if (random.below(3) == 0)
+                writeProcedure();
+            else
+                writeFunction();
+        }
+        source += "begin\n";
+        source += "    g0 := 1;\n";
+        if (functionCount > 0)
+            source += "    g1 := f0(g0, 2, 0.5);\n";
+        if (procedureCount > 0)
+            source += "    p0(g1)\n";
+        else
+            source += "    g2 := g1\n";
+        source += "end.\n";
+        return source;
+    }
+
+private:
+    void line(int indent, const string &text)
+    {
+        source.append(4 * indent, ' ');
+        source += text;
+        source += '\n';
+    }
+
+    string integerVariable()
+    {
+        static const char *names[] = {"a", "b", "t", "u", "g0", "g1", "g2", "g3", "g4", "g5", "g6", "g7"};
+        return names[random.below(12)];
+    }
+
+    string integerFactor(int depth)
+    {
+        switch (depth > 2 ? random.below(2) : random.below(6))
+        {
+        case 0:
+            return integerVariable();
+        case 1:
+            return to_string(random.below(1000));
+        case 2:
+            return "table[" + integerExpression(depth + 1) + "]";
+        case 3:
+            return "(" + integerExpression(depth + 1) + ")";
+        case 4:
+            if (functionCount > 0)
+                return "f" + to_string(random.below(functionCount)) + "(" + integerExpression(depth + 1) + ", " +
+                       integerVariable() + ", " + realExpression(depth + 1) + ")";
+            return integerVariable();
+        default:
+            return integerVariable();
+        }
+    }
+
+    string integerTerm(int depth)
+    {
+        string term = integerFactor(depth);
+        for (unsigned i = random.below(3); i > 0; i--)
+        {
+            switch (random.below(3))
+            {
+            case 0:
+                term += " * " + integerFactor(depth);
+                break;
+            case 1:
+                term += " div " + to_string(1 + random.below(9));
+                break;
+            default:
+                term += " mod " + to_string(2 + random.below(30));
+                break;
+            }
+        }
+        return term;
+    }
+
+    string integerExpression(int depth)
+    {
+        string expression = random.below(8) == 0 ? "- " + integerTerm(depth) : integerTerm(depth);
+        for (unsigned i = random.below(3); i > 0; i--)
+            expression += (random.below(2) ? " + " : " - ") + integerTerm(depth);
+        return expression;
+    }
+
+    string realLiteral()
+    {
+        string literal = to_string(random.below(100)) + "." + to_string(random.below(100));
+        if (random.below(4) == 0)
+            literal += "E" + string(random.below(2) ? "+" : "-") + to_string(1 + random.below(3));
+        return literal;
+    }
+
+    string realExpression(int depth)
+    {
+        string expression = random.below(2) ? "c" : realLiteral();
+        for (unsigned i = random.below(3); i > 0; i--)
+        {
+            static const char *operators[] = {" + ", " - ", " * ", " / "};
+            string factor = random.below(2) ? "r" + to_string(random.below(2)) : realLiteral();
+            if (depth < 2 && random.below(4) == 0)
+                factor = "(" + realExpression(depth + 1) + ")";
+            expression += operators[random.below(4)] + factor;
+        }
+        return expression;
+    }
+
+    string condition()
+    {
+        static const char *relops[] = {" = ", " <> ", " < ", " <= ", " > ", " >= "};
+        return integerExpression(1) + relops[random.below(6)] + integerExpression(1);
+    }
+
+    // Statements never end with ';': the caller places the separators
+    void statement(int indent, int depth)
+    {
+        unsigned kind = depth > 2 ? random.below(3) : random.below(8);
+        switch (kind)
+        {
+        case 0:
+        case 1:
+            line(indent, integerVariable() + " := " + integerExpression(0));
+            break;
+        case 2:
+            if (random.below(2))
+                line(indent, "table[" + integerExpression(1) + "] := " + integerExpression(0));
+            else
+                line(indent, "r" + to_string(random.below(2)) + " := " + realExpression(0));
+            break;
+        case 3:
+            line(indent, "if " + condition() + " then");
+            statement(indent + 1, depth + 1);
+            line(indent, "else");
+            statement(indent + 1, depth + 1);
+            break;
+        case 4:
+            line(indent, "while " + condition() + " do");
+            statement(indent + 1, depth + 1);
+            break;
+        case 5:
+            if (procedureCount > 0)
+            {
+                line(indent, "p" + to_string(random.below(procedureCount)) + "(" + integerExpression(1) + ")");
+                break;
+            }
+            line(indent, integerVariable() + " := " + integerExpression(0));
+            break;
+        case 6:
+            line(indent, "{ " + to_string(random.next() % 100000) + " iterations of the inner loop }");
+            line(indent, integerVariable() + " := " + integerExpression(0));
+            break;
+        default:
+            compound(indent, depth + 1);
+            break;
+        }
+    }
+
+    void compound(int indent, int depth)
+    {
+        line(indent, "begin");
+        unsigned count = 1 + random.below(depth == 0 ? 8 : 3);
+        for (unsigned i = 0; i < count; i++)
+        {
+            statement(indent + 1, depth);
+            if (i + 1 < count)
+                source.insert(source.size() - 1, ";");
+        }
+        line(indent, "end");
+    }
+
+    void writeFunction()
+    {
+        string name = "f" + to_string(functionCount);
+        line(0, "function " + name + "(a, b : integer; c : real) : integer;");
+        line(0, "var t, u : integer;");
+        line(0, "begin");
+        line(1, "t := a;");
+        line(1, "u := b;");
+        for (unsigned i = 1 + random.below(4); i > 0; i--)
+        {
+            statement(1, 1);
+            source.insert(source.size() - 1, ";");
+        }
+        line(1, name + " := t + u");
+        line(0, "end;");
+        source += '\n';
+        functionCount++;
+    }
+
+    void writeProcedure()
+    {
+        line(0, "procedure p" + to_string(procedureCount) + "(a : integer);");
+        line(0, "var t, u, b : integer;");
+        line(0, "var c : real;");
+        line(0, "begin");
+        line(1, "t := 0;");
+        line(1, "b := a;");
+        line(1, "c := 1.0;");
+        line(1, "while t < a do");
+        line(2, "begin");
+        line(3, "table[t mod 1000 + 1] := table[t mod 1000 + 1] + b;");
+        line(3, "t := t + 1");
+        line(2, "end;");
+        statement(1, 1);
+        line(0, "end;");
+        source += '\n';
+        procedureCount++;
+    }
+
+    PascalSourceRandom random;
+    string source;
+    unsigned functionCount = 0;
+    unsigned procedureCount = 0;
+};
@@ -0,0 +1,331 @@
+// TokenStream.h
+// Binary form of the lexer output, for tools that would otherwise re-read the
+// "TOKEN\tlexeme\tline:col" text of LexicalAnalyzer, or lex the source again.
+// TokenStreamWriter collects the tokens of one PascalLexer run and writes
+// them out; TokenStreamReader decodes a stream in place, usually straight
+// from a MappedFile, and hands out the same Tokens the lexer did.
+//
+// A stream is a fixed header followed by six sections, each 8-byte aligned:
+//   kinds     one TokenKind byte per token
+//   tokens    per token, two LEB128 varints: its start offset less that of
+//             the previous token, and its index in the lexeme table
+//   ends      lexemeCount + 1 uint32 offsets into text; lexeme i is
+//             text[ends[i], ends[i + 1])
+//   keywords  one PascalKeyword byte per lexeme, so Token::id needs no lookup
+//   text      every distinct lexeme once, one after another
+//   lines     per run of tokens on one line, three varints: the line number
+//             less the previous one, its start offset less the previous one,
+//             and how many tokens it holds
+// A token's length is that of its lexeme, and its column is its offset less
+// the start of its line, so neither is stored per token. The lexeme table is
+// exact spelling, not case-folded, so every token reads back as written.
+// Integers are little-endian, as written on x86.
+//
+// The EOF token is kept too, at the end of the source and with the "<EOF>"
+// lexeme and 0-based column PascalLexer gives it, so a decoded stream prints
+// exactly what LexicalAnalyzer prints.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "IdentifierTable.h"
+#include "PascalLexer.h"
+
+using namespace std;
+
+struct TokenStreamHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t lexemeCount;
+    uint64_t tokenCount;
+    uint64_t lineCount; // entries of the lines section
+    uint64_t sourceSize;
+    uint64_t kindsOffset;
+    uint64_t tokensOffset;
+    uint64_t endsOffset;
+    uint64_t keywordsOffset;
+    uint64_t textOffset;
+    uint64_t linesOffset;
+    uint64_t fileSize;
+};
+
+static_assert(sizeof(TokenStreamHeader) == 96, "TokenStreamHeader is written as it is laid out");
+
+static const char tokenStreamMagic[8] = {'P', 'A', 'S', 'T', 'O', 'K', 'S', '\0'};
+static const uint32_t tokenStreamVersion = 1;
+
+class TokenStreamWriter
+{
+public:
+    // Tokens must come from a lexer over source, in order; their lexemes point into it
+    TokenStreamWriter(const char *source, size_t size) : source(source), sourceSize(size) { ends.push_back(0); }
+
+    void add(const Token &token)
+    {
+        const bool eof = token.kind == TOKEN_EOF;
+        const uint64_t offset = eof ? sourceSize : (uint64_t)(token.lexeme.data() - source);
+        if (offset < previousEnd || offset > sourceSize)
+            throw runtime_error("Tokens are out of order for the token stream");
+        // The lexer counts EOF's column from 0 and every other token's from 1
+        const uint64_t start = offset - token.column + (eof ? 0 : 1);
+        if (lineCount == 0 || token.line != line || start != lineStart)
+        {
+            if (lineCount != 0 && (token.line < line || start < lineStart))
+                throw runtime_error("Lines are out of order for the token stream");
+            flushLine();
+            lineDelta = token.line - line;
+            startDelta = start - lineStart;
+            lineCount++;
+            line = token.line;
+            lineStart = start;
+        }
+        lineTokens++;
+
+        kinds.push_back((char)token.kind);
+        appendVarint(tokens, offset - previousStart);
+        appendVarint(tokens, intern(token));
+        previousStart = offset;
+        previousEnd = eof ? offset : offset + token.lexeme.size();
+    }
+
+    // After the last token
+    void write(ostream &out)
+    {
+        flushLine();
+        TokenStreamHeader header = {};
+        memcpy(header.magic, tokenStreamMagic, sizeof(header.magic));
+        header.version = tokenStreamVersion;
+        header.lexemeCount = (uint32_t)keywords.size();
+        header.tokenCount = kinds.size();
+        header.lineCount = lineCount;
+        header.sourceSize = sourceSize;
+
+        uint64_t at = sizeof(header);
+        header.kindsOffset = at;
+        at = align(at + kinds.size());
+        header.tokensOffset = at;
+        at = align(at + tokens.size());
+        header.endsOffset = at;
+        at = align(at + ends.size() * sizeof(uint32_t));
+        header.keywordsOffset = at;
+        at = align(at + keywords.size());
+        header.textOffset = at;
+        at = align(at + text.size());
+        header.linesOffset = at;
+        header.fileSize = at + lines.size();
+
+        out.write((const char *)&header, sizeof(header));
+        writeSection(out, kinds.data(), kinds.size());
+        writeSection(out, tokens.data(), tokens.size());
+        writeSection(out, (const char *)ends.data(), ends.size() * sizeof(uint32_t));
+        writeSection(out, keywords.data(), keywords.size());
+        writeSection(out, text.data(), text.size());
+        out.write(lines.data(), lines.size());
+    }
+
+    size_t tokenCount() const { return kinds.size(); }
+    size_t lexemeCount() const { return keywords.size(); }
+
+private:
+    // --- Lexeme table ---
+    uint32_t intern(const Token &token)
+    {
+        auto found = indexes.find(token.lexeme);
+        if (found != indexes.end())
+            return found->second;
+        if (text.size() + token.lexeme.size() > UINT32_MAX)
+            throw runtime_error("Too many distinct lexemes for the token stream");
+        uint32_t index = (uint32_t)keywords.size();
+        text.append(token.lexeme.data(), token.lexeme.size());
+        ends.push_back((uint32_t)text.size());
+        keywords.push_back(token.kind == TOKEN_KEYWORD ? (char)token.id : (char)KEYWORD_NONE);
+        indexes.emplace(token.lexeme, index);
+        return index;
+    }
+
+    // --- Encoding ---
+    static void appendVarint(string &out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out += (char)(value | 0x80);
+            value >>= 7;
+        }
+        out += (char)value;
+    }
+
+    // A line's token count is only known when the next line starts
+    void flushLine()
+    {
+        if (lineTokens == 0)
+            return;
+        appendVarint(lines, lineDelta);
+        appendVarint(lines, startDelta);
+        appendVarint(lines, lineTokens);
+        lineTokens = 0;
+    }
+
+    static uint64_t align(uint64_t at) { return (at + 7) & ~(uint64_t)7; }
+
+    static void writeSection(ostream &out, const char *data, size_t size)
+    {
+        static const char zeros[8] = {};
+        out.write(data, size);
+        out.write(zeros, align(size) - size);
+    }
+
+    const char *source;
+    uint64_t sourceSize;
+    uint64_t previousStart = 0;
+    uint64_t previousEnd = 0;
+    string kinds;
+    string tokens;
+    string lines;
+    uint64_t lineCount = 0;
+    uint32_t lineDelta = 0;
+    uint64_t startDelta = 0;
+    uint64_t lineTokens = 0;
+    uint32_t line = 0;
+    uint64_t lineStart = 0;
+    vector<uint32_t> ends;
+    string keywords;
+    string text;
+    unordered_map<string_view, uint32_t> indexes; // views into the source
+};
+
+class TokenStreamReader
+{
+public:
+    // data is a whole stream, usually a MappedFile; it must outlive the reader
+    // and the lexemes it hands out. Given an IdentifierTable, identifiers get
+    // their interned id in Token::id, each distinct spelling hashed once.
+    TokenStreamReader(const char *data, size_t size, IdentifierTable *identifiers = nullptr)
+        : identifiers(identifiers)
+    {
+        if (size < sizeof(header))
+            throw runtime_error("Token stream is truncated");
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, tokenStreamMagic, sizeof(header.magic)) != 0)
+            throw runtime_error("Not a token stream");
+        if (header.version != tokenStreamVersion)
+            throw runtime_error("Unsupported token stream version " + to_string(header.version));
+        if (header.fileSize != size || header.kindsOffset > header.tokensOffset ||
+            header.tokensOffset > header.endsOffset || header.endsOffset > header.keywordsOffset ||
+            header.keywordsOffset > header.textOffset || header.textOffset > header.linesOffset ||
+            header.linesOffset > size || header.tokenCount > header.tokensOffset - header.kindsOffset ||
+            (header.lexemeCount + 1ull) * sizeof(uint32_t) > header.keywordsOffset - header.endsOffset ||
+            header.lexemeCount > header.textOffset - header.keywordsOffset || header.endsOffset % alignof(uint32_t) != 0)
+            throw runtime_error("Token stream sections are corrupt");
+
+        kinds = (const uint8_t *)data + header.kindsOffset;
+        tokens = (const uint8_t *)data + header.tokensOffset;
+        tokensEnd = (const uint8_t *)data + header.endsOffset;
+        ends = (const uint32_t *)(data + header.endsOffset);
+        keywords = (const uint8_t *)data + header.keywordsOffset;
+        text = data + header.textOffset;
+        lines = (const uint8_t *)data + header.linesOffset;
+        linesEnd = (const uint8_t *)data + size;
+        // One pass over the table, so lexeme() can trust it
+        if (ends[0] != 0 || ends[header.lexemeCount] > header.linesOffset - header.textOffset)
+            throw runtime_error("Token stream lexemes are corrupt");
+        for (uint32_t i = 0; i < header.lexemeCount; i++)
+        {
+            if (ends[i] > ends[i + 1])
+                throw runtime_error("Token stream lexemes are corrupt");
+        }
+        if (identifiers != nullptr)
+            ids.assign(header.lexemeCount, 0);
+    }
+
+    uint64_t tokenCount() const { return header.tokenCount; }
+    uint32_t lexemeCount() const { return header.lexemeCount; }
+    uint64_t sourceSize() const { return header.sourceSize; }
+    string_view lexeme(uint32_t index) const { return string_view(text + ends[index], ends[index + 1] - ends[index]); }
+
+    // Source offset of the token last returned by next()
+    uint64_t offset() const { return position; }
+
+    // Returns TOKEN_EOF at the end, and keeps returning it
+    Token next()
+    {
+        if (index == header.tokenCount)
+            return last;
+        if (lineTokens == 0)
+        {
+            line += (uint32_t)readVarint(lines, linesEnd);
+            lineStart += readVarint(lines, linesEnd);
+            lineTokens = readVarint(lines, linesEnd);
+            if (lineTokens == 0)
+                throw runtime_error("Token stream lines are corrupt");
+        }
+        lineTokens--;
+
+        Token token;
+        token.kind = (TokenKind)kinds[index++];
+        position += readVarint(tokens, tokensEnd);
+        uint64_t lexemeIndex = readVarint(tokens, tokensEnd);
+        if (lexemeIndex >= header.lexemeCount || token.kind >= TOKEN_KIND_COUNT || position < lineStart)
+            throw runtime_error("Token stream tokens are corrupt");
+        token.lexeme = lexeme((uint32_t)lexemeIndex);
+        token.line = line;
+        token.column = (uint32_t)(position - lineStart);
+        token.id = keywords[lexemeIndex];
+        if (token.kind == TOKEN_EOF)
+            last = token;
+        else
+        {
+            token.column++;
+            if (token.kind == TOKEN_ID && identifiers != nullptr)
+            {
+                uint32_t &id = ids[lexemeIndex];
+                if (id == 0)
+                    id = identifiers->intern(token.lexeme.data(), token.lexeme.size());
+                token.id = id;
+            }
+        }
+        return token;
+    }
+
+private:
+    static uint64_t readVarint(const uint8_t *&p, const uint8_t *end)
+    {
+        // Most gaps and lexeme indexes fit one byte
+        if (p < end && *p < 0x80)
+            return *p++;
+        uint64_t value = 0;
+        for (int shift = 0; p < end && shift < 64; shift += 7)
+        {
+            uint8_t byte = *p++;
+            value |= (uint64_t)(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+        throw runtime_error("Token stream varint is truncated");
+    }
+
+    TokenStreamHeader header;
+    const uint8_t *kinds;
+    const uint8_t *tokens;
+    const uint8_t *tokensEnd;
+    const uint32_t *ends;
+    const uint8_t *keywords;
+    const char *text;
+    const uint8_t *lines;
+    const uint8_t *linesEnd;
+    IdentifierTable *identifiers;
+    vector<uint32_t> ids; // interned id per lexeme, 0 until first seen as an ID
+    uint64_t index = 0;
+    uint64_t position = 0;
+    uint32_t line = 0;
+    uint64_t lineStart = 0;
+    uint64_t lineTokens = 0;
+    Token last = {TOKEN_EOF, string_view("<EOF>"), 0, 0};
+};
@@ -0,0 +1,312 @@
+// Libraries
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include "../Lab2/MappedFile.h"
+#include "IdentifierTable.h"
+#include "PascalLexer.h"
+#include "PascalSourceGenerator.h"
+#include "TokenStream.h"
+
+using namespace std;
+
+// Size and reload time of the binary TokenStream against the text output of
+// LexicalAnalyzer, for a source file or a generated program of about S MB.
+// Both forms are written to PREFIX.txt and PREFIX.tok (removed afterwards
+// unless --keep), and each run maps them again and reads every token back:
+// the text by splitting its lines and parsing line:col, the stream through
+// TokenStreamReader. Lexing the source again is timed too, since that is what
+// a cached stream saves. The files were just written, so the reloads read
+// from the page cache. Before timing, the decoded stream is checked against
+// the lexer token by token, identifier ids included, and its text rendering
+// against the text file byte by byte.
+//
+// Usage:
+//   TokenStreamBenchmark [source.pas] [--size MB] [--runs R] [--seed N] [--out PREFIX] [--keep]
+
+// Structs
+struct Reload
+{
+    double seconds = 0;
+    uint64_t tokens = 0;
+    uint64_t checksum = 0;
+
+    void add(const Token &token)
+    {
+        tokens++;
+        checksum = checksum * 1000003 ^ (token.kind + ((uint64_t)token.line << 8) + ((uint64_t)token.column << 36) +
+                                         token.lexeme.size() * 31 + (uint8_t)(token.lexeme.empty() ? 0 : token.lexeme[0]));
+    }
+};
+
+// Function Prototypes
+Reload readText(const string &path);
+Reload readStream(const string &path);
+Reload relex(const char *data, size_t size);
+void verify(const char *data, size_t size, const string &text, const string &streamPath);
+uint64_t fileSize(const string &path);
+double since(chrono::steady_clock::time_point start);
+
+// Main Function
+int main(int argc, char *argv[])
+{
+    try
+    {
+        string sourcePath, prefix = "tokens";
+        size_t sizeMb = 16;
+        int runs = 5;
+        uint64_t seed = 1;
+        bool keep = false;
+        for (int i = 1; i < argc; i++)
+        {
+            string argument = argv[i];
+            if (argument == "--size" && i + 1 < argc)
+                sizeMb = stoul(argv[++i]);
+            else if (argument == "--runs" && i + 1 < argc)
+                runs = max(1, stoi(argv[++i]));
+            else if (argument == "--seed" && i + 1 < argc)
+                seed = stoull(argv[++i]);
+            else if (argument == "--out" && i + 1 < argc)
+                prefix = argv[++i];
+            else if (argument == "--keep")
+                keep = true;
+            else
+                sourcePath = argument;
+        }
+
+        MappedFile file;
+        string generated;
+        const char *data;
+        size_t size;
+        if (!sourcePath.empty())
+        {
+            if (!file.open(sourcePath))
+            {
+                cerr << "File could not be opened: " << sourcePath << endl;
+                return 1;
+            }
+            data = file.data();
+            size = file.size();
+        }
+        else
+        {
+            generated = PascalSourceGenerator(seed).generate(sizeMb * 1024 * 1024);
+            data = generated.data();
+            size = generated.size();
+        }
+
+        // Lex once into each form
+        string textPath = prefix + ".txt", streamPath = prefix + ".tok";
+        ostringstream textOutput;
+        auto start = chrono::steady_clock::now();
+        PascalLexer textLexer(data, size);
+        Token token;
+        do
+        {
+            token = textLexer.next();
+            writeToken(textOutput, token);
+        } while (token.kind != TOKEN_EOF);
+        string text = textOutput.str();
+        double textWrite = since(start);
+
+        start = chrono::steady_clock::now();
+        PascalLexer streamLexer(data, size);
+        TokenStreamWriter writer(data, size);
+        do
+        {
+            token = streamLexer.next();
+            writer.add(token);
+        } while (token.kind != TOKEN_EOF);
+        ostringstream streamOutput;
+        writer.write(streamOutput);
+        string stream = streamOutput.str();
+        double streamWrite = since(start);
+
+        ofstream(textPath, ios::out | ios::binary).write(text.data(), text.size());
+        ofstream(streamPath, ios::out | ios::binary).write(stream.data(), stream.size());
+        if (fileSize(textPath) != text.size() || fileSize(streamPath) != stream.size())
+            throw runtime_error("could not write " + textPath + " and " + streamPath);
+        verify(data, size, text, streamPath);
+
+        Reload bestText, bestStream, bestLex;
+        for (int r = 0; r < runs; r++)
+        {
+            Reload run = readText(textPath);
+            if (r == 0 || run.seconds < bestText.seconds)
+                bestText = run;
+            run = readStream(streamPath);
+            if (r == 0 || run.seconds < bestStream.seconds)
+                bestStream = run;
+            run = relex(data, size);
+            if (r == 0 || run.seconds < bestLex.seconds)
+                bestLex = run;
+        }
+        if (bestText.checksum != bestStream.checksum || bestText.checksum != bestLex.checksum ||
+            bestText.tokens != bestStream.tokens || bestText.tokens != bestLex.tokens)
+            throw runtime_error("the text and the stream read back different tokens");
+        if (!keep)
+        {
+            remove(textPath.c_str());
+            remove(streamPath.c_str());
+        }
+
+        TokenStreamReader reader(stream.data(), stream.size());
+        TokenStreamHeader header;
+        memcpy(&header, stream.data(), sizeof(header));
+        double megabyte = 1024.0 * 1024.0;
+        cout << "Source: " << (sourcePath.empty() ? "generated" : sourcePath) << ", " << size << " bytes, "
+             << reader.tokenCount() << " tokens, " << reader.lexemeCount() << " distinct lexemes" << endl;
+        cout << "Text: " << text.size() << " bytes (" << (double)text.size() / reader.tokenCount()
+             << " per token), written in " << textWrite * 1000 << " ms" << endl;
+        cout << "Stream: " << stream.size() << " bytes (" << (double)stream.size() / reader.tokenCount()
+             << " per token, " << (double)text.size() / stream.size() << "x smaller), written in " << streamWrite * 1000
+             << " ms" << endl;
+        cout << "  kinds " << header.tokensOffset - header.kindsOffset << ", tokens "
+             << header.endsOffset - header.tokensOffset << ", lexeme table "
+             << header.linesOffset - header.endsOffset << ", lines " << header.fileSize - header.linesOffset << " ("
+             << header.lineCount << " entries)" << endl;
+        cout << "Best of " << runs << ", reload:" << endl;
+        cout << "  text     " << bestText.seconds * 1000 << " ms, " << text.size() / megabyte / bestText.seconds
+             << " MB/s, " << bestText.tokens / bestText.seconds / 1e6 << " M tokens/s" << endl;
+        cout << "  stream   " << bestStream.seconds * 1000 << " ms, " << stream.size() / megabyte / bestStream.seconds
+             << " MB/s, " << bestStream.tokens / bestStream.seconds / 1e6 << " M tokens/s ("
+             << bestText.seconds / bestStream.seconds << "x the text)" << endl;
+        cout << "  re-lex   " << bestLex.seconds * 1000 << " ms, " << bestLex.tokens / bestLex.seconds / 1e6
+             << " M tokens/s" << endl;
+        return 0;
+    }
+    catch (exception &e)
+    {
+        cout << "Error occurred: " << e.what() << endl;
+        return 1;
+    }
+}
+
+// A line is KIND\tlexeme\tline:col\n. A string lexeme may hold tabs and
+// newlines, so the line ends at the first newline after a "\tN:N" field.
+Reload readText(const string &path)
+{
+    Reload reload;
+    auto start = chrono::steady_clock::now();
+    MappedFile file;
+    if (!file.open(path))
+        throw runtime_error("could not open " + path);
+    const char *p = file.data();
+    const char *end = p + file.size();
+    while (p < end)
+    {
+        Token token;
+        // The kind names differ in their first letter
+        switch (*p)
+        {
+        case 'K': token.kind = TOKEN_KEYWORD; break;
+        case 'I': token.kind = TOKEN_ID; break;
+        case 'N': token.kind = TOKEN_NUM; break;
+        case 'O': token.kind = TOKEN_OP; break;
+        case 'D': token.kind = TOKEN_DELIM; break;
+        case 'S': token.kind = TOKEN_STRING; break;
+        case 'U': token.kind = TOKEN_UNKNOWN; break;
+        case 'E': token.kind = TOKEN_EOF; break;
+        default: throw runtime_error("unknown token kind in " + path);
+        }
+        const char *lexeme = (const char *)memchr(p, '\t', end - p);
+        if (lexeme == nullptr)
+            throw runtime_error("truncated token in " + path);
+        lexeme++;
+        for (const char *newline = lexeme;; newline++)
+        {
+            newline = (const char *)memchr(newline, '\n', end - newline);
+            if (newline == nullptr)
+                throw runtime_error("truncated token in " + path);
+            // Parse N:N backwards from the newline
+            const char *q = newline;
+            uint32_t column = 0, line = 0, scale = 1;
+            while (q > lexeme && q[-1] >= '0' && q[-1] <= '9')
+                column += (*--q - '0') * scale, scale *= 10;
+            if (q == newline || q == lexeme || q[-1] != ':')
+                continue;
+            const char *colon = --q;
+            scale = 1;
+            while (q > lexeme && q[-1] >= '0' && q[-1] <= '9')
+                line += (*--q - '0') * scale, scale *= 10;
+            if (q == colon || q == lexeme || q[-1] != '\t')
+                continue;
+            token.lexeme = string_view(lexeme, q - 1 - lexeme);
+            token.line = line;
+            token.column = column;
+            p = newline + 1;
+            break;
+        }
+        reload.add(token);
+    }
+    reload.seconds = since(start);
+    return reload;
+}
+
+Reload readStream(const string &path)
+{
+    Reload reload;
+    auto start = chrono::steady_clock::now();
+    MappedFile file;
+    if (!file.open(path))
+        throw runtime_error("could not open " + path);
+    TokenStreamReader reader(file.data(), file.size());
+    for (uint64_t i = 0; i < reader.tokenCount(); i++)
+        reload.add(reader.next());
+    reload.seconds = since(start);
+    return reload;
+}
+
+Reload relex(const char *data, size_t size)
+{
+    Reload reload;
+    auto start = chrono::steady_clock::now();
+    PascalLexer lexer(data, size);
+    Token token;
+    do
+    {
+        token = lexer.next();
+        reload.add(token);
+    } while (token.kind != TOKEN_EOF);
+    reload.seconds = since(start);
+    return reload;
+}
+
+void verify(const char *data, size_t size, const string &text, const string &streamPath)
+{
+    MappedFile file;
+    if (!file.open(streamPath))
+        throw runtime_error("could not open " + streamPath);
+    IdentifierTable lexerIds, streamIds;
+    PascalLexer lexer(data, size, &lexerIds);
+    TokenStreamReader reader(file.data(), file.size(), &streamIds);
+    ostringstream decoded;
+    for (uint64_t i = 0; i < reader.tokenCount(); i++)
+    {
+        Token expected = lexer.next(), token = reader.next();
+        if (token.kind != expected.kind || token.lexeme != expected.lexeme || token.line != expected.line ||
+            token.column != expected.column || token.id != expected.id)
+            throw runtime_error("token " + to_string(i) + " decodes differently from the lexer");
+        writeToken(decoded, token);
+    }
+    if (decoded.str() != text)
+        throw runtime_error("the decoded stream does not print as the text output");
+}
+
+uint64_t fileSize(const string &path)
+{
+    ifstream file(path, ios::in | ios::binary | ios::ate);
+    return file ? (uint64_t)file.tellg() : 0;
+}
+
+double since(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
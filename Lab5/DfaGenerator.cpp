@@ -0,0 +1,615 @@
+// Libraries
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cctype>
+
+using namespace std;
+
+// Turns JFLAP finite automata (.jff) into a dense constexpr DFA table.
+//
+// The automata are joined under a new start state, determinized by subset
+// construction and minimized with Hopcroft's algorithm. Bytes that move every
+// state to the same place share an equivalence class, so the table has one
+// column per class instead of 256. The statistics go to stdout; the header is
+// only written with -o.
+//
+// A final state's token kind is the name given after the file (file.jff=KIND)
+// or else the state's JFLAP label. When a DFA state accepts several kinds, the
+// file listed first wins, so keywords are listed before identifiers.
+//
+// Reads follow JFLAP: an empty read is an epsilon move and a longer read is a
+// sequence of characters. As in StateDiagramIdentifier.jff, a read containing
+// commas is a set instead; its items are characters or ranges such as a-z,
+// and a range alone (0-9) is a set too.
+//
+// Usage:
+//   DfaGenerator [--ignore-case] [--name pascalDfa] [-o Tables.h] file.jff[=KIND] ...
+// PascalDfaTables.h is generated with:
+//   DfaGenerator --ignore-case -o PascalDfaTables.h PascalKeywords.jff PascalTokens.jff
+
+// Structs
+struct NfaState
+{
+    vector<pair<uint8_t, int>> moves;
+    vector<int> epsilon;
+    int kind = -1;     // index into the kind names, -1 if not final
+    int priority = -1; // lower wins
+};
+
+struct Nfa
+{
+    vector<NfaState> states;
+    vector<string> kinds;
+    int start = 0;
+};
+
+struct Dfa
+{
+    vector<vector<int>> next; // [state][byte]
+    vector<int> kinds;        // -1 if not accepting
+    int start = 0;
+    int dead = -1;
+};
+
+struct GeneratorOptions
+{
+    bool ignoreCase = false;
+    string name = "pascalDfa";
+    string outputPath;
+    vector<pair<string, string>> inputs; // path, kind override
+};
+
+// Function Prototypes
+string readFileText(const string &path);
+string decodeXml(const string &text);
+bool isIdentifier(const string &text);
+vector<uint8_t> readSymbols(const string &read, bool ignoreCase);
+int addJflapAutomaton(Nfa &nfa, const string &path, const string &kindOverride, int priority, bool ignoreCase);
+Dfa determinize(const Nfa &nfa);
+Dfa minimize(const Dfa &dfa);
+vector<int> byteClasses(const Dfa &dfa, int &classCount);
+void writeTables(const string &path, const GeneratorOptions &options, const Nfa &nfa, const Dfa &subset,
+                 const Dfa &minimal);
+
+// Main Function
+int main(int argc, char *argv[])
+{
+    try
+    {
+        GeneratorOptions options;
+        for (int i = 1; i < argc; i++)
+        {
+            string argument = argv[i];
+            if (argument == "--ignore-case")
+                options.ignoreCase = true;
+            else if (argument == "--name" && i + 1 < argc)
+                options.name = argv[++i];
+            else if (argument == "-o" && i + 1 < argc)
+                options.outputPath = argv[++i];
+            else
+            {
+                size_t equals = argument.find('=');
+                if (equals == string::npos)
+                    options.inputs.emplace_back(argument, "");
+                else
+                    options.inputs.emplace_back(argument.substr(0, equals), argument.substr(equals + 1));
+            }
+        }
+        if (options.inputs.empty())
+        {
+            cout << "Usage: DfaGenerator [--ignore-case] [--name prefix] [-o Tables.h] file.jff[=KIND] ..." << endl;
+            return 1;
+        }
+
+        Nfa nfa;
+        nfa.states.emplace_back();
+        for (size_t i = 0; i < options.inputs.size(); i++)
+        {
+            int start = addJflapAutomaton(nfa, options.inputs[i].first, options.inputs[i].second, (int)i,
+                                          options.ignoreCase);
+            nfa.states[nfa.start].epsilon.push_back(start);
+        }
+
+        Dfa subset = determinize(nfa);
+        Dfa minimal = minimize(subset);
+        int subsetClasses = 0;
+        int minimalClasses = 0;
+        byteClasses(subset, subsetClasses);
+        byteClasses(minimal, minimalClasses);
+
+        // The dead state is counted, since it has a row in the table
+        cout << "NFA states: " << nfa.states.size() << endl;
+        cout << "DFA states after subset construction: " << subset.next.size() << " (" << subsetClasses
+             << " byte classes)" << endl;
+        cout << "DFA states after minimization: " << minimal.next.size() << " (" << minimalClasses
+             << " byte classes)" << endl;
+        cout << "Token kinds:";
+        for (const string &kind : nfa.kinds)
+            cout << " " << kind;
+        cout << endl;
+
+        if (!options.outputPath.empty())
+        {
+            writeTables(options.outputPath, options, nfa, subset, minimal);
+            cout << "Tables written to " << options.outputPath << endl;
+        }
+        return 0;
+    }
+    catch (exception &e)
+    {
+        cout << "Error occurred: " << e.what() << endl;
+        return 1;
+    }
+}
+
+string readFileText(const string &path)
+{
+    ifstream file(path, ios::binary);
+    if (!file)
+        throw runtime_error("File could not be opened: " + path);
+    ostringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+
+string decodeXml(const string &text)
+{
+    string decoded;
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        if (text[i] != '&')
+        {
+            decoded += text[i];
+            continue;
+        }
+        size_t semicolon = text.find(';', i);
+        if (semicolon == string::npos)
+            throw runtime_error("Bad XML entity in: " + text);
+        string entity = text.substr(i + 1, semicolon - i - 1);
+        if (entity == "lt")
+            decoded += '<';
+        else if (entity == "gt")
+            decoded += '>';
+        else if (entity == "amp")
+            decoded += '&';
+        else if (entity == "quot")
+            decoded += '"';
+        else if (entity == "apos")
+            decoded += '\'';
+        else if (entity.size() > 2 && entity[0] == '#' && entity[1] == 'x')
+            decoded += (char)stoi(entity.substr(2), nullptr, 16);
+        else if (entity.size() > 1 && entity[0] == '#')
+            decoded += (char)stoi(entity.substr(1));
+        else
+            throw runtime_error("Unknown XML entity: &" + entity + ";");
+        i = semicolon;
+    }
+    return decoded;
+}
+
+bool isIdentifier(const string &text)
+{
+    if (text.empty() || !(isalpha((unsigned char)text[0]) || text[0] == '_'))
+        return false;
+    for (char c : text)
+    {
+        if (!(isalnum((unsigned char)c) || c == '_'))
+            return false;
+    }
+    return true;
+}
+
+// The bytes of a set read such as "a-z,A-Z,_"
+vector<uint8_t> readSymbols(const string &read, bool ignoreCase)
+{
+    bool member[256] = {};
+    size_t begin = 0;
+    while (begin <= read.size())
+    {
+        size_t comma = read.find(',', begin);
+        if (comma == string::npos)
+            comma = read.size();
+        string item = read.substr(begin, comma - begin);
+        if (item.size() == 1)
+            member[(uint8_t)item[0]] = true;
+        else if (item.size() == 3 && item[1] == '-' && (uint8_t)item[0] <= (uint8_t)item[2])
+        {
+            for (int c = (uint8_t)item[0]; c <= (uint8_t)item[2]; c++)
+                member[c] = true;
+        }
+        else
+            throw runtime_error("Bad item \"" + item + "\" in read \"" + read + "\"");
+        begin = comma + 1;
+    }
+    vector<uint8_t> symbols;
+    for (int c = 0; c < 256; c++)
+    {
+        if (member[c] || (ignoreCase && isalpha(c) && member[c ^ 0x20]))
+            symbols.push_back((uint8_t)c);
+    }
+    return symbols;
+}
+
+// Returns the NFA state of the automaton's initial state
+int addJflapAutomaton(Nfa &nfa, const string &path, const string &kindOverride, int priority, bool ignoreCase)
+{
+    string xml = readFileText(path);
+    if (xml.find("<type>fa</type>") == string::npos)
+        throw runtime_error("Not a JFLAP finite automaton: " + path);
+
+    auto element = [](const string &text, const string &tag, size_t from, size_t to, string &value) {
+        size_t open = text.find("<" + tag + ">", from);
+        if (open == string::npos || open >= to)
+            return false;
+        open += tag.size() + 2;
+        size_t close = text.find("</" + tag + ">", open);
+        if (close == string::npos || close > to)
+            return false;
+        value = decodeXml(text.substr(open, close - open));
+        return true;
+    };
+
+    map<string, int> statesById;
+    int initial = -1;
+    for (size_t at = xml.find("<state "); at != string::npos; at = xml.find("<state ", at + 1))
+    {
+        size_t tagEnd = xml.find('>', at);
+        size_t idAt = xml.find("id=\"", at);
+        if (tagEnd == string::npos || idAt == string::npos || idAt > tagEnd)
+            throw runtime_error("State without an id in " + path);
+        string id = xml.substr(idAt + 4, xml.find('"', idAt + 4) - idAt - 4);
+        size_t stateEnd = xml[tagEnd - 1] == '/' ? tagEnd : xml.find("</state>", tagEnd);
+        if (stateEnd == string::npos)
+            throw runtime_error("Unterminated state " + id + " in " + path);
+
+        int index = (int)nfa.states.size();
+        nfa.states.emplace_back();
+        statesById[id] = index;
+        string body = xml.substr(tagEnd, stateEnd - tagEnd);
+        if (body.find("<initial/>") != string::npos)
+            initial = index;
+        if (body.find("<final/>") != string::npos)
+        {
+            string label;
+            string kind = kindOverride;
+            if (kind.empty())
+                kind = element(body, "label", 0, body.size(), label) && isIdentifier(label) ? label : "ACCEPT";
+            auto known = find(nfa.kinds.begin(), nfa.kinds.end(), kind);
+            if (known == nfa.kinds.end())
+                known = nfa.kinds.insert(nfa.kinds.end(), kind);
+            nfa.states[index].kind = (int)(known - nfa.kinds.begin());
+            nfa.states[index].priority = priority;
+        }
+    }
+    if (initial < 0)
+        throw runtime_error("No initial state in " + path);
+
+    for (size_t at = xml.find("<transition>"); at != string::npos; at = xml.find("<transition>", at + 1))
+    {
+        size_t end = xml.find("</transition>", at);
+        string from, to, read;
+        if (end == string::npos || !element(xml, "from", at, end, from) || !element(xml, "to", at, end, to))
+            throw runtime_error("Incomplete transition in " + path);
+        if (!statesById.count(from) || !statesById.count(to))
+            throw runtime_error("Transition between unknown states in " + path);
+        int source = statesById[from];
+        int target = statesById[to];
+        if (!element(xml, "read", at, end, read) || read.empty())
+        {
+            nfa.states[source].epsilon.push_back(target);
+        }
+        else if ((read.size() > 1 && read.find(',') != string::npos) || (read.size() == 3 && read[1] == '-'))
+        {
+            for (uint8_t symbol : readSymbols(read, ignoreCase))
+                nfa.states[source].moves.emplace_back(symbol, target);
+        }
+        else
+        {
+            // A character sequence, through states of its own
+            for (size_t i = 0; i < read.size(); i++)
+            {
+                int step = target;
+                if (i + 1 < read.size())
+                {
+                    step = (int)nfa.states.size();
+                    nfa.states.emplace_back();
+                }
+                uint8_t symbol = (uint8_t)read[i];
+                nfa.states[source].moves.emplace_back(symbol, step);
+                if (ignoreCase && isalpha(symbol))
+                    nfa.states[source].moves.emplace_back((uint8_t)(symbol ^ 0x20), step);
+                source = step;
+            }
+        }
+    }
+    return initial;
+}
+
+Dfa determinize(const Nfa &nfa)
+{
+    auto closure = [&nfa](vector<int> set) {
+        vector<bool> seen(nfa.states.size());
+        for (int s : set)
+            seen[s] = true;
+        for (size_t i = 0; i < set.size(); i++)
+        {
+            for (int t : nfa.states[set[i]].epsilon)
+            {
+                if (!seen[t])
+                {
+                    seen[t] = true;
+                    set.push_back(t);
+                }
+            }
+        }
+        sort(set.begin(), set.end());
+        return set;
+    };
+
+    Dfa dfa;
+    map<vector<int>, int> ids;
+    vector<vector<int>> sets;
+    auto stateOf = [&](const vector<int> &set) {
+        auto found = ids.find(set);
+        if (found != ids.end())
+            return found->second;
+        int id = (int)sets.size();
+        ids.emplace(set, id);
+        sets.push_back(set);
+        int kind = -1;
+        int priority = -1;
+        for (int s : set)
+        {
+            const NfaState &state = nfa.states[s];
+            if (state.kind >= 0 && (kind < 0 || state.priority < priority ||
+                                    (state.priority == priority && state.kind < kind)))
+            {
+                kind = state.kind;
+                priority = state.priority;
+            }
+        }
+        dfa.kinds.push_back(kind);
+        dfa.next.emplace_back(256, -1);
+        return id;
+    };
+
+    dfa.dead = stateOf(vector<int>());
+    dfa.start = stateOf(closure(vector<int>(1, nfa.start)));
+    for (size_t i = 0; i < sets.size(); i++)
+    {
+        vector<vector<int>> targets(256);
+        for (int s : sets[i])
+        {
+            for (const pair<uint8_t, int> &move : nfa.states[s].moves)
+                targets[move.first].push_back(move.second);
+        }
+        for (int c = 0; c < 256; c++)
+        {
+            sort(targets[c].begin(), targets[c].end());
+            targets[c].erase(unique(targets[c].begin(), targets[c].end()), targets[c].end());
+            int target = stateOf(closure(targets[c]));
+            dfa.next[i][c] = target;
+        }
+    }
+    return dfa;
+}
+
+// Hopcroft's algorithm. States start out grouped by the kind they accept and
+// blocks are split until no byte tells two states of a block apart.
+Dfa minimize(const Dfa &dfa)
+{
+    const int stateCount = (int)dfa.next.size();
+    vector<vector<vector<int>>> incoming(256, vector<vector<int>>(stateCount));
+    for (int s = 0; s < stateCount; s++)
+    {
+        for (int c = 0; c < 256; c++)
+            incoming[c][dfa.next[s][c]].push_back(s);
+    }
+
+    vector<int> blockOf(stateCount);
+    vector<vector<int>> blocks;
+    map<int, int> blockByKind;
+    for (int s = 0; s < stateCount; s++)
+    {
+        auto found = blockByKind.find(dfa.kinds[s]);
+        if (found == blockByKind.end())
+        {
+            found = blockByKind.emplace(dfa.kinds[s], (int)blocks.size()).first;
+            blocks.emplace_back();
+        }
+        blockOf[s] = found->second;
+        blocks[found->second].push_back(s);
+    }
+
+    vector<int> work;
+    vector<bool> inWork(blocks.size(), true);
+    for (size_t b = 0; b < blocks.size(); b++)
+        work.push_back((int)b);
+
+    vector<int> marks(stateCount, 0);
+    int mark = 0;
+    while (!work.empty())
+    {
+        int splitter = work.back();
+        work.pop_back();
+        inWork[splitter] = false;
+        const vector<int> members = blocks[splitter];
+        for (int c = 0; c < 256; c++)
+        {
+            // The states that move into the splitter on c
+            mark++;
+            vector<int> touched;
+            for (int target : members)
+            {
+                for (int s : incoming[c][target])
+                {
+                    marks[s] = mark;
+                    touched.push_back(blockOf[s]);
+                }
+            }
+            sort(touched.begin(), touched.end());
+            touched.erase(unique(touched.begin(), touched.end()), touched.end());
+            for (int b : touched)
+            {
+                vector<int> in, out;
+                for (int s : blocks[b])
+                    (marks[s] == mark ? in : out).push_back(s);
+                if (out.empty())
+                    continue;
+                int added = (int)blocks.size();
+                blocks[b] = out;
+                blocks.push_back(in);
+                inWork.push_back(false);
+                for (int s : in)
+                    blockOf[s] = added;
+                if (inWork[b])
+                {
+                    work.push_back(added);
+                    inWork[added] = true;
+                }
+                else
+                {
+                    int smaller = in.size() <= out.size() ? added : b;
+                    work.push_back(smaller);
+                    inWork[smaller] = true;
+                }
+            }
+        }
+    }
+
+    // Dead state first, then the start state, then breadth-first order
+    Dfa minimal;
+    vector<int> order(blocks.size(), -1);
+    vector<int> queue;
+    auto number = [&](int block) {
+        if (order[block] < 0)
+        {
+            order[block] = (int)queue.size();
+            queue.push_back(block);
+        }
+    };
+    number(blockOf[dfa.dead]);
+    number(blockOf[dfa.start]);
+    for (size_t i = 0; i < queue.size(); i++)
+    {
+        int representative = blocks[queue[i]][0];
+        for (int c = 0; c < 256; c++)
+            number(blockOf[dfa.next[representative][c]]);
+    }
+    minimal.next.assign(queue.size(), vector<int>(256));
+    minimal.kinds.resize(queue.size());
+    for (size_t i = 0; i < queue.size(); i++)
+    {
+        int representative = blocks[queue[i]][0];
+        minimal.kinds[i] = dfa.kinds[representative];
+        for (int c = 0; c < 256; c++)
+            minimal.next[i][c] = order[blockOf[dfa.next[representative][c]]];
+    }
+    minimal.dead = 0;
+    minimal.start = 1;
+    return minimal;
+}
+
+// Bytes whose columns are identical in every state share a class
+vector<int> byteClasses(const Dfa &dfa, int &classCount)
+{
+    vector<int> classes(256);
+    map<vector<int>, int> columns;
+    for (int c = 0; c < 256; c++)
+    {
+        vector<int> column(dfa.next.size());
+        for (size_t s = 0; s < dfa.next.size(); s++)
+            column[s] = dfa.next[s][c];
+        auto found = columns.emplace(column, (int)columns.size()).first;
+        classes[c] = found->second;
+    }
+    classCount = (int)columns.size();
+    return classes;
+}
+
+// Transitions hold row offsets (state * stride) so the lexing loop needs no
+// multiply; the extra last column of each row holds the state's token kind.
+void writeTables(const string &path, const GeneratorOptions &options, const Nfa &nfa, const Dfa &subset,
+                 const Dfa &minimal)
+{
+    int classCount = 0;
+    vector<int> classes = byteClasses(minimal, classCount);
+    const size_t stride = classCount + 1;
+    const size_t cells = minimal.next.size() * stride;
+    if ((minimal.next.size() - 1) * stride > UINT16_MAX)
+        throw runtime_error("Too many DFA states for 16-bit row offsets");
+
+    string upper;
+    for (char c : options.name)
+    {
+        if (isupper((unsigned char)c) && !upper.empty())
+            upper += '_';
+        upper += (char)toupper((unsigned char)c);
+    }
+    string type = options.name;
+    type[0] = (char)toupper((unsigned char)type[0]);
+    string header = path.substr(path.find_last_of("/\\") + 1);
+    string sources;
+    for (const pair<string, string> &input : options.inputs)
+    {
+        sources += sources.empty() ? "" : " ";
+        sources += input.first.substr(input.first.find_last_of("/\\") + 1);
+        if (!input.second.empty())
+            sources += "=" + input.second;
+    }
+
+    ostringstream out;
+    out << "// " << header << "\n";
+    out << "// Generated by DfaGenerator from " << sources << "; do not edit.\n";
+    out << "//   DfaGenerator " << (options.ignoreCase ? "--ignore-case " : "") << "-o " << header << " " << sources
+        << "\n";
+    out << "// NFA states: " << nfa.states.size() << ", DFA states after subset construction: " << subset.next.size()
+        << ", after minimization: " << minimal.next.size() << ", byte classes: " << classCount << "\n";
+    out << "#pragma once\n\n#include <cstdint>\n\n";
+    out << "enum " << type << "Kind : uint8_t\n{\n    " << upper << "_NONE,\n";
+    for (const string &kind : nfa.kinds)
+        out << "    " << upper << "_" << kind << ",\n";
+    out << "    " << upper << "_KIND_COUNT\n};\n\n";
+    out << "constexpr unsigned " << options.name << "ClassCount = " << classCount << ";\n";
+    out << "constexpr unsigned " << options.name << "StateCount = " << minimal.next.size() << ";\n";
+    out << "constexpr unsigned " << options.name << "Stride = " << stride << ";\n";
+    out << "constexpr unsigned " << options.name << "KindColumn = " << classCount << ";\n";
+    out << "constexpr unsigned " << options.name << "Dead = 0;\n";
+    out << "constexpr unsigned " << options.name << "Start = " << minimal.start * stride << ";\n\n";
+
+    out << "constexpr uint8_t " << options.name << "Classes[256] = {";
+    for (int c = 0; c < 256; c++)
+        out << (c % 32 ? " " : "\n    ") << classes[c] << (c < 255 ? "," : "");
+    out << "};\n\n";
+
+    // One row per state: the next row for each class, then the kind
+    vector<int> representative(classCount);
+    for (int c = 255; c >= 0; c--)
+        representative[classes[c]] = c;
+    out << "constexpr uint16_t " << options.name << "Transitions[" << cells << "] = {";
+    for (size_t s = 0; s < minimal.next.size(); s++)
+    {
+        out << "\n    ";
+        for (int k = 0; k < classCount; k++)
+            out << minimal.next[s][representative[k]] * stride << ", ";
+        out << minimal.kinds[s] + 1 << (s + 1 < minimal.next.size() ? "," : "");
+    }
+    out << "};\n\n";
+
+    out << "constexpr const char *" << options.name << "KindNames[" << upper << "_KIND_COUNT] = {\"NONE\"";
+    for (const string &kind : nfa.kinds)
+        out << ", \"" << kind << "\"";
+    out << "};\n";
+
+    ofstream file(path, ios::binary);
+    if (!file)
+        throw runtime_error("Output file could not be created: " + path);
+    file << out.str();
+}
@@ -0,0 +1,169 @@
+// DfaLexer.h
+// Table-driven lexer for the Pascal subset of Lab4, run by the DFA that
+// DfaGenerator builds from PascalKeywords.jff and PascalTokens.jff. It returns
+// the same tokens as PascalLexer (Lab4/PascalLexer.h) and is interchangeable
+// with it.
+//
+// The inner loop does one class lookup and one transition lookup per byte and
+// remembers the last accepting position with conditional moves, so the only
+// branch is the loop condition. Its exit is the longest match. Blanks, newlines
+// and the openings of comments and strings are tokens of the DFA too; the loop
+// skips the blanks and finishes comments and strings with memchr.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include "../Lab4/PascalLexer.h"
+#include "PascalDfaTables.h"
+
+using namespace std;
+
+class PascalDfaLexer
+{
+public:
+    PascalDfaLexer(const char *data, size_t size) : cursor(data), end(data + size), lineStart(data) {}
+
+    // Returns TOKEN_EOF at the end, and keeps returning it
+    Token next()
+    {
+        const char *p = cursor;
+        for (;;)
+        {
+            // Single blanks between tokens are the commonest input; skip them without the DFA
+            while (p < end && *p == ' ')
+                p++;
+            if (p == end)
+            {
+                cursor = p;
+                return Token{TOKEN_EOF, string_view("<EOF>"), line, (uint32_t)(p - lineStart)};
+            }
+            const char *start = p;
+            unsigned kind;
+            p = longestMatch(p, kind);
+            switch (kind)
+            {
+            case PASCAL_DFA_SPACE:
+                continue;
+            case PASCAL_DFA_NEWLINE:
+                line++;
+                lineStart = start + 1;
+                continue;
+            case PASCAL_DFA_COMMENT_BRACE:
+            {
+                const char *close = (const char *)memchr(p, '}', end - p);
+                p = advanceCountingLines(p, close ? close + 1 : end);
+                continue;
+            }
+            case PASCAL_DFA_COMMENT_PAREN:
+                p = advanceCountingLines(p, findParenCommentEnd(p));
+                continue;
+            case PASCAL_DFA_STRING:
+            {
+                // Lines are counted after the token, whose position is its start
+                const uint32_t startLine = line;
+                const uint32_t startColumn = (uint32_t)(start - lineStart) + 1;
+                p = advanceCountingLines(p, findStringEnd(p));
+                cursor = p;
+                return Token{TOKEN_STRING, string_view(start, p - start), startLine, startColumn};
+            }
+            default:
+            {
+                cursor = p;
+                // The DFA already knows it is a keyword; only which one is looked up
+                const uint32_t id = kind == PASCAL_DFA_KEYWORD ? pascalKeyword(start, p - start) : 0;
+                return Token{tokenKindOf(kind), string_view(start, p - start), line, (uint32_t)(start - lineStart) + 1,
+                             id};
+            }
+            }
+        }
+    }
+
+private:
+    // Runs the DFA from p until it dies or the input ends. A byte no token
+    // starts with comes back as one UNKNOWN byte.
+    const char *longestMatch(const char *p, unsigned &kind) const
+    {
+        const uint16_t *table = pascalDfaTransitions;
+        unsigned state = pascalDfaStart;
+        unsigned acceptKind = PASCAL_DFA_NONE;
+        const char *acceptEnd = p + 1;
+        do
+        {
+            state = table[state + pascalDfaClasses[(unsigned char)*p++]];
+            const unsigned stateKind = table[state + pascalDfaKindColumn];
+            acceptEnd = stateKind != PASCAL_DFA_NONE ? p : acceptEnd;
+            acceptKind = stateKind != PASCAL_DFA_NONE ? stateKind : acceptKind;
+        } while (state != pascalDfaDead && p != end);
+        kind = acceptKind;
+        return acceptEnd;
+    }
+
+    static TokenKind tokenKindOf(unsigned kind)
+    {
+        switch (kind)
+        {
+        case PASCAL_DFA_KEYWORD:
+            return TOKEN_KEYWORD;
+        case PASCAL_DFA_ID:
+            return TOKEN_ID;
+        case PASCAL_DFA_NUM:
+            return TOKEN_NUM;
+        case PASCAL_DFA_OP:
+            return TOKEN_OP;
+        case PASCAL_DFA_DELIM:
+            return TOKEN_DELIM;
+        default:
+            return TOKEN_UNKNOWN;
+        }
+    }
+
+    const char *advanceCountingLines(const char *from, const char *to)
+    {
+        const char *newlineAt;
+        while ((newlineAt = (const char *)memchr(from, '\n', to - from)) != nullptr)
+        {
+            line++;
+            lineStart = newlineAt + 1;
+            from = newlineAt + 1;
+        }
+        return to;
+    }
+
+    // p is just past "(*"
+    const char *findParenCommentEnd(const char *p) const
+    {
+        for (;;)
+        {
+            const char *star = (const char *)memchr(p, '*', end - p);
+            if (star == nullptr || star + 1 == end)
+                return end;
+            if (star[1] == ')')
+                return star + 2;
+            p = star + 1;
+        }
+    }
+
+    // p is just past the opening quote; '' is a quote inside the string
+    const char *findStringEnd(const char *p) const
+    {
+        for (;;)
+        {
+            const char *quote = (const char *)memchr(p, '\'', end - p);
+            if (quote == nullptr)
+                return end;
+            if (quote + 1 < end && quote[1] == '\'')
+            {
+                p = quote + 2;
+                continue;
+            }
+            return quote + 1;
+        }
+    }
+
+    const char *cursor;
+    const char *end;
+    const char *lineStart;
+    uint32_t line = 1;
+};
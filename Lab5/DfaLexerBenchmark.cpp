@@ -0,0 +1,152 @@
+// Libraries
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include "../Lab2/MappedFile.h"
+#include "../Lab4/PascalLexer.h"
+#include "../Lab4/PascalSourceGenerator.h"
+#include "DfaLexer.h"
+
+using namespace std;
+
+// Single-core throughput of the table-driven PascalDfaLexer against the
+// hand-written PascalLexer of Lab4 on the same source, best of R runs each.
+// Both token streams are compared first, so the figures are for identical
+// output.
+//
+// Usage:
+//   DfaLexerBenchmark [source.pas] [--size MB] [--runs R] [--seed N]
+
+// Structs
+struct LexerRun
+{
+    double seconds = 0;
+    uint64_t tokens = 0;
+    uint64_t lexemeBytes = 0; // printed with the results, so the lexing loop cannot be dropped
+};
+
+// Function Prototypes
+template <class Lexer>
+LexerRun lexOnce(const char *data, size_t size);
+bool sameTokens(const char *data, size_t size);
+
+// Main Function
+int main(int argc, char *argv[])
+{
+    try
+    {
+        string sourcePath;
+        size_t sizeMb = 64;
+        int runs = 5;
+        uint64_t seed = 1;
+        for (int i = 1; i < argc; i++)
+        {
+            string argument = argv[i];
+            if (argument == "--size" && i + 1 < argc)
+                sizeMb = stoul(argv[++i]);
+            else if (argument == "--runs" && i + 1 < argc)
+                runs = max(1, stoi(argv[++i]));
+            else if (argument == "--seed" && i + 1 < argc)
+                seed = stoull(argv[++i]);
+            else
+                sourcePath = argument;
+        }
+
+        MappedFile file;
+        string generated;
+        const char *data;
+        size_t size;
+        if (!sourcePath.empty())
+        {
+            if (!file.open(sourcePath))
+            {
+                cerr << "File could not be opened: " << sourcePath << endl;
+                return 1;
+            }
+            data = file.data();
+            size = file.size();
+        }
+        else
+        {
+            generated = PascalSourceGenerator(seed).generate(sizeMb * 1024 * 1024);
+            data = generated.data();
+            size = generated.size();
+        }
+
+        if (!sameTokens(data, size))
+            return 1;
+
+        LexerRun bestDfa, bestHandWritten;
+        for (int r = 0; r < runs; r++)
+        {
+            LexerRun run = lexOnce<PascalDfaLexer>(data, size);
+            if (r == 0 || run.seconds < bestDfa.seconds)
+                bestDfa = run;
+            run = lexOnce<PascalLexer>(data, size);
+            if (r == 0 || run.seconds < bestHandWritten.seconds)
+                bestHandWritten = run;
+        }
+        if (bestDfa.tokens != bestHandWritten.tokens || bestDfa.lexemeBytes != bestHandWritten.lexemeBytes)
+            throw runtime_error("the two lexers counted different tokens while timed");
+        double megabytes = size / (1024.0 * 1024.0);
+        cout << "Source: " << (sourcePath.empty() ? "generated" : sourcePath) << ", " << size << " bytes, "
+             << bestDfa.tokens << " tokens, " << bestDfa.lexemeBytes << " lexeme bytes" << endl;
+        cout << "DFA: " << pascalDfaStateCount << " states, " << pascalDfaClassCount << " byte classes, "
+             << sizeof(pascalDfaTransitions) << " byte table" << endl;
+        cout << "Best of " << runs << ", table-driven: " << bestDfa.seconds * 1000 << " ms, "
+             << megabytes / bestDfa.seconds << " MB/s, " << bestDfa.tokens / bestDfa.seconds / 1e6 << " M tokens/s"
+             << endl;
+        cout << "Best of " << runs << ", hand-written: " << bestHandWritten.seconds * 1000 << " ms, "
+             << megabytes / bestHandWritten.seconds << " MB/s, "
+             << bestHandWritten.tokens / bestHandWritten.seconds / 1e6 << " M tokens/s" << endl;
+        return 0;
+    }
+    catch (exception &e)
+    {
+        cout << "Error occurred: " << e.what() << endl;
+        return 1;
+    }
+}
+
+template <class Lexer>
+LexerRun lexOnce(const char *data, size_t size)
+{
+    LexerRun run;
+    auto start = chrono::steady_clock::now();
+    Lexer lexer(data, size);
+    for (;;)
+    {
+        Token token = lexer.next();
+        run.tokens++;
+        run.lexemeBytes += token.lexeme.size();
+        if (token.kind == TOKEN_EOF)
+            break;
+    }
+    run.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return run;
+}
+
+bool sameTokens(const char *data, size_t size)
+{
+    PascalDfaLexer dfa(data, size);
+    PascalLexer handWritten(data, size);
+    for (uint64_t index = 0;; index++)
+    {
+        Token a = dfa.next();
+        Token b = handWritten.next();
+        if (a.kind != b.kind || a.lexeme != b.lexeme || a.line != b.line || a.column != b.column)
+        {
+            cerr << "Token " << index << " differs:" << endl;
+            cerr << "  table-driven: ";
+            writeToken(cerr, a);
+            cerr << "  hand-written: ";
+            writeToken(cerr, b);
+            return false;
+        }
+        if (a.kind == TOKEN_EOF)
+            return true;
+    }
+}
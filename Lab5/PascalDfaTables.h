@@ -0,0 +1,123 @@
+// PascalDfaTables.h
+// Generated by DfaGenerator from PascalKeywords.jff PascalTokens.jff; do not edit.
+//   DfaGenerator --ignore-case -o PascalDfaTables.h PascalKeywords.jff PascalTokens.jff
+// NFA states: 120, DFA states after subset construction: 114, after minimization: 79, byte classes: 39
+#pragma once
+
+#include <cstdint>
+
+enum PascalDfaKind : uint8_t
+{
+    PASCAL_DFA_NONE,
+    PASCAL_DFA_KEYWORD,
+    PASCAL_DFA_ID,
+    PASCAL_DFA_NUM,
+    PASCAL_DFA_OP,
+    PASCAL_DFA_DELIM,
+    PASCAL_DFA_COMMENT_BRACE,
+    PASCAL_DFA_COMMENT_PAREN,
+    PASCAL_DFA_STRING,
+    PASCAL_DFA_SPACE,
+    PASCAL_DFA_NEWLINE,
+    PASCAL_DFA_KIND_COUNT
+};
+
+constexpr unsigned pascalDfaClassCount = 39;
+constexpr unsigned pascalDfaStateCount = 79;
+constexpr unsigned pascalDfaStride = 40;
+constexpr unsigned pascalDfaKindColumn = 39;
+constexpr unsigned pascalDfaDead = 0;
+constexpr unsigned pascalDfaStart = 40;
+
+constexpr uint8_t pascalDfaClasses[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 0, 0, 0, 0, 0, 0, 3, 4, 5, 6, 7, 5, 7, 8, 9, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 11, 5, 12, 13, 14, 0,
+    0, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 24, 25, 26, 27, 28, 29, 24, 30, 31, 32, 33, 34, 35, 24, 36, 24, 5, 0, 5, 0, 37,
+    0, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 24, 25, 26, 27, 28, 29, 24, 30, 31, 32, 33, 34, 35, 24, 36, 24, 38, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+constexpr uint16_t pascalDfaTransitions[3160] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 80, 120, 160, 200, 240, 280, 280, 320, 280, 360, 400, 440, 280, 400, 480, 520, 560, 600, 640, 680, 720, 720, 760, 720, 720, 800, 840, 880, 920, 960, 720, 1000, 720, 1040, 1080, 720, 0, 1120, 0,
+    0, 80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 9,
+    0, 120, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 10,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 8,
+    0, 0, 0, 0, 0, 0, 1160, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4,
+    0, 0, 0, 0, 0, 0, 0, 0, 240, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5,
+    0, 0, 0, 0, 0, 0, 0, 0, 1200, 0, 360, 0, 0, 0, 0, 0, 0, 0, 0, 1240, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 280, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 280, 280, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 1280, 720, 720, 1320, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 1360, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 1400, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 1440, 720, 720, 720, 720, 1480, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 1520, 720, 1280, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 1560, 720, 720, 720, 720, 1600, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 1640, 720, 720, 720, 720, 720, 720, 1680, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 1280, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 1720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 1640, 720, 720, 720, 720, 720, 720, 720, 720, 720, 1640, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 1760, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 1800, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 1840, 720, 720, 720, 720, 720, 1640, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 1560, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 1880, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 7,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1920, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 1960, 0, 0, 2000, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 1640, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 2040, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 2080, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 2120, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 1640, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 2160, 720, 720, 0, 1,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 2200, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 1640, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 2240, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 1,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 2280, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 1640, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 2320, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 2360, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 2400, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 2440, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 2480, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1920, 0, 0, 0, 0, 0, 0, 0, 0, 1240, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2000, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2000, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 2520, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 2440, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 1720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 2560, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 1640, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 2600, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 2640, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 2680, 720, 720, 720, 2720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 1640, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 2760, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 1640, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 2200, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 1640, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 2800, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 2840, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 2880, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 2920, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 2960, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 2440, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 1640, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 3000, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 1560, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 3040, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 3080, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 2440, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 3120, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 1640, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 0, 2,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 720, 0, 0, 0, 0, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 720, 2200, 720, 720, 720, 720, 720, 720, 720, 0, 2};
+
+constexpr const char *pascalDfaKindNames[PASCAL_DFA_KIND_COUNT] = {"NONE", "KEYWORD", "ID", "NUM", "OP", "DELIM", "COMMENT_BRACE", "COMMENT_PAREN", "STRING", "SPACE", "NEWLINE"};
@@ -0,0 +1,111 @@
+// SymbolTable.h
+// Scoped symbol table for the native Pascal front end, keyed by the
+// identifier ids of Lab4/IdentifierTable.h instead of by name as in the AVL
+// trees of symbolTablePascal.py.
+//
+// All scopes share one stack of entries. Each entry remembers the entry it
+// shadows, and visible[id] points at the innermost declaration of an
+// identifier, so a lookup is one array index and no string is ever compared.
+// Entering a scope records the stack height; leaving it pops the scope's
+// entries and restores what they shadowed, which costs one step per
+// declaration made in the scope.
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "../Lab4/IdentifierTable.h"
+
+using namespace std;
+
+enum SymbolKind : uint8_t
+{
+    SYMBOL_PROGRAM,
+    SYMBOL_VARIABLE,
+    SYMBOL_PARAMETER,
+    SYMBOL_CONSTANT,
+    SYMBOL_FUNCTION,
+    SYMBOL_PROCEDURE
+};
+
+inline const char *symbolKindName(int kind)
+{
+    static const char *names[] = {"program", "variable", "parameter", "constant", "function", "procedure"};
+    return names[kind];
+}
+
+struct Symbol
+{
+    uint32_t name;     // identifier id
+    uint32_t type;     // caller's type id, e.g. the interned type name
+    uint32_t line;
+    uint32_t shadowed; // entry index + 1 of the declaration this one hides, 0 if none
+    uint16_t depth;    // 0 is the global scope
+    SymbolKind kind;
+};
+
+class SymbolTable
+{
+public:
+    explicit SymbolTable(size_t identifierCount = 1024)
+    {
+        visible.resize(identifierCount + 1, 0);
+        entries.reserve(256);
+        scopeStarts.reserve(16);
+    }
+
+    void enterScope() { scopeStarts.push_back((uint32_t)entries.size()); }
+
+    // The global scope cannot be left
+    void exitScope()
+    {
+        if (scopeStarts.empty())
+            return;
+        const uint32_t start = scopeStarts.back();
+        scopeStarts.pop_back();
+        while (entries.size() > start)
+        {
+            const Symbol &symbol = entries.back();
+            visible[symbol.name] = symbol.shadowed;
+            entries.pop_back();
+        }
+    }
+
+    unsigned depth() const { return (unsigned)scopeStarts.size(); }
+
+    // Returns nullptr, and declares nothing, when the current scope already has the name
+    const Symbol *declare(uint32_t name, SymbolKind kind, uint32_t type, uint32_t line)
+    {
+        if (name >= visible.size())
+            visible.resize(max<size_t>(name + 1, visible.size() * 2), 0);
+        const uint32_t previous = visible[name];
+        if (previous != 0 && entries[previous - 1].depth == depth())
+            return nullptr;
+        entries.push_back(Symbol{name, type, line, previous, (uint16_t)depth(), kind});
+        visible[name] = (uint32_t)entries.size();
+        return &entries.back();
+    }
+
+    // Innermost visible declaration, or nullptr; valid until the next declare or exitScope
+    const Symbol *lookup(uint32_t name) const
+    {
+        const uint32_t index = name < visible.size() ? visible[name] : 0;
+        return index != 0 ? &entries[index - 1] : nullptr;
+    }
+
+    // Only the current scope, as needed for redeclaration checks
+    const Symbol *lookupLocal(uint32_t name) const
+    {
+        const Symbol *symbol = lookup(name);
+        return symbol != nullptr && symbol->depth == depth() ? symbol : nullptr;
+    }
+
+    // Every declaration currently visible or shadowed, outermost first
+    const vector<Symbol> &symbols() const { return entries; }
+
+private:
+    vector<uint32_t> visible; // by identifier id: entry index + 1, 0 if undeclared
+    vector<Symbol> entries;
+    vector<uint32_t> scopeStarts;
+};
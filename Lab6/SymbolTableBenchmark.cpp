@@ -0,0 +1,287 @@
+// Libraries
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include "../Lab4/IdentifierTable.h"
+#include "../Lab4/PascalSourceGenerator.h"
+#include "SymbolTable.h"
+
+using namespace std;
+
+// Declarations and lookups across nested procedures, run through SymbolTable
+// and through a stack of ordered maps keyed by name (the std::map analogue of
+// the AVL trees in symbolTablePascal.py). Both run the same recorded script
+// of scope entries and exits, declarations and lookups, and must agree on
+// every result.
+//
+// The script opens procedures up to --depth deep, declares a handful of
+// locals in each, then looks up names: mostly visible ones, some from outer
+// scopes, some never declared.
+//
+// Usage:
+//   SymbolTableBenchmark [--declarations N] [--lookups N] [--names N] [--depth D] [--seed N]
+
+// Structs
+enum OperationKind : uint8_t
+{
+    OPERATION_ENTER,
+    OPERATION_EXIT,
+    OPERATION_DECLARE,
+    OPERATION_LOOKUP
+};
+
+struct Operation
+{
+    OperationKind kind;
+    uint32_t name; // index into the spellings
+};
+
+struct ScriptResult
+{
+    double seconds = 0;
+    uint64_t declared = 0;
+    uint64_t found = 0;
+    uint64_t checksum = 0; // sum of the declaration lines found
+};
+
+// Function Prototypes
+vector<Operation> makeScript(size_t declarations, size_t lookups, size_t names, unsigned maxDepth, uint64_t seed);
+ScriptResult runSymbolTable(const vector<Operation> &script, const vector<uint32_t> &ids, size_t identifierCount);
+ScriptResult runMapStack(const vector<Operation> &script, const vector<string> &spellings);
+
+// Main Function
+int main(int argc, char *argv[])
+{
+    try
+    {
+        size_t declarations = 1000000;
+        size_t lookups = 1000000;
+        size_t nameCount = 20000;
+        unsigned maxDepth = 8;
+        uint64_t seed = 1;
+        for (int i = 1; i + 1 < argc; i += 2)
+        {
+            string argument = argv[i];
+            if (argument == "--declarations")
+                declarations = stoul(argv[i + 1]);
+            else if (argument == "--lookups")
+                lookups = stoul(argv[i + 1]);
+            else if (argument == "--names")
+                nameCount = max<size_t>(1, stoul(argv[i + 1]));
+            else if (argument == "--depth")
+                maxDepth = max(1, stoi(argv[i + 1]));
+            else if (argument == "--seed")
+                seed = stoull(argv[i + 1]);
+            else
+                throw invalid_argument("Unknown option " + argument);
+        }
+
+        // Identifiers in mixed case, as a lexer would see them
+        PascalSourceRandom random(seed);
+        vector<string> spellings(nameCount);
+        for (size_t i = 0; i < nameCount; i++)
+        {
+            static const char *stems[] = {"count", "Index", "total", "VALUE", "temp", "sum", "Buffer", "x"};
+            spellings[i] = stems[random.below(8)] + to_string(i);
+        }
+
+        IdentifierTable identifiers(nameCount);
+        vector<uint32_t> ids(nameCount);
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < nameCount; i++)
+            ids[i] = identifiers.intern(spellings[i]);
+        double internSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        // Most identifiers a lexer sees are already interned
+        start = chrono::steady_clock::now();
+        size_t changedIds = 0;
+        for (int pass = 0; pass < 10; pass++)
+        {
+            for (size_t i = 0; i < nameCount; i++)
+                changedIds += identifiers.intern(spellings[i]) != ids[i];
+        }
+        double reinternSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count() / 10;
+        if (changedIds != 0 || identifiers.size() != nameCount)
+        {
+            cerr << "Interning is not stable" << endl;
+            return 1;
+        }
+
+        // The map stack keys by the lowercase spelling, like the interned names
+        vector<string> lowercase(nameCount);
+        for (size_t i = 0; i < nameCount; i++)
+            lowercase[i] = string(identifiers.name(ids[i]));
+
+        vector<Operation> script = makeScript(declarations, lookups, nameCount, maxDepth, seed);
+        ScriptResult table = runSymbolTable(script, ids, identifiers.size());
+        ScriptResult maps = runMapStack(script, lowercase);
+        if (table.declared != maps.declared || table.found != maps.found || table.checksum != maps.checksum)
+        {
+            cerr << "SymbolTable and the map stack disagree" << endl;
+            return 1;
+        }
+
+        size_t operations = script.size();
+        cout << "Script: " << operations << " operations, " << table.declared << " declarations, "
+             << table.found << " names found, " << nameCount << " distinct names, depth up to " << maxDepth << endl;
+        cout << "Interning " << nameCount << " names: " << internSeconds * 1e9 / nameCount << " ns per new name, "
+             << reinternSeconds * 1e9 / nameCount << " ns per known name" << endl;
+        cout << "SymbolTable: " << table.seconds * 1000 << " ms, " << table.seconds * 1e9 / operations
+             << " ns per operation" << endl;
+        cout << "Map stack:   " << maps.seconds * 1000 << " ms, " << maps.seconds * 1e9 / operations
+             << " ns per operation" << endl;
+        return 0;
+    }
+    catch (exception &e)
+    {
+        cout << "Error occurred: " << e.what() << endl;
+        return 1;
+    }
+}
+
+vector<Operation> makeScript(size_t declarations, size_t lookups, size_t names, unsigned maxDepth, uint64_t seed)
+{
+    PascalSourceRandom random(seed * 31 + 7);
+    vector<Operation> script;
+    script.reserve(declarations + lookups + declarations / 2);
+
+    // Globals first, then procedures
+    vector<vector<uint32_t>> declared(1);
+    for (size_t i = 0; i < min<size_t>(declarations / 100, 1000); i++)
+    {
+        uint32_t name = random.below((unsigned)names);
+        script.push_back(Operation{OPERATION_DECLARE, name});
+        declared[0].push_back(name);
+    }
+    size_t declarationsLeft = declarations - declared[0].size();
+    const double lookupsPerDeclaration = declarations > 0 ? (double)lookups / declarations : 0;
+    double lookupCredit = 0;
+    size_t lookupsLeft = lookups;
+
+    while (declarationsLeft > 0 || lookupsLeft > 0)
+    {
+        // Go deeper or come back out, like nested procedure bodies
+        unsigned depth = (unsigned)declared.size() - 1;
+        bool enter = depth == 0 || (depth < maxDepth && random.below(2) == 0);
+        if (declarationsLeft == 0)
+            enter = false;
+        if (enter)
+        {
+            script.push_back(Operation{OPERATION_ENTER, 0});
+            declared.emplace_back();
+            for (unsigned i = 2 + random.below(8); i > 0 && declarationsLeft > 0; i--, declarationsLeft--)
+            {
+                uint32_t name = random.below((unsigned)names);
+                script.push_back(Operation{OPERATION_DECLARE, name});
+                declared.back().push_back(name);
+            }
+        }
+        else if (depth > 0)
+        {
+            script.push_back(Operation{OPERATION_EXIT, 0});
+            declared.pop_back();
+        }
+
+        lookupCredit += enter ? 6 * lookupsPerDeclaration : 0;
+        if (declarationsLeft == 0)
+            lookupCredit = (double)lookupsLeft;
+        while (lookupCredit >= 1 && lookupsLeft > 0)
+        {
+            // Mostly the current scope, then any enclosing scope, then anything
+            const vector<uint32_t> &scope = declared[random.below((unsigned)declared.size())];
+            uint32_t name;
+            unsigned pick = random.below(10);
+            if (pick < 6 && !declared.back().empty())
+                name = declared.back()[random.below((unsigned)declared.back().size())];
+            else if (pick < 9 && !scope.empty())
+                name = scope[random.below((unsigned)scope.size())];
+            else
+                name = random.below((unsigned)names);
+            script.push_back(Operation{OPERATION_LOOKUP, name});
+            lookupCredit -= 1;
+            lookupsLeft--;
+        }
+        if (declarationsLeft == 0 && lookupsLeft == 0)
+            break;
+    }
+    while (declared.size() > 1)
+    {
+        script.push_back(Operation{OPERATION_EXIT, 0});
+        declared.pop_back();
+    }
+    return script;
+}
+
+ScriptResult runSymbolTable(const vector<Operation> &script, const vector<uint32_t> &ids, size_t identifierCount)
+{
+    ScriptResult result;
+    auto start = chrono::steady_clock::now();
+    SymbolTable table(identifierCount);
+    uint32_t line = 0;
+    for (const Operation &operation : script)
+    {
+        switch (operation.kind)
+        {
+        case OPERATION_ENTER:
+            table.enterScope();
+            break;
+        case OPERATION_EXIT:
+            table.exitScope();
+            break;
+        case OPERATION_DECLARE:
+            result.declared += table.declare(ids[operation.name], SYMBOL_VARIABLE, 0, ++line) != nullptr;
+            break;
+        case OPERATION_LOOKUP:
+            if (const Symbol *symbol = table.lookup(ids[operation.name]))
+            {
+                result.found++;
+                result.checksum += symbol->line;
+            }
+            break;
+        }
+    }
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+ScriptResult runMapStack(const vector<Operation> &script, const vector<string> &spellings)
+{
+    ScriptResult result;
+    auto start = chrono::steady_clock::now();
+    vector<map<string, uint32_t>> scopes(1); // name to declaration line
+    uint32_t line = 0;
+    for (const Operation &operation : script)
+    {
+        const string &name = spellings[operation.name];
+        switch (operation.kind)
+        {
+        case OPERATION_ENTER:
+            scopes.emplace_back();
+            break;
+        case OPERATION_EXIT:
+            scopes.pop_back();
+            break;
+        case OPERATION_DECLARE:
+            line++;
+            result.declared += scopes.back().emplace(name, line).second;
+            break;
+        case OPERATION_LOOKUP:
+            for (size_t i = scopes.size(); i-- > 0;)
+            {
+                auto found = scopes[i].find(name);
+                if (found != scopes[i].end())
+                {
+                    result.found++;
+                    result.checksum += found->second;
+                    break;
+                }
+            }
+            break;
+        }
+    }
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return result;
+}
@@ -0,0 +1,163 @@
+// Arena.h
+// Bump allocator for everything the compiler builds per source file. Memory
+// comes from large blocks and is never freed piecemeal: release() drops it
+// all at once, and reset() keeps the first block so a thread compiling file
+// after file allocates from the same memory every time.
+//
+// ArenaArray is a growable array inside an arena, for trivially copyable
+// items such as AST nodes. Growing copies into a block twice the size and
+// abandons the old one until the arena is reset, so at most half of an
+// array's memory is dead. Items are addressed by index, which stays valid
+// when the array moves.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+using namespace std;
+
+class Arena
+{
+public:
+    explicit Arena(size_t blockSize = 1 << 20) : blockSize(blockSize) {}
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+    ~Arena() { release(); }
+
+    void *allocate(size_t bytes, size_t alignment = alignof(max_align_t))
+    {
+        size_t offset = (used + alignment - 1) & ~(alignment - 1);
+        if (head == nullptr || offset + bytes > head->capacity)
+        {
+            newBlock(bytes + alignment);
+            offset = (used + alignment - 1) & ~(alignment - 1);
+        }
+        used = offset + bytes;
+        return head->data() + offset;
+    }
+
+    template <class T>
+    T *allocateArray(size_t count)
+    {
+        static_assert(is_trivially_copyable<T>::value, "arena memory is never destroyed");
+        return (T *)allocate(count * sizeof(T), alignof(T));
+    }
+
+    // Frees every block
+    void release()
+    {
+        while (head != nullptr)
+        {
+            Block *previous = head->previous;
+            free(head);
+            head = previous;
+        }
+        used = 0;
+        total = 0;
+    }
+
+    // Frees every block but the first, which is reused
+    void reset()
+    {
+        while (head != nullptr && head->previous != nullptr)
+        {
+            Block *previous = head->previous;
+            free(head);
+            head = previous;
+        }
+        used = head != nullptr ? sizeof(Block) : 0;
+        total = head != nullptr ? head->capacity : 0;
+    }
+
+    // Bytes of blocks held, including the unused tail of the current one
+    size_t bytesReserved() const { return total; }
+
+private:
+    struct Block
+    {
+        Block *previous;
+        size_t capacity; // including this header
+        char *data() { return (char *)this; }
+    };
+
+    void newBlock(size_t atLeast)
+    {
+        size_t capacity = blockSize;
+        if (atLeast + sizeof(Block) > capacity)
+            capacity = atLeast + sizeof(Block);
+        Block *block = (Block *)malloc(capacity);
+        if (block == nullptr)
+            throw bad_alloc();
+        block->previous = head;
+        block->capacity = capacity;
+        head = block;
+        used = sizeof(Block);
+        total += capacity;
+    }
+
+    size_t blockSize;
+    Block *head = nullptr;
+    size_t used = 0; // bytes used in head, header included
+    size_t total = 0;
+};
+
+template <class T>
+class ArenaArray
+{
+public:
+    explicit ArenaArray(Arena &arena) : arena(&arena) {}
+
+    uint32_t push_back(const T &item)
+    {
+        if (count == capacity)
+            grow(capacity == 0 ? 64 : capacity * 2);
+        items[count] = item;
+        return count++;
+    }
+
+    // Appends count default items and returns the index of the first
+    uint32_t extend(uint32_t extra)
+    {
+        if (count + extra > capacity)
+        {
+            uint32_t wanted = capacity == 0 ? 64 : capacity;
+            while (wanted < count + extra)
+                wanted *= 2;
+            grow(wanted);
+        }
+        uint32_t first = count;
+        count += extra;
+        return first;
+    }
+
+    T &operator[](uint32_t index) { return items[index]; }
+    const T &operator[](uint32_t index) const { return items[index]; }
+    uint32_t size() const { return count; }
+
+    // After the arena is reset
+    void clear()
+    {
+        items = nullptr;
+        count = 0;
+        capacity = 0;
+    }
+
+private:
+    void grow(uint32_t newCapacity)
+    {
+        T *moved = arena->allocateArray<T>(newCapacity);
+        if (count > 0)
+            memcpy((void *)moved, (const void *)items, count * sizeof(T));
+        items = moved;
+        capacity = newCapacity;
+    }
+
+    Arena *arena;
+    T *items = nullptr;
+    uint32_t count = 0;
+    uint32_t capacity = 0;
+};
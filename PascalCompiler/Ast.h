@@ -0,0 +1,353 @@
+// Ast.h
+// Syntax tree of one Pascal-subset source file (Lab4/Subset_of_Pascal.txt).
+//
+// Nodes are 24-byte records in one ArenaArray and refer to each other by
+// index; index 0 is a placeholder meaning "no node". Children whose number
+// varies (statements of a compound, arguments, declared names) are kept in a
+// second array of 32-bit words as [count, item, item, ...] and the node
+// stores the offset of the count; offset 0 is the empty list. Names are
+// IdentifierTable ids. Everything lives in the file's Arena, so the tree is
+// freed by releasing or resetting the arena.
+//
+// Field use by node kind:
+//   PROGRAM       a name, b parameter names (ids), c declarations, d body
+//   VARIABLES     a names (ids), type/bounds as below
+//   PARAMETERS    a names (ids), type/bounds as below
+//   FUNCTION      a name, b parameters, c declarations, d body, type = result
+//   PROCEDURE     a name, b parameters, c declarations, d body
+//   COMPOUND      a statements
+//   ASSIGN        a target (NAME or INDEX), b value
+//   CALL_STATEMENT a name, b arguments
+//   IF            a condition, b then, c else (0 if absent)
+//   WHILE         a condition, b body
+//   NAME          a name
+//   INDEX         a name, b index
+//   CALL          a name, b arguments
+//   INTEGER       c, d value (low and high 32 bits)
+//   REAL          c, d bits of the double
+//   UNARY         op, a operand
+//   BINARY        op, a left, b right
+// Declarations of array variables set NODE_FLAG_ARRAY and keep the bounds in
+// c and d (as int32).
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include "Arena.h"
+#include "../Lab4/IdentifierTable.h"
+
+using namespace std;
+
+enum NodeKind : uint8_t
+{
+    NODE_NONE,
+    NODE_PROGRAM,
+    NODE_VARIABLES,
+    NODE_PARAMETERS,
+    NODE_FUNCTION,
+    NODE_PROCEDURE,
+    NODE_COMPOUND,
+    NODE_ASSIGN,
+    NODE_CALL_STATEMENT,
+    NODE_IF,
+    NODE_WHILE,
+    NODE_NAME,
+    NODE_INDEX,
+    NODE_CALL,
+    NODE_INTEGER,
+    NODE_REAL,
+    NODE_UNARY,
+    NODE_BINARY,
+    NODE_KIND_COUNT
+};
+
+inline const char *nodeKindName(int kind)
+{
+    static const char *names[NODE_KIND_COUNT] = {
+        "none",   "program", "var",  "parameters", "function", "procedure", "compound", "assign", "call statement",
+        "if",     "while",   "name", "index",      "call",     "integer",   "real",     "unary",  "binary"};
+    return names[kind];
+}
+
+// Standard types; declarations of arrays add NODE_FLAG_ARRAY
+enum AstType : uint8_t
+{
+    AST_TYPE_NONE,
+    AST_TYPE_INTEGER,
+    AST_TYPE_REAL
+};
+
+enum : uint8_t
+{
+    NODE_FLAG_ARRAY = 1
+};
+
+// Operators of UNARY and BINARY nodes
+enum AstOperator : uint8_t
+{
+    OPERATOR_NONE,
+    OPERATOR_NEGATE,
+    OPERATOR_NOT,
+    OPERATOR_ADD,
+    OPERATOR_SUBTRACT,
+    OPERATOR_OR,
+    OPERATOR_MULTIPLY,
+    OPERATOR_DIVIDE, // '/', always real
+    OPERATOR_DIV,
+    OPERATOR_MOD,
+    OPERATOR_AND,
+    OPERATOR_EQUAL,
+    OPERATOR_NOT_EQUAL,
+    OPERATOR_LESS,
+    OPERATOR_LESS_EQUAL,
+    OPERATOR_GREATER,
+    OPERATOR_GREATER_EQUAL,
+    OPERATOR_COUNT
+};
+
+inline const char *operatorName(int op)
+{
+    static const char *names[OPERATOR_COUNT] = {"?", "-", "not", "+", "-", "or", "*", "/", "div",
+                                                "mod", "and", "=", "<>", "<", "<=", ">", ">="};
+    return names[op];
+}
+
+struct AstNode
+{
+    NodeKind kind;
+    uint8_t op;    // AstOperator
+    uint8_t type;  // AstType of declarations and function results
+    uint8_t flags;
+    uint32_t line;
+    uint32_t a, b, c, d;
+};
+
+static_assert(sizeof(AstNode) == 24, "AstNode is meant to stay compact");
+
+struct Diagnostic
+{
+    uint32_t line;
+    uint32_t column;
+    string message;
+};
+
+class Ast
+{
+public:
+    explicit Ast(Arena &arena) : nodes(arena), lists(arena)
+    {
+        nodes.push_back(AstNode{NODE_NONE, 0, 0, 0, 0, 0, 0, 0, 0});
+        lists.push_back(0);
+    }
+
+    uint32_t add(const AstNode &node) { return nodes.push_back(node); }
+
+    // Copies count words into a new list and returns its offset
+    uint32_t addList(const uint32_t *items, uint32_t count)
+    {
+        if (count == 0)
+            return 0;
+        uint32_t offset = lists.extend(count + 1);
+        lists[offset] = count;
+        memcpy(&lists[offset + 1], items, count * sizeof(uint32_t));
+        return offset;
+    }
+
+    AstNode &operator[](uint32_t index) { return nodes[index]; }
+    const AstNode &operator[](uint32_t index) const { return nodes[index]; }
+    uint32_t nodeCount() const { return nodes.size() - 1; }
+
+    uint32_t listSize(uint32_t offset) const { return lists[offset]; }
+    const uint32_t *listItems(uint32_t offset) const { return &lists[offset] + 1; }
+
+    static int64_t integerValue(const AstNode &node) { return (int64_t)(((uint64_t)node.d << 32) | node.c); }
+
+    static double realValue(const AstNode &node)
+    {
+        uint64_t bits = ((uint64_t)node.d << 32) | node.c;
+        double value;
+        memcpy(&value, &bits, sizeof value);
+        return value;
+    }
+
+    // Turn node into a constant; its other fields are left as they were
+    static void setInteger(AstNode &node, int64_t value)
+    {
+        node.kind = NODE_INTEGER;
+        node.c = (uint32_t)value;
+        node.d = (uint32_t)((uint64_t)value >> 32);
+    }
+
+    static void setReal(AstNode &node, double value)
+    {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof bits);
+        node.kind = NODE_REAL;
+        node.c = (uint32_t)bits;
+        node.d = (uint32_t)(bits >> 32);
+    }
+
+    uint32_t root = 0;
+
+private:
+    ArenaArray<AstNode> nodes;
+    ArenaArray<uint32_t> lists;
+};
+
+// Calls visit(index) for a node and every node below it, parents first
+template <class Visit>
+void forEachNode(const Ast &ast, uint32_t index, Visit &&visit)
+{
+    if (index == 0)
+        return;
+    visit(index);
+    const AstNode &node = ast[index];
+    auto list = [&](uint32_t offset) {
+        for (uint32_t i = 0; i < ast.listSize(offset); i++)
+            forEachNode(ast, ast.listItems(offset)[i], visit);
+    };
+    switch (node.kind)
+    {
+    case NODE_PROGRAM:
+        list(node.c);
+        forEachNode(ast, node.d, visit);
+        break;
+    case NODE_FUNCTION:
+    case NODE_PROCEDURE:
+        list(node.b);
+        list(node.c);
+        forEachNode(ast, node.d, visit);
+        break;
+    case NODE_COMPOUND:
+        list(node.a);
+        break;
+    case NODE_CALL_STATEMENT:
+    case NODE_CALL:
+        list(node.b);
+        break;
+    case NODE_IF:
+        forEachNode(ast, node.a, visit);
+        forEachNode(ast, node.b, visit);
+        forEachNode(ast, node.c, visit);
+        break;
+    case NODE_ASSIGN:
+    case NODE_WHILE:
+    case NODE_BINARY:
+        forEachNode(ast, node.a, visit);
+        forEachNode(ast, node.b, visit);
+        break;
+    case NODE_INDEX:
+        forEachNode(ast, node.b, visit);
+        break;
+    case NODE_UNARY:
+        forEachNode(ast, node.a, visit);
+        break;
+    default:
+        break;
+    }
+}
+
+// Indented outline of the tree, one node per line
+inline void printAst(ostream &out, const Ast &ast, const IdentifierTable &identifiers, uint32_t index = 0,
+                     int depth = 0)
+{
+    if (index == 0)
+    {
+        index = ast.root;
+        if (index == 0)
+            return;
+    }
+    const AstNode &node = ast[index];
+    out << string(2 * depth, ' ') << nodeKindName(node.kind);
+    auto names = [&](uint32_t list) {
+        for (uint32_t i = 0; i < ast.listSize(list); i++)
+            out << (i ? ", " : " ") << identifiers.name(ast.listItems(list)[i]);
+    };
+    auto children = [&](uint32_t list) {
+        for (uint32_t i = 0; i < ast.listSize(list); i++)
+            printAst(out, ast, identifiers, ast.listItems(list)[i], depth + 1);
+    };
+    auto child = [&](uint32_t child) {
+        if (child != 0)
+            printAst(out, ast, identifiers, child, depth + 1);
+    };
+    auto typeName = [&]() {
+        string name = node.type == AST_TYPE_REAL ? "real" : node.type == AST_TYPE_INTEGER ? "integer" : "";
+        if (node.flags & NODE_FLAG_ARRAY)
+            name = "array [" + to_string((int32_t)node.c) + ".." + to_string((int32_t)node.d) + "] of " + name;
+        return name;
+    };
+    switch (node.kind)
+    {
+    case NODE_PROGRAM:
+        out << " " << identifiers.name(node.a) << " (";
+        names(node.b);
+        out << " )\n";
+        children(node.c);
+        child(node.d);
+        break;
+    case NODE_VARIABLES:
+    case NODE_PARAMETERS:
+        names(node.a);
+        out << " : " << typeName() << "\n";
+        break;
+    case NODE_FUNCTION:
+    case NODE_PROCEDURE:
+        out << " " << identifiers.name(node.a);
+        if (node.kind == NODE_FUNCTION)
+            out << " : " << typeName();
+        out << "\n";
+        children(node.b);
+        children(node.c);
+        child(node.d);
+        break;
+    case NODE_COMPOUND:
+        out << "\n";
+        children(node.a);
+        break;
+    case NODE_ASSIGN:
+    case NODE_WHILE:
+        out << "\n";
+        child(node.a);
+        child(node.b);
+        break;
+    case NODE_IF:
+        out << "\n";
+        child(node.a);
+        child(node.b);
+        child(node.c);
+        break;
+    case NODE_CALL_STATEMENT:
+    case NODE_CALL:
+        out << " " << identifiers.name(node.a) << "\n";
+        children(node.b);
+        break;
+    case NODE_NAME:
+        out << " " << identifiers.name(node.a) << "\n";
+        break;
+    case NODE_INDEX:
+        out << " " << identifiers.name(node.a) << "\n";
+        child(node.b);
+        break;
+    case NODE_INTEGER:
+        out << " " << Ast::integerValue(node) << "\n";
+        break;
+    case NODE_REAL:
+        out << " " << Ast::realValue(node) << "\n";
+        break;
+    case NODE_UNARY:
+        out << " " << operatorName(node.op) << "\n";
+        child(node.a);
+        break;
+    case NODE_BINARY:
+        out << " " << operatorName(node.op) << "\n";
+        child(node.a);
+        child(node.b);
+        break;
+    default:
+        out << "\n";
+        break;
+    }
+}
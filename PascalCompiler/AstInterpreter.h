@@ -0,0 +1,348 @@
+// AstInterpreter.h
+// Straightforward tree-walking interpreter for the Pascal subset, kept as the
+// baseline the bytecode VM is measured against. It evaluates the Ast
+// directly: every name is looked up in hash maps (the current call's
+// variables, then the globals) each time it is used, and every value carries
+// its type at run time.
+//
+// It follows the semantics listed in BytecodeCompiler.h and prints and fails
+// the same way as VirtualMachine.h, except that it allows fewer nested
+// calls. It does no checking of its own, so run it only on programs the
+// bytecode compiler has accepted.
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Ast.h"
+#include "Bytecode.h"
+#include "../Lab4/IdentifierTable.h"
+
+using namespace std;
+
+class AstInterpreter
+{
+public:
+    AstInterpreter(const Ast &ast, IdentifierTable &identifiers) : ast(ast)
+    {
+        writeId = identifiers.intern("write");
+        writelnId = identifiers.intern("writeln");
+    }
+
+    void run(ostream &output)
+    {
+        out = &output;
+        globals.clear();
+        frames.clear();
+        subprograms.clear();
+        const AstNode &program = ast[ast.root];
+        for (uint32_t i = 0; i < ast.listSize(program.c); i++)
+        {
+            uint32_t index = ast.listItems(program.c)[i];
+            const AstNode &declaration = ast[index];
+            if (declaration.kind == NODE_VARIABLES)
+                declare(globals, declaration);
+            else
+                subprograms[declaration.a] = index;
+        }
+        execute(program.d);
+    }
+
+private:
+    struct TreeValue
+    {
+        uint8_t type;
+        int64_t i;
+        double r;
+    };
+
+    struct Variable
+    {
+        uint8_t type;
+        bool array;
+        int32_t low;
+        vector<TreeValue> elements; // one for scalars
+    };
+
+    typedef unordered_map<uint32_t, Variable> Scope;
+
+    struct Frame
+    {
+        uint32_t function; // identifier id
+        Scope variables;
+        TreeValue result;
+    };
+
+    // Each call nests several C++ calls, so this stays well inside the thread stack
+    static const size_t maxCallDepth = 5000;
+
+    [[noreturn]] static void fail(uint32_t line, const string &message)
+    {
+        throw runtime_error("line " + to_string(line) + ": " + message);
+    }
+
+    static TreeValue integer(int64_t value) { return TreeValue{AST_TYPE_INTEGER, value, 0}; }
+    static TreeValue real(double value) { return TreeValue{AST_TYPE_REAL, 0, value}; }
+    static double asReal(const TreeValue &value) { return value.type == AST_TYPE_REAL ? value.r : (double)value.i; }
+
+    static TreeValue converted(const TreeValue &value, uint8_t type)
+    {
+        return type == AST_TYPE_REAL && value.type == AST_TYPE_INTEGER ? real((double)value.i) : value;
+    }
+
+    void declare(Scope &scope, const AstNode &declaration)
+    {
+        Variable variable{declaration.type, (declaration.flags & NODE_FLAG_ARRAY) != 0, 0, {}};
+        size_t count = 1;
+        if (variable.array)
+        {
+            variable.low = (int32_t)declaration.c;
+            count = (size_t)((int64_t)(int32_t)declaration.d - variable.low + 1);
+        }
+        TreeValue zero = declaration.type == AST_TYPE_REAL ? real(0) : integer(0);
+        variable.elements.assign(count, zero);
+        for (uint32_t i = 0; i < ast.listSize(declaration.a); i++)
+            scope[ast.listItems(declaration.a)[i]] = variable;
+    }
+
+    Variable *find(uint32_t id)
+    {
+        if (!frames.empty())
+        {
+            auto local = frames.back().variables.find(id);
+            if (local != frames.back().variables.end())
+                return &local->second;
+        }
+        auto global = globals.find(id);
+        return global != globals.end() ? &global->second : nullptr;
+    }
+
+    TreeValue &element(Variable &variable, int64_t index, uint32_t line)
+    {
+        uint64_t k = (uint64_t)(index - variable.low);
+        if (k >= variable.elements.size())
+            fail(line, "array index " + to_string(index) + " out of bounds");
+        return variable.elements[k];
+    }
+
+    void execute(uint32_t index)
+    {
+        if (index == 0)
+            return;
+        const AstNode &node = ast[index];
+        switch (node.kind)
+        {
+        case NODE_COMPOUND:
+            for (uint32_t i = 0; i < ast.listSize(node.a); i++)
+                execute(ast.listItems(node.a)[i]);
+            break;
+        case NODE_ASSIGN:
+        {
+            const AstNode &target = ast[node.a];
+            if (target.kind == NODE_INDEX)
+            {
+                int64_t position = evaluate(target.b).i;
+                TreeValue value = evaluate(node.b);
+                Variable &variable = *find(target.a);
+                element(variable, position, node.line) = converted(value, variable.type);
+                break;
+            }
+            TreeValue value = evaluate(node.b);
+            Variable *variable = find(target.a);
+            if (variable != nullptr)
+                variable->elements[0] = converted(value, variable->type);
+            else
+            {
+                Frame &frame = frames.back();
+                frame.result = converted(value, ast[subprograms[frame.function]].type);
+            }
+            break;
+        }
+        case NODE_CALL_STATEMENT:
+            if ((node.a == writeId || node.a == writelnId) && subprograms.count(node.a) == 0 && find(node.a) == nullptr)
+            {
+                for (uint32_t i = 0; i < ast.listSize(node.b); i++)
+                {
+                    TreeValue value = evaluate(ast.listItems(node.b)[i]);
+                    if (value.type == AST_TYPE_REAL)
+                        writeReal(*out, value.r);
+                    else
+                        *out << value.i;
+                }
+                if (node.a == writelnId)
+                    *out << '\n';
+            }
+            else
+                call(node.a, node.b, node.line);
+            break;
+        case NODE_IF:
+            if (evaluate(node.a).i != 0)
+                execute(node.b);
+            else
+                execute(node.c);
+            break;
+        case NODE_WHILE:
+            while (evaluate(node.a).i != 0)
+                execute(node.b);
+            break;
+        default:
+            break;
+        }
+    }
+
+    TreeValue call(uint32_t id, uint32_t arguments, uint32_t line)
+    {
+        const AstNode &subprogram = ast[subprograms[id]];
+        if (frames.size() >= maxCallDepth)
+            fail(line, "stack overflow");
+
+        // Arguments are evaluated in the caller's scope, before the new frame exists
+        Frame frame{id, Scope(), subprogram.type == AST_TYPE_REAL ? real(0) : integer(0)};
+        uint32_t argument = 0;
+        for (uint32_t i = 0; i < ast.listSize(subprogram.b); i++)
+        {
+            const AstNode &group = ast[ast.listItems(subprogram.b)[i]];
+            for (uint32_t k = 0; k < ast.listSize(group.a); k++)
+            {
+                uint32_t expression = ast.listItems(arguments)[argument++];
+                if (group.flags & NODE_FLAG_ARRAY)
+                {
+                    Variable copy = *find(ast[expression].a);
+                    copy.low = (int32_t)group.c;
+                    frame.variables[ast.listItems(group.a)[k]] = move(copy);
+                }
+                else
+                {
+                    Variable variable{group.type, false, 0, {converted(evaluate(expression), group.type)}};
+                    frame.variables[ast.listItems(group.a)[k]] = variable;
+                }
+            }
+        }
+        for (uint32_t i = 0; i < ast.listSize(subprogram.c); i++)
+            declare(frame.variables, ast[ast.listItems(subprogram.c)[i]]);
+
+        frames.push_back(move(frame));
+        execute(subprogram.d);
+        TreeValue result = frames.back().result;
+        frames.pop_back();
+        return result;
+    }
+
+    TreeValue evaluate(uint32_t index)
+    {
+        const AstNode &node = ast[index];
+        switch (node.kind)
+        {
+        case NODE_INTEGER:
+            return integer(Ast::integerValue(node));
+        case NODE_REAL:
+            return real(Ast::realValue(node));
+        case NODE_NAME:
+        {
+            Variable *variable = find(node.a);
+            if (variable != nullptr)
+                return variable->elements[0];
+            return call(node.a, 0, node.line);
+        }
+        case NODE_INDEX:
+        {
+            int64_t position = evaluate(node.b).i;
+            return element(*find(node.a), position, node.line);
+        }
+        case NODE_CALL:
+            return call(node.a, node.b, node.line);
+        case NODE_UNARY:
+        {
+            TreeValue value = evaluate(node.a);
+            if (node.op == OPERATOR_NOT)
+                return integer(value.i == 0);
+            if (value.type == AST_TYPE_REAL)
+                return real(-value.r);
+            return integer((int64_t)(0 - (uint64_t)value.i));
+        }
+        case NODE_BINARY:
+            return binary(node);
+        default:
+            fail(node.line, "cannot evaluate this");
+        }
+    }
+
+    TreeValue binary(const AstNode &node)
+    {
+        TreeValue left = evaluate(node.a);
+        TreeValue right = evaluate(node.b);
+        if (node.op == OPERATOR_AND)
+            return integer(left.i != 0 && right.i != 0);
+        if (node.op == OPERATOR_OR)
+            return integer(left.i != 0 || right.i != 0);
+        if (node.op == OPERATOR_DIV || node.op == OPERATOR_MOD)
+        {
+            if (right.i == 0)
+                fail(node.line, "division by zero");
+            if (right.i == -1)
+                return integer(node.op == OPERATOR_DIV ? (int64_t)(0 - (uint64_t)left.i) : 0);
+            return integer(node.op == OPERATOR_DIV ? left.i / right.i : left.i % right.i);
+        }
+        if (left.type == AST_TYPE_INTEGER && right.type == AST_TYPE_INTEGER && node.op != OPERATOR_DIVIDE)
+        {
+            uint64_t x = (uint64_t)left.i, y = (uint64_t)right.i;
+            switch (node.op)
+            {
+            case OPERATOR_ADD:
+                return integer((int64_t)(x + y));
+            case OPERATOR_SUBTRACT:
+                return integer((int64_t)(x - y));
+            case OPERATOR_MULTIPLY:
+                return integer((int64_t)(x * y));
+            case OPERATOR_EQUAL:
+                return integer(left.i == right.i);
+            case OPERATOR_NOT_EQUAL:
+                return integer(left.i != right.i);
+            case OPERATOR_LESS:
+                return integer(left.i < right.i);
+            case OPERATOR_LESS_EQUAL:
+                return integer(left.i <= right.i);
+            case OPERATOR_GREATER:
+                return integer(left.i > right.i);
+            default:
+                return integer(left.i >= right.i);
+            }
+        }
+        double x = asReal(left), y = asReal(right);
+        switch (node.op)
+        {
+        case OPERATOR_ADD:
+            return real(x + y);
+        case OPERATOR_SUBTRACT:
+            return real(x - y);
+        case OPERATOR_MULTIPLY:
+            return real(x * y);
+        case OPERATOR_DIVIDE:
+            if (y == 0)
+                fail(node.line, "division by zero");
+            return real(x / y);
+        case OPERATOR_EQUAL:
+            return integer(x == y);
+        case OPERATOR_NOT_EQUAL:
+            return integer(x != y);
+        case OPERATOR_LESS:
+            return integer(x < y);
+        case OPERATOR_LESS_EQUAL:
+            return integer(x <= y);
+        case OPERATOR_GREATER:
+            return integer(x > y);
+        default:
+            return integer(x >= y);
+        }
+    }
+
+    const Ast &ast;
+    ostream *out = nullptr;
+    uint32_t writeId = 0, writelnId = 0;
+    Scope globals;
+    vector<Frame> frames;
+    unordered_map<uint32_t, uint32_t> subprograms; // identifier id to node
+};
@@ -0,0 +1,174 @@
+// Bytecode.h
+// Register bytecode for Pascal-subset programs, produced by
+// BytecodeCompiler.h and run by VirtualMachine.h.
+//
+// Every function runs in a frame of 8-byte Values. Instructions are 8 bytes:
+// an opcode and three 16-bit operands, which name registers of the current
+// frame unless the opcode says otherwise; jump targets and constant and
+// global indexes take b and c together as one 32-bit operand. Types are
+// resolved by the compiler, so each arithmetic opcode exists once for
+// integers and once for reals and the VM never checks a tag.
+//
+// Frame layout: parameters (array parameters inline), then the function
+// result, then scalar locals, then temporaries, then local arrays. Arrays are
+// reached through ArrayInfo entries, which hold their offset and bounds, so
+// only the first part of a frame needs 16-bit register numbers.
+//
+// Global scalars are the registers of the main program's frame; global
+// arrays sit at the bottom of the VM stack, below that frame. Subprograms
+// reach both with the G opcodes.
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Ast.h"
+#include "../Lab4/IdentifierTable.h"
+
+using namespace std;
+
+// X(name, operands) in opcode order; VirtualMachine.h builds its dispatch table from the same list.
+// There is no greater-than: the compiler swaps the operands of LT and LE.
+#define PASCAL_OPCODES(X)                                                                                              \
+    X(MOVE, "a = b")                                                                                                   \
+    X(LOADI, "a = integer bc")                                                                                         \
+    X(LOADK, "a = constant bc")                                                                                        \
+    X(I2R, "a = real(b)")                                                                                              \
+    X(ADDI, "a = b + c")                                                                                               \
+    X(SUBI, "a = b - c")                                                                                               \
+    X(MULI, "a = b * c")                                                                                               \
+    X(DIVI, "a = b div c")                                                                                             \
+    X(MODI, "a = b mod c")                                                                                             \
+    X(NEGI, "a = -b")                                                                                                  \
+    X(ADDR, "a = b + c")                                                                                               \
+    X(SUBR, "a = b - c")                                                                                               \
+    X(MULR, "a = b * c")                                                                                               \
+    X(DIVR, "a = b / c")                                                                                               \
+    X(NEGR, "a = -b")                                                                                                  \
+    X(EQI, "a = b = c")                                                                                                \
+    X(NEI, "a = b <> c")                                                                                               \
+    X(LTI, "a = b < c")                                                                                                \
+    X(LEI, "a = b <= c")                                                                                               \
+    X(EQR, "a = b = c")                                                                                                \
+    X(NER, "a = b <> c")                                                                                               \
+    X(LTR, "a = b < c")                                                                                                \
+    X(LER, "a = b <= c")                                                                                               \
+    X(AND, "a = b and c")                                                                                              \
+    X(OR, "a = b or c")                                                                                                \
+    X(NOT, "a = not b")                                                                                                \
+    X(GETG, "a = global bc")                                                                                           \
+    X(SETG, "global bc = a")                                                                                           \
+    X(GETEL, "a = local array b [c]")                                                                                  \
+    X(SETEL, "local array b [c] = a")                                                                                  \
+    X(GETEG, "a = global array b [c]")                                                                                 \
+    X(SETEG, "global array b [c] = a")                                                                                 \
+    X(COPYL, "a.. = local array b")                                                                                    \
+    X(COPYG, "a.. = global array b")                                                                                   \
+    X(JMP, "goto bc")                                                                                                  \
+    X(JMPF, "if not a goto bc")                                                                                        \
+    X(JMPT, "if a goto bc")                                                                                            \
+    X(CALL, "call function b with arguments from a, result to c")                                                      \
+    X(RET, "return")                                                                                                   \
+    X(WRITEI, "write integer a")                                                                                       \
+    X(WRITER, "write real a")                                                                                          \
+    X(WRITELN, "write newline")                                                                                        \
+    X(HALT, "stop")
+
+enum Opcode : uint16_t
+{
+#define PASCAL_OPCODE_ENUM(name, text) OP_##name,
+    PASCAL_OPCODES(PASCAL_OPCODE_ENUM)
+#undef PASCAL_OPCODE_ENUM
+        OP_COUNT
+};
+
+inline const char *opcodeName(int op)
+{
+#define PASCAL_OPCODE_NAME(name, text) #name,
+    static const char *names[OP_COUNT] = {PASCAL_OPCODES(PASCAL_OPCODE_NAME)};
+#undef PASCAL_OPCODE_NAME
+    return names[op];
+}
+
+inline const char *opcodeOperands(int op)
+{
+#define PASCAL_OPCODE_TEXT(name, text) text,
+    static const char *texts[OP_COUNT] = {PASCAL_OPCODES(PASCAL_OPCODE_TEXT)};
+#undef PASCAL_OPCODE_TEXT
+    return texts[op];
+}
+
+struct Instruction
+{
+    uint16_t op;
+    uint16_t a, b, c;
+};
+
+static_assert(sizeof(Instruction) == 8, "instructions are meant to stay 8 bytes");
+
+inline uint32_t wideOperand(const Instruction &instruction) { return instruction.b | (uint32_t)instruction.c << 16; }
+
+inline Instruction wideInstruction(Opcode op, uint16_t a, uint32_t operand)
+{
+    return Instruction{op, a, (uint16_t)operand, (uint16_t)(operand >> 16)};
+}
+
+union Value
+{
+    int64_t i;
+    double r;
+};
+
+struct ArrayInfo
+{
+    uint32_t offset; // from the frame, or from the stack bottom for global arrays
+    int32_t low;
+    uint32_t count;
+};
+
+struct BytecodeFunction
+{
+    uint32_t name;                // identifier id, 0 for the main program
+    uint16_t parameterSlots = 0;  // registers taken by the parameters
+    uint16_t result = 0;          // register of the result; functions only
+    uint8_t resultType = AST_TYPE_NONE;
+    uint32_t frameSize = 0;       // registers and local arrays
+    vector<Instruction> code;
+    vector<uint32_t> lines;       // source line of each instruction
+};
+
+struct BytecodeModule
+{
+    vector<BytecodeFunction> functions;
+    vector<Value> constants;
+    vector<ArrayInfo> arrays;
+    uint32_t globalArraySlots = 0; // stack slots below the main frame
+    uint32_t main = 0;             // function index of the program body
+};
+
+// Shortest text that reads back as the same double; both engines print reals this way
+inline void writeReal(ostream &out, double value)
+{
+    char text[32];
+    out.write(text, to_chars(text, text + sizeof text, value).ptr - text);
+}
+
+inline void disassemble(ostream &out, const BytecodeModule &module, const IdentifierTable &identifiers)
+{
+    for (size_t f = 0; f < module.functions.size(); f++)
+    {
+        const BytecodeFunction &function = module.functions[f];
+        out << "function " << f << " "
+            << (function.name != 0 ? string(identifiers.name(function.name)) : string("(main)")) << ", "
+            << function.parameterSlots << " parameter slots, frame of " << function.frameSize << "\n";
+        for (size_t pc = 0; pc < function.code.size(); pc++)
+        {
+            const Instruction &instruction = function.code[pc];
+            out << "  " << pc << "\t" << opcodeName(instruction.op) << "\t" << instruction.a << ", " << instruction.b
+                << ", " << instruction.c << "\t; " << opcodeOperands(instruction.op) << ", line " << function.lines[pc]
+                << "\n";
+        }
+    }
+}
@@ -0,0 +1,714 @@
+// BytecodeCompiler.h
+// Compiles a parsed Pascal-subset program (Ast.h) into the register
+// bytecode of Bytecode.h. Names are resolved with the scoped SymbolTable of
+// Lab6; each Symbol's type field holds an index into the compiler's own
+// table of variables, or the function index for subprograms. Types come
+// from TypeChecker.h: the type of each expression and the integers it
+// widens to real are read off its TypeAnnotations.
+//
+// Semantics, shared with AstInterpreter.h:
+//   - integers are 64-bit and wrap; an integer meeting a real is widened
+//   - relations, and, or and not work on integers: 1 is true, 0 is false,
+//     and conditions are true when nonzero
+//   - / always gives a real; div truncates and mod takes the dividend's sign
+//   - a function's result is set by assigning to its name; the bare name
+//     elsewhere calls it, as in Pascal
+//   - arrays are passed by value and cannot be assigned as a whole
+//   - every variable starts at zero
+//   - write and writeln print integers and reals, when not declared by the program
+// Subprograms may call each other in any order. Expressions that use a
+// variable and call a function keep the variable's value from before the
+// call, left to right.
+//
+// The program is checked first. Its first semantic error, or the first limit
+// of the bytecode it exceeds, stops compilation and is reported as a
+// Diagnostic.
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Ast.h"
+#include "Bytecode.h"
+#include "TypeChecker.h"
+#include "../Lab4/IdentifierTable.h"
+#include "../Lab6/SymbolTable.h"
+
+using namespace std;
+
+class BytecodeCompiler
+{
+public:
+    BytecodeCompiler(const Ast &ast, IdentifierTable &identifiers) : ast(ast), identifiers(identifiers) {}
+
+    // Returns false, with the error in diagnostics, when the program is not valid
+    bool compile(BytecodeModule &module, vector<Diagnostic> &diagnostics)
+    {
+        TypeAnnotations checked;
+        if (!TypeChecker(ast, identifiers).check(checked, diagnostics))
+            return false;
+        return compile(module, checked, diagnostics);
+    }
+
+    // Compiles a program TypeChecker has accepted into annotations
+    bool compile(BytecodeModule &module, const TypeAnnotations &annotations, vector<Diagnostic> &diagnostics)
+    {
+        types = &annotations;
+        out = &module;
+        module = BytecodeModule();
+        try
+        {
+            compileProgram();
+            return true;
+        }
+        catch (const CompileError &error)
+        {
+            diagnostics.push_back(Diagnostic{error.line, 0, error.message});
+            return false;
+        }
+    }
+
+private:
+    struct CompileError
+    {
+        uint32_t line;
+        string message;
+    };
+
+    struct Variable
+    {
+        bool global;
+        bool array;
+        uint32_t index; // register, or ArrayInfo index for arrays
+    };
+
+    struct Parameter
+    {
+        bool array;
+        uint16_t slot; // first register
+    };
+
+    struct Signature
+    {
+        uint32_t node;
+        vector<Parameter> parameters;
+    };
+
+    static const uint32_t maxRegisters = 65535;
+
+    [[noreturn]] void fail(uint32_t line, const string &message) { throw CompileError{line, message}; }
+
+    string name(uint32_t id) const { return string(identifiers.name(id)); }
+
+    // --- Declarations ---
+
+    void compileProgram()
+    {
+        const AstNode &program = ast[ast.root];
+        symbols = SymbolTable(identifiers.size());
+        writeId = identifiers.intern("write");
+        writelnId = identifiers.intern("writeln");
+        markCalls();
+
+        // Globals: scalars are registers of the main frame, arrays go below it
+        symbols.declare(program.a, SYMBOL_PROGRAM, 0, program.line);
+        uint32_t mainIndex = 0;
+        const uint32_t *declarations = ast.listItems(program.c);
+        uint32_t declarationCount = ast.listSize(program.c);
+        for (uint32_t i = 0; i < declarationCount; i++)
+        {
+            const AstNode &declaration = ast[declarations[i]];
+            if (declaration.kind != NODE_VARIABLES)
+                continue;
+            declareVariables(declaration, true, mainIndex, [&](uint32_t count) {
+                uint32_t offset = out->globalArraySlots;
+                out->globalArraySlots += count;
+                return offset;
+            });
+        }
+        uint32_t globalRegisters = mainIndex;
+
+        // Every subprogram is declared before any body is compiled
+        for (uint32_t i = 0; i < declarationCount; i++)
+        {
+            const AstNode &declaration = ast[declarations[i]];
+            if (declaration.kind != NODE_FUNCTION && declaration.kind != NODE_PROCEDURE)
+                continue;
+            uint32_t index = (uint32_t)out->functions.size();
+            SymbolKind kind = declaration.kind == NODE_FUNCTION ? SYMBOL_FUNCTION : SYMBOL_PROCEDURE;
+            symbols.declare(declaration.a, kind, index, declaration.line);
+            out->functions.emplace_back();
+            out->functions.back().name = declaration.a;
+            if (index > 0xFFFF)
+                fail(declaration.line, "too many subprograms");
+            signatures.push_back(Signature{declarations[i], {}});
+            declareSignature(index);
+        }
+
+        out->main = (uint32_t)out->functions.size();
+        out->functions.emplace_back();
+        for (uint32_t f = 0; f < signatures.size(); f++)
+            compileSubprogram(f);
+
+        beginFunction(out->main, globalRegisters);
+        statement(program.d);
+        emit(Instruction{OP_HALT, 0, 0, 0}, program.line);
+        endFunction();
+    }
+
+    // Declares the names of one VARIABLES or PARAMETERS node. Scalars take the
+    // next registers; arrays get an ArrayInfo whose offset comes from place(count).
+    template <class Place>
+    void declareVariables(const AstNode &declaration, bool global, uint32_t &registers, Place place)
+    {
+        bool array = (declaration.flags & NODE_FLAG_ARRAY) != 0;
+        int32_t low = (int32_t)declaration.c, high = (int32_t)declaration.d;
+        SymbolKind kind = declaration.kind == NODE_PARAMETERS ? SYMBOL_PARAMETER : SYMBOL_VARIABLE;
+        for (uint32_t i = 0; i < ast.listSize(declaration.a); i++)
+        {
+            uint32_t id = ast.listItems(declaration.a)[i];
+            Variable variable{global, array, 0};
+            if (array)
+            {
+                uint32_t count = (uint32_t)(high - low + 1);
+                variable.index = (uint32_t)out->arrays.size();
+                out->arrays.push_back(ArrayInfo{place(count), low, count});
+            }
+            else
+            {
+                if (registers >= maxRegisters)
+                    fail(declaration.line, "too many variables");
+                variable.index = registers++;
+            }
+            symbols.declare(id, kind, (uint32_t)variables.size(), declaration.line);
+            variables.push_back(variable);
+        }
+    }
+
+    void declareSignature(uint32_t index)
+    {
+        Signature &signature = signatures[index];
+        const AstNode &subprogram = ast[signature.node];
+        uint32_t slot = 0;
+        for (uint32_t i = 0; i < ast.listSize(subprogram.b); i++)
+        {
+            const AstNode &group = ast[ast.listItems(subprogram.b)[i]];
+            bool array = (group.flags & NODE_FLAG_ARRAY) != 0;
+            uint32_t count = array ? (uint32_t)((int32_t)group.d - (int32_t)group.c + 1) : 1;
+            for (uint32_t k = 0; k < ast.listSize(group.a); k++)
+            {
+                if (slot + count >= maxRegisters)
+                    fail(group.line, "parameters take too many registers");
+                signature.parameters.push_back(Parameter{array, (uint16_t)slot});
+                slot += count;
+            }
+        }
+        BytecodeFunction &function = out->functions[index];
+        function.parameterSlots = (uint16_t)slot;
+        function.resultType = subprogram.kind == NODE_FUNCTION ? subprogram.type : (uint8_t)AST_TYPE_NONE;
+        function.result = (uint16_t)slot;
+    }
+
+    void compileSubprogram(uint32_t index)
+    {
+        const Signature &signature = signatures[index];
+        const AstNode &subprogram = ast[signature.node];
+        const BytecodeFunction &function = out->functions[index];
+        symbols.enterScope();
+
+        // Parameters were given their registers by declareSignature
+        size_t parameter = 0;
+        for (uint32_t i = 0; i < ast.listSize(subprogram.b); i++)
+        {
+            const AstNode &group = ast[ast.listItems(subprogram.b)[i]];
+            for (uint32_t k = 0; k < ast.listSize(group.a); k++)
+            {
+                const Parameter &declared = signature.parameters[parameter++];
+                Variable variable{false, declared.array, declared.slot};
+                if (declared.array)
+                {
+                    int32_t low = (int32_t)group.c;
+                    variable.index = (uint32_t)out->arrays.size();
+                    out->arrays.push_back(ArrayInfo{declared.slot, low, (uint32_t)((int32_t)group.d - low + 1)});
+                }
+                uint32_t id = ast.listItems(group.a)[k];
+                symbols.declare(id, SYMBOL_PARAMETER, (uint32_t)variables.size(), group.line);
+                variables.push_back(variable);
+            }
+        }
+
+        // Local arrays are placed after the temporaries by endFunction
+        uint32_t registers = function.parameterSlots + (function.resultType != AST_TYPE_NONE ? 1 : 0);
+        localArrays.clear();
+        for (uint32_t i = 0; i < ast.listSize(subprogram.c); i++)
+        {
+            declareVariables(ast[ast.listItems(subprogram.c)[i]], false, registers, [&](uint32_t) {
+                localArrays.push_back((uint32_t)out->arrays.size());
+                return 0u;
+            });
+        }
+
+        beginFunction(index, registers);
+        statement(subprogram.d);
+        emit(Instruction{OP_RET, 0, 0, 0}, subprogram.line);
+        endFunction();
+        symbols.exitScope();
+    }
+
+    void beginFunction(uint32_t index, uint32_t firstTemporary)
+    {
+        current = index;
+        nextRegister = firstTemporary;
+        maxRegister = firstTemporary;
+    }
+
+    // Local arrays go after the registers, now that their number is known
+    void endFunction()
+    {
+        BytecodeFunction &function = out->functions[current];
+        uint32_t frameSize = maxRegister;
+        for (uint32_t array : localArrays)
+        {
+            ArrayInfo &info = out->arrays[array];
+            info.offset = frameSize;
+            frameSize += info.count;
+        }
+        localArrays.clear();
+        function.frameSize = frameSize;
+    }
+
+    // --- Code emission ---
+
+    uint32_t emit(const Instruction &instruction, uint32_t line)
+    {
+        BytecodeFunction &function = out->functions[current];
+        function.code.push_back(instruction);
+        function.lines.push_back(line);
+        return (uint32_t)function.code.size() - 1;
+    }
+
+    uint32_t here() const { return (uint32_t)out->functions[current].code.size(); }
+
+    void patch(uint32_t at, uint32_t target)
+    {
+        Instruction &instruction = out->functions[current].code[at];
+        instruction = wideInstruction((Opcode)instruction.op, instruction.a, target);
+    }
+
+    uint16_t temporary(uint32_t line, uint32_t count = 1)
+    {
+        if (nextRegister + count > maxRegisters)
+            fail(line, "expression needs too many registers");
+        uint16_t first = (uint16_t)nextRegister;
+        nextRegister += count;
+        if (nextRegister > maxRegister)
+            maxRegister = nextRegister;
+        return first;
+    }
+
+    // Children are created before their parents, so one forward pass marks
+    // every expression that may call a function
+    void markCalls()
+    {
+        vector<bool> isFunction(identifiers.size() + 1, false);
+        for (uint32_t i = 1; i <= ast.nodeCount(); i++)
+        {
+            if (ast[i].kind == NODE_FUNCTION)
+                isFunction[ast[i].a] = true;
+        }
+        calls.assign(ast.nodeCount() + 1, false);
+        for (uint32_t i = 1; i <= ast.nodeCount(); i++)
+        {
+            const AstNode &node = ast[i];
+            switch (node.kind)
+            {
+            case NODE_CALL:
+                calls[i] = true;
+                break;
+            case NODE_NAME:
+                calls[i] = isFunction[node.a];
+                break;
+            case NODE_INDEX:
+                calls[i] = calls[node.b];
+                break;
+            case NODE_UNARY:
+                calls[i] = calls[node.a];
+                break;
+            case NODE_BINARY:
+                calls[i] = calls[node.a] || calls[node.b];
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    // --- Names ---
+
+    const Symbol &resolve(uint32_t id, uint32_t line)
+    {
+        const Symbol *symbol = symbols.lookup(id);
+        if (symbol == nullptr)
+            fail(line, "'" + name(id) + "' is not declared");
+        return *symbol;
+    }
+
+    bool isVariable(const Symbol &symbol) const
+    {
+        return symbol.kind == SYMBOL_VARIABLE || symbol.kind == SYMBOL_PARAMETER;
+    }
+
+    // Globals are registers of the current frame only in the main program
+    bool inFrame(const Variable &variable) const { return !variable.global || current == out->main; }
+
+    // --- Statements ---
+
+    void statement(uint32_t index)
+    {
+        if (index == 0)
+            return;
+        const AstNode &node = ast[index];
+        uint32_t mark = nextRegister;
+        switch (node.kind)
+        {
+        case NODE_COMPOUND:
+            for (uint32_t i = 0; i < ast.listSize(node.a); i++)
+                statement(ast.listItems(node.a)[i]);
+            break;
+        case NODE_ASSIGN:
+            assignment(node);
+            break;
+        case NODE_CALL_STATEMENT:
+            if ((node.a == writeId || node.a == writelnId) && symbols.lookup(node.a) == nullptr)
+                write(node);
+            else
+                call(node.a, node.b, node.line, -1);
+            break;
+        case NODE_IF:
+        {
+            uint16_t condition = operand(node.a);
+            uint32_t skipThen = emit(Instruction{OP_JMPF, condition, 0, 0}, node.line);
+            nextRegister = mark;
+            statement(node.b);
+            if (node.c != 0)
+            {
+                uint32_t skipElse = emit(Instruction{OP_JMP, 0, 0, 0}, node.line);
+                patch(skipThen, here());
+                statement(node.c);
+                patch(skipElse, here());
+            }
+            else
+                patch(skipThen, here());
+            break;
+        }
+        case NODE_WHILE:
+        {
+            // The test sits after the body, so each iteration takes one jump
+            uint32_t toTest = emit(Instruction{OP_JMP, 0, 0, 0}, node.line);
+            uint32_t body = here();
+            statement(node.b);
+            patch(toTest, here());
+            uint16_t condition = operand(node.a);
+            emit(wideInstruction(OP_JMPT, condition, body), node.line);
+            break;
+        }
+        default:
+            fail(node.line, string("unexpected ") + nodeKindName(node.kind) + " statement");
+        }
+        nextRegister = mark;
+    }
+
+
+    void assignment(const AstNode &node)
+    {
+        const AstNode &target = ast[node.a];
+        const Symbol &symbol = resolve(target.a, target.line);
+        if (symbol.kind == SYMBOL_FUNCTION && symbol.type == current && target.kind == NODE_NAME)
+        {
+            storeConverted(node.b, out->functions[current].result, node.line);
+            return;
+        }
+        const Variable variable = variables[symbol.type];
+        if (target.kind == NODE_NAME)
+        {
+            if (inFrame(variable))
+                storeConverted(node.b, (uint16_t)variable.index, node.line);
+            else
+            {
+                uint16_t value = temporary(node.line);
+                storeConverted(node.b, value, node.line);
+                emit(wideInstruction(OP_SETG, value, variable.index), node.line);
+            }
+            return;
+        }
+        uint16_t position = stableOperand(target.b, calls[node.b]);
+        uint16_t value = temporary(node.line);
+        storeConverted(node.b, value, node.line);
+        emit(Instruction{(uint16_t)(variable.global ? OP_SETEG : OP_SETEL), value, arrayOperand(variable, node.line),
+                         position},
+             node.line);
+    }
+
+    // Evaluates index into target, widening it where the checker said so
+    void storeConverted(uint32_t index, uint16_t target, uint32_t line)
+    {
+        into(index, target);
+        if (types->widened[index])
+            emit(Instruction{OP_I2R, target, target, 0}, line);
+    }
+
+    uint16_t arrayOperand(const Variable &variable, uint32_t line)
+    {
+        if (variable.index > 0xFFFF)
+            fail(line, "too many arrays");
+        return (uint16_t)variable.index;
+    }
+
+    void write(const AstNode &node)
+    {
+        for (uint32_t i = 0; i < ast.listSize(node.b); i++)
+        {
+            uint32_t mark = nextRegister;
+            uint32_t argument = ast.listItems(node.b)[i];
+            uint16_t reg = operand(argument);
+            emit(Instruction{(uint16_t)(types->types[argument] == TYPE_REAL ? OP_WRITER : OP_WRITEI), reg, 0, 0},
+                 node.line);
+            nextRegister = mark;
+        }
+        if (node.a == writelnId)
+            emit(Instruction{OP_WRITELN, 0, 0, 0}, node.line);
+    }
+
+    // Calls a subprogram; target < 0 for procedure statements
+    void call(uint32_t id, uint32_t arguments, uint32_t line, int target)
+    {
+        uint32_t index = resolve(id, line).type;
+        const Signature &signature = signatures[index];
+        const BytecodeFunction &callee = out->functions[index];
+        uint32_t count = ast.listSize(arguments);
+        uint32_t mark = nextRegister;
+        uint16_t base = temporary(line, callee.parameterSlots);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const Parameter &parameter = signature.parameters[i];
+            uint32_t argument = ast.listItems(arguments)[i];
+            uint16_t slot = (uint16_t)(base + parameter.slot);
+            if (!parameter.array)
+            {
+                storeConverted(argument, slot, line);
+                continue;
+            }
+            const Variable *variable = &variables[resolve(ast[argument].a, line).type];
+            emit(Instruction{(uint16_t)(variable->global ? OP_COPYG : OP_COPYL), slot,
+                             arrayOperand(*variable, line), 0},
+                 line);
+        }
+        emit(Instruction{OP_CALL, base, (uint16_t)index, (uint16_t)(target >= 0 ? target : 0)}, line);
+        nextRegister = mark;
+    }
+
+    // --- Expressions ---
+
+    // Register holding the value of index: the variable's own register when it
+    // is a scalar of this frame, otherwise a new temporary
+    uint16_t operand(uint32_t index)
+    {
+        const AstNode &node = ast[index];
+        if (node.kind == NODE_NAME)
+        {
+            const Symbol &symbol = resolve(node.a, node.line);
+            if (isVariable(symbol))
+            {
+                const Variable &variable = variables[symbol.type];
+                if (!variable.array && inFrame(variable))
+                    return (uint16_t)variable.index;
+            }
+        }
+        uint16_t reg = temporary(node.line);
+        into(index, reg);
+        return reg;
+    }
+
+    // Operand whose value must be taken before the other side runs: a variable
+    // register is copied when the other side may call a function
+    uint16_t stableOperand(uint32_t index, bool otherCalls)
+    {
+        uint32_t mark = nextRegister;
+        uint16_t reg = operand(index);
+        if (otherCalls && nextRegister == mark)
+        {
+            uint16_t copy = temporary(ast[index].line);
+            emit(Instruction{OP_MOVE, copy, reg, 0}, ast[index].line);
+            return copy;
+        }
+        return reg;
+    }
+
+    // The operand at index, as a real when the checker widened it
+    uint16_t widened(uint16_t reg, uint32_t index, uint32_t line)
+    {
+        if (!types->widened[index])
+            return reg;
+        uint16_t result = temporary(line);
+        emit(Instruction{OP_I2R, result, reg, 0}, line);
+        return result;
+    }
+
+    // Evaluates index into register target
+    void into(uint32_t index, uint16_t target)
+    {
+        const AstNode &node = ast[index];
+        uint32_t mark = nextRegister;
+        switch (node.kind)
+        {
+        case NODE_INTEGER:
+        {
+            int64_t value = Ast::integerValue(node);
+            if (value >= INT32_MIN && value <= INT32_MAX)
+                emit(wideInstruction(OP_LOADI, target, (uint32_t)(int32_t)value), node.line);
+            else
+            {
+                Value constant;
+                constant.i = value;
+                emit(wideInstruction(OP_LOADK, target, constantIndex(constant)), node.line);
+            }
+            break;
+        }
+        case NODE_REAL:
+        {
+            Value constant;
+            constant.r = Ast::realValue(node);
+            emit(wideInstruction(OP_LOADK, target, constantIndex(constant)), node.line);
+            break;
+        }
+        case NODE_NAME:
+        {
+            const Symbol &symbol = resolve(node.a, node.line);
+            if (symbol.kind == SYMBOL_FUNCTION)
+            {
+                call(node.a, 0, node.line, target);
+                break;
+            }
+            const Variable &variable = variables[symbol.type];
+            if (inFrame(variable))
+                emit(Instruction{OP_MOVE, target, (uint16_t)variable.index, 0}, node.line);
+            else
+                emit(wideInstruction(OP_GETG, target, variable.index), node.line);
+            break;
+        }
+        case NODE_INDEX:
+        {
+            const Variable variable = variables[resolve(node.a, node.line).type];
+            uint16_t position = operand(node.b);
+            emit(Instruction{(uint16_t)(variable.global ? OP_GETEG : OP_GETEL), target,
+                             arrayOperand(variable, node.line), position},
+                 node.line);
+            break;
+        }
+        case NODE_CALL:
+            call(node.a, node.b, node.line, target);
+            break;
+        case NODE_UNARY:
+        {
+            uint16_t value = operand(node.a);
+            if (node.op == OPERATOR_NOT)
+                emit(Instruction{OP_NOT, target, value, 0}, node.line);
+            else
+                emit(Instruction{(uint16_t)(types->types[index] == TYPE_REAL ? OP_NEGR : OP_NEGI), target, value, 0},
+                     node.line);
+            break;
+        }
+        case NODE_BINARY:
+            binary(node, target);
+            break;
+        default:
+            fail(node.line, string("unexpected ") + nodeKindName(node.kind) + " in an expression");
+        }
+        nextRegister = mark;
+    }
+
+    void binary(const AstNode &node, uint16_t target)
+    {
+        uint16_t left = stableOperand(node.a, calls[node.b]);
+        uint16_t right = operand(node.b);
+        switch (node.op)
+        {
+        case OPERATOR_DIV:
+        case OPERATOR_MOD:
+        case OPERATOR_AND:
+        case OPERATOR_OR:
+        {
+            static const Opcode ops[] = {OP_DIVI, OP_MODI, OP_AND, OP_OR};
+            int which = node.op == OPERATOR_DIV ? 0 : node.op == OPERATOR_MOD ? 1 : node.op == OPERATOR_AND ? 2 : 3;
+            emit(Instruction{ops[which], target, left, right}, node.line);
+            return;
+        }
+        default:
+            break;
+        }
+        // After widening both sides have the same type
+        left = widened(left, node.a, node.line);
+        right = widened(right, node.b, node.line);
+        bool real = types->valueType(node.a) == TYPE_REAL;
+        Opcode op;
+        bool swap = false;
+        switch (node.op)
+        {
+        case OPERATOR_ADD:
+            op = real ? OP_ADDR : OP_ADDI;
+            break;
+        case OPERATOR_SUBTRACT:
+            op = real ? OP_SUBR : OP_SUBI;
+            break;
+        case OPERATOR_MULTIPLY:
+            op = real ? OP_MULR : OP_MULI;
+            break;
+        case OPERATOR_DIVIDE:
+            op = OP_DIVR;
+            break;
+        case OPERATOR_EQUAL:
+            op = real ? OP_EQR : OP_EQI;
+            break;
+        case OPERATOR_NOT_EQUAL:
+            op = real ? OP_NER : OP_NEI;
+            break;
+        case OPERATOR_LESS:
+            op = real ? OP_LTR : OP_LTI;
+            break;
+        case OPERATOR_LESS_EQUAL:
+            op = real ? OP_LER : OP_LEI;
+            break;
+        case OPERATOR_GREATER:
+            op = real ? OP_LTR : OP_LTI;
+            swap = true;
+            break;
+        case OPERATOR_GREATER_EQUAL:
+            op = real ? OP_LER : OP_LEI;
+            swap = true;
+            break;
+        default:
+            fail(node.line, string("unexpected operator ") + operatorName(node.op));
+        }
+        emit(Instruction{op, target, swap ? right : left, swap ? left : right}, node.line);
+    }
+
+    uint32_t constantIndex(Value value)
+    {
+        out->constants.push_back(value);
+        return (uint32_t)out->constants.size() - 1;
+    }
+
+    const Ast &ast;
+    IdentifierTable &identifiers;
+    const TypeAnnotations *types = nullptr;
+    BytecodeModule *out = nullptr;
+    SymbolTable symbols;
+    vector<Variable> variables;
+    vector<Signature> signatures;
+    vector<uint32_t> localArrays; // ArrayInfo indexes of the current function's local arrays
+    vector<bool> calls;           // by node: the expression may call a function
+    uint32_t writeId = 0, writelnId = 0;
+    uint32_t current = 0;
+    uint32_t nextRegister = 0;
+    uint32_t maxRegister = 0;
+};
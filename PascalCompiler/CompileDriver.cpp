@@ -0,0 +1,216 @@
+// Libraries
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include "../Lab2/DirectoryListing.h"
+#include "../Lab2/MappedFile.h"
+#include "../Lab4/IdentifierTable.h"
+#include "../Lab4/PascalLexer.h"
+#include "../Lab4/PascalSourceGenerator.h"
+#include "Arena.h"
+#include "Ast.h"
+#include "BytecodeCompiler.h"
+#include "PascalParser.h"
+
+using namespace std;
+
+// Compiles every .pas file below a folder in parallel: each file is lexed,
+// parsed, checked (names and types, by TypeChecker) and compiled as one task.
+// Workers claim files through a shared index and keep one Arena each, reset
+// between files, so after the first few files the trees need no new memory.
+// Diagnostics are collected per file and printed afterwards in path order,
+// so the output does not depend on the number of threads or on timing.
+//
+// For comparison the same files are first lexed alone on one thread, the way
+// Lab4/LexicalAnalyzer.cpp does it; both passes run after a warm-up read.
+//
+// Usage:
+//   CompileDriver <folder> [--threads N] [--generate N] [--size KB] [--seed S]
+// --generate first writes N generated programs into the folder, 100 per
+// subfolder; one in 97 gets a syntax error and one in 89 a type error.
+
+// Structs
+struct FileResult
+{
+    bool opened = false;
+    uint32_t lines = 0;
+    vector<Diagnostic> diagnostics;
+};
+
+// Function Prototypes
+void generateSources(const string &folder, size_t count, size_t sizeKb, uint64_t seed);
+void compileFile(const string &path, Arena &arena, FileResult &result);
+double lexFiles(const string &folder, const PathArena &fileNames, const vector<size_t> &order, uint64_t &tokens);
+
+// Main Function
+int main(int argc, char *argv[])
+{
+    try
+    {
+        if (argc < 2)
+        {
+            cerr << "Usage: CompileDriver <folder> [--threads N] [--generate N] [--size KB] [--seed S]" << endl;
+            return 1;
+        }
+        string folder = argv[1];
+        unsigned threadCount = max(1u, thread::hardware_concurrency());
+        size_t generateCount = 0, sizeKb = 8;
+        uint64_t seed = 1;
+        for (int i = 2; i < argc; i++)
+        {
+            string argument = argv[i];
+            if (argument == "--threads" && i + 1 < argc)
+                threadCount = max(1u, (unsigned)stoul(argv[++i]));
+            else if (argument == "--generate" && i + 1 < argc)
+                generateCount = stoul(argv[++i]);
+            else if (argument == "--size" && i + 1 < argc)
+                sizeKb = stoul(argv[++i]);
+            else if (argument == "--seed" && i + 1 < argc)
+                seed = stoull(argv[++i]);
+        }
+        if (generateCount > 0)
+            generateSources(folder, generateCount, sizeKb, seed);
+
+        DirectoryListing listing;
+        listing.recursive = true;
+        listing.extension = ".pas";
+        listing.sniff = false;
+        vector<uint64_t> fileSizes;
+        PathArena fileNames = getFileNamesInDirectory(folder, nullptr, &fileSizes, listing);
+        vector<size_t> order(fileNames.size());
+        for (size_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        sort(order.begin(), order.end(), [&](size_t x, size_t y) { return strcmp(fileNames[x], fileNames[y]) < 0; });
+        uint64_t totalBytes = 0;
+        for (uint64_t size : fileSizes)
+            totalBytes += size;
+        cout << "Found " << order.size() << " .pas files, " << totalBytes / (1024.0 * 1024.0) << " MB" << endl;
+        if (order.empty())
+            return 0;
+
+        // Warm-up, then lexing alone on one thread
+        uint64_t tokens = 0;
+        lexFiles(folder, fileNames, order, tokens);
+        double lexSeconds = lexFiles(folder, fileNames, order, tokens);
+
+        // Parallel lex, parse and check, one file per task
+        threadCount = min<unsigned>(threadCount, order.size());
+        vector<FileResult> results(order.size());
+        atomic<size_t> next(0);
+        auto worker = [&]() {
+            Arena arena;
+            for (size_t k = next++; k < order.size(); k = next++)
+            {
+                compileFile(folder + "/" + fileNames[order[k]], arena, results[k]);
+                arena.reset();
+            }
+        };
+        auto start = chrono::steady_clock::now();
+        vector<thread> workers;
+        for (unsigned t = 0; t < threadCount; t++)
+            workers.emplace_back(worker);
+        for (thread &t : workers)
+            t.join();
+        double compileSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        // Diagnostics in path order
+        size_t failed = 0, unreadable = 0;
+        uint64_t lines = 0;
+        for (size_t k = 0; k < order.size(); k++)
+        {
+            const FileResult &result = results[k];
+            lines += result.lines;
+            if (!result.opened)
+            {
+                cerr << fileNames[order[k]] << ": could not be opened" << endl;
+                unreadable++;
+                continue;
+            }
+            if (!result.diagnostics.empty())
+                failed++;
+            for (const Diagnostic &diagnostic : result.diagnostics)
+            {
+                cerr << fileNames[order[k]] << ":" << diagnostic.line;
+                if (diagnostic.column != 0)
+                    cerr << ":" << diagnostic.column;
+                cerr << ": " << diagnostic.message << "\n";
+            }
+        }
+        cerr.flush();
+
+        cout << order.size() - failed - unreadable << " files compiled, " << failed << " with errors";
+        if (unreadable > 0)
+            cout << ", " << unreadable << " unreadable";
+        cout << ", " << lines << " lines" << endl;
+        cout << "Lexing alone, 1 thread: " << lexSeconds * 1000 << " ms, " << tokens << " tokens" << endl;
+        cout << "Lex, parse and check, " << threadCount << " thread" << (threadCount == 1 ? "" : "s") << ": "
+             << compileSeconds * 1000 << " ms, " << lines / compileSeconds / 1e6 << " M lines/s, "
+             << compileSeconds / lexSeconds << "x the lexing time" << endl;
+        return failed > 0 || unreadable > 0 ? 2 : 0;
+    }
+    catch (exception &e)
+    {
+        cout << "Error occurred: " << e.what() << endl;
+        return 1;
+    }
+}
+
+void generateSources(const string &folder, size_t count, size_t sizeKb, uint64_t seed)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        string directory = folder + "/d" + to_string(i / 100);
+        if (i % 100 == 0)
+            filesystem::create_directories(directory);
+        string source = PascalSourceGenerator(seed + i).generate(sizeKb * 1024);
+        if (i % 97 == 96)
+            source.replace(source.size() - 2, 1, ";");
+        else if (i % 89 == 88)
+            source.replace(source.rfind("g0 := 1;"), 8, "g0 := 1.5;");
+        ofstream out(directory + "/p" + to_string(i) + ".pas", ios::out | ios::binary);
+        out << source;
+        if (!out)
+            throw runtime_error("Could not write into " + directory);
+    }
+    cout << "Generated " << count << " files of about " << sizeKb << " KB in " << folder << endl;
+}
+
+void compileFile(const string &path, Arena &arena, FileResult &result)
+{
+    MappedFile file;
+    if (!file.open(path))
+        return;
+    result.opened = true;
+    result.lines = (uint32_t)count(file.data(), file.data() + file.size(), '\n');
+    IdentifierTable identifiers;
+    Ast ast(arena);
+    PascalParser parser(file.data(), file.size(), identifiers);
+    if (!parser.parse(ast, result.diagnostics))
+        return;
+    BytecodeModule module;
+    BytecodeCompiler(ast, identifiers).compile(module, result.diagnostics);
+}
+
+double lexFiles(const string &folder, const PathArena &fileNames, const vector<size_t> &order, uint64_t &tokens)
+{
+    auto start = chrono::steady_clock::now();
+    tokens = 0;
+    for (size_t index : order)
+    {
+        MappedFile file;
+        if (!file.open(folder + "/" + fileNames[index]))
+            continue;
+        PascalLexer lexer(file.data(), file.size());
+        while (lexer.next().kind != TOKEN_EOF)
+            tokens++;
+    }
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,263 @@
+// ExpressionLowering.h
+// Constant folding on the Ast, and lowering of expressions into the compiled
+// prefix programs of Lab1/PrefixProgram.h.
+//
+// foldConstants() rewrites, in place, every unary or binary arithmetic node
+// whose operands are number literals into a literal. Integer operations fold
+// with Pascal's integer semantics and are left alone when they would
+// overflow or divide by zero, so the program still fails at run time the
+// way it would have; an integer operand next to a real one is widened. The
+// relational and boolean operators are not folded here, since the tree has
+// no boolean literal; lowering folds them instead.
+//
+// lowerExpression() emits an expression's prefix program. Names become
+// PREFIX_VARIABLE with the slot the caller assigned to their identifier;
+// calls, array elements and names without a slot cannot be lowered. Any
+// operator whose operands are all constants is evaluated on the spot with
+// applyPrefixOp, the same code the program would run, except divisions by
+// zero, which stay in the program as they stay in the tree.
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Ast.h"
+#include "../Lab1/PrefixProgram.h"
+
+using namespace std;
+
+// Returns the number of nodes folded in the subtree of index
+inline uint32_t foldConstants(Ast &ast, uint32_t index)
+{
+    if (index == 0)
+        return 0;
+    uint32_t folded = 0;
+    auto list = [&](uint32_t offset) {
+        for (uint32_t i = 0; i < ast.listSize(offset); i++)
+            folded += foldConstants(ast, ast.listItems(offset)[i]);
+    };
+    AstNode &node = ast[index];
+    switch (node.kind)
+    {
+    case NODE_PROGRAM:
+    case NODE_FUNCTION:
+    case NODE_PROCEDURE:
+        list(node.c);
+        folded += foldConstants(ast, node.d);
+        return folded;
+    case NODE_COMPOUND:
+        list(node.a);
+        return folded;
+    case NODE_CALL_STATEMENT:
+    case NODE_CALL:
+        list(node.b);
+        return folded;
+    case NODE_ASSIGN:
+    case NODE_WHILE:
+        folded += foldConstants(ast, node.a);
+        folded += foldConstants(ast, node.b);
+        return folded;
+    case NODE_INDEX:
+        return foldConstants(ast, node.b);
+    case NODE_IF:
+        folded += foldConstants(ast, node.a);
+        folded += foldConstants(ast, node.b);
+        folded += foldConstants(ast, node.c);
+        return folded;
+    case NODE_UNARY:
+    {
+        folded += foldConstants(ast, node.a);
+        const AstNode &operand = ast[node.a];
+        if (node.op != OPERATOR_NEGATE)
+            return folded;
+        if (operand.kind == NODE_INTEGER && Ast::integerValue(operand) != INT64_MIN)
+            Ast::setInteger(node, -Ast::integerValue(operand));
+        else if (operand.kind == NODE_REAL)
+            Ast::setReal(node, -Ast::realValue(operand));
+        else
+            return folded;
+        return folded + 1;
+    }
+    case NODE_BINARY:
+    {
+        folded += foldConstants(ast, node.a);
+        folded += foldConstants(ast, node.b);
+        const AstNode &left = ast[node.a];
+        const AstNode &right = ast[node.b];
+        bool leftNumber = left.kind == NODE_INTEGER || left.kind == NODE_REAL;
+        bool rightNumber = right.kind == NODE_INTEGER || right.kind == NODE_REAL;
+        if (!leftNumber || !rightNumber)
+            return folded;
+        if (left.kind == NODE_INTEGER && right.kind == NODE_INTEGER)
+        {
+            int64_t x = Ast::integerValue(left), y = Ast::integerValue(right), result;
+            switch (node.op)
+            {
+            case OPERATOR_ADD:
+                if (__builtin_add_overflow(x, y, &result))
+                    return folded;
+                break;
+            case OPERATOR_SUBTRACT:
+                if (__builtin_sub_overflow(x, y, &result))
+                    return folded;
+                break;
+            case OPERATOR_MULTIPLY:
+                if (__builtin_mul_overflow(x, y, &result))
+                    return folded;
+                break;
+            case OPERATOR_DIV:
+            case OPERATOR_MOD:
+                if (y == 0 || (x == INT64_MIN && y == -1))
+                    return folded;
+                result = node.op == OPERATOR_DIV ? x / y : x % y;
+                break;
+            case OPERATOR_DIVIDE:
+                if (y == 0)
+                    return folded;
+                Ast::setReal(node, (double)x / (double)y);
+                return folded + 1;
+            default:
+                return folded;
+            }
+            Ast::setInteger(node, result);
+            return folded + 1;
+        }
+        double x = left.kind == NODE_INTEGER ? (double)Ast::integerValue(left) : Ast::realValue(left);
+        double y = right.kind == NODE_INTEGER ? (double)Ast::integerValue(right) : Ast::realValue(right);
+        switch (node.op)
+        {
+        case OPERATOR_ADD:
+            Ast::setReal(node, x + y);
+            break;
+        case OPERATOR_SUBTRACT:
+            Ast::setReal(node, x - y);
+            break;
+        case OPERATOR_MULTIPLY:
+            Ast::setReal(node, x * y);
+            break;
+        case OPERATOR_DIVIDE:
+            if (y == 0)
+                return folded;
+            Ast::setReal(node, x / y);
+            break;
+        default:
+            return folded;
+        }
+        return folded + 1;
+    }
+    default:
+        return folded;
+    }
+}
+
+inline PrefixOp prefixOperator(int op)
+{
+    switch (op)
+    {
+    case OPERATOR_NEGATE:
+        return PREFIX_NEGATE;
+    case OPERATOR_NOT:
+        return PREFIX_NOT;
+    case OPERATOR_ADD:
+        return PREFIX_ADD;
+    case OPERATOR_SUBTRACT:
+        return PREFIX_SUBTRACT;
+    case OPERATOR_OR:
+        return PREFIX_OR;
+    case OPERATOR_MULTIPLY:
+        return PREFIX_MULTIPLY;
+    case OPERATOR_DIVIDE:
+        return PREFIX_DIVIDE;
+    case OPERATOR_DIV:
+        return PREFIX_DIV;
+    case OPERATOR_MOD:
+        return PREFIX_MOD;
+    case OPERATOR_AND:
+        return PREFIX_AND;
+    case OPERATOR_EQUAL:
+        return PREFIX_EQUAL;
+    case OPERATOR_NOT_EQUAL:
+        return PREFIX_NOT_EQUAL;
+    case OPERATOR_LESS:
+        return PREFIX_LESS;
+    case OPERATOR_LESS_EQUAL:
+        return PREFIX_LESS_EQUAL;
+    case OPERATOR_GREATER:
+        return PREFIX_GREATER;
+    default:
+        return PREFIX_GREATER_EQUAL;
+    }
+}
+
+// Appends the code of one expression, left operand first so that the right
+// one ends up on top of the stack, where the evaluator's operators take it
+inline bool emitPrefix(const Ast &ast, uint32_t index, const vector<uint32_t> &slots, vector<PrefixInstruction> &code)
+{
+    const AstNode &node = ast[index];
+    switch (node.kind)
+    {
+    case NODE_INTEGER:
+    {
+        // Doubles hold integers exactly only up to 2^53
+        int64_t value = Ast::integerValue(node);
+        if (value > (1ll << 53) || value < -(1ll << 53))
+            return false;
+        code.push_back(PrefixInstruction{PREFIX_CONSTANT, 0, (double)value});
+        return true;
+    }
+    case NODE_REAL:
+        code.push_back(PrefixInstruction{PREFIX_CONSTANT, 0, Ast::realValue(node)});
+        return true;
+    case NODE_NAME:
+        if (node.a >= slots.size() || slots[node.a] == 0)
+            return false;
+        code.push_back(PrefixInstruction{PREFIX_VARIABLE, slots[node.a] - 1, 0});
+        return true;
+    case NODE_UNARY:
+    {
+        if (!emitPrefix(ast, node.a, slots, code))
+            return false;
+        PrefixOp op = prefixOperator(node.op);
+        PrefixInstruction &operand = code.back();
+        if (operand.op == PREFIX_CONSTANT)
+            operand.value = op == PREFIX_NEGATE ? -operand.value : (operand.value == 0 ? 1 : 0);
+        else
+            code.push_back(PrefixInstruction{op, 0, 0});
+        return true;
+    }
+    case NODE_BINARY:
+    {
+        size_t first = code.size();
+        if (!emitPrefix(ast, node.a, slots, code) || !emitPrefix(ast, node.b, slots, code))
+            return false;
+        PrefixOp op = prefixOperator(node.op);
+        bool divides = op == PREFIX_DIVIDE || op == PREFIX_DIV || op == PREFIX_MOD;
+        if (code.size() == first + 2 && code[first].op == PREFIX_CONSTANT && code[first + 1].op == PREFIX_CONSTANT &&
+            !(divides && code[first + 1].value == 0))
+        {
+            code[first].value = applyPrefixOp(op, code[first].value, code[first + 1].value);
+            code.pop_back();
+        }
+        else
+            code.push_back(PrefixInstruction{op, 0, 0});
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+// slots[id] is 1 + the variable slot of identifier id, or 0 when the
+// identifier is not a lowerable variable. Returns false, leaving program
+// empty, when the expression cannot be lowered.
+inline bool lowerExpression(const Ast &ast, uint32_t index, const vector<uint32_t> &slots, PrefixProgram &program)
+{
+    program.code.clear();
+    program.maxStack = 0;
+    if (!emitPrefix(ast, index, slots, program.code))
+    {
+        program.code.clear();
+        return false;
+    }
+    program.maxStack = prefixStackDepth(program);
+    return true;
+}
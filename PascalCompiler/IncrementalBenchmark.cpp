@@ -0,0 +1,293 @@
+// Libraries
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include "../Lab2/MappedFile.h"
+#include "../Lab4/PascalSourceGenerator.h"
+#include "Ast.h"
+#include "IncrementalDocument.h"
+
+using namespace std;
+
+// Applies random small edits to a Pascal-subset file held in an
+// IncrementalDocument. For each kind of edit it reports how many tokens were
+// lexed again and how many were reused, how many tree nodes were created and
+// how many reused, how much of the tree was parsed again, and the time per
+// edit, next to the time to lex and parse the whole file. --verify checks
+// after every edit that the tokens and the tree match those of a fresh parse.
+//
+// The edits: change the last digit of a number, rename an identifier, swap
+// + and -, break a line before a token, put a comment before a token, add a
+// statement before an end, and type a letter after a keyword and delete it
+// again, which passes through a syntax error.
+//
+// Usage:
+//   IncrementalBenchmark [source.pas] [--size KB] [--edits N] [--seed N] [--verify]
+
+// Structs
+struct EditTotals
+{
+    uint64_t edits = 0;
+    uint64_t scopes[EDIT_SCOPE_COUNT] = {};
+    uint64_t tokensLexed = 0, tokensReused = 0, nodesCreated = 0, nodesReused = 0;
+    double seconds = 0;
+};
+
+struct PlannedEdit
+{
+    size_t offset;
+    size_t removed;
+    string inserted;
+};
+
+enum EditKind
+{
+    EDIT_DIGIT,
+    EDIT_RENAME,
+    EDIT_OPERATOR,
+    EDIT_LINE_BREAK,
+    EDIT_COMMENT,
+    EDIT_ADD_STATEMENT,
+    EDIT_TYPO,
+    EDIT_TYPO_FIX,
+    EDIT_KIND_COUNT
+};
+
+static const char *editKindNames[EDIT_KIND_COUNT] = {"digit",   "rename",        "operator", "line break",
+                                                     "comment", "add statement", "typo",     "typo fix"};
+
+// Function Prototypes
+bool planEdit(const IncrementalDocument &document, EditKind kind, PascalSourceRandom &random, PlannedEdit &edit);
+bool sameAsFreshParse(const IncrementalDocument &document, string &difference);
+string describeTree(const Ast &ast, const IdentifierTable &identifiers);
+
+// Main Function
+int main(int argc, char *argv[])
+{
+    try
+    {
+        string sourcePath;
+        size_t sizeKb = 256, editCount = 2000;
+        uint64_t seed = 1;
+        bool verify = false;
+        for (int i = 1; i < argc; i++)
+        {
+            string argument = argv[i];
+            if (argument == "--size" && i + 1 < argc)
+                sizeKb = stoul(argv[++i]);
+            else if (argument == "--edits" && i + 1 < argc)
+                editCount = stoul(argv[++i]);
+            else if (argument == "--seed" && i + 1 < argc)
+                seed = stoull(argv[++i]);
+            else if (argument == "--verify")
+                verify = true;
+            else
+                sourcePath = argument;
+        }
+
+        string source;
+        if (!sourcePath.empty())
+        {
+            MappedFile file;
+            if (!file.open(sourcePath))
+            {
+                cerr << "File could not be opened: " << sourcePath << endl;
+                return 1;
+            }
+            source.assign(file.data(), file.size());
+        }
+        else
+            source = PascalSourceGenerator(seed).generate(sizeKb * 1024);
+
+        // The whole file, best of 5
+        IncrementalDocument document;
+        vector<Diagnostic> diagnostics;
+        double fullSeconds = 0;
+        for (int r = 0; r < 5; r++)
+        {
+            auto start = chrono::steady_clock::now();
+            diagnostics.clear();
+            document.open(source, diagnostics);
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            if (r == 0 || seconds < fullSeconds)
+                fullSeconds = seconds;
+        }
+        if (!document.valid())
+        {
+            const Diagnostic &error = diagnostics.front();
+            cerr << "The source does not parse: " << error.line << ":" << error.column << ": " << error.message << endl;
+            return 1;
+        }
+        cout << "Source: " << (sourcePath.empty() ? "generated" : sourcePath) << ", " << source.size() << " bytes, "
+             << document.tokenRecords().size() << " tokens, " << document.tree().nodeCount() << " nodes" << endl;
+        cout << "Lex and parse the whole file: " << fullSeconds * 1e6 << " us" << endl;
+
+        PascalSourceRandom random(seed);
+        EditTotals totals[EDIT_KIND_COUNT];
+        size_t verified = 0;
+        for (size_t e = 0; e < editCount; e++)
+        {
+            EditKind kind = (EditKind)random.below(EDIT_TYPO_FIX);
+            PlannedEdit planned;
+            if (!planEdit(document, kind, random, planned))
+                continue;
+            // A typo is followed by its fix
+            for (int step = 0; step < (kind == EDIT_TYPO ? 2 : 1); step++)
+            {
+                EditKind counted = step == 0 ? kind : EDIT_TYPO_FIX;
+                if (step == 1)
+                    planned = PlannedEdit{planned.offset, planned.inserted.size(), ""};
+                EditReport report;
+                diagnostics.clear();
+                auto start = chrono::steady_clock::now();
+                document.edit(planned.offset, planned.removed, planned.inserted, diagnostics, &report);
+                double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                EditTotals &total = totals[counted];
+                total.edits++;
+                total.scopes[report.scope]++;
+                total.tokensLexed += report.tokensLexed;
+                total.tokensReused += report.tokensReused;
+                total.nodesCreated += report.nodesCreated;
+                total.nodesReused += report.nodesReused;
+                total.seconds += seconds;
+                string difference;
+                if (verify && !sameAsFreshParse(document, difference))
+                {
+                    cout << "Edit " << e << " (" << editKindNames[counted] << " at " << planned.offset
+                         << ") differs from a fresh parse: " << difference << endl;
+                    return 1;
+                }
+                verified += verify;
+            }
+        }
+
+        cout << left << setw(14) << "edit" << right << setw(7) << "count" << setw(26) << "stmt/unit/file/none"
+             << setw(10) << "lexed" << setw(10) << "reused" << setw(10) << "created" << setw(10) << "reused"
+             << setw(12) << "us/edit" << endl;
+        cout << left << setw(14) << "" << right << setw(7) << "" << setw(26) << "" << setw(20) << "tokens per edit"
+             << setw(20) << "nodes per edit" << endl;
+        for (int k = 0; k < EDIT_KIND_COUNT; k++)
+        {
+            const EditTotals &total = totals[k];
+            if (total.edits == 0)
+                continue;
+            double n = (double)total.edits;
+            ostringstream scopes;
+            scopes << total.scopes[EDIT_STATEMENT] << "/" << total.scopes[EDIT_UNIT] << "/" << total.scopes[EDIT_FILE]
+                   << "/" << total.scopes[EDIT_NOTHING];
+            cout << left << setw(14) << editKindNames[k] << right << setw(7) << total.edits << setw(26) << scopes.str()
+                 << fixed << setprecision(1) << setw(10) << total.tokensLexed / n << setw(10)
+                 << total.tokensReused / n << setw(10) << total.nodesCreated / n << setw(10) << total.nodesReused / n
+                 << setw(12) << total.seconds * 1e6 / n << defaultfloat << endl;
+        }
+        if (verify)
+            cout << verified << " edits matched a fresh parse" << endl;
+        return 0;
+    }
+    catch (exception &e)
+    {
+        cout << "Error occurred: " << e.what() << endl;
+        return 1;
+    }
+}
+
+// Picks a token the edit suits; returns false when there is none
+bool planEdit(const IncrementalDocument &document, EditKind kind, PascalSourceRandom &random, PlannedEdit &edit)
+{
+    const vector<TokenRecord> &tokens = document.tokenRecords();
+    const string &text = document.source();
+    for (int attempt = 0; attempt < 64; attempt++)
+    {
+        const TokenRecord &token = tokens[random.below((unsigned)tokens.size() - 1)];
+        string_view lexeme(text.data() + token.offset, token.length);
+        switch (kind)
+        {
+        case EDIT_DIGIT:
+            if (token.kind != TOKEN_NUM || !isdigit((unsigned char)lexeme.back()))
+                continue;
+            edit = PlannedEdit{token.offset + token.length - 1, 1, string(1, (char)('0' + random.below(10)))};
+            return true;
+        case EDIT_RENAME:
+            if (token.kind != TOKEN_ID)
+                continue;
+            edit = PlannedEdit{token.offset, token.length, random.below(2) ? "renamed" : "g1"};
+            return true;
+        case EDIT_OPERATOR:
+            if (lexeme != "+" && lexeme != "-")
+                continue;
+            edit = PlannedEdit{token.offset, 1, lexeme == "+" ? "-" : "+"};
+            return true;
+        case EDIT_LINE_BREAK:
+            edit = PlannedEdit{token.offset, 0, "\n"};
+            return true;
+        case EDIT_COMMENT:
+            edit = PlannedEdit{token.offset, 0, "{ note } "};
+            return true;
+        case EDIT_ADD_STATEMENT:
+            if (token.kind != TOKEN_KEYWORD || token.id != KEYWORD_END)
+                continue;
+            edit = PlannedEdit{token.offset, 0, "; g0 := g0 + 1 "};
+            return true;
+        case EDIT_TYPO:
+            if (token.kind != TOKEN_KEYWORD)
+                continue;
+            edit = PlannedEdit{token.offset + token.length, 0, "x"};
+            return true;
+        default:
+            return false;
+        }
+    }
+    return false;
+}
+
+bool sameAsFreshParse(const IncrementalDocument &document, string &difference)
+{
+    IncrementalDocument fresh;
+    vector<Diagnostic> diagnostics;
+    fresh.open(document.source(), diagnostics);
+    const vector<TokenRecord> &tokens = document.tokenRecords();
+    const vector<TokenRecord> &expected = fresh.tokenRecords();
+    if (tokens.size() != expected.size())
+    {
+        difference = to_string(tokens.size()) + " tokens instead of " + to_string(expected.size());
+        return false;
+    }
+    for (size_t k = 0; k < tokens.size(); k++)
+    {
+        const TokenRecord &a = tokens[k], &b = expected[k];
+        // Identifier ids depend on the order names were first seen
+        bool sameId = a.kind == TOKEN_ID ? document.identifierTable().name(a.id) == fresh.identifierTable().name(b.id)
+                                         : a.id == b.id;
+        if (a.kind != b.kind || a.offset != b.offset || a.length != b.length || a.line != b.line || !sameId)
+        {
+            difference = "token " + to_string(k) + " at offset " + to_string(b.offset);
+            return false;
+        }
+    }
+    if (document.valid() != fresh.valid())
+    {
+        difference = document.valid() ? "it parses, but should not" : "it does not parse, but should";
+        return false;
+    }
+    if (document.valid() &&
+        describeTree(document.tree(), document.identifierTable()) != describeTree(fresh.tree(), fresh.identifierTable()))
+    {
+        difference = "the trees differ";
+        return false;
+    }
+    return true;
+}
+
+// The printed tree, then the line of every node
+string describeTree(const Ast &ast, const IdentifierTable &identifiers)
+{
+    ostringstream out;
+    printAst(out, ast, identifiers);
+    forEachNode(ast, ast.root, [&](uint32_t index) { out << ast[index].line << ' '; });
+    return out.str();
+}
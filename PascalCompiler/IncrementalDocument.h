@@ -0,0 +1,424 @@
+// IncrementalDocument.h
+// A source file that is kept lexed and parsed while an editor changes it.
+// An edit is re-lexed and re-parsed only as far as it has to be.
+//
+// Tokens are kept as TokenRecords, with their byte offsets. An edit re-lexes
+// from a restart point: the end of the last token that is at least
+// lookahead bytes before the edit. No token is decided by bytes further
+// ahead than that. Lexing stops as soon as a new token starts where an old
+// token started after the edit. From there on the streams are the same, so
+// the old records are kept, moved by the size and line change of the edit.
+//
+// The parser records an outline: the token range of each subprogram and of
+// the program's body, and of every statement directly inside them. The
+// tokens that really changed are compared with the outline. When they lie
+// inside one such statement, only that statement is parsed again. Otherwise,
+// when they lie inside one subprogram or the body, only that unit is parsed
+// again. Anything else, such as an edit in the global declarations, parses
+// the whole file again. So does an edit made while the file has a syntax
+// error, and an edit whose fragment does not parse or does not end where it
+// ended before. The full parse then reports the error in order.
+//
+// The new fragment goes into the same arena. The compound, subprogram and
+// program nodes above it are copied with the new child, and every other node
+// is reused. Nodes that start after the edit get the line change added.
+// Replaced nodes stay in the arena as garbage. Once garbage outweighs the
+// live tree, the next edit parses the whole file, which compacts the arena.
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Arena.h"
+#include "Ast.h"
+#include "PascalParser.h"
+#include "../Lab4/IdentifierTable.h"
+#include "../Lab4/PascalLexer.h"
+
+using namespace std;
+
+// How much of the tree an edit parsed again
+enum EditScope : uint8_t
+{
+    EDIT_NOTHING, // only blanks or comments changed, on one line
+    EDIT_STATEMENT,
+    EDIT_UNIT, // a subprogram or the program's body
+    EDIT_FILE,
+    EDIT_SCOPE_COUNT
+};
+
+inline const char *editScopeName(int scope)
+{
+    static const char *names[EDIT_SCOPE_COUNT] = {"nothing", "statement", "subprogram", "file"};
+    return names[scope];
+}
+
+struct EditReport
+{
+    EditScope scope = EDIT_NOTHING;
+    uint32_t tokensLexed = 0;
+    uint32_t tokensReused = 0;
+    uint32_t nodesCreated = 0;
+    uint32_t nodesReused = 0; // nodes of the new tree that were already there
+};
+
+class IncrementalDocument
+{
+public:
+    // PascalLexer looks at most this many bytes past the end of a token (1E+5)
+    static const uint32_t lookahead = 3;
+
+    IncrementalDocument() : ast(new Ast(arena)) {}
+
+    // Replaces the whole text; returns false, with the error in diagnostics, on a syntax error
+    bool open(string source, vector<Diagnostic> &diagnostics, EditReport *report = nullptr)
+    {
+        if (source.size() >= UINT32_MAX)
+            throw runtime_error("source files are limited to 4 GB");
+        text = move(source);
+        lineStarts.assign(1, 0);
+        addLineStarts(0, text.size(), lineStarts);
+        tokens.clear();
+        PascalLexer lexer(text.data(), text.size(), &identifiers);
+        for (;;)
+        {
+            tokens.push_back(record(lexer.next()));
+            if (tokens.back().kind == TOKEN_EOF)
+                break;
+        }
+        EditReport full;
+        full.tokensLexed = (uint32_t)tokens.size();
+        bool result = parseFile(diagnostics, full);
+        if (report != nullptr)
+            *report = full;
+        return result;
+    }
+
+    // Replaces removed bytes at offset by inserted. Returns false, with the
+    // error in diagnostics, when the text now has a syntax error.
+    bool edit(size_t offset, size_t removed, string_view inserted, vector<Diagnostic> &diagnostics,
+              EditReport *report = nullptr)
+    {
+        if (offset > text.size() || removed > text.size() - offset)
+            throw runtime_error("edit outside the text");
+        if (text.size() - removed + inserted.size() >= UINT32_MAX)
+            throw runtime_error("source files are limited to 4 GB");
+        EditReport local;
+        EditReport &out = report != nullptr ? *report : local;
+        out = EditReport();
+
+        // Relex, keeping the tokens before the restart point
+        const uint32_t start = (uint32_t)offset;
+        const uint32_t oldEnd = (uint32_t)(offset + removed);
+        const uint32_t newEnd = (uint32_t)(offset + inserted.size());
+        const int64_t delta = (int64_t)inserted.size() - (int64_t)removed;
+        auto clearOfEdit = [&](const TokenRecord &token) { return token.offset + token.length + lookahead <= start; };
+        const uint32_t first = (uint32_t)(partition_point(tokens.begin(), tokens.end(), clearOfEdit) - tokens.begin());
+        const uint32_t resumeAt = first > 0 ? tokens[first - 1].offset + tokens[first - 1].length : 0;
+        const int64_t lineDelta = (int64_t)count(inserted.begin(), inserted.end(), '\n') -
+                                  (int64_t)count(text.begin() + start, text.begin() + oldEnd, '\n');
+        text.replace(offset, removed, inserted.data(), inserted.size());
+        updateLineStarts(start, oldEnd, newEnd, delta);
+
+        uint32_t line = lineOf(resumeAt);
+        PascalLexer lexer(text.data(), text.size(), &identifiers);
+        lexer.resume(text.data() + resumeAt, line, text.data() + lineStarts[line - 1]);
+        fresh.clear();
+        uint32_t sync = first;
+        for (;;)
+        {
+            TokenRecord token = record(lexer.next());
+            if (token.offset >= newEnd)
+            {
+                // The old tokens from here on were lexed from the same bytes
+                const int64_t oldOffset = token.offset - delta;
+                while (tokens[sync].offset < oldOffset)
+                    sync++;
+                if (tokens[sync].offset == oldOffset)
+                    break;
+            }
+            fresh.push_back(token);
+        }
+        out.tokensLexed = (uint32_t)fresh.size();
+        out.tokensReused = (uint32_t)(tokens.size() - (sync - first));
+
+        // The old tokens [changed, oldChangedEnd) are the ones that really changed
+        uint32_t same = 0;
+        while (same < fresh.size() && first + same < sync && fresh[same].offset + fresh[same].length <= start &&
+               sameToken(fresh[same], tokens[first + same], 0, 0))
+            same++;
+        uint32_t sameAfter = 0;
+        while (same + sameAfter < fresh.size() && first + same + sameAfter < sync &&
+               fresh[fresh.size() - 1 - sameAfter].offset >= newEnd &&
+               sameToken(fresh[fresh.size() - 1 - sameAfter], tokens[sync - 1 - sameAfter], delta, lineDelta))
+            sameAfter++;
+        const uint32_t changed = first + same;
+        const uint32_t oldChangedEnd = sync - sameAfter;
+        const bool tokensAdded = same + sameAfter < fresh.size();
+        const int64_t tokenDelta = (int64_t)fresh.size() - (int64_t)(sync - first);
+
+        for (size_t k = sync; k < tokens.size(); k++)
+        {
+            tokens[k].offset = (uint32_t)(tokens[k].offset + delta);
+            tokens[k].line = (uint32_t)(tokens[k].line + lineDelta);
+        }
+        tokens.erase(tokens.begin() + first, tokens.begin() + sync);
+        tokens.insert(tokens.begin() + first, fresh.begin(), fresh.end());
+
+        if (!parsed || ast->nodeCount() > 2 * liveNodes + 65536)
+            return parseFile(diagnostics, out);
+        if (changed == oldChangedEnd && !tokensAdded && lineDelta == 0)
+        {
+            out.nodesReused = liveNodes;
+            return true;
+        }
+        if (reparse(changed, oldChangedEnd, tokensAdded, tokenDelta, (int32_t)lineDelta, out))
+            return true;
+        return parseFile(diagnostics, out);
+    }
+
+    const string &source() const { return text; }
+    const vector<TokenRecord> &tokenRecords() const { return tokens; }
+    const Ast &tree() const { return *ast; }
+    const IdentifierTable &identifierTable() const { return identifiers; }
+    bool valid() const { return parsed; }
+
+private:
+    TokenRecord record(const Token &token) const
+    {
+        // The end of file's lexeme is not in the text
+        if (token.kind == TOKEN_EOF)
+            return TokenRecord{(uint32_t)text.size(), 0, token.line, 0, TOKEN_EOF};
+        return TokenRecord{(uint32_t)(token.lexeme.data() - text.data()), (uint32_t)token.lexeme.size(), token.line,
+                           token.id, token.kind};
+    }
+
+    static bool sameToken(const TokenRecord &now, const TokenRecord &before, int64_t delta, int64_t lineDelta)
+    {
+        return now.kind == before.kind && now.length == before.length && now.id == before.id &&
+               now.offset == before.offset + delta && now.line == before.line + lineDelta;
+    }
+
+    static void addLineStarts(size_t from, size_t to, vector<uint32_t> &starts, const char *data, size_t base)
+    {
+        for (const char *p = data + from; (p = (const char *)memchr(p, '\n', data + to - p)) != nullptr; p++)
+            starts.push_back((uint32_t)(base + (p - data) + 1));
+    }
+
+    void addLineStarts(size_t from, size_t to, vector<uint32_t> &starts) const
+    {
+        addLineStarts(from, to, starts, text.data(), 0);
+    }
+
+    // Line starts after a newline in the removed bytes go, those of the inserted ones come in
+    void updateLineStarts(uint32_t start, uint32_t oldEnd, uint32_t newEnd, int64_t delta)
+    {
+        auto low = upper_bound(lineStarts.begin(), lineStarts.end(), start);
+        auto high = upper_bound(low, lineStarts.end(), oldEnd);
+        for (auto k = high; k != lineStarts.end(); ++k)
+            *k = (uint32_t)(*k + delta);
+        vector<uint32_t> inserted;
+        addLineStarts(start, newEnd, inserted);
+        size_t at = low - lineStarts.begin();
+        lineStarts.erase(low, high);
+        lineStarts.insert(lineStarts.begin() + at, inserted.begin(), inserted.end());
+    }
+
+    uint32_t lineOf(uint32_t offset) const
+    {
+        return (uint32_t)(upper_bound(lineStarts.begin(), lineStarts.end(), offset) - lineStarts.begin());
+    }
+
+    bool parseFile(vector<Diagnostic> &diagnostics, EditReport &out)
+    {
+        ast.reset();
+        arena.reset();
+        ast.reset(new Ast(arena));
+        PascalParser parser(text.data(), tokens.data(), lineStarts.data());
+        parsed = parser.parse(*ast, diagnostics, &outline);
+        liveNodes = ast->nodeCount();
+        out.scope = EDIT_FILE;
+        out.nodesCreated = liveNodes;
+        out.nodesReused = 0;
+        return parsed;
+    }
+
+    uint32_t countNodes(uint32_t index) const
+    {
+        uint32_t count = 0;
+        forEachNode(*ast, index, [&](uint32_t) { count++; });
+        return count;
+    }
+
+    void shiftLines(uint32_t index, int32_t lineDelta)
+    {
+        if (lineDelta != 0)
+            forEachNode(*ast, index, [&](uint32_t node) { (*ast)[node].line += lineDelta; });
+    }
+
+    // Does the token range hold the change of the old tokens [first, end)?
+    // When no old token changed, the change sits before token first: new
+    // tokens there may end the range, but blanks must be inside it to matter.
+    static bool holds(const TokenRange &range, uint32_t first, uint32_t end, bool tokensAdded)
+    {
+        if (first < end)
+            return range.first <= first && end <= range.end;
+        return range.first < first && (first < range.end || (tokensAdded && first == range.end));
+    }
+
+    uint32_t unitNode(const OutlineUnit &unit) const
+    {
+        const AstNode &program = (*ast)[ast->root];
+        return unit.slot == OutlineUnit::noSlot ? program.d : ast->listItems(program.c)[unit.slot];
+    }
+
+    // A copy of the list at offset with item slot replaced
+    uint32_t replaceInList(uint32_t offset, uint32_t slot, uint32_t item)
+    {
+        vector<uint32_t> items(ast->listItems(offset), ast->listItems(offset) + ast->listSize(offset));
+        items[slot] = item;
+        return ast->addList(items.data(), (uint32_t)items.size());
+    }
+
+    // A new program node whose unit is node
+    void replaceUnit(const OutlineUnit &unit, uint32_t node)
+    {
+        AstNode program = (*ast)[ast->root];
+        if (unit.slot == OutlineUnit::noSlot)
+            program.d = node;
+        else
+            program.c = replaceInList(program.c, unit.slot, node);
+        ast->root = ast->add(program);
+    }
+
+    // Re-parses the statement or the unit that holds the change of the old
+    // tokens [first, end), or returns false when none does or it no longer
+    // parses alone
+    bool reparse(uint32_t first, uint32_t end, bool tokensAdded, int64_t tokenDelta, int32_t lineDelta,
+                 EditReport &out)
+    {
+        const bool blanksOnly = first == end && !tokensAdded;
+        size_t u = 0;
+        while (u < outline.size() && !holds(outline[u].range, first, end, tokensAdded))
+            u++;
+        if (u == outline.size())
+        {
+            // A blank line between two units only moves the ones after it
+            bool between = blanksOnly && !outline.empty() && first >= outline[0].range.first;
+            if (!between)
+                return false;
+            size_t later = 0;
+            while (later < outline.size() && outline[later].range.first < first)
+                later++;
+            for (size_t k = later; k < outline.size(); k++)
+                shiftLines(unitNode(outline[k]), lineDelta);
+            out.scope = EDIT_NOTHING;
+            out.nodesReused = liveNodes;
+            return true;
+        }
+        OutlineUnit &unit = outline[u];
+        uint32_t before = ast->nodeCount(); // nodes after it are new, or garbage of a failed attempt
+        const uint32_t oldUnit = unitNode(unit);
+        uint32_t removed = 0;
+
+        size_t s = 0;
+        while (s < unit.statements.size() && !holds(unit.statements[s], first, end, tokensAdded))
+            s++;
+        uint32_t node, parsedEnd;
+        PascalParser parser(text.data(), tokens.data(), lineStarts.data());
+        if (s < unit.statements.size() &&
+            parser.parseFragment(*ast, FRAGMENT_STATEMENT, unit.statements[s].first, node, parsedEnd) &&
+            parsedEnd == unit.statements[s].end + tokenDelta)
+        {
+            // New compound above the statement, and a new subprogram above that
+            uint32_t body = unit.slot == OutlineUnit::noSlot ? oldUnit : (*ast)[oldUnit].d;
+            AstNode compound = (*ast)[body];
+            removed += countNodes(ast->listItems(compound.a)[s]) + 1;
+            for (size_t k = s + 1; k < unit.statements.size(); k++)
+                shiftLines(ast->listItems(compound.a)[k], lineDelta);
+            compound.a = replaceInList(compound.a, (uint32_t)s, node);
+            uint32_t newUnit = ast->add(compound);
+            if (unit.slot != OutlineUnit::noSlot)
+            {
+                AstNode subprogram = (*ast)[oldUnit];
+                subprogram.d = newUnit;
+                newUnit = ast->add(subprogram);
+                removed++;
+            }
+            unit.statements[s].end = parsedEnd;
+            for (size_t k = s + 1; k < unit.statements.size(); k++)
+                moveRange(unit.statements[k], tokenDelta);
+            replaceUnit(unit, newUnit);
+            out.scope = EDIT_STATEMENT;
+        }
+        else if (blanksOnly && s == unit.statements.size() && !unit.statements.empty() &&
+                 first >= unit.statements[0].first)
+        {
+            // A blank line between two statements moves the statements after it
+            const AstNode &compound = (*ast)[unit.slot == OutlineUnit::noSlot ? oldUnit : (*ast)[oldUnit].d];
+            for (size_t k = 0; k < unit.statements.size(); k++)
+            {
+                if (unit.statements[k].first >= first)
+                    shiftLines(ast->listItems(compound.a)[k], lineDelta);
+            }
+            for (size_t k = u + 1; k < outline.size(); k++)
+                shiftLines(unitNode(outline[k]), lineDelta);
+            out.scope = EDIT_NOTHING;
+            out.nodesReused = liveNodes;
+            return true;
+        }
+        else
+        {
+            const TokenRecord &opening = tokens[unit.range.first];
+            bool subprogram = unit.slot != OutlineUnit::noSlot;
+            if (subprogram && !(opening.kind == TOKEN_KEYWORD &&
+                                (opening.id == KEYWORD_FUNCTION || opening.id == KEYWORD_PROCEDURE)))
+                return false;
+            OutlineUnit parsedUnit{unit.range, unit.slot, {}};
+            before = ast->nodeCount();
+            if (!parser.parseFragment(*ast, subprogram ? FRAGMENT_SUBPROGRAM : FRAGMENT_BODY, unit.range.first, node,
+                                      parsedEnd, &parsedUnit) ||
+                parsedEnd != unit.range.end + tokenDelta)
+                return false;
+            removed += countNodes(oldUnit);
+            unit.statements = move(parsedUnit.statements);
+            replaceUnit(unit, node);
+            out.scope = EDIT_UNIT;
+        }
+        removed++; // the program node
+        unit.range.end = (uint32_t)(unit.range.end + tokenDelta);
+        for (size_t k = u + 1; k < outline.size(); k++)
+        {
+            shiftLines(unitNode(outline[k]), lineDelta);
+            moveRange(outline[k].range, tokenDelta);
+            for (TokenRange &statement : outline[k].statements)
+                moveRange(statement, tokenDelta);
+        }
+        out.nodesCreated = ast->nodeCount() - before;
+        liveNodes = liveNodes - removed + out.nodesCreated;
+        out.nodesReused = liveNodes - out.nodesCreated;
+        return true;
+    }
+
+    static void moveRange(TokenRange &range, int64_t tokenDelta)
+    {
+        range.first = (uint32_t)(range.first + tokenDelta);
+        range.end = (uint32_t)(range.end + tokenDelta);
+    }
+
+    string text;
+    vector<uint32_t> lineStarts; // offset of the first byte of each line
+    vector<TokenRecord> tokens;  // ends with the end of file
+    vector<TokenRecord> fresh;   // tokens of the edit being lexed
+    IdentifierTable identifiers;
+    Arena arena;
+    unique_ptr<Ast> ast;
+    vector<OutlineUnit> outline;
+    uint32_t liveNodes = 0;
+    bool parsed = false;
+};
@@ -0,0 +1,265 @@
+// Libraries
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include "../Lab1/PrefixProgram.h"
+#include "../Lab2/MappedFile.h"
+#include "../Lab4/IdentifierTable.h"
+#include "../Lab4/PascalSourceGenerator.h"
+#include "Arena.h"
+#include "Ast.h"
+#include "ExpressionLowering.h"
+#include "PascalParser.h"
+
+using namespace std;
+
+// Folds the constants of a Pascal source and lowers every expression it can
+// into a prefix program (Lab1/PrefixProgram.h). Every scalar variable and
+// parameter gets a slot by name; scopes are ignored, which is enough to run
+// the programs. Then all lowered programs are run R times, against compiling
+// each one again from its prefix text before every run, which is what the
+// text evaluator pays per evaluation.
+//
+// Usage:
+//   LoweringBenchmark [source.pas] [--size MB] [--runs R] [--seed N] [--print]
+// --print lists each lowered expression as line: prefix text = value.
+
+// Function Prototypes
+void assignSlots(const Ast &ast, uint32_t index, vector<uint32_t> &slots, uint32_t &slotCount);
+void collectExpressions(const Ast &ast, uint32_t index, vector<uint32_t> &expressions);
+
+// Main Function
+int main(int argc, char *argv[])
+{
+    try
+    {
+        string sourcePath;
+        size_t sizeMb = 4;
+        int runs = 5;
+        uint64_t seed = 1;
+        bool print = false;
+        for (int i = 1; i < argc; i++)
+        {
+            string argument = argv[i];
+            if (argument == "--size" && i + 1 < argc)
+                sizeMb = stoul(argv[++i]);
+            else if (argument == "--runs" && i + 1 < argc)
+                runs = max(1, stoi(argv[++i]));
+            else if (argument == "--seed" && i + 1 < argc)
+                seed = stoull(argv[++i]);
+            else if (argument == "--print")
+                print = true;
+            else
+                sourcePath = argument;
+        }
+
+        MappedFile file;
+        string generated;
+        const char *data;
+        size_t size;
+        if (!sourcePath.empty())
+        {
+            if (!file.open(sourcePath))
+            {
+                cerr << "File could not be opened: " << sourcePath << endl;
+                return 1;
+            }
+            data = file.data();
+            size = file.size();
+        }
+        else
+        {
+            generated = PascalSourceGenerator(seed).generate(sizeMb * 1024 * 1024);
+            data = generated.data();
+            size = generated.size();
+        }
+
+        Arena arena;
+        Ast ast(arena);
+        IdentifierTable identifiers;
+        vector<Diagnostic> diagnostics;
+        PascalParser parser(data, size, identifiers);
+        if (!parser.parse(ast, diagnostics))
+        {
+            for (const Diagnostic &diagnostic : diagnostics)
+                cerr << (sourcePath.empty() ? "generated" : sourcePath) << ":" << diagnostic.line << ":"
+                     << diagnostic.column << ": " << diagnostic.message << endl;
+            return 1;
+        }
+
+        uint32_t folded = foldConstants(ast, ast.root);
+        vector<uint32_t> slots(identifiers.size() + 1, 0);
+        uint32_t slotCount = 0;
+        assignSlots(ast, ast.root, slots, slotCount);
+        vector<uint32_t> expressions;
+        collectExpressions(ast, ast.root, expressions);
+
+        vector<PrefixProgram> programs;
+        vector<string> texts;
+        size_t instructions = 0;
+        for (uint32_t expression : expressions)
+        {
+            PrefixProgram program;
+            if (!lowerExpression(ast, expression, slots, program))
+                continue;
+            instructions += program.code.size();
+            texts.push_back(prefixText(program));
+            programs.push_back(move(program));
+        }
+
+        // Slot k holds k + 1, so the results do not depend on the order of runs
+        vector<double> variables(slotCount);
+        for (uint32_t i = 0; i < slotCount; i++)
+            variables[i] = i + 1;
+
+        if (print)
+        {
+            size_t p = 0;
+            for (uint32_t expression : expressions)
+            {
+                PrefixProgram program;
+                if (!lowerExpression(ast, expression, slots, program))
+                    continue;
+                cout << ast[expression].line << ": " << texts[p++] << " = " << runPrefix(program, variables.data())
+                     << "\n";
+            }
+            return 0;
+        }
+
+        double bestCompiled = 0, bestText = 0, checkCompiled = 0, checkText = 0;
+        for (int r = 0; r < runs; r++)
+        {
+            auto start = chrono::steady_clock::now();
+            double sum = 0;
+            for (const PrefixProgram &program : programs)
+                sum += runPrefix(program, variables.data());
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            if (r == 0 || seconds < bestCompiled)
+                bestCompiled = seconds;
+            checkCompiled = sum;
+
+            // Names in the text are $slot, which compilePrefix hands out in order of appearance
+            start = chrono::steady_clock::now();
+            sum = 0;
+            vector<string> names;
+            vector<double> values;
+            for (const string &text : texts)
+            {
+                names.clear();
+                PrefixProgram program = compilePrefix(text, names);
+                values.resize(names.size());
+                for (size_t i = 0; i < names.size(); i++)
+                    values[i] = variables[stoul(names[i].substr(1))];
+                sum += runPrefix(program, values.data());
+            }
+            seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            if (r == 0 || seconds < bestText)
+                bestText = seconds;
+            checkText = sum;
+        }
+        if (checkCompiled != checkText)
+            throw runtime_error("Compiled and reparsed programs disagree");
+
+        size_t count = programs.size();
+        cout << "Source: " << (sourcePath.empty() ? "generated" : sourcePath) << ", " << size << " bytes" << endl;
+        cout << "Folded " << folded << " constant nodes" << endl;
+        cout << "Expressions: " << expressions.size() << ", lowered " << count << " ("
+             << (expressions.empty() ? 0 : 100.0 * count / expressions.size()) << "%), " << instructions
+             << " instructions, " << slotCount << " variable slots" << endl;
+        if (count == 0)
+            return 0;
+        cout << "Best of " << runs << ", compiled programs: " << bestCompiled * 1e9 / count << " ns per expression"
+             << endl;
+        cout << "Best of " << runs << ", compiled from text each time: " << bestText * 1e9 / count
+             << " ns per expression" << endl;
+        return 0;
+    }
+    catch (exception &e)
+    {
+        cout << "Error occurred: " << e.what() << endl;
+        return 1;
+    }
+}
+
+void assignSlots(const Ast &ast, uint32_t index, vector<uint32_t> &slots, uint32_t &slotCount)
+{
+    const AstNode &node = ast[index];
+    auto children = [&](uint32_t list) {
+        for (uint32_t i = 0; i < ast.listSize(list); i++)
+            assignSlots(ast, ast.listItems(list)[i], slots, slotCount);
+    };
+    switch (node.kind)
+    {
+    case NODE_PROGRAM:
+        children(node.c);
+        break;
+    case NODE_FUNCTION:
+    case NODE_PROCEDURE:
+        children(node.b);
+        children(node.c);
+        break;
+    case NODE_VARIABLES:
+    case NODE_PARAMETERS:
+        if (node.flags & NODE_FLAG_ARRAY)
+            break;
+        for (uint32_t i = 0; i < ast.listSize(node.a); i++)
+        {
+            uint32_t id = ast.listItems(node.a)[i];
+            if (slots[id] == 0)
+                slots[id] = ++slotCount;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// Gathers the outermost expressions of every statement
+void collectExpressions(const Ast &ast, uint32_t index, vector<uint32_t> &expressions)
+{
+    if (index == 0)
+        return;
+    const AstNode &node = ast[index];
+    auto all = [&](uint32_t list, bool areExpressions) {
+        for (uint32_t i = 0; i < ast.listSize(list); i++)
+        {
+            if (areExpressions)
+                expressions.push_back(ast.listItems(list)[i]);
+            else
+                collectExpressions(ast, ast.listItems(list)[i], expressions);
+        }
+    };
+    switch (node.kind)
+    {
+    case NODE_PROGRAM:
+    case NODE_FUNCTION:
+    case NODE_PROCEDURE:
+        all(node.c, false);
+        collectExpressions(ast, node.d, expressions);
+        break;
+    case NODE_COMPOUND:
+        all(node.a, false);
+        break;
+    case NODE_ASSIGN:
+        if (ast[node.a].kind == NODE_INDEX)
+            expressions.push_back(ast[node.a].b);
+        expressions.push_back(node.b);
+        break;
+    case NODE_CALL_STATEMENT:
+        all(node.b, true);
+        break;
+    case NODE_IF:
+        expressions.push_back(node.a);
+        collectExpressions(ast, node.b, expressions);
+        collectExpressions(ast, node.c, expressions);
+        break;
+    case NODE_WHILE:
+        expressions.push_back(node.a);
+        collectExpressions(ast, node.b, expressions);
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,1358 @@
+// NativeCompiler.h
+// Compiles a BytecodeModule to x86-64 machine code in memory, by way of the
+// optimized SSA form of SsaOptimizer.h, and runs it. Programs print the same
+// thing as on VirtualMachine.h and fail with the same run-time errors.
+//
+// Frames keep the VM's layout, in a stack of Values of their own: the global
+// arrays at the bottom (R14), the main program's frame above them (R15),
+// then one frame per active call (RBP); R13 points to the NativeContext.
+// Pinned registers and arrays stay in the frame. Every other SSA value gets
+// a general purpose register, or an XMM register when it holds a real, by
+// linear scan over the blocks in bytecode order (Poletto and Sarkar): when
+// the registers run out, the value whose interval ends last goes to a slot
+// after the bytecode frame. A phi shares a register with its operands where
+// their intervals allow; the rest of its copies go at the end of each
+// predecessor. Values in registers are saved around calls.
+//
+// A call stores its arguments straight into the next frame, which is the
+// caller's frame plus its spill slots. Besides the Value stack it checks
+// the thread's own stack against NativeMachine's budget, so very deep
+// recursion can report a stack overflow sooner than on the VM. Output goes
+// through small C++ helpers; a run-time error longjmps back to
+// NativeMachine::run, which throws it as runtime_error like the VM does.
+//
+// Needs x86-64 and the System V calling convention; PASCAL_NATIVE is
+// defined when both are there.
+#pragma once
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define PASCAL_NATIVE
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "Bytecode.h"
+#include "Ssa.h"
+#include "SsaOptimizer.h"
+#include "X86Assembler.h"
+
+using namespace std;
+
+enum NativeError : uint32_t
+{
+    NATIVE_DIVISION_BY_ZERO,
+    NATIVE_INDEX_OUT_OF_BOUNDS,
+    NATIVE_STACK_OVERFLOW
+};
+
+// What native code reaches through R13
+struct NativeContext
+{
+    Value *bottom;
+    Value *globals;
+    Value *end;            // of the Value stack
+    uintptr_t stackLimit;  // the machine stack may not go below this
+    ostream *out;
+    uint32_t errorLine, errorKind;
+    int64_t errorValue;
+    jmp_buf jump;
+};
+
+inline void nativeWriteInteger(NativeContext *context, int64_t value) { *context->out << value; }
+inline void nativeWriteReal(NativeContext *context, double value) { writeReal(*context->out, value); }
+inline void nativeWriteLine(NativeContext *context) { *context->out << '\n'; }
+
+[[noreturn]] inline void nativeFail(NativeContext *context, uint32_t line, uint32_t kind, int64_t value)
+{
+    context->errorLine = line;
+    context->errorKind = kind;
+    context->errorValue = value;
+    longjmp(context->jump, 1);
+}
+
+struct NativeStatistics
+{
+    uint32_t values = 0;  // SSA values that needed a place
+    uint32_t spilled = 0; // of those, values that live in frame slots
+    uint32_t saved = 0;   // register values saved around calls, counted once each
+    uint32_t codeBytes = 0;
+};
+
+struct NativeProgram
+{
+    ExecutableMemory memory;
+    vector<uint8_t> code;
+    uint32_t mainFrame = 0; // slots of the main program's frame, spill slots included
+    uint32_t globalArraySlots = 0;
+    NativeStatistics statistics;
+
+    void enter(NativeContext *context) const
+    {
+        reinterpret_cast<void (*)(NativeContext *)>(const_cast<uint8_t *>(memory.data()))(context);
+    }
+};
+
+class NativeCompiler
+{
+public:
+    NativeCompiler(const BytecodeModule &module, uint32_t passes = SSA_PASS_ALL) : module(module), passes(passes) {}
+
+    void compile(NativeProgram &program)
+    {
+        plans.assign(module.functions.size(), Plan());
+        functionLabels.clear();
+        for (uint32_t index = 0; index < module.functions.size(); index++)
+        {
+            plan(index);
+            functionLabels.push_back(as.newLabel());
+        }
+        emitEntry();
+        for (uint32_t index = 0; index < module.functions.size(); index++)
+        {
+            as.bind(functionLabels[index]);
+            emitFunction(index);
+        }
+        as.finish();
+        program.code = as.code();
+        program.memory.load(program.code);
+        program.mainFrame = plans[module.main].frame;
+        program.globalArraySlots = module.globalArraySlots;
+        statistics.codeBytes = (uint32_t)program.code.size();
+        program.statistics = statistics;
+    }
+
+private:
+    enum LocationKind : uint8_t
+    {
+        IN_NOTHING,
+        IN_GPR,
+        IN_XMM,
+        IN_SLOT
+    };
+
+    struct Location
+    {
+        LocationKind kind = IN_NOTHING;
+        uint32_t where = 0; // register or frame slot
+
+        bool operator==(const Location &other) const { return kind == other.kind && where == other.where; }
+    };
+
+    struct Plan
+    {
+        SsaFunction function;
+        vector<uint32_t> position; // of each instruction; phis take their block's
+        vector<uint32_t> blockStart, blockEnd;
+        vector<uint32_t> first, last; // interval of each value
+        vector<uint32_t> uses;
+        vector<bool> real;
+        vector<Location> location;
+        vector<uint32_t> saveSlot;           // where a register value goes around calls
+        vector<vector<uint32_t>> saves;      // by instruction: values to save around it
+        uint32_t frame = 0;                  // slots, the bytecode frame first
+    };
+
+    // Registers linear scan may hand out; RAX, RDX, R11, XMM0 and XMM1 are scratch
+    static constexpr uint8_t generalRegisters[] = {RBX, RCX, RSI, RDI, R8, R9, R10, R12};
+    static constexpr uint8_t xmmRegisters[] = {2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+    static const uint8_t XMM0 = 0, XMM1 = 1;
+
+    // --- Planning: positions, intervals, classes, registers ---
+
+    void plan(uint32_t index)
+    {
+        Plan &p = plans[index];
+        SsaBuilder(module).build(index, p.function);
+        SsaOptimizer(module, passes).run(p.function);
+        splitCriticalEdges(p.function);
+        current = &p;
+        numberPositions();
+        findIntervals();
+        findClasses();
+        allocateRegisters();
+        findSaves();
+    }
+
+    void numberPositions()
+    {
+        Plan &p = *current;
+        const SsaFunction &f = p.function;
+        p.position.assign(f.instructions.size(), 0);
+        p.blockStart.assign(f.blocks.size(), 0);
+        p.blockEnd.assign(f.blocks.size(), 0);
+        p.uses.assign(f.instructions.size(), 0);
+        uint32_t position = 0;
+        for (uint32_t block : f.layout)
+        {
+            p.blockStart[block] = position;
+            position += 2;
+            for (uint32_t index : f.blocks[block].code)
+            {
+                if (f.instructions[index].op == SSA_PHI)
+                    p.position[index] = p.blockStart[block];
+                else
+                {
+                    p.position[index] = position;
+                    position += 2;
+                }
+                forEachOperand(f, index, [&](uint32_t operand) { p.uses[operand]++; });
+            }
+            p.blockEnd[block] = p.position[f.blocks[block].code.back()];
+        }
+    }
+
+    // One range per value, from its definition to its last use, widened to the blocks it is live through
+    void findIntervals()
+    {
+        Plan &p = *current;
+        const SsaFunction &f = p.function;
+        size_t count = f.instructions.size();
+        p.first.assign(count, UINT32_MAX);
+        p.last.assign(count, 0);
+        for (uint32_t block : f.layout)
+        {
+            const SsaBlock &b = f.blocks[block];
+            for (uint32_t index : b.code)
+            {
+                const SsaInstruction &instruction = f.instructions[index];
+                if (instruction.defines)
+                {
+                    p.first[index] = min(p.first[index], p.position[index]);
+                    p.last[index] = max(p.last[index], p.position[index]);
+                }
+                if (instruction.op != SSA_PHI)
+                {
+                    forEachOperand(f, index, [&](uint32_t operand) {
+                        p.last[operand] = max(p.last[operand], p.position[index]);
+                    });
+                    continue;
+                }
+                // A phi is written at the end of each predecessor and read at the end of its operand's.
+                // Its interval reaches back to the predecessors laid out before it; on an edge back to an
+                // earlier block it is dead from its last use until the copy
+                p.last[index] = max(p.last[index], p.blockStart[block]);
+                for (size_t k = 0; k < b.predecessors.size(); k++)
+                {
+                    uint32_t end = p.blockEnd[b.predecessors[k]];
+                    uint32_t operand = f.operands[instruction.a + k];
+                    p.last[operand] = max(p.last[operand], end);
+                    if (end < p.blockStart[block])
+                        p.first[index] = min(p.first[index], end);
+                }
+            }
+        }
+
+        // Liveness by block, phis excluded from live-in and their operands counted live-out of their edge
+        size_t words = (count + 63) / 64;
+        vector<vector<uint64_t>> liveIn(f.blocks.size(), vector<uint64_t>(words, 0)), liveOut = liveIn;
+        auto set = [](vector<uint64_t> &bits, uint32_t k) { bits[k >> 6] |= 1ull << (k & 63); };
+        auto reset = [](vector<uint64_t> &bits, uint32_t k) { bits[k >> 6] &= ~(1ull << (k & 63)); };
+        for (bool changed = true; changed;)
+        {
+            changed = false;
+            for (size_t k = f.layout.size(); k-- > 0;)
+            {
+                uint32_t block = f.layout[k];
+                const SsaBlock &b = f.blocks[block];
+                vector<uint64_t> live(words, 0);
+                for (uint32_t successor : b.successors)
+                {
+                    if (successor == ssaNone)
+                        continue;
+                    for (size_t w = 0; w < words; w++)
+                        live[w] |= liveIn[successor][w];
+                    const SsaBlock &next = f.blocks[successor];
+                    size_t at = find(next.predecessors.begin(), next.predecessors.end(), block) -
+                                next.predecessors.begin();
+                    for (size_t j = 0, phis = f.phiCount(successor); j < phis; j++)
+                        set(live, f.operands[f.instructions[next.code[j]].a + at]);
+                }
+                liveOut[block] = live;
+                for (size_t j = b.code.size(); j-- > 0;)
+                {
+                    uint32_t index = b.code[j];
+                    reset(live, index);
+                    if (f.instructions[index].op != SSA_PHI)
+                        forEachOperand(f, index, [&](uint32_t operand) { set(live, operand); });
+                }
+                if (live != liveIn[block])
+                {
+                    liveIn[block] = std::move(live);
+                    changed = true;
+                }
+            }
+        }
+        for (uint32_t block : f.layout)
+        {
+            for (size_t w = 0; w < words; w++)
+            {
+                for (uint64_t bits = liveIn[block][w]; bits != 0; bits &= bits - 1)
+                {
+                    uint32_t value = (uint32_t)(w * 64 + __builtin_ctzll(bits));
+                    p.first[value] = min(p.first[value], p.blockStart[block]);
+                }
+                for (uint64_t bits = liveOut[block][w]; bits != 0; bits &= bits - 1)
+                {
+                    uint32_t value = (uint32_t)(w * 64 + __builtin_ctzll(bits));
+                    p.last[value] = max(p.last[value], p.blockEnd[block]);
+                }
+            }
+        }
+    }
+
+    // Reals go to XMM registers. Loads, constants, parameters and phis carry no type in the
+    // bytecode, so they go where most of their uses want them; a use of the other kind moves the bits
+    void findClasses()
+    {
+        Plan &p = *current;
+        const SsaFunction &f = p.function;
+        size_t count = f.instructions.size();
+        vector<int> vote(count, 0);
+        vector<uint32_t> parent(count);
+        for (uint32_t k = 0; k < count; k++)
+            parent[k] = k;
+        auto root = [&](uint32_t k) {
+            while (parent[k] != k)
+                k = parent[k] = parent[parent[k]];
+            return k;
+        };
+        const int fixed = 1 << 20;
+        for (uint32_t block : f.layout)
+        {
+            for (uint32_t index : f.blocks[block].code)
+            {
+                const SsaInstruction &instruction = f.instructions[index];
+                uint16_t op = instruction.op;
+                if (definesReal(op) || (op == OP_CALL && instruction.defines &&
+                                        module.functions[instruction.c].resultType == AST_TYPE_REAL))
+                    vote[index] += fixed;
+                else if (definesInteger(op) || op == OP_CALL)
+                    vote[index] -= fixed;
+                switch (op)
+                {
+                case SSA_PHI:
+                    forEachOperand(f, index, [&](uint32_t operand) { parent[root(operand)] = root(index); });
+                    break;
+                case OP_WRITER:
+                    vote[instruction.a]++;
+                    break;
+                case OP_RET:
+                    if (f.returnsValue)
+                        vote[instruction.a] += module.functions[f.index].resultType == AST_TYPE_REAL ? 1 : -1;
+                    break;
+                case OP_GETEL:
+                case OP_GETEG:
+                case OP_WRITEI:
+                case SSA_BRANCH:
+                    vote[instruction.a]--;
+                    break;
+                case OP_SETEL:
+                case OP_SETEG:
+                    vote[instruction.b]--;
+                    break;
+                default:
+                    if (op >= OP_I2R && op <= OP_NOT)
+                    {
+                        int weight = readsReal(op) ? 1 : -1;
+                        forEachOperand(f, index, [&](uint32_t operand) { vote[operand] += weight; });
+                    }
+                    break;
+                }
+            }
+        }
+        vector<int> groupVote(count, 0);
+        for (uint32_t k = 0; k < count; k++)
+        {
+            if (isTyped(f.instructions[k].op) || f.instructions[k].op == OP_CALL)
+                continue;
+            groupVote[root(k)] += max(-fixed, min(fixed, vote[k]));
+        }
+        p.real.assign(count, false);
+        for (uint32_t k = 0; k < count; k++)
+        {
+            const SsaInstruction &instruction = f.instructions[k];
+            if (isTyped(instruction.op) || instruction.op == OP_CALL)
+                p.real[k] = vote[k] > 0;
+            else
+                p.real[k] = groupVote[root(k)] > 0;
+        }
+        // A phi follows the operands whose type is known
+        for (uint32_t k = 0; k < count; k++)
+        {
+            if (f.instructions[k].op != SSA_PHI)
+                continue;
+            forEachOperand(f, k, [&](uint32_t operand) {
+                if (isTyped(f.instructions[operand].op))
+                    groupVote[root(k)] += p.real[operand] ? fixed : -fixed;
+            });
+        }
+        for (uint32_t k = 0; k < count; k++)
+        {
+            if (!isTyped(f.instructions[k].op) && f.instructions[k].op != OP_CALL)
+                p.real[k] = groupVote[root(k)] > 0;
+        }
+    }
+
+    static bool definesReal(uint16_t op) { return op == OP_I2R || (op >= OP_ADDR && op <= OP_NEGR); }
+    static bool definesInteger(uint16_t op) { return (op >= OP_ADDI && op <= OP_NEGI) || (op >= OP_EQI && op <= OP_NOT); }
+    static bool isTyped(uint16_t op) { return definesReal(op) || definesInteger(op); }
+    static bool readsReal(uint16_t op) { return (op >= OP_ADDR && op <= OP_NEGR) || (op >= OP_EQR && op <= OP_LER); }
+
+    void allocateRegisters()
+    {
+        Plan &p = *current;
+        const SsaFunction &f = p.function;
+        const BytecodeFunction &bytecode = module.functions[f.index];
+        size_t count = f.instructions.size();
+        p.location.assign(count, Location());
+        p.saveSlot.assign(count, UINT32_MAX);
+        p.frame = bytecode.frameSize;
+
+        vector<uint32_t> order;
+        vector<vector<uint32_t>> partners(count); // phi operands and phis, which like one register
+        for (uint32_t block : f.layout)
+        {
+            for (uint32_t index : f.blocks[block].code)
+            {
+                if (!f.instructions[index].defines)
+                    continue;
+                order.push_back(index);
+                if (f.instructions[index].op == SSA_PHI)
+                {
+                    forEachOperand(f, index, [&](uint32_t operand) {
+                        partners[index].push_back(operand);
+                        partners[operand].push_back(index);
+                    });
+                }
+            }
+        }
+        sort(order.begin(), order.end(), [&](uint32_t x, uint32_t y) {
+            return p.first[x] != p.first[y] ? p.first[x] < p.first[y] : x < y;
+        });
+
+        vector<uint8_t> freeGeneral(begin(generalRegisters), end(generalRegisters));
+        vector<uint8_t> freeXmm(begin(xmmRegisters), end(xmmRegisters));
+        vector<uint32_t> active;
+        auto pool = [&](uint32_t value) -> vector<uint8_t> & { return p.real[value] ? freeXmm : freeGeneral; };
+        for (uint32_t value : order)
+        {
+            statistics.values++;
+            for (size_t k = 0; k < active.size();)
+            {
+                uint32_t other = active[k];
+                if (p.last[other] <= p.first[value])
+                {
+                    pool(other).push_back((uint8_t)p.location[other].where);
+                    active[k] = active.back();
+                    active.pop_back();
+                }
+                else
+                    k++;
+            }
+            vector<uint8_t> &registers = pool(value);
+            LocationKind kind = p.real[value] ? IN_XMM : IN_GPR;
+            if (!registers.empty())
+            {
+                // A register a phi partner had, when it is free, saves a copy
+                size_t pick = registers.size() - 1;
+                for (uint32_t partner : partners[value])
+                {
+                    if (p.location[partner].kind != kind)
+                        continue;
+                    auto found = find(registers.begin(), registers.end(), (uint8_t)p.location[partner].where);
+                    if (found != registers.end())
+                    {
+                        pick = found - registers.begin();
+                        break;
+                    }
+                }
+                p.location[value] = Location{kind, registers[pick]};
+                registers.erase(registers.begin() + pick);
+                active.push_back(value);
+                continue;
+            }
+            // No register left: the value that lives longest goes to memory
+            uint32_t victim = value;
+            for (uint32_t other : active)
+            {
+                if (p.real[other] == p.real[value] && p.last[other] > p.last[victim])
+                    victim = other;
+            }
+            if (victim != value)
+            {
+                p.location[value] = p.location[victim];
+                active.erase(find(active.begin(), active.end(), victim));
+                active.push_back(value);
+            }
+            spill(victim);
+        }
+    }
+
+    void spill(uint32_t value)
+    {
+        Plan &p = *current;
+        const SsaInstruction &instruction = p.function.instructions[value];
+        statistics.spilled++;
+        // A scalar parameter's own register is free once it has been read
+        if (instruction.op == SSA_ENTRY)
+            p.location[value] = Location{IN_SLOT, instruction.reg};
+        else
+            p.location[value] = Location{IN_SLOT, p.frame++};
+    }
+
+    // Registers live across a call or an output helper are saved in a slot of their own
+    void findSaves()
+    {
+        Plan &p = *current;
+        const SsaFunction &f = p.function;
+        p.saves.assign(f.instructions.size(), {});
+        vector<pair<uint32_t, uint32_t>> calls; // position, instruction
+        for (uint32_t block : f.layout)
+        {
+            for (uint32_t index : f.blocks[block].code)
+            {
+                uint16_t op = f.instructions[index].op;
+                if (op == OP_CALL || op == OP_WRITEI || op == OP_WRITER || op == OP_WRITELN)
+                    calls.push_back({p.position[index], index});
+            }
+        }
+        for (uint32_t value = 0; value < f.instructions.size(); value++)
+        {
+            const Location &location = p.location[value];
+            if (location.kind != IN_GPR && location.kind != IN_XMM)
+                continue;
+            auto k = upper_bound(calls.begin(), calls.end(), make_pair(p.first[value], UINT32_MAX));
+            for (; k != calls.end() && k->first < p.last[value]; ++k)
+            {
+                // The helpers keep RBX and R12, as the C calling convention asks
+                bool helper = f.instructions[k->second].op != OP_CALL;
+                if (helper && location.kind == IN_GPR && (location.where == RBX || location.where == R12))
+                    continue;
+                if (p.saveSlot[value] == UINT32_MAX)
+                {
+                    p.saveSlot[value] = p.frame++;
+                    statistics.saved++;
+                }
+                p.saves[k->second].push_back(value);
+            }
+        }
+    }
+
+    // --- Code ---
+
+    static X86Operand reg(uint8_t r) { return X86Operand::registerOperand(r); }
+    static X86Operand slot(uint32_t k) { return X86Operand::at(RBP, (int32_t)(k * 8)); }
+
+    const Location &where(uint32_t value) const { return current->location[value]; }
+
+    X86Operand home(uint32_t value) const
+    {
+        const Location &location = where(value);
+        return location.kind == IN_SLOT ? slot(location.where) : reg((uint8_t)location.where);
+    }
+
+    // The value as an integer operand; an XMM value is moved to scratch first
+    X86Operand integerOperand(uint32_t value, uint8_t scratch)
+    {
+        if (where(value).kind == IN_XMM)
+        {
+            as.movqFromXmm(reg(scratch), (uint8_t)where(value).where);
+            return reg(scratch);
+        }
+        return home(value);
+    }
+
+    uint8_t integerRegister(uint32_t value, uint8_t scratch)
+    {
+        if (where(value).kind == IN_GPR)
+            return (uint8_t)where(value).where;
+        as.mov(scratch, integerOperand(value, scratch));
+        return scratch;
+    }
+
+    X86Operand realOperand(uint32_t value, uint8_t scratch)
+    {
+        if (where(value).kind == IN_GPR)
+        {
+            as.movqToXmm(scratch, home(value));
+            return reg(scratch);
+        }
+        return home(value);
+    }
+
+    uint8_t realRegister(uint32_t value, uint8_t scratch)
+    {
+        if (where(value).kind == IN_XMM)
+            return (uint8_t)where(value).where;
+        as.movsd(scratch, realOperand(value, scratch));
+        return scratch;
+    }
+
+    uint8_t integerTarget(uint32_t value) const { return where(value).kind == IN_GPR ? (uint8_t)where(value).where : (uint8_t)RAX; }
+    uint8_t realTarget(uint32_t value) const { return where(value).kind == IN_XMM ? (uint8_t)where(value).where : XMM0; }
+
+    void setInteger(uint32_t value, uint8_t from)
+    {
+        const Location &location = where(value);
+        if (location.kind == IN_XMM)
+            as.movqToXmm((uint8_t)location.where, reg(from));
+        else if (location.kind == IN_SLOT)
+            as.store(home(value), from);
+        else
+            as.mov((uint8_t)location.where, reg(from));
+    }
+
+    void setReal(uint32_t value, uint8_t from)
+    {
+        const Location &location = where(value);
+        if (location.kind == IN_GPR)
+            as.movqFromXmm(home(value), from);
+        else if (location.kind == IN_SLOT)
+            as.storeSd(home(value), from);
+        else
+            as.movsd((uint8_t)location.where, reg(from));
+    }
+
+    // Memory to a value and back; RDX carries slot to slot
+    void load(uint32_t value, const X86Operand &memory)
+    {
+        const Location &location = where(value);
+        if (location.kind == IN_GPR)
+            as.mov((uint8_t)location.where, memory);
+        else if (location.kind == IN_XMM)
+            as.movsd((uint8_t)location.where, memory);
+        else
+        {
+            as.mov(RDX, memory);
+            as.store(home(value), RDX);
+        }
+    }
+
+    void storeTo(const X86Operand &memory, uint32_t value)
+    {
+        const Location &location = where(value);
+        if (location.kind == IN_GPR)
+            as.store(memory, (uint8_t)location.where);
+        else if (location.kind == IN_XMM)
+            as.storeSd(memory, (uint8_t)location.where);
+        else
+        {
+            as.mov(RDX, home(value));
+            as.store(memory, RDX);
+        }
+    }
+
+    bool smallConstant(uint32_t value, int32_t &result) const
+    {
+        const SsaInstruction &instruction = current->function.instructions[value];
+        if (instruction.op != SSA_CONST || instruction.constant.i < INT32_MIN || instruction.constant.i > INT32_MAX)
+            return false;
+        result = (int32_t)instruction.constant.i;
+        return true;
+    }
+
+    // A run-time error at the end of the function, one per kind, line and bound
+    uint32_t failure(NativeError kind, uint32_t line, int32_t low = 0)
+    {
+        auto key = make_tuple((uint32_t)kind, line, low);
+        auto found = failures.find(key);
+        if (found != failures.end())
+            return found->second;
+        uint32_t label = as.newLabel();
+        failures[key] = label;
+        return label;
+    }
+
+    void emitFailures()
+    {
+        for (auto &[key, label] : failures)
+        {
+            auto [kind, line, low] = key;
+            as.bind(label);
+            if (kind == NATIVE_INDEX_OUT_OF_BOUNDS)
+                as.lea(RCX, X86Operand::at(RAX, low)); // the index, from the offset in RAX
+            as.mov(RDI, reg(R13));
+            as.movImmediate(RSI, line);
+            as.movImmediate(RDX, kind);
+            as.arithmeticImmediate(X86_AND, reg(RSP), -16);
+            as.callAbsolute((const void *)&nativeFail);
+        }
+        failures.clear();
+    }
+
+    // Calls a C++ helper with RSP aligned to 16 bytes, whatever it was
+    void callHelper(const void *helper)
+    {
+        as.mov(R11, reg(RSP));
+        as.arithmeticImmediate(X86_AND, reg(RSP), -16);
+        as.arithmeticImmediate(X86_SUB, reg(RSP), 16);
+        as.store(X86Operand::at(RSP, 0), R11);
+        as.callAbsolute(helper);
+        as.mov(RSP, X86Operand::at(RSP, 0));
+    }
+
+    // Slots to slots, through RAX; long runs as a loop counting RDX down
+    void copySlots(uint8_t toBase, int64_t to, uint8_t fromBase, int64_t from, uint32_t count)
+    {
+        if (count <= 4)
+        {
+            for (uint32_t k = 0; k < count; k++)
+            {
+                as.mov(RAX, X86Operand::at(fromBase, (int32_t)((from + k) * 8)));
+                as.store(X86Operand::at(toBase, (int32_t)((to + k) * 8)), RAX);
+            }
+            return;
+        }
+        as.movImmediate(RDX, count);
+        uint32_t loop = as.newLabel();
+        as.bind(loop);
+        as.mov(RAX, X86Operand::at(fromBase, (int32_t)(from * 8 - 8), RDX));
+        as.store(X86Operand::at(toBase, (int32_t)(to * 8 - 8), RDX), RAX);
+        as.arithmeticImmediate(X86_SUB, reg(RDX), 1);
+        as.jcc(CC_NE, loop);
+    }
+
+    void zeroSlots(uint32_t from, uint32_t count)
+    {
+        as.movImmediate(RAX, 0);
+        if (count <= 4)
+        {
+            for (uint32_t k = 0; k < count; k++)
+                as.store(slot(from + k), RAX);
+            return;
+        }
+        as.movImmediate(RDX, count);
+        uint32_t loop = as.newLabel();
+        as.bind(loop);
+        as.store(X86Operand::at(RBP, (int32_t)(from * 8 - 8), RDX), RAX);
+        as.arithmeticImmediate(X86_SUB, reg(RDX), 1);
+        as.jcc(CC_NE, loop);
+    }
+
+    // Saves the callee-saved registers of the C convention, sets up R13, R14, R15 and RBP, runs the main program
+    void emitEntry()
+    {
+        for (uint8_t r : {RBX, RBP, R12, R13, R14, R15})
+            as.push(r);
+        as.arithmeticImmediate(X86_SUB, reg(RSP), 8);
+        as.mov(R13, reg(RDI));
+        as.mov(R14, X86Operand::at(R13, (int32_t)offsetof(NativeContext, bottom)));
+        as.mov(R15, X86Operand::at(R13, (int32_t)offsetof(NativeContext, globals)));
+        as.mov(RBP, reg(R15));
+        as.call(functionLabels[module.main]);
+        as.arithmeticImmediate(X86_ADD, reg(RSP), 8);
+        for (uint8_t r : {R15, R14, R13, R12, RBP, RBX})
+            as.pop(r);
+        as.ret();
+    }
+
+    void emitFunction(uint32_t index)
+    {
+        current = &plans[index];
+        const SsaFunction &f = current->function;
+        blockLabels.assign(f.blocks.size(), 0);
+        for (uint32_t block : f.layout)
+            blockLabels[block] = as.newLabel();
+
+        // The VM starts frames at zero; only what stays in memory needs it here
+        if (index != module.main)
+        {
+            vector<bool> zero(module.functions[index].frameSize, false);
+            for (uint32_t r = module.functions[index].parameterSlots; r < f.registers; r++)
+                zero[r] = f.isPinned(r);
+            for (uint32_t array : f.localArrays)
+            {
+                const ArrayInfo &info = module.arrays[array];
+                fill(zero.begin() + info.offset, zero.begin() + info.offset + info.count, true);
+            }
+            for (uint32_t k = 0; k < zero.size();)
+            {
+                uint32_t end = k;
+                while (end < zero.size() && zero[end])
+                    end++;
+                if (end > k)
+                    zeroSlots(k, end - k);
+                k = end + 1;
+            }
+        }
+
+        for (size_t position = 0; position < f.layout.size(); position++)
+        {
+            uint32_t block = f.layout[position];
+            nextBlock = position + 1 < f.layout.size() ? f.layout[position + 1] : ssaNone;
+            as.bind(blockLabels[block]);
+            const vector<uint32_t> &code = f.blocks[block].code;
+            for (size_t k = 0; k < code.size(); k++)
+            {
+                // A compare that only decides the branch right after it becomes the branch's flags
+                const SsaInstruction &instruction = f.instructions[code[k]];
+                if (k + 1 < code.size() && fusable(instruction.op) && current->uses[code[k]] == 1 &&
+                    f.instructions[code[k + 1]].op == SSA_BRANCH && f.instructions[code[k + 1]].a == code[k])
+                    continue;
+                emitInstruction(code[k], block);
+            }
+        }
+        emitFailures();
+    }
+
+    static bool fusable(uint16_t op) { return (op >= OP_EQI && op <= OP_LEI) || op == OP_LTR || op == OP_LER; }
+
+    // Sets the flags for a compare; returns the condition under which it holds
+    X86Condition compare(const SsaInstruction &instruction)
+    {
+        switch (instruction.op)
+        {
+        case OP_LTR:
+        case OP_LER:
+        case OP_EQR:
+        case OP_NER:
+        {
+            // b > a rather than a < b, so an unordered compare counts as false
+            bool swapped = instruction.op == OP_LTR || instruction.op == OP_LER;
+            uint32_t x = swapped ? instruction.b : instruction.a, y = swapped ? instruction.a : instruction.b;
+            uint8_t left = realRegister(x, XMM0);
+            as.ucomisd(left, realOperand(y, XMM1));
+            return instruction.op == OP_LTR ? CC_A : instruction.op == OP_LER ? CC_AE : instruction.op == OP_EQR ? CC_E : CC_NE;
+        }
+        default:
+        {
+            int32_t constant;
+            if (smallConstant(instruction.b, constant))
+                as.arithmeticImmediate(X86_CMP, integerOperand(instruction.a, R11), constant);
+            else
+            {
+                uint8_t left = integerRegister(instruction.a, RAX);
+                as.arithmetic(X86_CMP, left, integerOperand(instruction.b, R11));
+            }
+            static const X86Condition conditions[] = {CC_E, CC_NE, CC_L, CC_LE};
+            return conditions[instruction.op - OP_EQI];
+        }
+        }
+    }
+
+    // Jumps to successors[0] on the condition, to successors[1] otherwise, falling through where it can
+    void branch(X86Condition condition, uint32_t block)
+    {
+        const uint32_t *successors = current->function.blocks[block].successors;
+        if (successors[1] == nextBlock)
+            as.jcc(condition, blockLabels[successors[0]]);
+        else if (successors[0] == nextBlock)
+            as.jcc(inverse(condition), blockLabels[successors[1]]);
+        else
+        {
+            as.jcc(condition, blockLabels[successors[0]]);
+            as.jmp(blockLabels[successors[1]]);
+        }
+    }
+
+    // An element of an array; checks the index unless it is a constant within bounds
+    X86Operand element(uint32_t array, uint32_t index, uint8_t base, uint32_t line)
+    {
+        const ArrayInfo &info = module.arrays[array];
+        int32_t constant;
+        if (smallConstant(index, constant) && (uint64_t)((int64_t)constant - info.low) < info.count)
+            return X86Operand::at(base, (int32_t)((info.offset + (int64_t)constant - info.low) * 8));
+        as.mov(RAX, integerOperand(index, RAX));
+        if (info.low != 0)
+            as.arithmeticImmediate(X86_SUB, reg(RAX), info.low);
+        as.arithmeticImmediate(X86_CMP, reg(RAX), (int32_t)info.count);
+        as.jcc(CC_AE, failure(NATIVE_INDEX_OUT_OF_BOUNDS, line, info.low));
+        return X86Operand::at(base, (int32_t)(info.offset * 8), RAX);
+    }
+
+    void saveAround(uint32_t index, bool restore)
+    {
+        for (uint32_t value : current->saves[index])
+        {
+            const Location &location = where(value);
+            X86Operand saved = slot(current->saveSlot[value]);
+            if (location.kind == IN_GPR)
+                restore ? as.mov((uint8_t)location.where, saved) : as.store(saved, (uint8_t)location.where);
+            else
+                restore ? as.movsd((uint8_t)location.where, saved) : as.storeSd(saved, (uint8_t)location.where);
+        }
+    }
+
+    void emitInstruction(uint32_t index, uint32_t block)
+    {
+        const SsaFunction &f = current->function;
+        const SsaInstruction &instruction = f.instructions[index];
+        uint16_t op = instruction.op;
+        switch (op)
+        {
+        case SSA_PHI:
+            break;
+        case SSA_CONST:
+        {
+            int64_t value = instruction.constant.i;
+            const Location &location = where(index);
+            if (location.kind == IN_GPR)
+                as.movImmediate((uint8_t)location.where, value);
+            else if (location.kind == IN_XMM && value == 0)
+                as.xorpd((uint8_t)location.where, home(index));
+            else if (location.kind == IN_XMM)
+            {
+                as.movImmediate(RAX, value);
+                as.movqToXmm((uint8_t)location.where, reg(RAX));
+            }
+            else if (value >= INT32_MIN && value <= INT32_MAX)
+                as.storeImmediate(home(index), (int32_t)value);
+            else
+            {
+                as.movImmediate(RAX, value);
+                as.store(home(index), RAX);
+            }
+            break;
+        }
+        case SSA_ENTRY:
+            if (!(where(index).kind == IN_SLOT && where(index).where == instruction.reg))
+                load(index, slot(instruction.reg));
+            break;
+        case SSA_GETR:
+            load(index, slot(instruction.reg));
+            break;
+        case SSA_SETR:
+            storeTo(slot(instruction.reg), instruction.a);
+            break;
+        case OP_GETG:
+            load(index, X86Operand::at(R15, (int32_t)(instruction.c * 8)));
+            break;
+        case OP_SETG:
+            storeTo(X86Operand::at(R15, (int32_t)(instruction.c * 8)), instruction.a);
+            break;
+        case OP_GETEL:
+        case OP_GETEG:
+            load(index, element(instruction.c, instruction.a, op == OP_GETEL ? RBP : R14, instruction.line));
+            break;
+        case OP_SETEL:
+        case OP_SETEG:
+            storeTo(element(instruction.c, instruction.b, op == OP_SETEL ? RBP : R14, instruction.line), instruction.a);
+            break;
+        case OP_COPYL:
+        case OP_COPYG:
+        {
+            const ArrayInfo &info = module.arrays[instruction.c];
+            copySlots(RBP, instruction.reg, op == OP_COPYL ? RBP : R14, info.offset, info.count);
+            break;
+        }
+        case OP_I2R:
+        {
+            X86Operand from = integerOperand(instruction.a, R11);
+            uint8_t to = realTarget(index);
+            as.xorpd(to, reg(to));
+            as.cvtsi2sd(to, from);
+            setReal(index, to);
+            break;
+        }
+        case OP_ADDI:
+        case OP_SUBI:
+        case OP_MULI:
+            integerArithmetic(index);
+            break;
+        case OP_DIVI:
+        case OP_MODI:
+            divide(index);
+            break;
+        case OP_NEGI:
+        {
+            uint8_t to = integerTarget(index);
+            as.mov(to, integerOperand(instruction.a, R11));
+            as.neg(reg(to));
+            setInteger(index, to);
+            break;
+        }
+        case OP_ADDR:
+        case OP_SUBR:
+        case OP_MULR:
+        case OP_DIVR:
+            realArithmetic(index);
+            break;
+        case OP_NEGR:
+        {
+            uint8_t to = realTarget(index);
+            as.movsd(to, realOperand(instruction.a, XMM1));
+            as.movImmediate(RAX, INT64_MIN);
+            as.movqToXmm(XMM1, reg(RAX));
+            as.xorpd(to, reg(XMM1));
+            setReal(index, to);
+            break;
+        }
+        case OP_EQI:
+        case OP_NEI:
+        case OP_LTI:
+        case OP_LEI:
+        case OP_LTR:
+        case OP_LER:
+            as.setcc(compare(instruction), RAX);
+            as.movzxByte(integerTarget(index), RAX);
+            setInteger(index, integerTarget(index));
+            break;
+        case OP_EQR:
+        case OP_NER:
+            // Unordered sets the parity flag: never equal
+            compare(instruction);
+            as.setcc(op == OP_EQR ? CC_E : CC_NE, RAX);
+            as.setcc(op == OP_EQR ? CC_NP : CC_P, RDX);
+            op == OP_EQR ? as.andByte(RAX, RDX) : as.orByte(RAX, RDX);
+            as.movzxByte(integerTarget(index), RAX);
+            setInteger(index, integerTarget(index));
+            break;
+        case OP_AND:
+        case OP_OR:
+            as.arithmeticImmediate(X86_CMP, integerOperand(instruction.a, R11), 0);
+            as.setcc(CC_NE, RAX);
+            as.arithmeticImmediate(X86_CMP, integerOperand(instruction.b, R11), 0);
+            as.setcc(CC_NE, RDX);
+            op == OP_AND ? as.andByte(RAX, RDX) : as.orByte(RAX, RDX);
+            as.movzxByte(integerTarget(index), RAX);
+            setInteger(index, integerTarget(index));
+            break;
+        case OP_NOT:
+            as.arithmeticImmediate(X86_CMP, integerOperand(instruction.a, R11), 0);
+            as.setcc(CC_E, RAX);
+            as.movzxByte(integerTarget(index), RAX);
+            setInteger(index, integerTarget(index));
+            break;
+        case OP_CALL:
+            call(index);
+            break;
+        case OP_WRITEI:
+        case OP_WRITER:
+        case OP_WRITELN:
+            saveAround(index, false);
+            if (op == OP_WRITEI)
+                as.mov(RSI, integerOperand(instruction.a, RSI));
+            else if (op == OP_WRITER)
+                as.movsd(XMM0, realOperand(instruction.a, XMM0));
+            as.mov(RDI, reg(R13));
+            callHelper(op == OP_WRITEI   ? (const void *)&nativeWriteInteger
+                       : op == OP_WRITER ? (const void *)&nativeWriteReal
+                                         : (const void *)&nativeWriteLine);
+            saveAround(index, true);
+            break;
+        case OP_RET:
+            if (f.returnsValue)
+                as.mov(RAX, integerOperand(instruction.a, RAX));
+            as.ret();
+            break;
+        case OP_HALT:
+            as.ret();
+            break;
+        case OP_JMP:
+        {
+            uint32_t successor = f.blocks[block].successors[0];
+            phiCopies(block, successor);
+            if (successor != nextBlock)
+                as.jmp(blockLabels[successor]);
+            break;
+        }
+        case SSA_BRANCH:
+        {
+            const SsaInstruction &condition = f.instructions[instruction.a];
+            if (fusable(condition.op) && current->uses[instruction.a] == 1 && condition.block == block)
+                branch(compare(condition), block);
+            else
+            {
+                if (where(instruction.a).kind == IN_GPR)
+                    as.test((uint8_t)where(instruction.a).where, home(instruction.a));
+                else
+                    as.arithmeticImmediate(X86_CMP, integerOperand(instruction.a, R11), 0);
+                branch(CC_NE, block);
+            }
+            break;
+        }
+        default:
+            throw runtime_error(string("no native code for ") + ssaOpName(op));
+        }
+    }
+
+    void integerArithmetic(uint32_t index)
+    {
+        const SsaInstruction &instruction = current->function.instructions[index];
+        X86Arithmetic kind = instruction.op == OP_ADDI ? X86_ADD : X86_SUB;
+        bool multiply = instruction.op == OP_MULI;
+        uint8_t to = integerTarget(index);
+        int32_t constant;
+        if (smallConstant(instruction.b, constant))
+        {
+            if (multiply)
+                as.imulImmediate(to, integerOperand(instruction.a, R11), constant);
+            else
+            {
+                as.mov(to, integerOperand(instruction.a, R11));
+                as.arithmeticImmediate(kind, reg(to), constant);
+            }
+        }
+        else if (where(instruction.b).kind == IN_GPR && where(instruction.b).where == to &&
+                 instruction.a != instruction.b)
+        {
+            // The target holds the right operand
+            if (instruction.op == OP_SUBI)
+            {
+                as.mov(RAX, integerOperand(instruction.a, RAX));
+                as.arithmetic(kind, RAX, reg(to));
+                to = RAX;
+            }
+            else if (multiply)
+                as.imul(to, integerOperand(instruction.a, R11));
+            else
+                as.arithmetic(kind, to, integerOperand(instruction.a, R11));
+        }
+        else
+        {
+            as.mov(to, integerOperand(instruction.a, R11));
+            if (multiply)
+                as.imul(to, integerOperand(instruction.b, R11));
+            else
+                as.arithmetic(kind, to, integerOperand(instruction.b, R11));
+        }
+        setInteger(index, to);
+    }
+
+    // div and mod as the VM does them: a zero divisor fails, -1 wraps instead of trapping
+    void divide(uint32_t index)
+    {
+        const SsaInstruction &instruction = current->function.instructions[index];
+        bool quotient = instruction.op == OP_DIVI;
+        int32_t constant;
+        if (smallConstant(instruction.b, constant) && constant != 0)
+        {
+            if (constant == -1)
+            {
+                uint8_t to = integerTarget(index);
+                if (quotient)
+                {
+                    as.mov(to, integerOperand(instruction.a, R11));
+                    as.neg(reg(to));
+                }
+                else
+                    as.movImmediate(to, 0);
+                setInteger(index, to);
+                return;
+            }
+            as.mov(RAX, integerOperand(instruction.a, RAX));
+            as.movImmediate(R11, constant);
+            as.cqo();
+            as.idiv(reg(R11));
+            setInteger(index, quotient ? RAX : RDX);
+            return;
+        }
+        uint8_t divisor = integerRegister(instruction.b, R11);
+        as.mov(RAX, integerOperand(instruction.a, RAX));
+        as.test(divisor, reg(divisor));
+        as.jcc(CC_E, failure(NATIVE_DIVISION_BY_ZERO, instruction.line));
+        uint32_t minusOne = as.newLabel(), done = as.newLabel();
+        as.arithmeticImmediate(X86_CMP, reg(divisor), -1);
+        as.jcc(CC_E, minusOne);
+        as.cqo();
+        as.idiv(reg(divisor));
+        as.jmp(done);
+        as.bind(minusOne);
+        if (quotient)
+            as.neg(reg(RAX));
+        else
+            as.movImmediate(RDX, 0);
+        as.bind(done);
+        setInteger(index, quotient ? RAX : RDX);
+    }
+
+    void realArithmetic(uint32_t index)
+    {
+        const SsaInstruction &instruction = current->function.instructions[index];
+        static const X86Sse kinds[] = {SSE_ADD, SSE_SUB, SSE_MUL, SSE_DIV};
+        X86Sse kind = kinds[instruction.op - OP_ADDR];
+        if (instruction.op == OP_DIVR)
+        {
+            const SsaInstruction &divisor = current->function.instructions[instruction.b];
+            if (divisor.op != SSA_CONST || divisor.constant.r == 0)
+            {
+                uint8_t x = realRegister(instruction.b, XMM1);
+                as.xorpd(XMM0, reg(XMM0));
+                as.ucomisd(XMM0, reg(x));
+                uint32_t nonzero = as.newLabel();
+                as.jcc(CC_P, nonzero);
+                as.jcc(CC_E, failure(NATIVE_DIVISION_BY_ZERO, instruction.line));
+                as.bind(nonzero);
+            }
+        }
+        uint8_t to = realTarget(index);
+        if (where(instruction.b).kind == IN_XMM && where(instruction.b).where == to && instruction.a != instruction.b)
+        {
+            if (instruction.op == OP_ADDR || instruction.op == OP_MULR)
+                as.sse(kind, to, realOperand(instruction.a, XMM1));
+            else
+            {
+                as.movsd(XMM0, realOperand(instruction.a, XMM1));
+                as.sse(kind, XMM0, reg(to));
+                to = XMM0;
+            }
+        }
+        else
+        {
+            as.movsd(to, realOperand(instruction.a, XMM1));
+            as.sse(kind, to, realOperand(instruction.b, XMM1));
+        }
+        setReal(index, to);
+    }
+
+    // Arguments go straight into the callee's frame, just past this one
+    void call(uint32_t index)
+    {
+        const SsaFunction &f = current->function;
+        const SsaInstruction &instruction = f.instructions[index];
+        const BytecodeFunction &callee = module.functions[instruction.c];
+        int64_t next = current->frame;
+        as.lea(RAX, slot((uint32_t)(next + plans[instruction.c].frame)));
+        as.arithmetic(X86_CMP, RAX, X86Operand::at(R13, (int32_t)offsetof(NativeContext, end)));
+        as.jcc(CC_A, failure(NATIVE_STACK_OVERFLOW, instruction.line));
+        as.arithmetic(X86_CMP, RSP, X86Operand::at(R13, (int32_t)offsetof(NativeContext, stackLimit)));
+        as.jcc(CC_B, failure(NATIVE_STACK_OVERFLOW, instruction.line));
+
+        saveAround(index, false);
+        uint32_t argument = 0;
+        for (uint32_t k = 0; k < callee.parameterSlots;)
+        {
+            if (!f.isPinned(instruction.reg + k))
+            {
+                storeTo(slot((uint32_t)(next + k)), f.operands[instruction.a + argument++]);
+                k++;
+                continue;
+            }
+            uint32_t end = k;
+            while (end < callee.parameterSlots && f.isPinned(instruction.reg + end))
+                end++;
+            copySlots(RBP, next + k, RBP, instruction.reg + k, end - k);
+            k = end;
+        }
+        as.arithmeticImmediate(X86_ADD, reg(RBP), (int32_t)(next * 8));
+        as.call(functionLabels[instruction.c]);
+        as.arithmeticImmediate(X86_SUB, reg(RBP), (int32_t)(next * 8));
+        if (instruction.defines)
+            setInteger(index, RAX);
+        saveAround(index, true);
+    }
+
+    // The copies a jump makes for the phis of its target, all at once
+    void phiCopies(uint32_t block, uint32_t successor)
+    {
+        const SsaFunction &f = current->function;
+        const SsaBlock &next = f.blocks[successor];
+        size_t phis = f.phiCount(successor);
+        if (phis == 0)
+            return;
+        size_t at = find(next.predecessors.begin(), next.predecessors.end(), block) - next.predecessors.begin();
+        vector<pair<Location, Location>> pending; // to, from
+        for (size_t k = 0; k < phis; k++)
+        {
+            uint32_t phi = next.code[k];
+            Location to = where(phi), from = where(f.operands[f.instructions[phi].a + at]);
+            if (!(to == from))
+                pending.push_back({to, from});
+        }
+        const Location scratch{IN_GPR, R11};
+        while (!pending.empty())
+        {
+            bool progress = false;
+            for (size_t k = 0; k < pending.size(); k++)
+            {
+                Location to = pending[k].first;
+                bool read = any_of(pending.begin(), pending.end(), [&](auto &copy) { return copy.second == to; });
+                if (read)
+                    continue;
+                move(to, pending[k].second);
+                pending.erase(pending.begin() + k);
+                progress = true;
+                break;
+            }
+            if (progress)
+                continue;
+            // A cycle: one target goes to R11 first
+            Location to = pending[0].first;
+            move(scratch, to);
+            for (auto &copy : pending)
+            {
+                if (copy.second == to)
+                    copy.second = scratch;
+            }
+        }
+    }
+
+    void move(const Location &to, const Location &from)
+    {
+        X86Operand source = from.kind == IN_SLOT ? slot(from.where) : reg((uint8_t)from.where);
+        X86Operand target = to.kind == IN_SLOT ? slot(to.where) : reg((uint8_t)to.where);
+        if (to.kind == IN_GPR)
+            from.kind == IN_XMM ? as.movqFromXmm(target, (uint8_t)from.where) : as.mov((uint8_t)to.where, source);
+        else if (to.kind == IN_XMM)
+            from.kind == IN_GPR ? as.movqToXmm((uint8_t)to.where, source) : as.movsd((uint8_t)to.where, source);
+        else if (from.kind == IN_GPR)
+            as.store(target, (uint8_t)from.where);
+        else if (from.kind == IN_XMM)
+            as.storeSd(target, (uint8_t)from.where);
+        else
+        {
+            as.mov(RDX, source);
+            as.store(target, RDX);
+        }
+    }
+
+    const BytecodeModule &module;
+    uint32_t passes;
+    X86Assembler as;
+    vector<Plan> plans;
+    Plan *current = nullptr;
+    vector<uint32_t> functionLabels, blockLabels;
+    uint32_t nextBlock = ssaNone;
+    map<tuple<uint32_t, uint32_t, int32_t>, uint32_t> failures; // kind, line, low bound: label
+    NativeStatistics statistics;
+};
+
+// Runs a NativeProgram; the counterpart of VirtualMachine
+class NativeMachine
+{
+public:
+    // machineStack is how deep native calls may take the thread's own stack
+    explicit NativeMachine(size_t stackSlots = 1 << 22, size_t machineStack = 1 << 22)
+        : stack(stackSlots), machineStack(machineStack)
+    {
+    }
+
+    void run(const NativeProgram &program, ostream &out)
+    {
+        Value *bottom = stack.data();
+        Value *globals = bottom + program.globalArraySlots;
+        if (globals + program.mainFrame > bottom + stack.size())
+            throw runtime_error("global variables do not fit in the VM stack");
+        memset((void *)bottom, 0, (program.globalArraySlots + program.mainFrame) * sizeof(Value));
+        NativeContext context;
+        context.bottom = bottom;
+        context.globals = globals;
+        context.end = bottom + stack.size();
+        context.stackLimit = (uintptr_t)__builtin_frame_address(0) - machineStack;
+        context.out = &out;
+        if (setjmp(context.jump) == 0)
+        {
+            program.enter(&context);
+            return;
+        }
+        string message = context.errorKind == NATIVE_DIVISION_BY_ZERO ? "division by zero"
+                         : context.errorKind == NATIVE_STACK_OVERFLOW
+                             ? "stack overflow"
+                             : "array index " + to_string(context.errorValue) + " out of bounds";
+        throw runtime_error("line " + to_string(context.errorLine) + ": " + message);
+    }
+
+private:
+    vector<Value> stack;
+    size_t machineStack;
+};
+
+#endif
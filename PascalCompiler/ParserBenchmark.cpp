@@ -0,0 +1,163 @@
+// Libraries
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include "../Lab2/MappedFile.h"
+#include "../Lab4/IdentifierTable.h"
+#include "../Lab4/PascalLexer.h"
+#include "../Lab4/PascalSourceGenerator.h"
+#include "Arena.h"
+#include "Ast.h"
+#include "PascalParser.h"
+
+using namespace std;
+
+// Parse throughput of PascalParser in lines per second, best of R runs, on a
+// source file or on a generated program. Each run parses into a fresh arena
+// and frees the whole tree with one release. Lexing alone (with interning)
+// is timed on the same source for comparison. --print writes the tree of the
+// source instead.
+//
+// Usage:
+//   ParserBenchmark [source.pas] [--size MB] [--runs R] [--seed N] [--print]
+
+// Structs
+struct ParseRun
+{
+    double seconds = 0;
+    uint32_t nodes = 0;
+    size_t arenaBytes = 0;
+};
+
+// Function Prototypes
+ParseRun parseOnce(const char *data, size_t size);
+double lexOnce(const char *data, size_t size);
+
+// Main Function
+int main(int argc, char *argv[])
+{
+    try
+    {
+        string sourcePath;
+        size_t sizeMb = 16;
+        int runs = 5;
+        uint64_t seed = 1;
+        bool print = false;
+        for (int i = 1; i < argc; i++)
+        {
+            string argument = argv[i];
+            if (argument == "--size" && i + 1 < argc)
+                sizeMb = stoul(argv[++i]);
+            else if (argument == "--runs" && i + 1 < argc)
+                runs = max(1, stoi(argv[++i]));
+            else if (argument == "--seed" && i + 1 < argc)
+                seed = stoull(argv[++i]);
+            else if (argument == "--print")
+                print = true;
+            else
+                sourcePath = argument;
+        }
+
+        MappedFile file;
+        string generated;
+        const char *data;
+        size_t size;
+        if (!sourcePath.empty())
+        {
+            if (!file.open(sourcePath))
+            {
+                cerr << "File could not be opened: " << sourcePath << endl;
+                return 1;
+            }
+            data = file.data();
+            size = file.size();
+        }
+        else
+        {
+            generated = PascalSourceGenerator(seed).generate(sizeMb * 1024 * 1024);
+            data = generated.data();
+            size = generated.size();
+        }
+
+        // Checks the source parses, and shows the tree on request
+        {
+            Arena arena;
+            Ast ast(arena);
+            IdentifierTable identifiers;
+            vector<Diagnostic> diagnostics;
+            PascalParser parser(data, size, identifiers);
+            if (!parser.parse(ast, diagnostics))
+            {
+                for (const Diagnostic &diagnostic : diagnostics)
+                    cerr << (sourcePath.empty() ? "generated" : sourcePath) << ":" << diagnostic.line << ":"
+                         << diagnostic.column << ": " << diagnostic.message << endl;
+                return 1;
+            }
+            if (print)
+            {
+                printAst(cout, ast, identifiers);
+                return 0;
+            }
+        }
+
+        uint64_t lines = count(data, data + size, '\n');
+        ParseRun best;
+        double bestLex = 0;
+        for (int r = 0; r < runs; r++)
+        {
+            ParseRun run = parseOnce(data, size);
+            if (r == 0 || run.seconds < best.seconds)
+                best = run;
+            double seconds = lexOnce(data, size);
+            if (r == 0 || seconds < bestLex)
+                bestLex = seconds;
+        }
+        double megabytes = size / (1024.0 * 1024.0);
+        cout << "Source: " << (sourcePath.empty() ? "generated" : sourcePath) << ", " << size << " bytes, " << lines
+             << " lines" << endl;
+        cout << "Tree: " << best.nodes << " nodes of " << sizeof(AstNode) << " bytes, "
+             << best.arenaBytes / (1024.0 * 1024.0) << " MB of arena" << endl;
+        cout << "Best of " << runs << ", parsing: " << best.seconds * 1000 << " ms, " << lines / best.seconds / 1e6
+             << " M lines/s, " << megabytes / best.seconds << " MB/s" << endl;
+        cout << "Best of " << runs << ", lexing alone: " << bestLex * 1000 << " ms, " << lines / bestLex / 1e6
+             << " M lines/s, " << megabytes / bestLex << " MB/s" << endl;
+        return 0;
+    }
+    catch (exception &e)
+    {
+        cout << "Error occurred: " << e.what() << endl;
+        return 1;
+    }
+}
+
+ParseRun parseOnce(const char *data, size_t size)
+{
+    ParseRun run;
+    auto start = chrono::steady_clock::now();
+    {
+        Arena arena;
+        Ast ast(arena);
+        IdentifierTable identifiers;
+        vector<Diagnostic> diagnostics;
+        PascalParser parser(data, size, identifiers);
+        parser.parse(ast, diagnostics);
+        run.nodes = ast.nodeCount();
+        run.arenaBytes = arena.bytesReserved();
+    }
+    run.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return run;
+}
+
+double lexOnce(const char *data, size_t size)
+{
+    auto start = chrono::steady_clock::now();
+    IdentifierTable identifiers;
+    PascalLexer lexer(data, size, &identifiers);
+    while (lexer.next().kind != TOKEN_EOF)
+    {
+    }
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
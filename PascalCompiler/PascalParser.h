@@ -0,0 +1,704 @@
+// PascalParser.h
+// Recursive-descent parser for the Pascal subset of Lab4/Subset_of_Pascal.txt.
+// It pulls tokens from PascalLexer one at a time and builds an Ast in the
+// caller's arena; identifiers are interned by the lexer on the way.
+//
+// One function per grammar rule, with the left recursion of the grammar
+// turned into loops. Beyond the grammar text it accepts what Pascal itself
+// does and the generated sources use: an if without else, an empty statement
+// before end, array elements inside expressions (table[i] + 1), several
+// declaration groups after one var, and a program without a parameter list.
+//
+// The first syntax error stops the parse and is reported as a Diagnostic.
+//
+// It can also parse a file that is already lexed into TokenRecords, and then
+// record an outline of the token ranges of each subprogram and of the
+// statements directly in each body, and parse one such range again on its
+// own. IncrementalDocument.h uses this to re-parse only the edited part.
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Arena.h"
+#include "Ast.h"
+#include "../Lab4/IdentifierTable.h"
+#include "../Lab4/PascalLexer.h"
+
+using namespace std;
+
+// A lexed token by its place in the text, which stays valid when the text grows
+struct TokenRecord
+{
+    uint32_t offset;
+    uint32_t length;
+    uint32_t line;
+    uint32_t id; // as in Token
+    TokenKind kind;
+};
+
+// Tokens [first, end)
+struct TokenRange
+{
+    uint32_t first;
+    uint32_t end;
+};
+
+// A subprogram, or the program's own begin ... end, with the statements
+// directly inside its body
+struct OutlineUnit
+{
+    TokenRange range;
+    uint32_t slot; // position in the program's declarations; noSlot for the program's body
+    vector<TokenRange> statements;
+
+    static const uint32_t noSlot = UINT32_MAX;
+};
+
+enum PascalFragment : uint8_t
+{
+    FRAGMENT_STATEMENT,
+    FRAGMENT_SUBPROGRAM,
+    FRAGMENT_BODY // the program's compound statement
+};
+
+class PascalParser
+{
+public:
+    PascalParser(const char *data, size_t size, IdentifierTable &identifiers)
+        : lexer(data, size, &identifiers)
+    {
+    }
+
+    // Parses tokens lexed before; records ends with a TOKEN_EOF, and
+    // lineStarts[k] is the offset where line k + 1 starts
+    PascalParser(const char *text, const TokenRecord *records, const uint32_t *lineStarts)
+        : lexer(text, 0), text(text), records(records), lineStarts(lineStarts)
+    {
+    }
+
+    // Returns false, with the error in diagnostics, when the source has a syntax error
+    bool parse(Ast &ast, vector<Diagnostic> &diagnostics, vector<OutlineUnit> *outline = nullptr)
+    {
+        tree = &ast;
+        scratch.clear();
+        depth = 0;
+        this->outline = outline;
+        if (outline != nullptr)
+            outline->clear();
+        try
+        {
+            if (records != nullptr)
+                load(0);
+            else
+                advance();
+            ast.root = parseProgram();
+            return true;
+        }
+        catch (const SyntaxError &error)
+        {
+            diagnostics.push_back(Diagnostic{error.line, error.column, error.message});
+            ast.root = 0;
+            if (outline != nullptr)
+                outline->clear();
+            return false;
+        }
+    }
+
+    // Parses one statement, subprogram or program body that starts at token
+    // first, adding its nodes to ast. On success node is its root and end the
+    // token after it; a statement's or subprogram's unit gets its outline.
+    // Errors are not reported: a fragment that does not parse is re-parsed
+    // with the rest of the file, which reports them in order.
+    bool parseFragment(Ast &ast, PascalFragment what, uint32_t first, uint32_t &node, uint32_t &end,
+                       OutlineUnit *unit = nullptr)
+    {
+        tree = &ast;
+        scratch.clear();
+        depth = 0;
+        outline = nullptr;
+        try
+        {
+            load(first);
+            if (what == FRAGMENT_STATEMENT)
+                node = parseStatement();
+            else if (what == FRAGMENT_SUBPROGRAM)
+                node = parseSubprogram(unit);
+            else
+                node = parseCompound(unit);
+            end = at;
+            return true;
+        }
+        catch (const SyntaxError &)
+        {
+            return false;
+        }
+    }
+
+private:
+    struct SyntaxError
+    {
+        uint32_t line;
+        uint32_t column;
+        string message;
+    };
+
+    // Punctuation as one number: first character, second character << 8
+    static constexpr uint16_t symbol(char first, char second = 0)
+    {
+        return (uint16_t)((unsigned char)first | (unsigned char)second << 8);
+    }
+
+    static const unsigned maxDepth = 1000;
+
+    void advance()
+    {
+        if (records != nullptr)
+        {
+            load(current.kind == TOKEN_EOF ? at : at + 1);
+            return;
+        }
+        current = lexer.next();
+        currentSymbol = 0;
+        if (current.kind == TOKEN_OP || current.kind == TOKEN_DELIM)
+            currentSymbol = symbol(current.lexeme[0], current.lexeme.size() > 1 ? current.lexeme[1] : 0);
+    }
+
+    // Makes records[index] the current token. Columns count from 1, except
+    // the end of file's, as PascalLexer has them.
+    void load(uint32_t index)
+    {
+        at = index;
+        const TokenRecord &record = records[index];
+        uint32_t column = record.offset - lineStarts[record.line - 1] + (record.kind != TOKEN_EOF);
+        string_view lexeme(text + record.offset, record.length);
+        current = Token{record.kind, lexeme, record.line, column, record.id};
+        currentSymbol = 0;
+        if (current.kind == TOKEN_OP || current.kind == TOKEN_DELIM)
+            currentSymbol = symbol(current.lexeme[0], current.lexeme.size() > 1 ? current.lexeme[1] : 0);
+    }
+
+    [[noreturn]] void fail(const string &expected)
+    {
+        string found = current.kind == TOKEN_EOF ? "end of file" : "'" + string(current.lexeme) + "'";
+        throw SyntaxError{current.line, current.column, "expected " + expected + " but found " + found};
+    }
+
+    bool atKeyword(PascalKeyword keyword) const { return current.kind == TOKEN_KEYWORD && current.id == keyword; }
+    bool atSymbol(uint16_t code) const { return currentSymbol == code; }
+
+    void expectKeyword(PascalKeyword keyword, const char *text)
+    {
+        if (!atKeyword(keyword))
+            fail(string("'") + text + "'");
+        advance();
+    }
+
+    void expectSymbol(uint16_t code, const char *text)
+    {
+        if (!atSymbol(code))
+            fail(string("'") + text + "'");
+        advance();
+    }
+
+    uint32_t expectIdentifier()
+    {
+        if (current.kind != TOKEN_ID)
+            fail("an identifier");
+        uint32_t id = current.id;
+        advance();
+        return id;
+    }
+
+    // Lists are gathered on a scratch stack and copied into the tree when complete
+    size_t listStart() const { return scratch.size(); }
+
+    uint32_t listEnd(size_t start)
+    {
+        uint32_t offset = tree->addList(scratch.data() + start, (uint32_t)(scratch.size() - start));
+        scratch.resize(start);
+        return offset;
+    }
+
+    uint32_t node(NodeKind kind, uint32_t line, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0, uint32_t d = 0)
+    {
+        return tree->add(AstNode{kind, 0, 0, 0, line, a, b, c, d});
+    }
+
+    // program id ( identifier_list ) ; declarations subprogram_declarations compound_statement .
+    uint32_t parseProgram()
+    {
+        uint32_t line = current.line;
+        expectKeyword(KEYWORD_PROGRAM, "program");
+        uint32_t name = expectIdentifier();
+        uint32_t parameters = 0;
+        if (atSymbol(symbol('(')))
+        {
+            advance();
+            parameters = parseIdentifierList();
+            expectSymbol(symbol(')'), ")");
+        }
+        expectSymbol(symbol(';'), ";");
+        size_t start = listStart();
+        parseDeclarations();
+        while (atKeyword(KEYWORD_FUNCTION) || atKeyword(KEYWORD_PROCEDURE))
+        {
+            OutlineUnit *unit = startUnit((uint32_t)(scratch.size() - start));
+            uint32_t subprogram = parseSubprogram(unit);
+            scratch.push_back(subprogram);
+            if (unit != nullptr)
+                unit->range.end = at;
+            expectSymbol(symbol(';'), ";");
+        }
+        uint32_t declarations = listEnd(start);
+        OutlineUnit *unit = startUnit(OutlineUnit::noSlot);
+        uint32_t body = parseCompound(unit);
+        if (unit != nullptr)
+            unit->range.end = at;
+        expectSymbol(symbol('.'), ".");
+        if (current.kind != TOKEN_EOF)
+            fail("end of file");
+        return node(NODE_PROGRAM, line, name, parameters, declarations, body);
+    }
+
+    OutlineUnit *startUnit(uint32_t slot)
+    {
+        if (outline == nullptr)
+            return nullptr;
+        outline->push_back(OutlineUnit{TokenRange{at, at}, slot, {}});
+        return &outline->back();
+    }
+
+    uint32_t parseIdentifierList()
+    {
+        size_t start = listStart();
+        scratch.push_back(expectIdentifier());
+        while (atSymbol(symbol(',')))
+        {
+            advance();
+            scratch.push_back(expectIdentifier());
+        }
+        return listEnd(start);
+    }
+
+    // Pushes one VARIABLES node per group onto the scratch stack
+    void parseDeclarations()
+    {
+        while (atKeyword(KEYWORD_VAR))
+        {
+            advance();
+            do
+            {
+                uint32_t line = current.line;
+                uint32_t names = parseIdentifierList();
+                expectSymbol(symbol(':'), ":");
+                uint32_t declaration = node(NODE_VARIABLES, line, names);
+                parseType(declaration);
+                expectSymbol(symbol(';'), ";");
+                scratch.push_back(declaration);
+            } while (current.kind == TOKEN_ID);
+        }
+    }
+
+    AstType parseStandardType()
+    {
+        if (atKeyword(KEYWORD_INTEGER))
+        {
+            advance();
+            return AST_TYPE_INTEGER;
+        }
+        if (atKeyword(KEYWORD_REAL))
+        {
+            advance();
+            return AST_TYPE_REAL;
+        }
+        fail("'integer' or 'real'");
+    }
+
+    // standard_type | array [ num .. num ] of standard_type
+    void parseType(uint32_t declaration)
+    {
+        if (!atKeyword(KEYWORD_ARRAY))
+        {
+            (*tree)[declaration].type = parseStandardType();
+            return;
+        }
+        advance();
+        expectSymbol(symbol('['), "[");
+        int32_t low = parseBound();
+        expectSymbol(symbol('.', '.'), "..");
+        int32_t high = parseBound();
+        expectSymbol(symbol(']'), "]");
+        expectKeyword(KEYWORD_OF, "of");
+        AstType type = parseStandardType();
+        AstNode &node = (*tree)[declaration];
+        node.type = type;
+        node.flags |= NODE_FLAG_ARRAY;
+        node.c = (uint32_t)low;
+        node.d = (uint32_t)high;
+    }
+
+    int32_t parseBound()
+    {
+        int64_t value;
+        if (current.kind != TOKEN_NUM || !parseInteger(current.lexeme, value) || value > INT32_MAX)
+            fail("an integer array bound");
+        advance();
+        return (int32_t)value;
+    }
+
+    // function id arguments : standard_type ; declarations compound_statement
+    // procedure id arguments ; declarations compound_statement
+    uint32_t parseSubprogram(OutlineUnit *unit = nullptr)
+    {
+        uint32_t line = current.line;
+        bool function = atKeyword(KEYWORD_FUNCTION);
+        advance();
+        uint32_t name = expectIdentifier();
+        size_t start = listStart();
+        if (atSymbol(symbol('(')))
+        {
+            advance();
+            for (;;)
+            {
+                uint32_t groupLine = current.line;
+                uint32_t names = parseIdentifierList();
+                expectSymbol(symbol(':'), ":");
+                uint32_t group = node(NODE_PARAMETERS, groupLine, names);
+                parseType(group);
+                scratch.push_back(group);
+                if (!atSymbol(symbol(';')))
+                    break;
+                advance();
+            }
+            expectSymbol(symbol(')'), ")");
+        }
+        uint32_t parameters = listEnd(start);
+        AstType result = AST_TYPE_NONE;
+        if (function)
+        {
+            expectSymbol(symbol(':'), ":");
+            result = parseStandardType();
+        }
+        expectSymbol(symbol(';'), ";");
+        start = listStart();
+        parseDeclarations();
+        uint32_t declarations = listEnd(start);
+        uint32_t body = parseCompound(unit);
+        uint32_t subprogram = node(function ? NODE_FUNCTION : NODE_PROCEDURE, line, name, parameters, declarations, body);
+        (*tree)[subprogram].type = result;
+        return subprogram;
+    }
+
+    // begin optional_statements end; a body's unit gets the range of each statement
+    uint32_t parseCompound(OutlineUnit *unit = nullptr)
+    {
+        uint32_t line = current.line;
+        expectKeyword(KEYWORD_BEGIN, "begin");
+        size_t start = listStart();
+        if (unit != nullptr)
+            unit->statements.clear();
+        if (!atKeyword(KEYWORD_END))
+        {
+            for (;;)
+            {
+                uint32_t first = at;
+                uint32_t statement = parseStatement();
+                scratch.push_back(statement);
+                if (unit != nullptr)
+                    unit->statements.push_back(TokenRange{first, at});
+                if (!atSymbol(symbol(';')))
+                    break;
+                advance();
+                if (atKeyword(KEYWORD_END))
+                    break;
+            }
+        }
+        uint32_t statements = listEnd(start);
+        expectKeyword(KEYWORD_END, "';' or 'end'");
+        return node(NODE_COMPOUND, line, statements);
+    }
+
+    uint32_t parseStatement()
+    {
+        if (++depth > maxDepth)
+            fail("less deeply nested statements");
+        uint32_t line = current.line;
+        uint32_t result;
+        if (current.kind == TOKEN_ID)
+        {
+            uint32_t name = current.id;
+            advance();
+            if (atSymbol(symbol(':', '=')) || atSymbol(symbol('[')))
+            {
+                uint32_t target = node(NODE_NAME, line, name);
+                if (atSymbol(symbol('[')))
+                {
+                    advance();
+                    uint32_t index = parseExpression();
+                    expectSymbol(symbol(']'), "]");
+                    target = node(NODE_INDEX, line, name, index);
+                }
+                expectSymbol(symbol(':', '='), ":=");
+                uint32_t value = parseExpression();
+                result = node(NODE_ASSIGN, line, target, value);
+            }
+            else
+                result = node(NODE_CALL_STATEMENT, line, name, parseOptionalArguments());
+        }
+        else if (atKeyword(KEYWORD_BEGIN))
+            result = parseCompound();
+        else if (atKeyword(KEYWORD_IF))
+        {
+            advance();
+            uint32_t condition = parseExpression();
+            expectKeyword(KEYWORD_THEN, "then");
+            uint32_t then = parseStatement();
+            uint32_t otherwise = 0;
+            if (atKeyword(KEYWORD_ELSE))
+            {
+                advance();
+                otherwise = parseStatement();
+            }
+            result = node(NODE_IF, line, condition, then, otherwise);
+        }
+        else if (atKeyword(KEYWORD_WHILE))
+        {
+            advance();
+            uint32_t condition = parseExpression();
+            expectKeyword(KEYWORD_DO, "do");
+            uint32_t body = parseStatement();
+            result = node(NODE_WHILE, line, condition, body);
+        }
+        else
+            fail("a statement");
+        depth--;
+        return result;
+    }
+
+    // ( expression_list ) or nothing
+    uint32_t parseOptionalArguments()
+    {
+        if (!atSymbol(symbol('(')))
+            return 0;
+        advance();
+        size_t start = listStart();
+        for (;;)
+        {
+            uint32_t argument = parseExpression();
+            scratch.push_back(argument);
+            if (!atSymbol(symbol(',')))
+                break;
+            advance();
+        }
+        expectSymbol(symbol(')'), "')' or ','");
+        return listEnd(start);
+    }
+
+    AstOperator relationalOperator() const
+    {
+        switch (currentSymbol)
+        {
+        case symbol('='):
+            return OPERATOR_EQUAL;
+        case symbol('<', '>'):
+            return OPERATOR_NOT_EQUAL;
+        case symbol('<'):
+            return OPERATOR_LESS;
+        case symbol('<', '='):
+            return OPERATOR_LESS_EQUAL;
+        case symbol('>'):
+            return OPERATOR_GREATER;
+        case symbol('>', '='):
+            return OPERATOR_GREATER_EQUAL;
+        default:
+            return OPERATOR_NONE;
+        }
+    }
+
+    AstOperator addingOperator() const
+    {
+        if (atSymbol(symbol('+')))
+            return OPERATOR_ADD;
+        if (atSymbol(symbol('-')))
+            return OPERATOR_SUBTRACT;
+        if (atKeyword(KEYWORD_OR))
+            return OPERATOR_OR;
+        return OPERATOR_NONE;
+    }
+
+    AstOperator multiplyingOperator() const
+    {
+        if (atSymbol(symbol('*')))
+            return OPERATOR_MULTIPLY;
+        if (atSymbol(symbol('/')))
+            return OPERATOR_DIVIDE;
+        if (atKeyword(KEYWORD_DIV))
+            return OPERATOR_DIV;
+        if (atKeyword(KEYWORD_MOD))
+            return OPERATOR_MOD;
+        if (atKeyword(KEYWORD_AND))
+            return OPERATOR_AND;
+        return OPERATOR_NONE;
+    }
+
+    uint32_t binary(AstOperator op, uint32_t line, uint32_t left, uint32_t right)
+    {
+        uint32_t result = node(NODE_BINARY, line, left, right);
+        (*tree)[result].op = op;
+        return result;
+    }
+
+    // simple_expression [ relop simple_expression ]
+    uint32_t parseExpression()
+    {
+        if (++depth > maxDepth)
+            fail("a less deeply nested expression");
+        uint32_t left = parseSimpleExpression();
+        AstOperator op = relationalOperator();
+        if (op != OPERATOR_NONE)
+        {
+            uint32_t line = current.line;
+            advance();
+            left = binary(op, line, left, parseSimpleExpression());
+        }
+        depth--;
+        return left;
+    }
+
+    // [ sign ] term { addop term }
+    uint32_t parseSimpleExpression()
+    {
+        uint32_t line = current.line;
+        uint32_t left;
+        if (atSymbol(symbol('-')))
+        {
+            advance();
+            left = node(NODE_UNARY, line, parseTerm());
+            (*tree)[left].op = OPERATOR_NEGATE;
+        }
+        else
+        {
+            if (atSymbol(symbol('+')))
+                advance();
+            left = parseTerm();
+        }
+        for (AstOperator op; (op = addingOperator()) != OPERATOR_NONE;)
+        {
+            line = current.line;
+            advance();
+            left = binary(op, line, left, parseTerm());
+        }
+        return left;
+    }
+
+    // factor { mulop factor }
+    uint32_t parseTerm()
+    {
+        uint32_t left = parseFactor();
+        for (AstOperator op; (op = multiplyingOperator()) != OPERATOR_NONE;)
+        {
+            uint32_t line = current.line;
+            advance();
+            left = binary(op, line, left, parseFactor());
+        }
+        return left;
+    }
+
+    // id | id ( expression_list ) | id [ expression ] | num | ( expression ) | not factor
+    uint32_t parseFactor()
+    {
+        uint32_t line = current.line;
+        switch (current.kind)
+        {
+        case TOKEN_ID:
+        {
+            uint32_t name = current.id;
+            advance();
+            if (atSymbol(symbol('(')))
+                return node(NODE_CALL, line, name, parseOptionalArguments());
+            if (atSymbol(symbol('[')))
+            {
+                advance();
+                uint32_t index = parseExpression();
+                expectSymbol(symbol(']'), "]");
+                return node(NODE_INDEX, line, name, index);
+            }
+            return node(NODE_NAME, line, name);
+        }
+        case TOKEN_NUM:
+            return parseNumber();
+        case TOKEN_KEYWORD:
+            if (atKeyword(KEYWORD_NOT))
+            {
+                if (++depth > maxDepth)
+                    fail("a less deeply nested expression");
+                advance();
+                uint32_t operand = node(NODE_UNARY, line, parseFactor());
+                (*tree)[operand].op = OPERATOR_NOT;
+                depth--;
+                return operand;
+            }
+            break;
+        case TOKEN_DELIM:
+            if (atSymbol(symbol('(')))
+            {
+                advance();
+                uint32_t inner = parseExpression();
+                expectSymbol(symbol(')'), ")");
+                return inner;
+            }
+            break;
+        default:
+            break;
+        }
+        fail("an expression");
+    }
+
+    static bool parseInteger(string_view text, int64_t &value)
+    {
+        const char *end = text.data() + text.size();
+        from_chars_result result = from_chars(text.data(), end, value);
+        return result.ec == errc() && result.ptr == end;
+    }
+
+    uint32_t parseNumber()
+    {
+        uint32_t line = current.line;
+        string_view text = current.lexeme;
+        int64_t integer;
+        uint64_t bits;
+        NodeKind kind;
+        if (text.find_first_of(".eE") == string_view::npos)
+        {
+            if (!parseInteger(text, integer))
+                fail("an integer in range");
+            bits = (uint64_t)integer;
+            kind = NODE_INTEGER;
+        }
+        else
+        {
+            double real;
+            from_chars_result result = from_chars(text.data(), text.data() + text.size(), real);
+            if (result.ec != errc() || result.ptr != text.data() + text.size())
+                fail("a real number in range");
+            memcpy(&bits, &real, sizeof bits);
+            kind = NODE_REAL;
+        }
+        advance();
+        return node(kind, line, 0, 0, (uint32_t)bits, (uint32_t)(bits >> 32));
+    }
+
+    PascalLexer lexer;
+    const char *text = nullptr;
+    const TokenRecord *records = nullptr; // with the two above, when parsing lexed tokens
+    const uint32_t *lineStarts = nullptr;
+    uint32_t at = 0;                      // index of current in records
+    vector<OutlineUnit> *outline = nullptr;
+    Token current;
+    uint16_t currentSymbol = 0;
+    Ast *tree = nullptr;
+    vector<uint32_t> scratch;
+    unsigned depth = 0;
+};
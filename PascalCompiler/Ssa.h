@@ -0,0 +1,1102 @@
+// Ssa.h
+// Static single assignment form of one BytecodeFunction, which
+// SsaOptimizer.h optimizes and SsaLowering.h turns back into bytecode.
+// SsaBuilder builds it from the bytecode of BytecodeCompiler.h, where names,
+// types and semantic checks are already resolved.
+//
+// A function is one array of SsaInstructions that refer to each other by
+// index: an instruction's index is the value it defines. Blocks hold the
+// indexes of their instructions in order, phis first and a terminator last,
+// and the indexes of their predecessors and successors. Phis and calls keep
+// their operands in the function's operand array. Arithmetic, memory and
+// output instructions keep their bytecode opcodes; SsaOp adds constants,
+// parameters, phis, branches and access to pinned registers.
+//
+// Registers become values unless something besides plain reads and writes
+// reaches them: array parameters, the argument slots that COPYL and COPYG
+// fill, and in the main program the global scalars that subprograms reach
+// with GETG and SETG. Those pinned registers keep their numbers and are read
+// and written with GETR and SETR. A MOVE only renames a value. Registers
+// start at zero, as in the VM, except scalar parameters, which ENTRY reads.
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "Bytecode.h"
+
+using namespace std;
+
+enum SsaOp : uint16_t
+{
+    SSA_CONST = OP_COUNT, // constant
+    SSA_ENTRY,            // parameter register reg on entry
+    SSA_PHI,              // operands in the order of the block's predecessors
+    SSA_GETR,             // pinned register reg
+    SSA_SETR,             // pinned register reg = a
+    SSA_BRANCH,           // if a goto successors[0] else successors[1]
+    SSA_DEAD,             // removed from its block
+    SSA_OP_END
+};
+
+static const uint32_t ssaNone = UINT32_MAX;
+
+inline const char *ssaOpName(int op)
+{
+    static const char *names[SSA_OP_END - OP_COUNT] = {"CONST", "ENTRY", "PHI", "GETR", "SETR", "BRANCH", "DEAD"};
+    return op < OP_COUNT ? opcodeName(op) : names[op - OP_COUNT];
+}
+
+struct SsaInstruction
+{
+    uint16_t op = SSA_DEAD;
+    uint16_t reg = 0;      // ENTRY, PHI, GETR, SETR: the register; COPYL, COPYG: the first one; CALL: the arguments'
+    bool defines = false;  // the instruction has a value
+    uint32_t block = 0;
+    uint32_t a = 0, b = 0; // operand values; PHI and CALL: first operand and count in SsaFunction::operands
+    uint32_t c = 0;        // array for element access and copies, global for GETG and SETG, function for CALL
+    uint32_t line = 0;
+    Value constant = {0};
+};
+
+struct SsaBlock
+{
+    vector<uint32_t> code; // instruction indexes: phis, the rest, then the terminator
+    vector<uint32_t> predecessors;
+    uint32_t successors[2] = {ssaNone, ssaNone};
+
+    uint32_t successorCount() const { return (successors[0] != ssaNone) + (successors[1] != ssaNone); }
+};
+
+struct SsaFunction
+{
+    uint32_t index = 0; // in the module
+    vector<SsaInstruction> instructions;
+    vector<uint32_t> operands;
+    vector<SsaBlock> blocks;      // block 0 is the entry
+    vector<uint32_t> layout;      // the live blocks in bytecode order, the entry first
+    vector<bool> pinned;          // by register
+    vector<uint32_t> localArrays; // ArrayInfo indexes of the arrays in the frame, after the registers
+    uint32_t registers = 0;       // registers of the bytecode frame
+    uint32_t result = 0;          // register RET returns
+    bool returnsValue = false;
+
+    uint32_t add(const SsaInstruction &instruction)
+    {
+        instructions.push_back(instruction);
+        return (uint32_t)instructions.size() - 1;
+    }
+
+    uint32_t addBlock()
+    {
+        blocks.emplace_back();
+        return (uint32_t)blocks.size() - 1;
+    }
+
+    bool isPinned(uint32_t reg) const { return reg < pinned.size() && pinned[reg]; }
+
+    // Phis come first in a block
+    size_t phiCount(uint32_t block) const
+    {
+        const vector<uint32_t> &code = blocks[block].code;
+        size_t k = 0;
+        while (k < code.size() && instructions[code[k]].op == SSA_PHI)
+            k++;
+        return k;
+    }
+};
+
+// Fixed operands of an opcode; phis and calls list theirs in the operand array
+inline int ssaOperandCount(uint16_t op, bool returnsValue)
+{
+    switch (op)
+    {
+    case OP_ADDI:
+    case OP_SUBI:
+    case OP_MULI:
+    case OP_DIVI:
+    case OP_MODI:
+    case OP_ADDR:
+    case OP_SUBR:
+    case OP_MULR:
+    case OP_DIVR:
+    case OP_EQI:
+    case OP_NEI:
+    case OP_LTI:
+    case OP_LEI:
+    case OP_EQR:
+    case OP_NER:
+    case OP_LTR:
+    case OP_LER:
+    case OP_AND:
+    case OP_OR:
+    case OP_SETEL:
+    case OP_SETEG:
+        return 2;
+    case OP_I2R:
+    case OP_NEGI:
+    case OP_NEGR:
+    case OP_NOT:
+    case OP_SETG:
+    case OP_GETEL:
+    case OP_GETEG:
+    case OP_WRITEI:
+    case OP_WRITER:
+    case SSA_SETR:
+    case SSA_BRANCH:
+        return 1;
+    case OP_RET:
+        return returnsValue ? 1 : 0;
+    default:
+        return 0;
+    }
+}
+
+// Calls visit with a reference to each operand of an instruction
+template <class Visit>
+void forEachOperand(SsaFunction &function, uint32_t index, Visit &&visit)
+{
+    SsaInstruction &instruction = function.instructions[index];
+    if (instruction.op == SSA_PHI || instruction.op == OP_CALL)
+    {
+        for (uint32_t k = 0; k < instruction.b; k++)
+            visit(function.operands[instruction.a + k]);
+        return;
+    }
+    int count = ssaOperandCount(instruction.op, function.returnsValue);
+    if (count > 0)
+        visit(instruction.a);
+    if (count > 1)
+        visit(instruction.b);
+}
+
+template <class Visit>
+void forEachOperand(const SsaFunction &function, uint32_t index, Visit &&visit)
+{
+    forEachOperand(const_cast<SsaFunction &>(function), index, [&](uint32_t operand) { visit(operand); });
+}
+
+// Instructions that must stay even when nothing uses their value
+inline bool ssaHasEffect(uint16_t op)
+{
+    switch (op)
+    {
+    case OP_SETG:
+    case OP_SETEL:
+    case OP_SETEG:
+    case OP_COPYL:
+    case OP_COPYG:
+    case OP_CALL:
+    case OP_RET:
+    case OP_WRITEI:
+    case OP_WRITER:
+    case OP_WRITELN:
+    case OP_HALT:
+    case OP_JMP:
+    case SSA_SETR:
+    case SSA_BRANCH:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Instructions whose value depends on nothing but their operands
+inline bool ssaIsPure(uint16_t op)
+{
+    return (op >= OP_I2R && op <= OP_NOT) || op == SSA_CONST;
+}
+
+inline bool ssaIsCommutative(uint16_t op)
+{
+    switch (op)
+    {
+    case OP_ADDI:
+    case OP_MULI:
+    case OP_ADDR:
+    case OP_MULR:
+    case OP_EQI:
+    case OP_NEI:
+    case OP_EQR:
+    case OP_NER:
+    case OP_AND:
+    case OP_OR:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Removes the edge from one block to another from to's side, with the phi operands it brought
+inline void dropPredecessor(SsaFunction &function, uint32_t to, uint32_t from)
+{
+    vector<uint32_t> &predecessors = function.blocks[to].predecessors;
+    size_t at = find(predecessors.begin(), predecessors.end(), from) - predecessors.begin();
+    if (at == predecessors.size())
+        return;
+    predecessors.erase(predecessors.begin() + at);
+    for (size_t k = 0, phis = function.phiCount(to); k < phis; k++)
+    {
+        SsaInstruction &phi = function.instructions[function.blocks[to].code[k]];
+        uint32_t *operands = function.operands.data() + phi.a;
+        copy(operands + at + 1, operands + phi.b, operands + at);
+        phi.b--;
+    }
+}
+
+// Removes the instruction from its block; the index stays, as SSA_DEAD
+inline void removeInstruction(SsaFunction &function, uint32_t index)
+{
+    SsaInstruction &instruction = function.instructions[index];
+    vector<uint32_t> &code = function.blocks[instruction.block].code;
+    code.erase(find(code.begin(), code.end(), index));
+    instruction.op = SSA_DEAD;
+}
+
+// Puts a block with just a jump on every edge from a block with two successors to a block
+// with phis, so the copies that phis become have a block of their own to go in
+inline void splitCriticalEdges(SsaFunction &function)
+{
+    vector<uint32_t> layout;
+    for (uint32_t block : function.layout)
+    {
+        layout.push_back(block);
+        for (int k = 0; k < 2; k++)
+        {
+            uint32_t successor = function.blocks[block].successors[k];
+            if (function.blocks[block].successorCount() < 2 || function.phiCount(successor) == 0)
+                continue;
+            uint32_t edge = function.addBlock();
+            SsaInstruction jump;
+            jump.op = OP_JMP;
+            jump.block = edge;
+            jump.line = function.instructions[function.blocks[block].code.back()].line;
+            function.blocks[edge].code.push_back(function.add(jump));
+            function.blocks[edge].successors[0] = successor;
+            function.blocks[edge].predecessors.push_back(block);
+            function.blocks[block].successors[k] = edge;
+            vector<uint32_t> &predecessors = function.blocks[successor].predecessors;
+            *find(predecessors.begin(), predecessors.end(), block) = edge;
+            layout.push_back(edge);
+        }
+    }
+    function.layout = move(layout);
+}
+
+struct SsaDominators
+{
+    vector<uint32_t> order; // reachable blocks in reverse postorder
+    vector<uint32_t> idom;  // immediate dominator; ssaNone for the entry and unreachable blocks
+    vector<vector<uint32_t>> children;
+    vector<uint32_t> enter, leave; // preorder interval in the dominator tree
+
+    bool reachable(uint32_t block) const { return enter[block] != ssaNone; }
+
+    bool dominates(uint32_t a, uint32_t b) const { return enter[a] <= enter[b] && leave[b] <= leave[a]; }
+
+    // Cooper, Harvey and Kennedy's iteration over the reverse postorder
+    void compute(const SsaFunction &function)
+    {
+        size_t count = function.blocks.size();
+        order.clear();
+        vector<uint32_t> number(count, ssaNone);
+        vector<pair<uint32_t, uint32_t>> stack{{0, 0}};
+        vector<bool> seen(count, false);
+        seen[0] = true;
+        while (!stack.empty())
+        {
+            auto &[block, next] = stack.back();
+            const SsaBlock &current = function.blocks[block];
+            if (next < 2)
+            {
+                uint32_t successor = current.successors[next++];
+                if (successor != ssaNone && !seen[successor])
+                {
+                    seen[successor] = true;
+                    stack.push_back({successor, 0});
+                }
+                continue;
+            }
+            order.push_back(block);
+            stack.pop_back();
+        }
+        reverse(order.begin(), order.end());
+        for (size_t k = 0; k < order.size(); k++)
+            number[order[k]] = (uint32_t)k;
+
+        idom.assign(count, ssaNone);
+        idom[0] = 0;
+        for (bool changed = true; changed;)
+        {
+            changed = false;
+            for (size_t k = 1; k < order.size(); k++)
+            {
+                uint32_t block = order[k], chosen = ssaNone;
+                for (uint32_t predecessor : function.blocks[block].predecessors)
+                {
+                    if (number[predecessor] == ssaNone || idom[predecessor] == ssaNone)
+                        continue;
+                    if (chosen == ssaNone)
+                    {
+                        chosen = predecessor;
+                        continue;
+                    }
+                    uint32_t x = predecessor, y = chosen;
+                    while (x != y)
+                    {
+                        while (number[x] > number[y])
+                            x = idom[x];
+                        while (number[y] > number[x])
+                            y = idom[y];
+                    }
+                    chosen = x;
+                }
+                if (chosen != idom[block])
+                {
+                    idom[block] = chosen;
+                    changed = true;
+                }
+            }
+        }
+        idom[0] = ssaNone;
+
+        children.assign(count, {});
+        for (size_t k = 1; k < order.size(); k++)
+            children[idom[order[k]]].push_back(order[k]);
+        enter.assign(count, ssaNone);
+        leave.assign(count, ssaNone);
+        uint32_t clock = 0;
+        vector<pair<uint32_t, size_t>> walk{{0, 0}};
+        enter[0] = clock++;
+        while (!walk.empty())
+        {
+            auto &[block, next] = walk.back();
+            if (next < children[block].size())
+            {
+                uint32_t child = children[block][next++];
+                enter[child] = clock++;
+                walk.push_back({child, 0});
+                continue;
+            }
+            leave[block] = clock++;
+            walk.pop_back();
+        }
+    }
+};
+
+struct SsaLoop
+{
+    uint32_t header;
+    vector<uint32_t> blocks; // the header first
+};
+
+// Natural loops, one per header, the innermost first
+inline vector<SsaLoop> findLoops(const SsaFunction &function, const SsaDominators &dominators)
+{
+    vector<SsaLoop> loops;
+    vector<uint32_t> mark(function.blocks.size(), ssaNone);
+    for (uint32_t header : dominators.order)
+    {
+        SsaLoop loop{header, {header}};
+        mark[header] = header;
+        vector<uint32_t> work;
+        for (uint32_t predecessor : function.blocks[header].predecessors)
+        {
+            if (dominators.reachable(predecessor) && dominators.dominates(header, predecessor))
+                work.push_back(predecessor);
+        }
+        if (work.empty())
+            continue;
+        while (!work.empty())
+        {
+            uint32_t block = work.back();
+            work.pop_back();
+            if (mark[block] == header)
+                continue;
+            mark[block] = header;
+            loop.blocks.push_back(block);
+            for (uint32_t predecessor : function.blocks[block].predecessors)
+            {
+                if (dominators.reachable(predecessor))
+                    work.push_back(predecessor);
+            }
+        }
+        loops.push_back(move(loop));
+    }
+    stable_sort(loops.begin(), loops.end(),
+                [](const SsaLoop &x, const SsaLoop &y) { return x.blocks.size() < y.blocks.size(); });
+    return loops;
+}
+
+class SsaBuilder
+{
+public:
+    explicit SsaBuilder(const BytecodeModule &module) : module(module)
+    {
+        // Global scalars that subprograms reach stay in the main frame's registers
+        for (const BytecodeFunction &function : module.functions)
+        {
+            for (const Instruction &instruction : function.code)
+            {
+                if (instruction.op == OP_GETG || instruction.op == OP_SETG)
+                    reachedGlobals.push_back(wideOperand(instruction));
+            }
+        }
+    }
+
+    void build(uint32_t index, SsaFunction &out)
+    {
+        function = &module.functions[index];
+        this->out = &out;
+        out = SsaFunction();
+        out.index = index;
+        out.returnsValue = function->resultType != AST_TYPE_NONE;
+        out.result = function->result;
+        findRegisters(index == module.main);
+        findBlocks();
+        dominators.compute(out);
+        placePhis();
+        rename();
+
+        // Parameters on entry come first, then constants, then the jump
+        SsaBlock &entry = out.blocks[0];
+        stable_partition(entry.code.begin(), entry.code.end(),
+                         [&](uint32_t k) { return out.instructions[k].op == SSA_ENTRY; });
+        SsaInstruction jump;
+        jump.op = OP_JMP;
+        entry.code.push_back(out.add(jump));
+        for (uint32_t block : dominators.order)
+            out.layout.push_back(block);
+        sort(out.layout.begin() + 1, out.layout.end());
+    }
+
+private:
+    // Registers end where the local arrays start; some of them are pinned
+    void findRegisters(bool main)
+    {
+        const vector<Instruction> &code = function->code;
+        out->registers = function->frameSize;
+        for (const Instruction &instruction : code)
+        {
+            if (instruction.op != OP_GETEL && instruction.op != OP_SETEL && instruction.op != OP_COPYL)
+                continue;
+            const ArrayInfo &array = module.arrays[instruction.b];
+            if (array.offset < function->parameterSlots)
+                continue;
+            out->registers = min(out->registers, array.offset);
+            if (find(out->localArrays.begin(), out->localArrays.end(), instruction.b) == out->localArrays.end())
+                out->localArrays.push_back(instruction.b);
+        }
+        sort(out->localArrays.begin(), out->localArrays.end());
+        out->pinned.assign(out->registers, false);
+        auto pin = [&](uint32_t first, uint32_t count) {
+            for (uint32_t reg = first; reg < first + count && reg < out->registers; reg++)
+                out->pinned[reg] = true;
+        };
+        for (const Instruction &instruction : code)
+        {
+            switch (instruction.op)
+            {
+            case OP_GETEL:
+            case OP_SETEL:
+            case OP_COPYL:
+            {
+                const ArrayInfo &array = module.arrays[instruction.b];
+                if (array.offset < function->parameterSlots)
+                    pin(array.offset, array.count);
+                if (instruction.op == OP_COPYL)
+                    pin(instruction.a, array.count);
+                break;
+            }
+            case OP_COPYG:
+                pin(instruction.a, module.arrays[instruction.b].count);
+                break;
+            default:
+                break;
+            }
+        }
+        if (main)
+        {
+            for (uint32_t global : reachedGlobals)
+                pin(global, 1);
+        }
+    }
+
+    // Leaders start blocks; block 0 is an empty entry that jumps to the first
+    void findBlocks()
+    {
+        const vector<Instruction> &code = function->code;
+        vector<bool> leader(code.size() + 1, false);
+        leader[0] = true;
+        for (size_t pc = 0; pc < code.size(); pc++)
+        {
+            switch (code[pc].op)
+            {
+            case OP_JMP:
+            case OP_JMPF:
+            case OP_JMPT:
+                leader[wideOperand(code[pc])] = true;
+                leader[pc + 1] = true;
+                break;
+            case OP_RET:
+            case OP_HALT:
+                leader[pc + 1] = true;
+                break;
+            default:
+                break;
+            }
+        }
+        blockAt.assign(code.size() + 1, ssaNone);
+        blockStart.assign(1, 0);
+        out->addBlock();
+        for (size_t pc = 0; pc < code.size(); pc++)
+        {
+            if (leader[pc])
+            {
+                blockAt[pc] = out->addBlock();
+                blockStart.push_back((uint32_t)pc);
+            }
+        }
+        blockStart.push_back((uint32_t)code.size());
+
+        out->blocks[0].successors[0] = 1;
+        for (uint32_t block = 1; block < out->blocks.size(); block++)
+        {
+            uint32_t end = blockStart[block + 1];
+            const Instruction &last = code[end - 1];
+            uint32_t *successors = out->blocks[block].successors;
+            uint32_t next = end < code.size() ? blockAt[end] : ssaNone;
+            switch (last.op)
+            {
+            case OP_JMP:
+                successors[0] = blockAt[wideOperand(last)];
+                break;
+            case OP_JMPF:
+                successors[0] = next;
+                successors[1] = blockAt[wideOperand(last)];
+                break;
+            case OP_JMPT:
+                successors[0] = blockAt[wideOperand(last)];
+                successors[1] = next;
+                break;
+            case OP_RET:
+            case OP_HALT:
+                break;
+            default:
+                successors[0] = next;
+                break;
+            }
+            // A branch to where it falls through is a jump
+            if (successors[1] == successors[0])
+                successors[1] = ssaNone;
+        }
+
+        // Only reachable blocks are predecessors
+        vector<bool> seen(out->blocks.size(), false);
+        vector<uint32_t> work{0};
+        seen[0] = true;
+        while (!work.empty())
+        {
+            uint32_t block = work.back();
+            work.pop_back();
+            for (uint32_t successor : out->blocks[block].successors)
+            {
+                if (successor != ssaNone && !seen[successor])
+                {
+                    seen[successor] = true;
+                    work.push_back(successor);
+                }
+            }
+        }
+        for (uint32_t block = 0; block < out->blocks.size(); block++)
+        {
+            if (!seen[block])
+            {
+                out->blocks[block].successors[0] = out->blocks[block].successors[1] = ssaNone;
+                continue;
+            }
+            for (uint32_t successor : out->blocks[block].successors)
+            {
+                if (successor != ssaNone)
+                    out->blocks[successor].predecessors.push_back(block);
+            }
+        }
+    }
+
+    // Calls read(reg) and write(reg) for the registers an instruction reads and writes, pinned ones left out
+    template <class Read, class Write>
+    void registersOf(const Instruction &instruction, Read read, Write write) const
+    {
+        auto r = [&](uint32_t reg) {
+            if (!out->isPinned(reg))
+                read(reg);
+        };
+        auto w = [&](uint32_t reg) {
+            if (!out->isPinned(reg))
+                write(reg);
+        };
+        switch (instruction.op)
+        {
+        case OP_MOVE:
+        case OP_I2R:
+        case OP_NEGI:
+        case OP_NEGR:
+        case OP_NOT:
+            r(instruction.b);
+            w(instruction.a);
+            break;
+        case OP_LOADI:
+        case OP_LOADK:
+        case OP_GETG:
+            w(instruction.a);
+            break;
+        case OP_GETEL:
+        case OP_GETEG:
+            r(instruction.c);
+            w(instruction.a);
+            break;
+        case OP_SETEL:
+        case OP_SETEG:
+            r(instruction.a);
+            r(instruction.c);
+            break;
+        case OP_SETG:
+        case OP_JMPF:
+        case OP_JMPT:
+        case OP_WRITEI:
+        case OP_WRITER:
+            r(instruction.a);
+            break;
+        case OP_CALL:
+        {
+            const BytecodeFunction &callee = module.functions[instruction.b];
+            for (uint32_t slot = 0; slot < callee.parameterSlots; slot++)
+                r(instruction.a + slot);
+            if (callee.resultType != AST_TYPE_NONE)
+                w(instruction.c);
+            break;
+        }
+        case OP_RET:
+            if (out->returnsValue)
+                r(function->result);
+            break;
+        default:
+            if (instruction.op >= OP_ADDI && instruction.op <= OP_OR)
+            {
+                r(instruction.b);
+                r(instruction.c);
+                w(instruction.a);
+            }
+            break;
+        }
+    }
+
+    // Semi-pruned SSA: phis only for registers read in some block before it writes them
+    void placePhis()
+    {
+        const vector<Instruction> &code = function->code;
+        size_t blockCount = out->blocks.size();
+        vector<bool> crossing(out->registers, false);
+        vector<vector<uint32_t>> written(out->registers);
+        vector<uint32_t> stamp(out->registers, ssaNone);
+        for (uint32_t block = 1; block < blockCount; block++)
+        {
+            if (!dominators.reachable(block))
+                continue;
+            for (uint32_t pc = blockStart[block]; pc < blockStart[block + 1]; pc++)
+            {
+                registersOf(
+                    code[pc], [&](uint32_t reg) { crossing[reg] = crossing[reg] || stamp[reg] != block; },
+                    [&](uint32_t reg) {
+                        if (stamp[reg] != block)
+                            written[reg].push_back(block);
+                        stamp[reg] = block;
+                    });
+            }
+        }
+
+        vector<vector<uint32_t>> frontier(blockCount);
+        for (uint32_t block : dominators.order)
+        {
+            const vector<uint32_t> &predecessors = out->blocks[block].predecessors;
+            if (predecessors.size() < 2)
+                continue;
+            for (uint32_t runner : predecessors)
+            {
+                while (runner != dominators.idom[block])
+                {
+                    if (frontier[runner].empty() || frontier[runner].back() != block)
+                        frontier[runner].push_back(block);
+                    runner = dominators.idom[runner];
+                }
+            }
+        }
+
+        vector<uint32_t> hasPhi(blockCount, ssaNone), queued(blockCount, ssaNone);
+        for (uint32_t reg = 0; reg < out->registers; reg++)
+        {
+            if (!crossing[reg])
+                continue;
+            vector<uint32_t> work = written[reg];
+            for (uint32_t block : work)
+                queued[block] = reg;
+            while (!work.empty())
+            {
+                uint32_t block = work.back();
+                work.pop_back();
+                for (uint32_t join : frontier[block])
+                {
+                    if (hasPhi[join] == reg)
+                        continue;
+                    hasPhi[join] = reg;
+                    SsaInstruction phi;
+                    phi.op = SSA_PHI;
+                    phi.reg = (uint16_t)reg;
+                    phi.defines = true;
+                    phi.block = join;
+                    phi.a = (uint32_t)out->operands.size();
+                    phi.b = (uint32_t)out->blocks[join].predecessors.size();
+                    out->operands.resize(out->operands.size() + phi.b, ssaNone);
+                    out->blocks[join].code.push_back(out->add(phi));
+                    if (queued[join] != reg)
+                    {
+                        queued[join] = reg;
+                        work.push_back(join);
+                    }
+                }
+            }
+        }
+    }
+
+    // Walks the dominator tree with a stack of values per register
+    void rename()
+    {
+        values.assign(out->registers, {});
+        initial.assign(out->registers, ssaNone);
+        zero = ssaNone;
+        renamed.clear();
+        vector<pair<uint32_t, size_t>> walk{{0, 0}};
+        vector<size_t> marks{0};
+        visit(0);
+        while (!walk.empty())
+        {
+            auto &[block, next] = walk.back();
+            if (next < dominators.children[block].size())
+            {
+                uint32_t child = dominators.children[block][next++];
+                marks.push_back(renamed.size());
+                visit(child);
+                walk.push_back({child, 0});
+                continue;
+            }
+            for (size_t k = renamed.size(); k > marks.back(); k--)
+                values[renamed[k - 1]].pop_back();
+            renamed.resize(marks.back());
+            marks.pop_back();
+            walk.pop_back();
+        }
+    }
+
+    void visit(uint32_t block)
+    {
+        current = block;
+        SsaBlock &target = out->blocks[block];
+        for (uint32_t phi : target.code)
+            define(out->instructions[phi].reg, phi);
+        if (block != 0)
+        {
+            uint32_t end = blockStart[block + 1];
+            for (uint32_t pc = blockStart[block]; pc < end; pc++)
+                translate(pc);
+            uint16_t last = function->code[end - 1].op;
+            if (last != OP_JMP && last != OP_JMPF && last != OP_JMPT && last != OP_RET && last != OP_HALT)
+            {
+                SsaInstruction jump;
+                jump.op = OP_JMP;
+                emit(jump, function->lines[end - 1]);
+            }
+        }
+        for (uint32_t successor : out->blocks[block].successors)
+        {
+            if (successor == ssaNone)
+                continue;
+            const SsaBlock &next = out->blocks[successor];
+            size_t at = find(next.predecessors.begin(), next.predecessors.end(), block) - next.predecessors.begin();
+            for (size_t k = 0, phis = out->phiCount(successor); k < phis; k++)
+            {
+                uint32_t phi = next.code[k];
+                uint32_t value = valueOf(out->instructions[phi].reg);
+                out->operands[out->instructions[phi].a + at] = value;
+            }
+        }
+    }
+
+    uint32_t emit(SsaInstruction instruction, uint32_t line)
+    {
+        instruction.block = current;
+        instruction.line = line;
+        uint32_t index = out->add(instruction);
+        out->blocks[current].code.push_back(index);
+        return index;
+    }
+
+    uint32_t valueOf(uint32_t reg)
+    {
+        if (!values[reg].empty())
+            return values[reg].back();
+        if (initial[reg] != ssaNone)
+            return initial[reg];
+        // Values on entry go to the entry block, which dominates every use
+        SsaInstruction start;
+        start.defines = true;
+        if (reg < function->parameterSlots)
+        {
+            start.op = SSA_ENTRY;
+            start.reg = (uint16_t)reg;
+        }
+        else if (zero != ssaNone)
+            return initial[reg] = zero;
+        else
+            start.op = SSA_CONST;
+        uint32_t saved = current;
+        current = 0;
+        uint32_t value = emit(start, function->lines.empty() ? 0 : function->lines[0]);
+        current = saved;
+        if (start.op == SSA_CONST)
+            zero = value;
+        return initial[reg] = value;
+    }
+
+    uint32_t use(uint32_t reg, uint32_t line)
+    {
+        if (!out->isPinned(reg))
+            return valueOf(reg);
+        SsaInstruction read;
+        read.op = SSA_GETR;
+        read.reg = (uint16_t)reg;
+        read.defines = true;
+        return emit(read, line);
+    }
+
+    void define(uint32_t reg, uint32_t value, uint32_t line = 0)
+    {
+        if (out->isPinned(reg))
+        {
+            SsaInstruction write;
+            write.op = SSA_SETR;
+            write.reg = (uint16_t)reg;
+            write.a = value;
+            emit(write, line);
+            return;
+        }
+        values[reg].push_back(value);
+        renamed.push_back(reg);
+    }
+
+    void translate(uint32_t pc)
+    {
+        const Instruction &in = function->code[pc];
+        const uint32_t line = function->lines[pc];
+        SsaInstruction made;
+        made.op = in.op;
+        switch (in.op)
+        {
+        case OP_MOVE:
+            define(in.a, use(in.b, line), line);
+            return;
+        case OP_LOADI:
+        case OP_LOADK:
+            made.op = SSA_CONST;
+            made.defines = true;
+            if (in.op == OP_LOADI)
+                made.constant.i = (int32_t)wideOperand(in);
+            else
+                made.constant = module.constants[wideOperand(in)];
+            define(in.a, emit(made, line), line);
+            return;
+        case OP_I2R:
+        case OP_NEGI:
+        case OP_NEGR:
+        case OP_NOT:
+            made.a = use(in.b, line);
+            made.defines = true;
+            define(in.a, emit(made, line), line);
+            return;
+        case OP_GETG:
+            made.c = wideOperand(in);
+            made.defines = true;
+            define(in.a, emit(made, line), line);
+            return;
+        case OP_SETG:
+            made.a = use(in.a, line);
+            made.c = wideOperand(in);
+            emit(made, line);
+            return;
+        case OP_GETEL:
+        case OP_GETEG:
+            made.a = use(in.c, line);
+            made.c = in.b;
+            made.defines = true;
+            define(in.a, emit(made, line), line);
+            return;
+        case OP_SETEL:
+        case OP_SETEG:
+            made.a = use(in.a, line);
+            made.b = use(in.c, line);
+            made.c = in.b;
+            emit(made, line);
+            return;
+        case OP_COPYL:
+        case OP_COPYG:
+            made.reg = in.a;
+            made.c = in.b;
+            emit(made, line);
+            return;
+        case OP_JMP:
+            emit(made, line);
+            return;
+        case OP_JMPF:
+        case OP_JMPT:
+            if (out->blocks[current].successors[1] == ssaNone)
+                made.op = OP_JMP;
+            else
+            {
+                made.op = SSA_BRANCH;
+                made.a = use(in.a, line);
+            }
+            emit(made, line);
+            return;
+        case OP_CALL:
+        {
+            // The pinned slots are array arguments, already copied in place
+            const BytecodeFunction &callee = module.functions[in.b];
+            vector<uint32_t> arguments;
+            for (uint32_t slot = 0; slot < callee.parameterSlots; slot++)
+            {
+                if (!out->isPinned(in.a + slot))
+                    arguments.push_back(use(in.a + slot, line));
+            }
+            made.reg = in.a;
+            made.c = in.b;
+            made.a = (uint32_t)out->operands.size();
+            made.b = (uint32_t)arguments.size();
+            out->operands.insert(out->operands.end(), arguments.begin(), arguments.end());
+            made.defines = callee.resultType != AST_TYPE_NONE;
+            uint32_t call = emit(made, line);
+            if (made.defines)
+                define(in.c, call, line);
+            return;
+        }
+        case OP_RET:
+            if (out->returnsValue)
+                made.a = use(function->result, line);
+            emit(made, line);
+            return;
+        case OP_WRITEI:
+        case OP_WRITER:
+            made.a = use(in.a, line);
+            emit(made, line);
+            return;
+        case OP_WRITELN:
+        case OP_HALT:
+            emit(made, line);
+            return;
+        default:
+            made.a = use(in.b, line);
+            made.b = use(in.c, line);
+            made.defines = true;
+            define(in.a, emit(made, line), line);
+            return;
+        }
+    }
+
+    const BytecodeModule &module;
+    vector<uint32_t> reachedGlobals;
+    const BytecodeFunction *function = nullptr;
+    SsaFunction *out = nullptr;
+    SsaDominators dominators;
+    vector<uint32_t> blockAt;    // by pc: the block starting there
+    vector<uint32_t> blockStart; // by block: its first pc, and one past the last block
+    vector<vector<uint32_t>> values;
+    vector<uint32_t> initial;
+    vector<uint32_t> renamed; // registers defined, in order, popped when the walk leaves a block
+    uint32_t zero = ssaNone;
+    uint32_t current = 0;
+};
+
+inline void printSsa(ostream &out, const SsaFunction &function)
+{
+    auto value = [](uint32_t v) { return v == ssaNone ? string("?") : "v" + to_string(v); };
+    for (uint32_t block : function.layout)
+    {
+        const SsaBlock &current = function.blocks[block];
+        out << "b" << block;
+        if (!current.predecessors.empty())
+        {
+            out << " (from";
+            for (uint32_t predecessor : current.predecessors)
+                out << " b" << predecessor;
+            out << ")";
+        }
+        out << ":\n";
+        for (uint32_t index : current.code)
+        {
+            const SsaInstruction &instruction = function.instructions[index];
+            out << "  ";
+            if (instruction.defines)
+                out << value(index) << " = ";
+            out << ssaOpName(instruction.op);
+            bool first = true;
+            auto item = [&](const string &text) {
+                out << (first ? " " : ", ") << text;
+                first = false;
+            };
+            switch (instruction.op)
+            {
+            case SSA_CONST:
+                item(to_string(instruction.constant.i));
+                break;
+            case SSA_ENTRY:
+            case SSA_GETR:
+            case SSA_SETR:
+            case OP_COPYL:
+            case OP_COPYG:
+                item("r" + to_string(instruction.reg));
+                break;
+            case OP_GETG:
+            case OP_SETG:
+                item("global " + to_string(instruction.c));
+                break;
+            case OP_GETEL:
+            case OP_GETEG:
+            case OP_SETEL:
+            case OP_SETEG:
+                item("array " + to_string(instruction.c));
+                break;
+            case OP_CALL:
+                item("function " + to_string(instruction.c));
+                break;
+            default:
+                break;
+            }
+            if (instruction.op == SSA_PHI)
+            {
+                for (uint32_t k = 0; k < instruction.b; k++)
+                    item("[b" + to_string(current.predecessors[k]) + "] " +
+                         value(function.operands[instruction.a + k]));
+            }
+            else
+                forEachOperand(function, index, [&](uint32_t operand) { item(value(operand)); });
+            if (instruction.op == OP_JMP || instruction.op == SSA_BRANCH)
+            {
+                for (uint32_t successor : current.successors)
+                {
+                    if (successor != ssaNone)
+                        item("b" + to_string(successor));
+                }
+            }
+            out << "\n";
+        }
+    }
+}
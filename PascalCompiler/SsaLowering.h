@@ -0,0 +1,576 @@
+// SsaLowering.h
+// Turns the SSA form of Ssa.h back into register bytecode for the VM.
+//
+// Each phi becomes copies at the end of its predecessors, after critical
+// edges are split. A call's scalar arguments are copied into the call's
+// argument slots and a function's result into its result register just
+// before they are needed; parameters arrive in their own registers. Values
+// linked by these copies share a register when their live ranges do not
+// interfere, innermost loops first, so most copies vanish. The rest of the
+// values get the lowest register that no interfering value holds, leaving
+// the pinned registers alone. A parallel copy whose registers form a cycle
+// goes through one scratch register.
+//
+// Local arrays move to just after the new registers. A function that would
+// need more than 16-bit registers keeps its old bytecode.
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "Bytecode.h"
+#include "Ssa.h"
+
+using namespace std;
+
+class SsaLowering
+{
+public:
+    explicit SsaLowering(BytecodeModule &module) : module(module) {}
+
+    // Replaces the function's bytecode; splits the critical edges of the SSA form as it goes
+    bool lower(SsaFunction &function)
+    {
+        f = &function;
+        splitCriticalEdges(function);
+        listItems();
+        findLiveness();
+        findInterference();
+        coalesce();
+        if (!assignRegisters())
+            return false;
+        emitCode();
+        return true;
+    }
+
+private:
+    // A parallel copy, then an instruction (or nothing, when instruction is ssaNone)
+    struct Item
+    {
+        uint32_t instruction;
+        uint32_t firstCopy, copyCount;
+    };
+
+    struct Copy
+    {
+        uint32_t to, from; // values, or registers once they are assigned
+    };
+
+    static const uint32_t maxRegisters = 65535;
+
+    // Values are instruction indexes; argument and result copies get the values after them
+    void listItems()
+    {
+        valueCount = (uint32_t)f->instructions.size();
+        precolor.assign(valueCount, ssaNone);
+        items.assign(f->blocks.size(), {});
+        copies.clear();
+        for (uint32_t block : f->layout)
+        {
+            for (uint32_t index : f->blocks[block].code)
+            {
+                const SsaInstruction &instruction = f->instructions[index];
+                Item item{index, (uint32_t)copies.size(), 0};
+                switch (instruction.op)
+                {
+                case SSA_PHI:
+                    continue;
+                case SSA_ENTRY:
+                    precolor[index] = instruction.reg;
+                    break;
+                case OP_CALL:
+                {
+                    // Scalar arguments go to the slots that are not pinned
+                    const BytecodeFunction &callee = module.functions[instruction.c];
+                    uint32_t k = 0;
+                    for (uint32_t slot = 0; slot < callee.parameterSlots; slot++)
+                    {
+                        if (f->isPinned(instruction.reg + slot))
+                            continue;
+                        copies.push_back(Copy{newValue(instruction.reg + slot), f->operands[instruction.a + k++]});
+                    }
+                    break;
+                }
+                case OP_RET:
+                    if (f->returnsValue)
+                        copies.push_back(Copy{newValue(f->result), instruction.a});
+                    break;
+                case OP_JMP:
+                {
+                    // Phis of the successor read their operands here
+                    uint32_t successor = f->blocks[block].successors[0];
+                    const SsaBlock &next = f->blocks[successor];
+                    size_t at = find(next.predecessors.begin(), next.predecessors.end(), block) -
+                                next.predecessors.begin();
+                    for (size_t k = 0, phis = f->phiCount(successor); k < phis; k++)
+                    {
+                        const SsaInstruction &phi = f->instructions[next.code[k]];
+                        copies.push_back(Copy{next.code[k], f->operands[phi.a + at]});
+                    }
+                    break;
+                }
+                default:
+                    break;
+                }
+                item.copyCount = (uint32_t)copies.size() - item.firstCopy;
+                items[block].push_back(item);
+            }
+        }
+    }
+
+    uint32_t newValue(uint32_t reg)
+    {
+        precolor.push_back(reg);
+        return valueCount++;
+    }
+
+    // Calls visit for each value the instruction reads; calls and returns read their copies
+    template <class Visit>
+    void usesOf(const Item &item, Visit &&visit) const
+    {
+        const SsaInstruction &instruction = f->instructions[item.instruction];
+        if (instruction.op == OP_CALL || instruction.op == OP_RET)
+        {
+            for (uint32_t k = 0; k < item.copyCount; k++)
+                visit(copies[item.firstCopy + k].to);
+            return;
+        }
+        forEachOperand(*f, item.instruction, visit);
+    }
+
+    // --- Liveness and interference ---
+
+    struct Bits
+    {
+        vector<uint64_t> words;
+
+        void resize(uint32_t count) { words.assign((count + 63) / 64, 0); }
+        bool test(uint32_t k) const { return words[k >> 6] >> (k & 63) & 1; }
+        void set(uint32_t k) { words[k >> 6] |= 1ull << (k & 63); }
+        void reset(uint32_t k) { words[k >> 6] &= ~(1ull << (k & 63)); }
+
+        template <class Visit>
+        void forEach(Visit &&visit) const
+        {
+            for (size_t w = 0; w < words.size(); w++)
+            {
+                for (uint64_t bits = words[w]; bits != 0; bits &= bits - 1)
+                    visit((uint32_t)(w * 64 + __builtin_ctzll(bits)));
+            }
+        }
+    };
+
+    // Walks a block's items backwards from live, calling defined(value, live) for each definition
+    template <class Defined>
+    void walkBack(uint32_t block, Bits &live, Defined &&defined) const
+    {
+        const vector<Item> &list = items[block];
+        for (size_t k = list.size(); k-- > 0;)
+        {
+            const Item &item = list[k];
+            const SsaInstruction &instruction = f->instructions[item.instruction];
+            if (instruction.defines)
+            {
+                defined(item.instruction, ssaNone, live);
+                live.reset(item.instruction);
+            }
+            usesOf(item, [&](uint32_t value) { live.set(value); });
+            for (uint32_t c = 0; c < item.copyCount; c++)
+            {
+                const Copy &copy = copies[item.firstCopy + c];
+                defined(copy.to, copy.from, live);
+            }
+            for (uint32_t c = 0; c < item.copyCount; c++)
+                live.reset(copies[item.firstCopy + c].to);
+            for (uint32_t c = 0; c < item.copyCount; c++)
+                live.set(copies[item.firstCopy + c].from);
+        }
+    }
+
+    void findLiveness()
+    {
+        liveOut.assign(f->blocks.size(), Bits());
+        vector<Bits> liveIn(f->blocks.size());
+        for (uint32_t block : f->layout)
+        {
+            liveOut[block].resize(valueCount);
+            liveIn[block].resize(valueCount);
+        }
+        for (bool changed = true; changed;)
+        {
+            changed = false;
+            for (size_t k = f->layout.size(); k-- > 0;)
+            {
+                uint32_t block = f->layout[k];
+                Bits &out = liveOut[block];
+                for (uint32_t successor : f->blocks[block].successors)
+                {
+                    if (successor == ssaNone)
+                        continue;
+                    for (size_t w = 0; w < out.words.size(); w++)
+                        out.words[w] |= liveIn[successor].words[w];
+                }
+                Bits live = out;
+                walkBack(block, live, [](uint32_t, uint32_t, const Bits &) {});
+                if (live.words != liveIn[block].words)
+                {
+                    liveIn[block] = move(live);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // A definition interferes with everything live after it, except the value it copies
+    void findInterference()
+    {
+        neighbors.assign(valueCount, {});
+        for (uint32_t block : f->layout)
+        {
+            Bits live = liveOut[block];
+            walkBack(block, live, [&](uint32_t value, uint32_t from, const Bits &after) {
+                after.forEach([&](uint32_t other) {
+                    if (other != value && other != from)
+                    {
+                        neighbors[value].push_back(other);
+                        neighbors[other].push_back(value);
+                    }
+                });
+            });
+        }
+    }
+
+    // --- Registers ---
+
+    uint32_t groupOf(uint32_t value)
+    {
+        while (parent[value] != value)
+            value = parent[value] = parent[parent[value]];
+        return value;
+    }
+
+    bool interferes(uint32_t x, uint32_t y)
+    {
+        if (members[x].size() > members[y].size())
+            swap(x, y);
+        for (uint32_t member : members[x])
+        {
+            for (uint32_t other : neighbors[member])
+            {
+                if (groupOf(other) == y)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    bool neighborHas(uint32_t group, uint32_t reg)
+    {
+        for (uint32_t member : members[group])
+        {
+            for (uint32_t other : neighbors[member])
+            {
+                if (color[groupOf(other)] == reg)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    // Gives the two ends of a copy one register where they do not interfere, innermost loops first
+    void coalesce()
+    {
+        parent.resize(valueCount);
+        members.assign(valueCount, {});
+        color = precolor;
+        for (uint32_t value = 0; value < valueCount; value++)
+        {
+            parent[value] = value;
+            members[value].push_back(value);
+        }
+        SsaDominators dominators;
+        dominators.compute(*f);
+        vector<uint32_t> depth(f->blocks.size(), 0);
+        for (const SsaLoop &loop : findLoops(*f, dominators))
+        {
+            for (uint32_t block : loop.blocks)
+                depth[block]++;
+        }
+        vector<pair<uint32_t, uint32_t>> order; // depth, copy
+        for (uint32_t block : f->layout)
+        {
+            for (const Item &item : items[block])
+            {
+                for (uint32_t c = 0; c < item.copyCount; c++)
+                    order.push_back({depth[block], item.firstCopy + c});
+            }
+        }
+        stable_sort(order.begin(), order.end(), [](auto &x, auto &y) { return x.first > y.first; });
+        for (auto [loopDepth, c] : order)
+        {
+            uint32_t x = groupOf(copies[c].to), y = groupOf(copies[c].from);
+            if (x == y || (color[x] != ssaNone && color[y] != ssaNone && color[x] != color[y]) || interferes(x, y))
+                continue;
+            uint32_t reg = color[x] != ssaNone ? color[x] : color[y];
+            if (reg != ssaNone && neighborHas(color[x] == ssaNone ? x : y, reg))
+                continue;
+            if (members[x].size() < members[y].size())
+                swap(x, y);
+            parent[y] = x;
+            members[x].insert(members[x].end(), members[y].begin(), members[y].end());
+            members[y].clear();
+            color[x] = reg;
+        }
+    }
+
+    // Lowest register that is neither pinned nor held by an interfering group, in order of definition
+    bool assignRegisters()
+    {
+        uint32_t stamp = 0;
+        vector<uint32_t> usedStamp;
+        auto give = [&](uint32_t value) {
+            uint32_t group = groupOf(value);
+            if (color[group] != ssaNone)
+                return;
+            stamp++;
+            for (uint32_t member : members[group])
+            {
+                for (uint32_t other : neighbors[member])
+                {
+                    uint32_t reg = color[groupOf(other)];
+                    if (reg == ssaNone)
+                        continue;
+                    if (reg >= usedStamp.size())
+                        usedStamp.resize(reg + 1, 0);
+                    usedStamp[reg] = stamp;
+                }
+            }
+            uint32_t reg = 0;
+            while (f->isPinned(reg) || (reg < usedStamp.size() && usedStamp[reg] == stamp))
+                reg++;
+            color[group] = reg;
+        };
+        for (uint32_t block : f->layout)
+        {
+            for (const Item &item : items[block])
+            {
+                for (uint32_t c = 0; c < item.copyCount; c++)
+                    give(copies[item.firstCopy + c].to);
+                if (f->instructions[item.instruction].defines)
+                    give(item.instruction);
+            }
+        }
+
+        // The frame keeps the pinned registers, the parameters, the result and every argument block
+        registerCount = 0;
+        for (uint32_t reg = 0; reg < f->pinned.size(); reg++)
+        {
+            if (f->pinned[reg])
+                registerCount = reg + 1;
+        }
+        const BytecodeFunction &old = module.functions[f->index];
+        registerCount = max(registerCount, (uint32_t)old.parameterSlots + (f->returnsValue ? 1 : 0));
+        for (uint32_t value = 0; value < valueCount; value++)
+        {
+            uint32_t reg = color[groupOf(value)];
+            if (reg != ssaNone)
+                registerCount = max(registerCount, reg + 1);
+        }
+        for (uint32_t block : f->layout)
+        {
+            for (uint32_t index : f->blocks[block].code)
+            {
+                const SsaInstruction &instruction = f->instructions[index];
+                if (instruction.op == OP_CALL)
+                    registerCount =
+                        max(registerCount, (uint32_t)instruction.reg + module.functions[instruction.c].parameterSlots);
+            }
+        }
+        return registerCount + 1 <= maxRegisters; // one more for a scratch register
+    }
+
+    uint16_t reg(uint32_t value) { return (uint16_t)color[groupOf(value)]; }
+
+    // --- Bytecode ---
+
+    void emit(const Instruction &instruction, uint32_t line)
+    {
+        code.push_back(instruction);
+        lines.push_back(line);
+    }
+
+    // Copies all at once: a register is only overwritten once nothing still needs to read it
+    void emitCopies(const Item &item, uint32_t line)
+    {
+        vector<Copy> pending;
+        for (uint32_t c = 0; c < item.copyCount; c++)
+        {
+            const Copy &copy = copies[item.firstCopy + c];
+            if (reg(copy.to) != reg(copy.from))
+                pending.push_back(Copy{reg(copy.to), reg(copy.from)});
+        }
+        while (!pending.empty())
+        {
+            bool progress = false;
+            for (size_t k = 0; k < pending.size(); k++)
+            {
+                uint32_t to = pending[k].to;
+                bool read = any_of(pending.begin(), pending.end(), [&](const Copy &c) { return c.from == to; });
+                if (read)
+                    continue;
+                emit(Instruction{OP_MOVE, (uint16_t)to, (uint16_t)pending[k].from, 0}, line);
+                pending.erase(pending.begin() + k);
+                progress = true;
+                break;
+            }
+            if (progress)
+                continue;
+            // Every target is still to be read: a cycle, broken through the scratch register
+            uint32_t to = pending[0].to;
+            emit(Instruction{OP_MOVE, (uint16_t)registerCount, (uint16_t)to, 0}, line);
+            usedScratch = true;
+            for (Copy &c : pending)
+            {
+                if (c.from == to)
+                    c.from = registerCount;
+            }
+        }
+    }
+
+    void emitCode()
+    {
+        code.clear();
+        lines.clear();
+        usedScratch = false;
+        vector<uint32_t> start(f->blocks.size(), ssaNone);
+        vector<pair<uint32_t, uint32_t>> jumps; // pc, block
+        auto jump = [&](Opcode op, uint16_t a, uint32_t target, uint32_t line) {
+            jumps.push_back({(uint32_t)code.size(), target});
+            emit(wideInstruction(op, a, 0), line);
+        };
+        for (size_t position = 0; position < f->layout.size(); position++)
+        {
+            uint32_t block = f->layout[position];
+            uint32_t next = position + 1 < f->layout.size() ? f->layout[position + 1] : ssaNone;
+            start[block] = (uint32_t)code.size();
+            for (const Item &item : items[block])
+            {
+                const SsaInstruction &instruction = f->instructions[item.instruction];
+                const uint32_t line = instruction.line;
+                emitCopies(item, line);
+                const uint32_t *successors = f->blocks[block].successors;
+                uint16_t op = instruction.op;
+                switch (op)
+                {
+                case SSA_CONST:
+                {
+                    int64_t value = instruction.constant.i;
+                    if (value >= INT32_MIN && value <= INT32_MAX)
+                        emit(wideInstruction(OP_LOADI, reg(item.instruction), (uint32_t)(int32_t)value), line);
+                    else
+                    {
+                        module.constants.push_back(instruction.constant);
+                        emit(wideInstruction(OP_LOADK, reg(item.instruction),
+                                             (uint32_t)module.constants.size() - 1),
+                             line);
+                    }
+                    break;
+                }
+                case SSA_ENTRY:
+                    break;
+                case SSA_GETR:
+                    if (reg(item.instruction) != instruction.reg)
+                        emit(Instruction{OP_MOVE, reg(item.instruction), instruction.reg, 0}, line);
+                    break;
+                case SSA_SETR:
+                    if (reg(instruction.a) != instruction.reg)
+                        emit(Instruction{OP_MOVE, instruction.reg, reg(instruction.a), 0}, line);
+                    break;
+                case OP_I2R:
+                case OP_NEGI:
+                case OP_NEGR:
+                case OP_NOT:
+                    emit(Instruction{op, reg(item.instruction), reg(instruction.a), 0}, line);
+                    break;
+                case OP_GETG:
+                    emit(wideInstruction(OP_GETG, reg(item.instruction), instruction.c), line);
+                    break;
+                case OP_SETG:
+                    emit(wideInstruction(OP_SETG, reg(instruction.a), instruction.c), line);
+                    break;
+                case OP_GETEL:
+                case OP_GETEG:
+                    emit(Instruction{op, reg(item.instruction), (uint16_t)instruction.c, reg(instruction.a)}, line);
+                    break;
+                case OP_SETEL:
+                case OP_SETEG:
+                    emit(Instruction{op, reg(instruction.a), (uint16_t)instruction.c, reg(instruction.b)}, line);
+                    break;
+                case OP_COPYL:
+                case OP_COPYG:
+                    emit(Instruction{op, instruction.reg, (uint16_t)instruction.c, 0}, line);
+                    break;
+                case OP_CALL:
+                    emit(Instruction{OP_CALL, instruction.reg, (uint16_t)instruction.c,
+                                     instruction.defines ? reg(item.instruction) : (uint16_t)0},
+                         line);
+                    break;
+                case OP_WRITEI:
+                case OP_WRITER:
+                    emit(Instruction{op, reg(instruction.a), 0, 0}, line);
+                    break;
+                case OP_WRITELN:
+                case OP_RET:
+                case OP_HALT:
+                    emit(Instruction{op, 0, 0, 0}, line);
+                    break;
+                case OP_JMP:
+                    if (successors[0] != next)
+                        jump(OP_JMP, 0, successors[0], line);
+                    break;
+                case SSA_BRANCH:
+                    if (successors[1] == next)
+                        jump(OP_JMPT, reg(instruction.a), successors[0], line);
+                    else
+                    {
+                        jump(OP_JMPF, reg(instruction.a), successors[1], line);
+                        if (successors[0] != next)
+                            jump(OP_JMP, 0, successors[0], line);
+                    }
+                    break;
+                default:
+                    emit(Instruction{op, reg(item.instruction), reg(instruction.a), reg(instruction.b)}, line);
+                    break;
+                }
+            }
+        }
+        for (auto [pc, block] : jumps)
+            code[pc] = wideInstruction((Opcode)code[pc].op, code[pc].a, start[block]);
+
+        BytecodeFunction &out = module.functions[f->index];
+        uint32_t frameSize = registerCount + (usedScratch ? 1 : 0);
+        for (uint32_t array : f->localArrays)
+        {
+            module.arrays[array].offset = frameSize;
+            frameSize += module.arrays[array].count;
+        }
+        out.code = move(code);
+        out.lines = move(lines);
+        out.frameSize = frameSize;
+    }
+
+    BytecodeModule &module;
+    SsaFunction *f = nullptr;
+    uint32_t valueCount = 0;
+    vector<uint32_t> precolor; // register a value must be in, or ssaNone
+    vector<vector<Item>> items;
+    vector<Copy> copies;
+    vector<Bits> liveOut;
+    vector<vector<uint32_t>> neighbors;
+    vector<uint32_t> parent, color;
+    vector<vector<uint32_t>> members;
+    uint32_t registerCount = 0;
+    bool usedScratch = false;
+    vector<Instruction> code;
+    vector<uint32_t> lines;
+};
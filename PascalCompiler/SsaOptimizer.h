@@ -0,0 +1,814 @@
+// SsaOptimizer.h
+// Classic optimizations on the SSA form of Ssa.h:
+//   - sparse conditional constant propagation (Wegman and Zadeck): folds
+//     every value that only depends on constants, following only the
+//     branches that can be taken, and removes the blocks that cannot run
+//   - global value numbering over the dominator tree: an expression that a
+//     dominating instruction already computed is reused. Within extended
+//     basic blocks loads also reuse earlier loads and stored values, until a
+//     store to the same array or a call may have changed them
+//   - loop-invariant code motion: pure instructions whose operands come
+//     from outside a loop move to its preheader, innermost loops first
+//   - dead code elimination: what no output, store, call or branch needs
+// Folding computes exactly what the VM would. An instruction that can fail
+// at run time (division by a value that may be zero, an array index that
+// may be out of bounds) is never folded, moved or removed.
+//
+// optimizeModule builds, optimizes and lowers every function of a module.
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+#include "Bytecode.h"
+#include "Ssa.h"
+#include "SsaLowering.h"
+
+using namespace std;
+
+enum SsaPass : uint32_t
+{
+    SSA_PASS_CONSTANTS = 1,
+    SSA_PASS_VALUE_NUMBERING = 2,
+    SSA_PASS_LOOP_INVARIANTS = 4,
+    SSA_PASS_DEAD_CODE = 8,
+    SSA_PASS_ALL = 15
+};
+
+struct SsaStatistics
+{
+    uint32_t folded = 0;          // values that became constants
+    uint32_t branchesFolded = 0;
+    uint32_t blocksRemoved = 0;
+    uint32_t numbered = 0;        // values replaced by an equal dominating one
+    uint32_t loadsReused = 0;     // loads replaced by a loaded or stored value
+    uint32_t hoisted = 0;
+    uint32_t removed = 0;         // dead instructions
+    uint32_t instructionsBefore = 0; // bytecode
+    uint32_t instructionsAfter = 0;
+};
+
+// Value of op on constant operands, as the VM computes it; false when the VM would fail
+inline bool foldSsa(uint16_t op, Value x, Value y, Value &result)
+{
+    switch (op)
+    {
+    case OP_I2R:
+        result.r = (double)x.i;
+        return true;
+    case OP_ADDI:
+        result.i = (int64_t)((uint64_t)x.i + (uint64_t)y.i);
+        return true;
+    case OP_SUBI:
+        result.i = (int64_t)((uint64_t)x.i - (uint64_t)y.i);
+        return true;
+    case OP_MULI:
+        result.i = (int64_t)((uint64_t)x.i * (uint64_t)y.i);
+        return true;
+    case OP_DIVI:
+        if (y.i == 0)
+            return false;
+        result.i = y.i == -1 ? (int64_t)(0 - (uint64_t)x.i) : x.i / y.i;
+        return true;
+    case OP_MODI:
+        if (y.i == 0)
+            return false;
+        result.i = y.i == -1 ? 0 : x.i % y.i;
+        return true;
+    case OP_NEGI:
+        result.i = (int64_t)(0 - (uint64_t)x.i);
+        return true;
+    case OP_ADDR:
+        result.r = x.r + y.r;
+        return true;
+    case OP_SUBR:
+        result.r = x.r - y.r;
+        return true;
+    case OP_MULR:
+        result.r = x.r * y.r;
+        return true;
+    case OP_DIVR:
+        if (y.r == 0)
+            return false;
+        result.r = x.r / y.r;
+        return true;
+    case OP_NEGR:
+        result.r = -x.r;
+        return true;
+    case OP_EQI:
+        result.i = x.i == y.i;
+        return true;
+    case OP_NEI:
+        result.i = x.i != y.i;
+        return true;
+    case OP_LTI:
+        result.i = x.i < y.i;
+        return true;
+    case OP_LEI:
+        result.i = x.i <= y.i;
+        return true;
+    case OP_EQR:
+        result.i = x.r == y.r;
+        return true;
+    case OP_NER:
+        result.i = x.r != y.r;
+        return true;
+    case OP_LTR:
+        result.i = x.r < y.r;
+        return true;
+    case OP_LER:
+        result.i = x.r <= y.r;
+        return true;
+    case OP_AND:
+        result.i = (x.i != 0) & (y.i != 0);
+        return true;
+    case OP_OR:
+        result.i = (x.i != 0) | (y.i != 0);
+        return true;
+    case OP_NOT:
+        result.i = x.i == 0;
+        return true;
+    default:
+        return false;
+    }
+}
+
+class SsaOptimizer
+{
+public:
+    SsaOptimizer(const BytecodeModule &module, uint32_t passes = SSA_PASS_ALL) : module(module), passes(passes) {}
+
+    void run(SsaFunction &function)
+    {
+        this->function = &function;
+        if (passes & SSA_PASS_CONSTANTS)
+            propagateConstants();
+        if (passes & SSA_PASS_VALUE_NUMBERING)
+            numberValues();
+        if (passes & SSA_PASS_LOOP_INVARIANTS)
+        {
+            hoistInvariants();
+            // Constants hoisted from several loops meet in one preheader
+            if (passes & SSA_PASS_VALUE_NUMBERING)
+                numberValues();
+        }
+        if (passes & SSA_PASS_DEAD_CODE)
+            removeDeadCode();
+    }
+
+    const SsaStatistics &statistics() const { return counts; }
+    SsaStatistics &statistics() { return counts; }
+
+private:
+    // --- Shared ---
+
+    bool isConstant(uint32_t value) const { return function->instructions[value].op == SSA_CONST; }
+
+    // Can the instruction fail at run time, given what is known of its operands?
+    bool mayFail(uint32_t index) const
+    {
+        const SsaInstruction &instruction = function->instructions[index];
+        switch (instruction.op)
+        {
+        case OP_DIVI:
+        case OP_MODI:
+            return !isConstant(instruction.b) || function->instructions[instruction.b].constant.i == 0;
+        case OP_DIVR:
+            return !isConstant(instruction.b) || function->instructions[instruction.b].constant.r == 0;
+        case OP_GETEL:
+        case OP_GETEG:
+        {
+            if (!isConstant(instruction.a))
+                return true;
+            const ArrayInfo &array = module.arrays[instruction.c];
+            return (uint64_t)(function->instructions[instruction.a].constant.i - array.low) >= array.count;
+        }
+        default:
+            return false;
+        }
+    }
+
+    // --- Sparse conditional constant propagation ---
+
+    enum Lattice : uint8_t
+    {
+        LATTICE_UNKNOWN,
+        LATTICE_CONSTANT,
+        LATTICE_VARYING
+    };
+
+    void propagateConstants()
+    {
+        SsaFunction &f = *function;
+        size_t count = f.instructions.size();
+        state.assign(count, LATTICE_UNKNOWN);
+        known.assign(count, Value{0});
+        users.assign(count, {});
+        for (uint32_t block : f.layout)
+        {
+            for (uint32_t index : f.blocks[block].code)
+                forEachOperand(f, index, [&](uint32_t operand) { users[operand].push_back(index); });
+        }
+        liveEdges.assign(f.blocks.size(), {});
+        for (uint32_t block : f.layout)
+            liveEdges[block].assign(f.blocks[block].predecessors.size(), false);
+        liveBlocks.assign(f.blocks.size(), false);
+        edgeWork.clear();
+        valueWork.clear();
+
+        liveBlocks[0] = true;
+        for (uint32_t index : f.blocks[0].code)
+            evaluate(index);
+        while (!edgeWork.empty() || !valueWork.empty())
+        {
+            if (!edgeWork.empty())
+            {
+                auto [from, to] = edgeWork.back();
+                edgeWork.pop_back();
+                const vector<uint32_t> &predecessors = f.blocks[to].predecessors;
+                size_t at = find(predecessors.begin(), predecessors.end(), from) - predecessors.begin();
+                if (liveEdges[to][at])
+                    continue;
+                liveEdges[to][at] = true;
+                if (!liveBlocks[to])
+                {
+                    liveBlocks[to] = true;
+                    for (uint32_t index : f.blocks[to].code)
+                        evaluate(index);
+                }
+                else
+                {
+                    for (size_t k = 0, phis = f.phiCount(to); k < phis; k++)
+                        evaluate(f.blocks[to].code[k]);
+                }
+                continue;
+            }
+            uint32_t index = valueWork.back();
+            valueWork.pop_back();
+            if (liveBlocks[f.instructions[index].block])
+                evaluate(index);
+        }
+
+        // Constants replace what they were computed by; branches that cannot go both ways become jumps
+        vector<uint32_t> layout;
+        for (uint32_t block : f.layout)
+        {
+            if (!liveBlocks[block])
+                continue;
+            layout.push_back(block);
+            SsaBlock &current = f.blocks[block];
+            for (uint32_t index : current.code)
+            {
+                SsaInstruction &instruction = f.instructions[index];
+                if (instruction.defines && instruction.op != SSA_CONST && state[index] == LATTICE_CONSTANT)
+                {
+                    instruction.op = SSA_CONST;
+                    instruction.constant = known[index];
+                    instruction.a = instruction.b = instruction.c = 0;
+                    counts.folded++;
+                }
+            }
+            stable_partition(current.code.begin(), current.code.end(),
+                             [&](uint32_t index) { return f.instructions[index].op == SSA_PHI; });
+            SsaInstruction &last = f.instructions[current.code.back()];
+            if (last.op == SSA_BRANCH && state[last.a] == LATTICE_CONSTANT)
+            {
+                int taken = known[last.a].i != 0 ? 0 : 1;
+                dropPredecessor(f, current.successors[1 - taken], block);
+                current.successors[0] = current.successors[taken];
+                current.successors[1] = ssaNone;
+                last.op = OP_JMP;
+                last.a = 0;
+                counts.branchesFolded++;
+            }
+        }
+        for (uint32_t block : f.layout)
+        {
+            if (liveBlocks[block])
+                continue;
+            SsaBlock &dead = f.blocks[block];
+            for (uint32_t successor : dead.successors)
+            {
+                if (successor != ssaNone && liveBlocks[successor])
+                    dropPredecessor(f, successor, block);
+            }
+            for (uint32_t index : dead.code)
+                f.instructions[index].op = SSA_DEAD;
+            dead = SsaBlock();
+            counts.blocksRemoved++;
+        }
+        f.layout = move(layout);
+    }
+
+    void evaluate(uint32_t index)
+    {
+        SsaFunction &f = *function;
+        const SsaInstruction &instruction = f.instructions[index];
+        const SsaBlock &block = f.blocks[instruction.block];
+        switch (instruction.op)
+        {
+        case OP_JMP:
+            edgeWork.push_back({instruction.block, block.successors[0]});
+            return;
+        case SSA_BRANCH:
+            if (state[instruction.a] == LATTICE_VARYING)
+            {
+                edgeWork.push_back({instruction.block, block.successors[0]});
+                edgeWork.push_back({instruction.block, block.successors[1]});
+            }
+            else if (state[instruction.a] == LATTICE_CONSTANT)
+                edgeWork.push_back({instruction.block, block.successors[known[instruction.a].i != 0 ? 0 : 1]});
+            return;
+        default:
+            break;
+        }
+        if (!instruction.defines || state[index] == LATTICE_VARYING)
+            return;
+
+        Lattice now = LATTICE_VARYING;
+        Value value{0};
+        if (instruction.op == SSA_CONST)
+        {
+            now = LATTICE_CONSTANT;
+            value = instruction.constant;
+        }
+        else if (instruction.op == SSA_PHI)
+        {
+            now = LATTICE_UNKNOWN;
+            for (uint32_t k = 0; k < instruction.b && now != LATTICE_VARYING; k++)
+            {
+                uint32_t operand = f.operands[instruction.a + k];
+                if (!liveEdges[instruction.block][k] || state[operand] == LATTICE_UNKNOWN)
+                    continue;
+                if (state[operand] == LATTICE_VARYING ||
+                    (now == LATTICE_CONSTANT && known[operand].i != value.i))
+                    now = LATTICE_VARYING;
+                else
+                {
+                    now = LATTICE_CONSTANT;
+                    value = known[operand];
+                }
+            }
+        }
+        else if (ssaIsPure(instruction.op))
+        {
+            int operands = ssaOperandCount(instruction.op, f.returnsValue);
+            Lattice x = state[instruction.a], y = operands > 1 ? state[instruction.b] : LATTICE_CONSTANT;
+            if (x == LATTICE_VARYING || y == LATTICE_VARYING)
+                now = LATTICE_VARYING;
+            else if (x == LATTICE_UNKNOWN || y == LATTICE_UNKNOWN)
+                now = LATTICE_UNKNOWN;
+            else if (foldSsa(instruction.op, known[instruction.a], operands > 1 ? known[instruction.b] : Value{0},
+                             value))
+                now = LATTICE_CONSTANT;
+        }
+        if (now == state[index])
+            return;
+        state[index] = now;
+        known[index] = value;
+        for (uint32_t user : users[index])
+            valueWork.push_back(user);
+    }
+
+    // --- Global value numbering ---
+
+    struct Expression
+    {
+        uint16_t op;
+        uint32_t a, b, c;
+        int64_t constant;
+
+        bool operator==(const Expression &other) const
+        {
+            return op == other.op && a == other.a && b == other.b && c == other.c && constant == other.constant;
+        }
+    };
+
+    struct ExpressionHash
+    {
+        size_t operator()(const Expression &e) const
+        {
+            uint64_t h = e.op * 0x9E3779B97F4A7C15ull;
+            h = (h ^ e.a) * 0xBF58476D1CE4E5B9ull;
+            h = (h ^ e.b) * 0x94D049BB133111EBull;
+            h = (h ^ e.c) * 0x9E3779B97F4A7C15ull;
+            h = (h ^ (uint64_t)e.constant) * 0xBF58476D1CE4E5B9ull;
+            return (size_t)(h ^ (h >> 29));
+        }
+    };
+
+    // What a load would read: GETEL/GETEG array c at index, GETG global c, GETR register c
+    struct Memory
+    {
+        uint16_t op;
+        uint32_t c, index;
+        uint32_t value;
+    };
+
+    uint32_t resolve(uint32_t value)
+    {
+        while (forward[value] != value)
+            value = forward[value] = forward[forward[value]];
+        return value;
+    }
+
+    void replace(uint32_t index, uint32_t by)
+    {
+        forward[index] = by;
+        function->instructions[index].op = SSA_DEAD;
+    }
+
+    void numberValues()
+    {
+        SsaFunction &f = *function;
+        SsaDominators dominators;
+        dominators.compute(f);
+        forward.resize(f.instructions.size());
+        for (uint32_t k = 0; k < forward.size(); k++)
+            forward[k] = k;
+        unordered_map<Expression, uint32_t, ExpressionHash> available;
+        vector<Expression> added;
+        vector<vector<Memory>> memoryAtEnd(f.blocks.size());
+
+        vector<pair<uint32_t, size_t>> walk{{0, 0}};
+        vector<size_t> marks{0};
+        numberBlock(0, dominators, available, added, memoryAtEnd);
+        while (!walk.empty())
+        {
+            auto &[block, next] = walk.back();
+            if (next < dominators.children[block].size())
+            {
+                uint32_t child = dominators.children[block][next++];
+                marks.push_back(added.size());
+                numberBlock(child, dominators, available, added, memoryAtEnd);
+                walk.push_back({child, 0});
+                continue;
+            }
+            for (size_t k = added.size(); k > marks.back(); k--)
+                available.erase(added[k - 1]);
+            added.resize(marks.back());
+            marks.pop_back();
+            memoryAtEnd[block].clear();
+            walk.pop_back();
+        }
+
+        // Phi operands from back edges, and the blocks' lists
+        for (uint32_t block : f.layout)
+        {
+            vector<uint32_t> &code = f.blocks[block].code;
+            code.erase(remove_if(code.begin(), code.end(),
+                                 [&](uint32_t index) { return f.instructions[index].op == SSA_DEAD; }),
+                       code.end());
+            for (uint32_t index : code)
+                forEachOperand(f, index, [&](uint32_t &operand) { operand = resolve(operand); });
+        }
+    }
+
+    void numberBlock(uint32_t block, const SsaDominators &dominators,
+                     unordered_map<Expression, uint32_t, ExpressionHash> &available, vector<Expression> &added,
+                     vector<vector<Memory>> &memoryAtEnd)
+    {
+        SsaFunction &f = *function;
+        const SsaBlock &current = f.blocks[block];
+        // Memory is known only where the one way in is from the dominator
+        vector<Memory> memory;
+        if (current.predecessors.size() == 1)
+            memory = memoryAtEnd[dominators.idom[block]];
+        auto forget = [&](auto &&matches) {
+            memory.erase(remove_if(memory.begin(), memory.end(), matches), memory.end());
+        };
+        auto recall = [&](uint16_t op, uint32_t c, uint32_t index) {
+            for (const Memory &m : memory)
+            {
+                if (m.op == op && m.c == c && m.index == index)
+                    return m.value;
+            }
+            return ssaNone;
+        };
+
+        for (size_t k = 0; k < current.code.size(); k++)
+        {
+            uint32_t index = current.code[k];
+            forEachOperand(f, index, [&](uint32_t &operand) { operand = resolve(operand); });
+            SsaInstruction &instruction = f.instructions[index];
+            switch (instruction.op)
+            {
+            case SSA_PHI:
+            {
+                // A phi of one value, besides itself, is that value
+                uint32_t same = ssaNone;
+                bool one = true;
+                for (uint32_t j = 0; j < instruction.b && one; j++)
+                {
+                    uint32_t operand = f.operands[instruction.a + j];
+                    if (operand == index || operand == same)
+                        continue;
+                    one = same == ssaNone;
+                    same = operand;
+                }
+                if (one && same != ssaNone)
+                {
+                    replace(index, same);
+                    counts.numbered++;
+                    continue;
+                }
+                // Or an earlier phi of the block with the same operands
+                for (size_t j = 0; j < k; j++)
+                {
+                    const SsaInstruction &other = f.instructions[current.code[j]];
+                    if (other.op == SSA_PHI &&
+                        equal(f.operands.begin() + other.a, f.operands.begin() + other.a + other.b,
+                              f.operands.begin() + instruction.a))
+                    {
+                        replace(index, current.code[j]);
+                        counts.numbered++;
+                        break;
+                    }
+                }
+                continue;
+            }
+            case OP_GETEL:
+            case OP_GETEG:
+            case OP_GETG:
+            case SSA_GETR:
+            {
+                uint32_t c = instruction.op == SSA_GETR ? instruction.reg : instruction.c;
+                uint32_t at = instruction.op == OP_GETEL || instruction.op == OP_GETEG ? instruction.a : 0;
+                uint32_t value = recall(instruction.op, c, at);
+                if (value != ssaNone)
+                {
+                    replace(index, value);
+                    counts.loadsReused++;
+                }
+                else
+                    memory.push_back(Memory{instruction.op, c, at, index});
+                continue;
+            }
+            case OP_SETEL:
+            case OP_SETEG:
+            {
+                uint16_t load = instruction.op == OP_SETEL ? OP_GETEL : OP_GETEG;
+                uint32_t array = instruction.c;
+                forget([&](const Memory &m) { return m.op == load && m.c == array; });
+                memory.push_back(Memory{load, array, instruction.b, instruction.a});
+                continue;
+            }
+            case OP_SETG:
+            case SSA_SETR:
+            {
+                uint16_t load = instruction.op == OP_SETG ? (uint16_t)OP_GETG : (uint16_t)SSA_GETR;
+                uint32_t c = instruction.op == SSA_SETR ? instruction.reg : instruction.c;
+                forget([&](const Memory &m) { return m.op == load && m.c == c; });
+                memory.push_back(Memory{load, c, 0, instruction.a});
+                continue;
+            }
+            case OP_CALL:
+            case OP_COPYL:
+            case OP_COPYG:
+                // The callee may change globals; local arrays are out of its reach
+                forget([&](const Memory &m) { return m.op != OP_GETEL; });
+                continue;
+            default:
+                break;
+            }
+            if (!ssaIsPure(instruction.op))
+                continue;
+            if (ssaIsCommutative(instruction.op) && instruction.a > instruction.b)
+                swap(instruction.a, instruction.b);
+            Expression key{instruction.op, instruction.a, instruction.b, instruction.c,
+                           instruction.op == SSA_CONST ? instruction.constant.i : 0};
+            auto found = available.find(key);
+            if (found != available.end())
+            {
+                replace(index, found->second);
+                counts.numbered++;
+                continue;
+            }
+            available.emplace(key, index);
+            added.push_back(key);
+        }
+        memoryAtEnd[block] = move(memory);
+    }
+
+    // --- Loop-invariant code motion ---
+
+    void hoistInvariants()
+    {
+        SsaFunction &f = *function;
+        SsaDominators dominators;
+        dominators.compute(f);
+        vector<SsaLoop> loops = findLoops(f, dominators);
+        vector<vector<bool>> inLoop(loops.size());
+        for (size_t l = 0; l < loops.size(); l++)
+        {
+            inLoop[l].assign(f.blocks.size(), false);
+            for (uint32_t block : loops[l].blocks)
+                inLoop[l][block] = true;
+        }
+        auto contains = [&](size_t l, uint32_t block) { return block < inLoop[l].size() && inLoop[l][block]; };
+
+        for (size_t l = 0; l < loops.size(); l++)
+        {
+            uint32_t header = loops[l].header;
+            uint32_t preheader = preheaderOf(header, inLoop[l]);
+            // A new preheader belongs to the loops around this one
+            for (size_t outer = l + 1; outer < loops.size(); outer++)
+            {
+                if (contains(outer, header) && loops[outer].header != header)
+                {
+                    inLoop[outer].resize(f.blocks.size(), false);
+                    inLoop[outer][preheader] = true;
+                    loops[outer].blocks.push_back(preheader);
+                }
+            }
+
+            vector<uint32_t> moving;
+            vector<bool> invariant(f.instructions.size(), false);
+            for (bool changed = true; changed;)
+            {
+                changed = false;
+                for (uint32_t block : loops[l].blocks)
+                {
+                    for (uint32_t index : f.blocks[block].code)
+                    {
+                        const SsaInstruction &instruction = f.instructions[index];
+                        if (invariant[index] || !ssaIsPure(instruction.op) || mayFail(index))
+                            continue;
+                        bool outside = true;
+                        forEachOperand(f, index, [&](uint32_t operand) {
+                            outside = outside && (invariant[operand] || !contains(l, f.instructions[operand].block));
+                        });
+                        if (!outside)
+                            continue;
+                        invariant[index] = true;
+                        moving.push_back(index);
+                        changed = true;
+                    }
+                }
+            }
+            vector<uint32_t> &target = f.blocks[preheader].code;
+            for (uint32_t index : moving)
+            {
+                SsaInstruction &instruction = f.instructions[index];
+                vector<uint32_t> &code = f.blocks[instruction.block].code;
+                code.erase(find(code.begin(), code.end(), index));
+                target.insert(target.end() - 1, index);
+                instruction.block = preheader;
+                counts.hoisted++;
+            }
+        }
+    }
+
+    // The one block outside the loop that leads to its header, made when there is none
+    uint32_t preheaderOf(uint32_t header, const vector<bool> &inLoop)
+    {
+        SsaFunction &f = *function;
+        vector<uint32_t> outside, inside;
+        vector<size_t> outsideAt, insideAt;
+        const vector<uint32_t> &predecessors = f.blocks[header].predecessors;
+        for (size_t k = 0; k < predecessors.size(); k++)
+        {
+            bool in = predecessors[k] < inLoop.size() && inLoop[predecessors[k]];
+            (in ? inside : outside).push_back(predecessors[k]);
+            (in ? insideAt : outsideAt).push_back(k);
+        }
+        if (outside.size() == 1 && f.blocks[outside[0]].successorCount() == 1)
+            return outside[0];
+
+        uint32_t preheader = f.addBlock();
+        SsaInstruction jump;
+        jump.op = OP_JMP;
+        jump.block = preheader;
+        jump.line = f.instructions[f.blocks[header].code.front()].line;
+        f.blocks[preheader].successors[0] = header;
+        f.blocks[preheader].predecessors = outside;
+        for (uint32_t from : outside)
+        {
+            uint32_t *successors = f.blocks[from].successors;
+            for (int k = 0; k < 2; k++)
+            {
+                if (successors[k] == header)
+                    successors[k] = preheader;
+            }
+        }
+        // Phis of the header take the outside values from the preheader, merged there when there are several
+        for (size_t k = 0, phis = f.phiCount(header); k < phis; k++)
+        {
+            uint32_t index = f.blocks[header].code[k];
+            SsaInstruction phi = f.instructions[index];
+            uint32_t fromOutside;
+            if (outside.size() == 1)
+                fromOutside = f.operands[phi.a + outsideAt[0]];
+            else
+            {
+                SsaInstruction merge = phi;
+                merge.block = preheader;
+                merge.a = (uint32_t)f.operands.size();
+                merge.b = (uint32_t)outside.size();
+                for (size_t at : outsideAt)
+                    f.operands.push_back(f.operands[phi.a + at]);
+                fromOutside = f.add(merge);
+                f.blocks[preheader].code.push_back(fromOutside);
+            }
+            uint32_t first = (uint32_t)f.operands.size();
+            f.operands.push_back(fromOutside);
+            for (size_t at : insideAt)
+                f.operands.push_back(f.operands[phi.a + at]);
+            f.instructions[index].a = first;
+            f.instructions[index].b = (uint32_t)(1 + inside.size());
+        }
+        f.blocks[preheader].code.push_back(f.add(jump));
+        vector<uint32_t> &headerPredecessors = f.blocks[header].predecessors;
+        headerPredecessors.assign(1, preheader);
+        headerPredecessors.insert(headerPredecessors.end(), inside.begin(), inside.end());
+        f.layout.insert(find(f.layout.begin(), f.layout.end(), header), preheader);
+        return preheader;
+    }
+
+    // --- Dead code elimination ---
+
+    void removeDeadCode()
+    {
+        SsaFunction &f = *function;
+        vector<bool> live(f.instructions.size(), false);
+        vector<uint32_t> work;
+        for (uint32_t block : f.layout)
+        {
+            for (uint32_t index : f.blocks[block].code)
+            {
+                if (ssaHasEffect(f.instructions[index].op) || mayFail(index))
+                {
+                    live[index] = true;
+                    work.push_back(index);
+                }
+            }
+        }
+        while (!work.empty())
+        {
+            uint32_t index = work.back();
+            work.pop_back();
+            forEachOperand(f, index, [&](uint32_t operand) {
+                if (!live[operand])
+                {
+                    live[operand] = true;
+                    work.push_back(operand);
+                }
+            });
+        }
+        for (uint32_t block : f.layout)
+        {
+            vector<uint32_t> &code = f.blocks[block].code;
+            for (uint32_t index : code)
+            {
+                if (!live[index])
+                {
+                    f.instructions[index].op = SSA_DEAD;
+                    counts.removed++;
+                }
+            }
+            code.erase(remove_if(code.begin(), code.end(), [&](uint32_t index) { return !live[index]; }),
+                       code.end());
+        }
+    }
+
+    const BytecodeModule &module;
+    uint32_t passes;
+    SsaFunction *function = nullptr;
+    SsaStatistics counts;
+
+    // Constant propagation
+    vector<Lattice> state;
+    vector<Value> known;
+    vector<vector<uint32_t>> users;
+    vector<vector<bool>> liveEdges; // by block, by predecessor
+    vector<bool> liveBlocks;
+    vector<pair<uint32_t, uint32_t>> edgeWork;
+    vector<uint32_t> valueWork;
+
+    // Value numbering
+    vector<uint32_t> forward; // what each value was replaced by
+};
+
+// Optimizes every function of the module in place. A function whose frame
+// would need more than 16-bit registers keeps its bytecode.
+// Prints each optimized function to listing, when there is one
+inline SsaStatistics optimizeModule(BytecodeModule &module, uint32_t passes = SSA_PASS_ALL, ostream *listing = nullptr)
+{
+    SsaBuilder builder(module);
+    SsaOptimizer optimizer(module, passes);
+    SsaLowering lowering(module);
+    SsaFunction function;
+    for (uint32_t index = 0; index < module.functions.size(); index++)
+    {
+        optimizer.statistics().instructionsBefore += (uint32_t)module.functions[index].code.size();
+        builder.build(index, function);
+        optimizer.run(function);
+        if (listing != nullptr)
+            printSsa(*listing, function);
+        lowering.lower(function);
+        optimizer.statistics().instructionsAfter += (uint32_t)module.functions[index].code.size();
+    }
+    return optimizer.statistics();
+}
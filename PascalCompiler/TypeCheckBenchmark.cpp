@@ -0,0 +1,176 @@
+// Libraries
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include "../Lab2/MappedFile.h"
+#include "../Lab4/IdentifierTable.h"
+#include "../Lab4/PascalSourceGenerator.h"
+#include "Arena.h"
+#include "Ast.h"
+#include "BytecodeCompiler.h"
+#include "PascalParser.h"
+#include "TypeChecker.h"
+
+using namespace std;
+
+// Time of TypeChecker on a source file or on a generated program of about
+// N lines (a million by default), best of R runs. The program is parsed once.
+// Then each run checks the tree into TypeAnnotations again, and compiles it
+// to bytecode from those annotations, which no longer derives any type; a
+// program past the limits of the bytecode, such as 65536 subprograms, gets
+// its diagnostic instead. The parse is timed too, for scale. --types lists
+// the interned types.
+//
+// Usage:
+//   TypeCheckBenchmark [source.pas] [--lines N] [--runs R] [--seed N] [--types]
+
+// Structs
+struct Best
+{
+    double seconds = 0;
+
+    void add(double run, int r)
+    {
+        if (r == 0 || run < seconds)
+            seconds = run;
+    }
+};
+
+// Function Prototypes
+string generateLines(uint64_t seed, size_t lines);
+double since(chrono::steady_clock::time_point start);
+
+// Main Function
+int main(int argc, char *argv[])
+{
+    try
+    {
+        string sourcePath;
+        size_t lineTarget = 1000000;
+        int runs = 5;
+        uint64_t seed = 1;
+        bool listTypes = false;
+        for (int i = 1; i < argc; i++)
+        {
+            string argument = argv[i];
+            if (argument == "--lines" && i + 1 < argc)
+                lineTarget = stoul(argv[++i]);
+            else if (argument == "--runs" && i + 1 < argc)
+                runs = max(1, stoi(argv[++i]));
+            else if (argument == "--seed" && i + 1 < argc)
+                seed = stoull(argv[++i]);
+            else if (argument == "--types")
+                listTypes = true;
+            else
+                sourcePath = argument;
+        }
+
+        MappedFile file;
+        string generated;
+        const char *data;
+        size_t size;
+        if (!sourcePath.empty())
+        {
+            if (!file.open(sourcePath))
+            {
+                cerr << "File could not be opened: " << sourcePath << endl;
+                return 1;
+            }
+            data = file.data();
+            size = file.size();
+        }
+        else
+        {
+            generated = generateLines(seed, lineTarget);
+            data = generated.data();
+            size = generated.size();
+        }
+        string label = sourcePath.empty() ? "generated" : sourcePath;
+
+        Arena arena;
+        Ast ast(arena);
+        IdentifierTable identifiers;
+        vector<Diagnostic> diagnostics;
+        auto start = chrono::steady_clock::now();
+        bool parsed = PascalParser(data, size, identifiers).parse(ast, diagnostics);
+        double parseSeconds = since(start);
+
+        TypeAnnotations annotations;
+        if (!parsed || !TypeChecker(ast, identifiers).check(annotations, diagnostics))
+        {
+            for (const Diagnostic &diagnostic : diagnostics)
+                cerr << label << ":" << diagnostic.line << ": " << diagnostic.message << endl;
+            return 1;
+        }
+
+        Best check, compile;
+        bool compiled = true;
+        for (int r = 0; r < runs; r++)
+        {
+            start = chrono::steady_clock::now();
+            TypeChecker(ast, identifiers).check(annotations, diagnostics);
+            check.add(since(start), r);
+
+            BytecodeModule module;
+            start = chrono::steady_clock::now();
+            compiled = BytecodeCompiler(ast, identifiers).compile(module, annotations, diagnostics);
+            compile.add(since(start), r);
+        }
+
+        uint64_t lines = count(data, data + size, '\n');
+        uint32_t expressions = 0, widened = 0;
+        for (uint32_t i = 1; i <= ast.nodeCount(); i++)
+        {
+            NodeKind kind = ast[i].kind;
+            expressions += kind >= NODE_NAME && kind <= NODE_BINARY;
+            widened += annotations.widened[i];
+        }
+        size_t sideBytes = annotations.types.size() * sizeof(TypeId) + annotations.widened.size();
+        cout << "Source: " << label << ", " << size << " bytes, " << lines << " lines, " << ast.nodeCount()
+             << " nodes, " << expressions << " expressions" << endl;
+        cout << "Types: " << annotations.table.size() << " interned, " << widened << " integers widened to real, "
+             << sideBytes / (1024.0 * 1024.0) << " MB of side arrays" << endl;
+        cout << "Parse once: " << parseSeconds * 1000 << " ms" << endl;
+        cout << "Best of " << runs << ", type check: " << check.seconds * 1000 << " ms, "
+             << lines / check.seconds / 1e6 << " M lines/s, " << ast.nodeCount() / check.seconds / 1e6
+             << " M nodes/s" << endl;
+        if (compiled)
+            cout << "Best of " << runs << ", bytecode from the annotations: " << compile.seconds * 1000 << " ms" << endl;
+        else
+            cout << "Bytecode: not compiled, line " << diagnostics.back().line << ": " << diagnostics.back().message
+                 << endl;
+        if (listTypes)
+        {
+            for (size_t id = 0; id < annotations.table.size(); id++)
+                cout << "  " << id << ": " << annotations.table.name((TypeId)id) << endl;
+        }
+        return 0;
+    }
+    catch (exception &e)
+    {
+        cout << "Error occurred: " << e.what() << endl;
+        return 1;
+    }
+}
+
+// PascalSourceGenerator works in bytes: grows the size until the program has the lines
+string generateLines(uint64_t seed, size_t lines)
+{
+    size_t bytes = lines * 40;
+    for (;;)
+    {
+        string source = PascalSourceGenerator(seed).generate(bytes);
+        size_t have = max<size_t>(1, count(source.begin(), source.end(), '\n'));
+        if (have >= lines)
+            return source;
+        bytes = (size_t)(bytes * ((double)lines / have) * 1.01);
+    }
+}
+
+double since(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,488 @@
+// TypeChecker.h
+// Names and types of a parsed Pascal-subset program (Ast.h), checked once
+// before code generation, by the rules listed in BytecodeCompiler.h.
+//
+// Types are interned in a TypeTable as 16-bit ids. integer and real keep
+// their AstType values. Each distinct array type, by element type and
+// bounds, gets the next id. Types compare by id, with no tree to walk.
+//
+// Results go in TypeAnnotations: two side arrays indexed like the Ast's
+// nodes. types holds the type of every expression as written, and of every
+// declaration. widened marks each integer expression whose value is used as
+// a real, on the node being widened. That covers an operand of / or of an
+// operator whose other operand is real, an integer assigned to a real, and
+// an integer argument passed for a real parameter. So the code generator
+// reads each coercion off its node; it never works one out again.
+//
+// Subprograms may call each other in any order, so all of them are declared
+// before any body is checked. Bodies are checked in the order the bytecode
+// compiler emits them: subprograms first, then the program's body. The first
+// error stops the check and is reported as a Diagnostic.
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Ast.h"
+#include "../Lab4/IdentifierTable.h"
+#include "../Lab6/SymbolTable.h"
+
+using namespace std;
+
+typedef uint16_t TypeId;
+
+enum : TypeId
+{
+    TYPE_NONE = AST_TYPE_NONE, // statements, procedures
+    TYPE_INTEGER = AST_TYPE_INTEGER,
+    TYPE_REAL = AST_TYPE_REAL
+};
+
+struct TypeInfo
+{
+    uint8_t element; // AstType of an array's elements; AST_TYPE_NONE for the standard types
+    int32_t low, high;
+};
+
+class TypeTable
+{
+public:
+    TypeTable() : types{{AST_TYPE_NONE, 0, 0}, {AST_TYPE_NONE, 0, 0}, {AST_TYPE_NONE, 0, 0}} {}
+
+    // The id of array [low..high] of element, made on first use
+    TypeId array(uint8_t element, int32_t low, int32_t high)
+    {
+        uint64_t key = ((uint64_t)(uint32_t)low << 32) | (uint32_t)high;
+        auto &ids = arrays[element == AST_TYPE_REAL];
+        auto found = ids.find(key);
+        if (found != ids.end())
+            return found->second;
+        if (types.size() > 0xFFFF)
+            throw runtime_error("too many array types");
+        TypeId id = (TypeId)types.size();
+        types.push_back(TypeInfo{element, low, high});
+        ids.emplace(key, id);
+        return id;
+    }
+
+    // What a VARIABLES, PARAMETERS or FUNCTION node declares
+    TypeId declared(const AstNode &declaration)
+    {
+        if (declaration.flags & NODE_FLAG_ARRAY)
+            return array(declaration.type, (int32_t)declaration.c, (int32_t)declaration.d);
+        return declaration.type;
+    }
+
+    bool isArray(TypeId id) const { return id > TYPE_REAL; }
+    uint8_t element(TypeId id) const { return types[id].element; }
+    uint64_t count(TypeId id) const { return (uint64_t)((int64_t)types[id].high - types[id].low + 1); }
+    const TypeInfo &operator[](TypeId id) const { return types[id]; }
+    size_t size() const { return types.size(); }
+
+    string name(TypeId id) const
+    {
+        if (!isArray(id))
+            return id == TYPE_REAL ? "real" : id == TYPE_INTEGER ? "integer" : "none";
+        const TypeInfo &info = types[id];
+        return "array [" + to_string(info.low) + ".." + to_string(info.high) + "] of " + name(info.element);
+    }
+
+private:
+    vector<TypeInfo> types;
+    unordered_map<uint64_t, TypeId> arrays[2]; // by element: bounds to id
+};
+
+struct TypeAnnotations
+{
+    TypeTable table;
+    vector<TypeId> types;    // by node
+    vector<uint8_t> widened; // by node: 1 when the integer value is used as a real
+
+    // The type the node's value has where it is used
+    TypeId valueType(uint32_t node) const { return widened[node] ? (TypeId)TYPE_REAL : types[node]; }
+};
+
+class TypeChecker
+{
+public:
+    TypeChecker(const Ast &ast, IdentifierTable &identifiers) : ast(ast), identifiers(identifiers) {}
+
+    // Returns false, with the error in diagnostics, when the program is not valid
+    bool check(TypeAnnotations &annotations, vector<Diagnostic> &diagnostics)
+    {
+        out = &annotations;
+        annotations.table = TypeTable();
+        annotations.types.assign(ast.nodeCount() + 1, TYPE_NONE);
+        annotations.widened.assign(ast.nodeCount() + 1, 0);
+        try
+        {
+            checkProgram();
+            return true;
+        }
+        catch (const CheckError &error)
+        {
+            diagnostics.push_back(Diagnostic{error.line, 0, error.message});
+            return false;
+        }
+        catch (const runtime_error &error)
+        {
+            diagnostics.push_back(Diagnostic{ast[ast.root].line, 0, error.what()});
+            return false;
+        }
+    }
+
+private:
+    struct CheckError
+    {
+        uint32_t line;
+        string message;
+    };
+
+    struct Subprogram
+    {
+        uint32_t node;
+        TypeId result;
+        uint32_t parameters, parameterCount; // in parameterTypes
+    };
+
+    [[noreturn]] void fail(uint32_t line, const string &message) { throw CheckError{line, message}; }
+
+    string name(uint32_t id) const { return string(identifiers.name(id)); }
+
+    // --- Declarations ---
+
+    void checkProgram()
+    {
+        const AstNode &program = ast[ast.root];
+        symbols = SymbolTable(identifiers.size());
+        subprograms.clear();
+        parameterTypes.clear();
+        writeId = identifiers.intern("write");
+        writelnId = identifiers.intern("writeln");
+
+        symbols.declare(program.a, SYMBOL_PROGRAM, 0, program.line);
+        const uint32_t *declarations = ast.listItems(program.c);
+        uint32_t declarationCount = ast.listSize(program.c);
+        for (uint32_t i = 0; i < declarationCount; i++)
+        {
+            if (ast[declarations[i]].kind == NODE_VARIABLES)
+                declareVariables(declarations[i]);
+        }
+
+        // Every subprogram is declared before any body is checked
+        for (uint32_t i = 0; i < declarationCount; i++)
+        {
+            const AstNode &declaration = ast[declarations[i]];
+            if (declaration.kind != NODE_FUNCTION && declaration.kind != NODE_PROCEDURE)
+                continue;
+            SymbolKind kind = declaration.kind == NODE_FUNCTION ? SYMBOL_FUNCTION : SYMBOL_PROCEDURE;
+            if (symbols.declare(declaration.a, kind, (uint32_t)subprograms.size(), declaration.line) == nullptr)
+                fail(declaration.line, "'" + name(declaration.a) + "' is already declared");
+            TypeId result = declaration.kind == NODE_FUNCTION ? (TypeId)declaration.type : (TypeId)TYPE_NONE;
+            Subprogram subprogram{declarations[i], result, (uint32_t)parameterTypes.size(), 0};
+            out->types[declarations[i]] = subprogram.result;
+            for (uint32_t g = 0; g < ast.listSize(declaration.b); g++)
+            {
+                uint32_t group = ast.listItems(declaration.b)[g];
+                const AstNode &parameters = ast[group];
+                if ((parameters.flags & NODE_FLAG_ARRAY) && (int32_t)parameters.d < (int32_t)parameters.c)
+                    fail(parameters.line, "array bounds must be ascending");
+                TypeId type = out->table.declared(parameters);
+                out->types[group] = type;
+                parameterTypes.insert(parameterTypes.end(), ast.listSize(parameters.a), type);
+            }
+            subprogram.parameterCount = (uint32_t)parameterTypes.size() - subprogram.parameters;
+            subprograms.push_back(subprogram);
+        }
+
+        for (uint32_t s = 0; s < subprograms.size(); s++)
+            checkSubprogram(s);
+        current = UINT32_MAX;
+        statement(program.d);
+    }
+
+    void declareVariables(uint32_t index)
+    {
+        const AstNode &declaration = ast[index];
+        bool array = (declaration.flags & NODE_FLAG_ARRAY) != 0;
+        int32_t low = (int32_t)declaration.c, high = (int32_t)declaration.d;
+        if (array && (high < low || (int64_t)high - low >= (1 << 24)))
+            fail(declaration.line, "array bounds must be ascending and at most 16M elements apart");
+        TypeId type = out->table.declared(declaration);
+        out->types[index] = type;
+        SymbolKind kind = declaration.kind == NODE_PARAMETERS ? SYMBOL_PARAMETER : SYMBOL_VARIABLE;
+        for (uint32_t i = 0; i < ast.listSize(declaration.a); i++)
+        {
+            uint32_t id = ast.listItems(declaration.a)[i];
+            if (symbols.declare(id, kind, type, declaration.line) == nullptr)
+                fail(declaration.line, "'" + name(id) + "' is already declared");
+        }
+    }
+
+    void checkSubprogram(uint32_t index)
+    {
+        const AstNode &subprogram = ast[subprograms[index].node];
+        current = index;
+        symbols.enterScope();
+        for (uint32_t i = 0; i < ast.listSize(subprogram.b); i++)
+        {
+            uint32_t group = ast.listItems(subprogram.b)[i];
+            const AstNode &parameters = ast[group];
+            for (uint32_t k = 0; k < ast.listSize(parameters.a); k++)
+            {
+                uint32_t id = ast.listItems(parameters.a)[k];
+                if (symbols.declare(id, SYMBOL_PARAMETER, out->types[group], parameters.line) == nullptr)
+                    fail(parameters.line, "'" + name(id) + "' is already declared");
+            }
+        }
+        for (uint32_t i = 0; i < ast.listSize(subprogram.c); i++)
+            declareVariables(ast.listItems(subprogram.c)[i]);
+        statement(subprogram.d);
+        symbols.exitScope();
+    }
+
+    // --- Names ---
+
+    const Symbol &resolve(uint32_t id, uint32_t line)
+    {
+        const Symbol *symbol = symbols.lookup(id);
+        if (symbol == nullptr)
+            fail(line, "'" + name(id) + "' is not declared");
+        return *symbol;
+    }
+
+    static bool isVariable(const Symbol &symbol)
+    {
+        return symbol.kind == SYMBOL_VARIABLE || symbol.kind == SYMBOL_PARAMETER;
+    }
+
+    // --- Statements ---
+
+    void statement(uint32_t index)
+    {
+        if (index == 0)
+            return;
+        const AstNode &node = ast[index];
+        switch (node.kind)
+        {
+        case NODE_COMPOUND:
+            for (uint32_t i = 0; i < ast.listSize(node.a); i++)
+                statement(ast.listItems(node.a)[i]);
+            break;
+        case NODE_ASSIGN:
+            assignment(node);
+            break;
+        case NODE_CALL_STATEMENT:
+            if ((node.a == writeId || node.a == writelnId) && symbols.lookup(node.a) == nullptr)
+            {
+                for (uint32_t i = 0; i < ast.listSize(node.b); i++)
+                    expression(ast.listItems(node.b)[i]);
+            }
+            else
+                call(node.a, node.b, node.line, false);
+            break;
+        case NODE_IF:
+            condition(node.a);
+            statement(node.b);
+            statement(node.c);
+            break;
+        case NODE_WHILE:
+            // In the order of the code: the test follows the body
+            statement(node.b);
+            condition(node.a);
+            break;
+        default:
+            fail(node.line, string("unexpected ") + nodeKindName(node.kind) + " statement");
+        }
+    }
+
+    void condition(uint32_t index)
+    {
+        if (expression(index) != TYPE_INTEGER)
+            fail(ast[index].line, "a condition must be an integer or boolean expression");
+    }
+
+    void assignment(const AstNode &node)
+    {
+        const AstNode &target = ast[node.a];
+        const Symbol &symbol = resolve(target.a, target.line);
+        if (symbol.kind == SYMBOL_FUNCTION && symbol.type == current && target.kind == NODE_NAME)
+        {
+            out->types[node.a] = subprograms[current].result;
+            store(node.b, subprograms[current].result, node.line);
+            return;
+        }
+        if (!isVariable(symbol))
+            fail(node.line, "cannot assign to " + string(symbolKindName(symbol.kind)) + " '" + name(target.a) + "'");
+        TypeId type = (TypeId)symbol.type;
+        if (target.kind == NODE_NAME)
+        {
+            if (out->table.isArray(type))
+                fail(node.line, "arrays can only be assigned element by element");
+            out->types[node.a] = type;
+            store(node.b, type, node.line);
+            return;
+        }
+        if (!out->table.isArray(type))
+            fail(node.line, "'" + name(target.a) + "' is not an array");
+        arrayIndex(target);
+        out->types[node.a] = out->table.element(type);
+        store(node.b, out->table.element(type), node.line);
+    }
+
+    // Checks the expression at index against a scalar of type, widening an integer for a real
+    void store(uint32_t index, TypeId type, uint32_t line)
+    {
+        TypeId valueType = expression(index);
+        if (valueType == type)
+            return;
+        if (type == TYPE_REAL && valueType == TYPE_INTEGER)
+            out->widened[index] = 1;
+        else
+            fail(line, "cannot store a real value in an integer");
+    }
+
+    void arrayIndex(const AstNode &target)
+    {
+        if (expression(target.b) != TYPE_INTEGER)
+            fail(target.line, "an array index must be an integer");
+    }
+
+    // A call of a function, or of a procedure when !wantValue; returns the result type
+    TypeId call(uint32_t id, uint32_t arguments, uint32_t line, bool wantValue)
+    {
+        const Symbol &symbol = resolve(id, line);
+        if (symbol.kind != (wantValue ? SYMBOL_FUNCTION : SYMBOL_PROCEDURE))
+            fail(line, "'" + name(id) + "' is not a " + (wantValue ? "function" : "procedure"));
+        const Subprogram &callee = subprograms[symbol.type];
+        uint32_t count = ast.listSize(arguments);
+        if (count != callee.parameterCount)
+            fail(line, "'" + name(id) + "' takes " + to_string(callee.parameterCount) + " argument" +
+                           (callee.parameterCount == 1 ? "" : "s") + ", not " + to_string(count));
+        for (uint32_t i = 0; i < count; i++)
+        {
+            TypeId parameter = parameterTypes[callee.parameters + i];
+            uint32_t argument = ast.listItems(arguments)[i];
+            if (!out->table.isArray(parameter))
+            {
+                store(argument, parameter, line);
+                continue;
+            }
+            // Arrays are passed by name and copied; the callee numbers the elements its own way
+            const AstNode &node = ast[argument];
+            const Symbol *passed = node.kind == NODE_NAME ? symbols.lookup(node.a) : nullptr;
+            if (passed == nullptr || !isVariable(*passed) || !out->table.isArray((TypeId)passed->type))
+                fail(line, "argument " + to_string(i + 1) + " of '" + name(id) + "' must be an array");
+            TypeId type = (TypeId)passed->type;
+            if (out->table.element(type) != out->table.element(parameter) ||
+                out->table.count(type) != out->table.count(parameter))
+                fail(line, "argument " + to_string(i + 1) + " of '" + name(id) + "' has the wrong array type");
+            out->types[argument] = type;
+        }
+        return callee.result;
+    }
+
+    // --- Expressions ---
+
+    TypeId expression(uint32_t index)
+    {
+        const AstNode &node = ast[index];
+        TypeId type = TYPE_INTEGER;
+        switch (node.kind)
+        {
+        case NODE_INTEGER:
+            break;
+        case NODE_REAL:
+            type = TYPE_REAL;
+            break;
+        case NODE_NAME:
+        {
+            const Symbol &symbol = resolve(node.a, node.line);
+            if (symbol.kind == SYMBOL_FUNCTION)
+            {
+                type = call(node.a, 0, node.line, true);
+                break;
+            }
+            if (!isVariable(symbol))
+                fail(node.line, string(symbolKindName(symbol.kind)) + " '" + name(node.a) + "' has no value");
+            if (out->table.isArray((TypeId)symbol.type))
+                fail(node.line, "array '" + name(node.a) + "' used as a value");
+            type = (TypeId)symbol.type;
+            break;
+        }
+        case NODE_INDEX:
+        {
+            const Symbol &symbol = resolve(node.a, node.line);
+            if (!isVariable(symbol) || !out->table.isArray((TypeId)symbol.type))
+                fail(node.line, "'" + name(node.a) + "' is not an array");
+            TypeId array = (TypeId)symbol.type;
+            arrayIndex(node);
+            type = out->table.element(array);
+            break;
+        }
+        case NODE_CALL:
+            type = call(node.a, node.b, node.line, true);
+            break;
+        case NODE_UNARY:
+            type = expression(node.a);
+            if (node.op == OPERATOR_NOT && type != TYPE_INTEGER)
+                fail(node.line, "'not' needs an integer or boolean operand");
+            break;
+        case NODE_BINARY:
+            type = binary(node);
+            break;
+        default:
+            fail(node.line, string("unexpected ") + nodeKindName(node.kind) + " in an expression");
+        }
+        out->types[index] = type;
+        return type;
+    }
+
+    TypeId binary(const AstNode &node)
+    {
+        TypeId left = expression(node.a);
+        TypeId right = expression(node.b);
+        bool integers = left == TYPE_INTEGER && right == TYPE_INTEGER;
+        switch (node.op)
+        {
+        case OPERATOR_DIV:
+        case OPERATOR_MOD:
+        case OPERATOR_AND:
+        case OPERATOR_OR:
+            if (!integers)
+                fail(node.line, string("'") + operatorName(node.op) + "' needs integer operands");
+            return TYPE_INTEGER;
+        case OPERATOR_ADD:
+        case OPERATOR_SUBTRACT:
+        case OPERATOR_MULTIPLY:
+        case OPERATOR_DIVIDE:
+        case OPERATOR_EQUAL:
+        case OPERATOR_NOT_EQUAL:
+        case OPERATOR_LESS:
+        case OPERATOR_LESS_EQUAL:
+        case OPERATOR_GREATER:
+        case OPERATOR_GREATER_EQUAL:
+            break;
+        default:
+            fail(node.line, string("unexpected operator ") + operatorName(node.op));
+        }
+        bool real = node.op == OPERATOR_DIVIDE || !integers;
+        if (real)
+        {
+            out->widened[node.a] = left == TYPE_INTEGER;
+            out->widened[node.b] = right == TYPE_INTEGER;
+        }
+        return node.op >= OPERATOR_EQUAL || !real ? TYPE_INTEGER : TYPE_REAL;
+    }
+
+    const Ast &ast;
+    IdentifierTable &identifiers;
+    TypeAnnotations *out = nullptr;
+    SymbolTable symbols;
+    vector<Subprogram> subprograms;
+    vector<TypeId> parameterTypes;
+    uint32_t writeId = 0, writelnId = 0;
+    uint32_t current = UINT32_MAX; // subprogram being checked; none in the program's body
+};
@@ -0,0 +1,364 @@
+// VirtualMachine.h
+// Runs a BytecodeModule. The dispatch loop uses computed goto (GCC and
+// Clang's labels as values): every handler ends with its own indirect jump
+// to the next handler, so the branch predictor sees one jump site per
+// opcode instead of the single shared one of a switch. Other compilers, or
+// a build with PASCAL_VM_SWITCH defined, get the same handlers in a switch.
+//
+// All frames live in one preallocated stack of Values: the global arrays at
+// the bottom, then the main program's frame, then one frame per active
+// call, each directly above its caller's. A call copies the arguments from
+// the caller's registers into the new frame and zeroes the rest of it.
+//
+// Run-time errors (division by zero, an index out of bounds, too deep a
+// recursion) throw runtime_error with the source line.
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Bytecode.h"
+
+using namespace std;
+
+#if !defined(PASCAL_VM_SWITCH) && !defined(__GNUC__)
+#define PASCAL_VM_SWITCH
+#endif
+
+class VirtualMachine
+{
+public:
+    explicit VirtualMachine(size_t stackSlots = 1 << 22) : stack(stackSlots) { calls.reserve(1024); }
+
+    void run(const BytecodeModule &module, ostream &out)
+    {
+        const BytecodeFunction *function = &module.functions[module.main];
+        Value *bottom = stack.data();
+        Value *end = bottom + stack.size();
+        Value *globals = bottom + module.globalArraySlots;
+        if (globals + function->frameSize > end)
+            throw runtime_error("global variables do not fit in the VM stack");
+        memset((void *)bottom, 0, (module.globalArraySlots + function->frameSize) * sizeof(Value));
+        const Value *constants = module.constants.data();
+        const ArrayInfo *arrays = module.arrays.data();
+        const Instruction *code = function->code.data();
+        const Instruction *pc = code;
+        const Instruction *instruction;
+        Value *frame = globals;
+        calls.clear();
+
+#define R(field) frame[instruction->field]
+#define WIDE wideOperand(*instruction)
+#ifdef PASCAL_VM_SWITCH
+#define CASE(name) case OP_##name:
+#define NEXT() continue
+        for (;;)
+        {
+            instruction = pc++;
+            switch (instruction->op)
+            {
+#else
+#define PASCAL_OPCODE_LABEL(name, text) &&op_##name,
+        static void *const labels[OP_COUNT] = {PASCAL_OPCODES(PASCAL_OPCODE_LABEL)};
+#undef PASCAL_OPCODE_LABEL
+#define CASE(name) op_##name:
+#define NEXT() goto *labels[(instruction = pc++)->op]
+        NEXT();
+        {
+            {
+#endif
+            CASE(MOVE)
+            {
+                R(a) = R(b);
+                NEXT();
+            }
+            CASE(LOADI)
+            {
+                R(a).i = (int32_t)WIDE;
+                NEXT();
+            }
+            CASE(LOADK)
+            {
+                R(a) = constants[WIDE];
+                NEXT();
+            }
+            CASE(I2R)
+            {
+                R(a).r = (double)R(b).i;
+                NEXT();
+            }
+            CASE(ADDI)
+            {
+                R(a).i = (int64_t)((uint64_t)R(b).i + (uint64_t)R(c).i);
+                NEXT();
+            }
+            CASE(SUBI)
+            {
+                R(a).i = (int64_t)((uint64_t)R(b).i - (uint64_t)R(c).i);
+                NEXT();
+            }
+            CASE(MULI)
+            {
+                R(a).i = (int64_t)((uint64_t)R(b).i * (uint64_t)R(c).i);
+                NEXT();
+            }
+            CASE(DIVI)
+            {
+                int64_t divisor = R(c).i;
+                if (divisor == 0)
+                    fail(function, pc, "division by zero");
+                R(a).i = divisor == -1 ? (int64_t)(0 - (uint64_t)R(b).i) : R(b).i / divisor;
+                NEXT();
+            }
+            CASE(MODI)
+            {
+                int64_t divisor = R(c).i;
+                if (divisor == 0)
+                    fail(function, pc, "division by zero");
+                R(a).i = divisor == -1 ? 0 : R(b).i % divisor;
+                NEXT();
+            }
+            CASE(NEGI)
+            {
+                R(a).i = (int64_t)(0 - (uint64_t)R(b).i);
+                NEXT();
+            }
+            CASE(ADDR)
+            {
+                R(a).r = R(b).r + R(c).r;
+                NEXT();
+            }
+            CASE(SUBR)
+            {
+                R(a).r = R(b).r - R(c).r;
+                NEXT();
+            }
+            CASE(MULR)
+            {
+                R(a).r = R(b).r * R(c).r;
+                NEXT();
+            }
+            CASE(DIVR)
+            {
+                if (R(c).r == 0)
+                    fail(function, pc, "division by zero");
+                R(a).r = R(b).r / R(c).r;
+                NEXT();
+            }
+            CASE(NEGR)
+            {
+                R(a).r = -R(b).r;
+                NEXT();
+            }
+            CASE(EQI)
+            {
+                R(a).i = R(b).i == R(c).i;
+                NEXT();
+            }
+            CASE(NEI)
+            {
+                R(a).i = R(b).i != R(c).i;
+                NEXT();
+            }
+            CASE(LTI)
+            {
+                R(a).i = R(b).i < R(c).i;
+                NEXT();
+            }
+            CASE(LEI)
+            {
+                R(a).i = R(b).i <= R(c).i;
+                NEXT();
+            }
+            CASE(EQR)
+            {
+                R(a).i = R(b).r == R(c).r;
+                NEXT();
+            }
+            CASE(NER)
+            {
+                R(a).i = R(b).r != R(c).r;
+                NEXT();
+            }
+            CASE(LTR)
+            {
+                R(a).i = R(b).r < R(c).r;
+                NEXT();
+            }
+            CASE(LER)
+            {
+                R(a).i = R(b).r <= R(c).r;
+                NEXT();
+            }
+            CASE(AND)
+            {
+                R(a).i = (R(b).i != 0) & (R(c).i != 0);
+                NEXT();
+            }
+            CASE(OR)
+            {
+                R(a).i = (R(b).i != 0) | (R(c).i != 0);
+                NEXT();
+            }
+            CASE(NOT)
+            {
+                R(a).i = R(b).i == 0;
+                NEXT();
+            }
+            CASE(GETG)
+            {
+                R(a) = globals[WIDE];
+                NEXT();
+            }
+            CASE(SETG)
+            {
+                globals[WIDE] = R(a);
+                NEXT();
+            }
+            CASE(GETEL)
+            {
+                const ArrayInfo &array = arrays[instruction->b];
+                uint64_t k = (uint64_t)(R(c).i - array.low);
+                if (k >= array.count)
+                    fail(function, pc, "array index " + to_string(R(c).i) + " out of bounds");
+                R(a) = frame[array.offset + k];
+                NEXT();
+            }
+            CASE(SETEL)
+            {
+                const ArrayInfo &array = arrays[instruction->b];
+                uint64_t k = (uint64_t)(R(c).i - array.low);
+                if (k >= array.count)
+                    fail(function, pc, "array index " + to_string(R(c).i) + " out of bounds");
+                frame[array.offset + k] = R(a);
+                NEXT();
+            }
+            CASE(GETEG)
+            {
+                const ArrayInfo &array = arrays[instruction->b];
+                uint64_t k = (uint64_t)(R(c).i - array.low);
+                if (k >= array.count)
+                    fail(function, pc, "array index " + to_string(R(c).i) + " out of bounds");
+                R(a) = bottom[array.offset + k];
+                NEXT();
+            }
+            CASE(SETEG)
+            {
+                const ArrayInfo &array = arrays[instruction->b];
+                uint64_t k = (uint64_t)(R(c).i - array.low);
+                if (k >= array.count)
+                    fail(function, pc, "array index " + to_string(R(c).i) + " out of bounds");
+                bottom[array.offset + k] = R(a);
+                NEXT();
+            }
+            CASE(COPYL)
+            {
+                const ArrayInfo &array = arrays[instruction->b];
+                memcpy((void *)&R(a), (const void *)(frame + array.offset), array.count * sizeof(Value));
+                NEXT();
+            }
+            CASE(COPYG)
+            {
+                const ArrayInfo &array = arrays[instruction->b];
+                memcpy((void *)&R(a), (const void *)(bottom + array.offset), array.count * sizeof(Value));
+                NEXT();
+            }
+            CASE(JMP)
+            {
+                pc = code + WIDE;
+                NEXT();
+            }
+            CASE(JMPF)
+            {
+                if (R(a).i == 0)
+                    pc = code + WIDE;
+                NEXT();
+            }
+            CASE(JMPT)
+            {
+                if (R(a).i != 0)
+                    pc = code + WIDE;
+                NEXT();
+            }
+            CASE(CALL)
+            {
+                const BytecodeFunction *callee = &module.functions[instruction->b];
+                Value *next = frame + function->frameSize;
+                if (next + callee->frameSize > end)
+                    fail(function, pc, "stack overflow");
+                memcpy((void *)next, (const void *)&R(a), callee->parameterSlots * sizeof(Value));
+                memset((void *)(next + callee->parameterSlots), 0,
+                       (callee->frameSize - callee->parameterSlots) * sizeof(Value));
+                calls.push_back(CallRecord{function, pc, frame, instruction->c});
+                function = callee;
+                frame = next;
+                code = pc = callee->code.data();
+                NEXT();
+            }
+            CASE(RET)
+            {
+                const CallRecord &caller = calls.back();
+                Value result = frame[function->result];
+                bool hasResult = function->resultType != AST_TYPE_NONE;
+                function = caller.function;
+                frame = caller.frame;
+                pc = caller.returnPc;
+                code = function->code.data();
+                if (hasResult)
+                    frame[caller.result] = result;
+                calls.pop_back();
+                NEXT();
+            }
+            CASE(WRITEI)
+            {
+                out << R(a).i;
+                NEXT();
+            }
+            CASE(WRITER)
+            {
+                writeReal(out, R(a).r);
+                NEXT();
+            }
+            CASE(WRITELN)
+            {
+                out << '\n';
+                NEXT();
+            }
+            CASE(HALT)
+            {
+                return;
+            }
+#ifdef PASCAL_VM_SWITCH
+            default:
+                fail(function, pc, "bad opcode");
+#endif
+            }
+        }
+#undef R
+#undef WIDE
+#undef CASE
+#undef NEXT
+    }
+
+private:
+    struct CallRecord
+    {
+        const BytecodeFunction *function;
+        const Instruction *returnPc;
+        Value *frame;
+        uint16_t result; // caller's register for a function result
+    };
+
+    // pc is already past the failing instruction
+    [[noreturn]] static void fail(const BytecodeFunction *function, const Instruction *pc, const string &message)
+    {
+        size_t at = pc - 1 - function->code.data();
+        throw runtime_error("line " + to_string(function->lines[at]) + ": " + message);
+    }
+
+    vector<Value> stack;
+    vector<CallRecord> calls;
+};
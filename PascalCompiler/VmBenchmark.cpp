@@ -0,0 +1,427 @@
+// Libraries
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include "../Lab2/MappedFile.h"
+#include "../Lab4/IdentifierTable.h"
+#include "Arena.h"
+#include "Ast.h"
+#include "AstInterpreter.h"
+#include "Bytecode.h"
+#include "BytecodeCompiler.h"
+#include "NativeCompiler.h"
+#include "PascalParser.h"
+#include "SsaOptimizer.h"
+#include "VirtualMachine.h"
+
+using namespace std;
+
+// Runs Pascal-subset programs on the bytecode VM and on the tree-walking
+// AstInterpreter, and checks that both print the same thing. The VM also
+// runs the bytecode after the SSA optimizations of SsaOptimizer.h; --passes
+// picks some of them (constants, numbering, invariants, dead, joined by
+// commas) and --ssa prints the optimized SSA form. On x86-64 the same SSA is
+// also compiled to machine code by NativeCompiler.h and timed alongside;
+// --native-code writes that code to a file, for objdump -D -b binary -mi386
+// -Mx86-64. Without a source file it times a suite of small numeric kernels,
+// best of R runs each. Build with -DPASCAL_VM_SWITCH to time switch dispatch
+// instead of computed goto.
+//
+// Usage:
+//   VmBenchmark [source.pas] [--runs R] [--kernel name] [--disassemble] [--ssa] [--passes list]
+//               [--native-code path]
+
+// Structs
+struct Kernel
+{
+    const char *name;
+    const char *source;
+};
+
+struct Timing
+{
+    string output;
+    double seconds = 0;
+};
+
+// Function Prototypes
+bool compileSource(const string &source, const string &label, IdentifierTable &identifiers, Ast &ast,
+                   BytecodeModule &module);
+template <class Engine>
+Timing timeRuns(Engine &engine, int runs);
+uint32_t parsePasses(const string &list);
+
+static const Kernel kernels[] = {
+    {"loop", R"(program loop(output);
+var i, sum: integer;
+begin
+    i := 0;
+    sum := 0;
+    while i < 5000000 do
+    begin
+        sum := sum + i mod 7 * 3;
+        i := i + 1
+    end;
+    writeln(sum)
+end.
+)"},
+    {"array-sum", R"(program arraysum(output);
+var data: array [1..10000] of integer;
+var i, pass, total: integer;
+begin
+    i := 1;
+    while i <= 10000 do
+    begin
+        data[i] := i * 3 mod 1000;
+        i := i + 1
+    end;
+    pass := 0;
+    total := 0;
+    while pass < 200 do
+    begin
+        i := 1;
+        while i <= 10000 do
+        begin
+            total := total + data[i];
+            i := i + 1
+        end;
+        pass := pass + 1
+    end;
+    writeln(total)
+end.
+)"},
+    {"fibonacci", R"(program fibonacci(output);
+function fib(n: integer): integer;
+begin
+    if n < 2 then
+        fib := n
+    else
+        fib := fib(n - 1) + fib(n - 2)
+end;
+begin
+    writeln(fib(27))
+end.
+)"},
+    {"sieve", R"(program sieve(output);
+var flags: array [2..200000] of integer;
+var count, round: integer;
+procedure run;
+var i, j: integer;
+begin
+    i := 2;
+    while i <= 200000 do
+    begin
+        flags[i] := 1;
+        i := i + 1
+    end;
+    count := 0;
+    i := 2;
+    while i <= 200000 do
+    begin
+        if flags[i] = 1 then
+        begin
+            count := count + 1;
+            j := i + i;
+            while j <= 200000 do
+            begin
+                flags[j] := 0;
+                j := j + i
+            end
+        end;
+        i := i + 1
+    end
+end;
+begin
+    round := 0;
+    while round < 10 do
+    begin
+        run;
+        round := round + 1
+    end;
+    writeln(count)
+end.
+)"},
+    {"leibniz", R"(program leibniz(output);
+var k: integer;
+var sum, sign: real;
+begin
+    k := 0;
+    sum := 0;
+    sign := 1;
+    while k < 3000000 do
+    begin
+        sum := sum + sign / (2 * k + 1);
+        sign := -sign;
+        k := k + 1
+    end;
+    writeln(4 * sum)
+end.
+)"},
+    {"gcd-calls", R"(program gcdcalls(output);
+var i, total: integer;
+function gcd(a, b: integer): integer;
+begin
+    if b = 0 then
+        gcd := a
+    else
+        gcd := gcd(b, a mod b)
+end;
+begin
+    i := 1;
+    total := 0;
+    while i <= 300000 do
+    begin
+        total := total + gcd(i, 360360);
+        i := i + 1
+    end;
+    writeln(total)
+end.
+)"},
+    {"bubble-sort", R"(program bubblesort(output);
+function sorted(seed: integer): integer;
+var data: array [1..600] of integer;
+var i, j, t, n: integer;
+begin
+    n := 600;
+    i := 1;
+    while i <= n do
+    begin
+        seed := (seed * 1103515245 + 12345) mod 2147483648;
+        data[i] := seed mod 10000;
+        i := i + 1
+    end;
+    i := 1;
+    while i < n do
+    begin
+        j := 1;
+        while j <= n - i do
+        begin
+            if data[j] > data[j + 1] then
+            begin
+                t := data[j];
+                data[j] := data[j + 1];
+                data[j + 1] := t
+            end;
+            j := j + 1
+        end;
+        i := i + 1
+    end;
+    sorted := data[1] + data[n div 2] * 7 + data[n]
+end;
+begin
+    writeln(sorted(42))
+end.
+)"},
+};
+
+// Main Function
+int main(int argc, char *argv[])
+{
+    try
+    {
+        string sourcePath, only, codePath;
+        int runs = 3;
+        bool disassembly = false, listing = false;
+        uint32_t passes = SSA_PASS_ALL;
+        for (int i = 1; i < argc; i++)
+        {
+            string argument = argv[i];
+            if (argument == "--runs" && i + 1 < argc)
+                runs = max(1, stoi(argv[++i]));
+            else if (argument == "--kernel" && i + 1 < argc)
+                only = argv[++i];
+            else if (argument == "--disassemble")
+                disassembly = true;
+            else if (argument == "--ssa")
+                listing = true;
+            else if (argument == "--passes" && i + 1 < argc)
+                passes = parsePasses(argv[++i]);
+            else if (argument == "--native-code" && i + 1 < argc)
+                codePath = argv[++i];
+            else
+                sourcePath = argument;
+        }
+
+        vector<Kernel> selected;
+        string fileSource;
+        if (!sourcePath.empty())
+        {
+            MappedFile file;
+            if (!file.open(sourcePath))
+            {
+                cerr << "File could not be opened: " << sourcePath << endl;
+                return 1;
+            }
+            fileSource.assign(file.data(), file.size());
+            selected.push_back(Kernel{sourcePath.c_str(), fileSource.c_str()});
+        }
+        else
+        {
+            for (const Kernel &kernel : kernels)
+            {
+                if (only.empty() || only == kernel.name)
+                    selected.push_back(kernel);
+            }
+            if (selected.empty())
+            {
+                cerr << "No kernel named " << only << endl;
+                return 1;
+            }
+        }
+
+        bool mismatch = false;
+        for (const Kernel &kernel : selected)
+        {
+            Arena arena;
+            Ast ast(arena);
+            IdentifierTable identifiers;
+            BytecodeModule module;
+            if (!compileSource(kernel.source, kernel.name, identifiers, ast, module))
+                return 1;
+            BytecodeModule optimized = module;
+            SsaStatistics statistics = optimizeModule(optimized, passes, listing ? &cout : nullptr);
+            if (disassembly || listing)
+            {
+                if (disassembly)
+                {
+                    disassemble(cout, module, identifiers);
+                    cout << "; after the SSA optimizations\n";
+                    disassemble(cout, optimized, identifiers);
+                }
+                continue;
+            }
+
+            VirtualMachine machine;
+            auto runMachine = [&](ostream &out) { machine.run(module, out); };
+            auto runOptimized = [&](ostream &out) { machine.run(optimized, out); };
+            AstInterpreter interpreter(ast, identifiers);
+            auto runInterpreter = [&](ostream &out) { interpreter.run(out); };
+            Timing vm = timeRuns(runMachine, runs);
+            Timing ssa = timeRuns(runOptimized, runs);
+            Timing tree = timeRuns(runInterpreter, runs);
+
+            if (!sourcePath.empty())
+                cout << vm.output;
+            string result = vm.output.substr(0, vm.output.find('\n'));
+            cout << kernel.name << ": " << result << ", AST interpreter " << tree.seconds * 1000 << " ms, VM "
+                 << vm.seconds * 1000 << " ms, " << tree.seconds / vm.seconds << "x, optimized VM "
+                 << ssa.seconds * 1000 << " ms, " << vm.seconds / ssa.seconds << "x faster" << endl;
+            cout << "  " << statistics.instructionsBefore << " -> " << statistics.instructionsAfter
+                 << " instructions; folded " << statistics.folded << ", branches folded "
+                 << statistics.branchesFolded << ", numbered " << statistics.numbered << ", loads reused "
+                 << statistics.loadsReused << ", hoisted " << statistics.hoisted << ", removed " << statistics.removed
+                 << endl;
+            if (vm.output != tree.output)
+            {
+                cout << "  outputs differ; the AST interpreter printed:\n" << tree.output;
+                mismatch = true;
+            }
+            if (ssa.output != vm.output)
+            {
+                cout << "  outputs differ; the optimized VM printed:\n" << ssa.output;
+                mismatch = true;
+            }
+#ifdef PASCAL_NATIVE
+            NativeProgram program;
+            NativeCompiler(module, passes).compile(program);
+            if (!codePath.empty())
+                ofstream(codePath, ios::binary).write((const char *)program.code.data(), program.code.size());
+            NativeMachine native;
+            auto runNative = [&](ostream &out) { native.run(program, out); };
+            Timing code = timeRuns(runNative, runs);
+            const NativeStatistics &counts = program.statistics;
+            cout << "  native " << code.seconds * 1000 << " ms, " << vm.seconds / code.seconds << "x the VM, "
+                 << ssa.seconds / code.seconds << "x the optimized VM; " << counts.codeBytes << " bytes, "
+                 << counts.values << " values, " << counts.spilled << " spilled, " << counts.saved
+                 << " saved around calls" << endl;
+            if (code.output != vm.output)
+            {
+                cout << "  outputs differ; the native code printed:\n" << code.output;
+                mismatch = true;
+            }
+#endif
+        }
+        return mismatch ? 1 : 0;
+    }
+    catch (exception &e)
+    {
+        cout << "Error occurred: " << e.what() << endl;
+        return 1;
+    }
+}
+
+bool compileSource(const string &source, const string &label, IdentifierTable &identifiers, Ast &ast,
+                   BytecodeModule &module)
+{
+    vector<Diagnostic> diagnostics;
+    PascalParser parser(source.data(), source.size(), identifiers);
+    bool compiled = parser.parse(ast, diagnostics) && BytecodeCompiler(ast, identifiers).compile(module, diagnostics);
+    for (const Diagnostic &diagnostic : diagnostics)
+    {
+        cerr << label << ":" << diagnostic.line;
+        if (diagnostic.column != 0)
+            cerr << ":" << diagnostic.column;
+        cerr << ": " << diagnostic.message << endl;
+    }
+    return compiled;
+}
+
+// Best time of runs; a run-time error is reported as the output, as both engines fail the same way
+template <class Engine>
+Timing timeRuns(Engine &engine, int runs)
+{
+    Timing timing;
+    for (int r = 0; r < runs; r++)
+    {
+        ostringstream out;
+        auto start = chrono::steady_clock::now();
+        try
+        {
+            engine(out);
+        }
+        catch (runtime_error &e)
+        {
+            out << "run-time error: " << e.what() << "\n";
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (r == 0 || seconds < timing.seconds)
+            timing.seconds = seconds;
+        timing.output = out.str();
+    }
+    return timing;
+}
+
+// A comma-separated list of pass names
+uint32_t parsePasses(const string &list)
+{
+    static const pair<const char *, uint32_t> names[] = {{"constants", SSA_PASS_CONSTANTS},
+                                                         {"numbering", SSA_PASS_VALUE_NUMBERING},
+                                                         {"invariants", SSA_PASS_LOOP_INVARIANTS},
+                                                         {"dead", SSA_PASS_DEAD_CODE}};
+    uint32_t passes = 0;
+    stringstream in(list);
+    string name;
+    while (getline(in, name, ','))
+    {
+        if (name.empty() || name == "none")
+            continue;
+        bool known = false;
+        for (auto &[passName, pass] : names)
+        {
+            if (name == passName)
+            {
+                passes |= pass;
+                known = true;
+            }
+        }
+        if (name == "all")
+            passes = SSA_PASS_ALL, known = true;
+        if (!known)
+            throw runtime_error("Unknown pass: " + name);
+    }
+    return passes;
+}
@@ -0,0 +1,382 @@
+// X86Assembler.h
+// Encodes the x86-64 instructions NativeCompiler.h needs into a byte
+// buffer: 64-bit integer moves and arithmetic, scalar double SSE2, compares,
+// jumps and calls. Registers are numbered as in the encoding (0-15 for both
+// general purpose and XMM registers); a memory operand is a base register,
+// an optional index register scaled by 8 and a 32-bit displacement.
+//
+// Jumps and calls go to labels, which may be bound before or after them;
+// finish() patches every 32-bit displacement once all labels are bound.
+// ExecutableMemory copies finished code into pages that may be executed.
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+enum X86Register : uint8_t
+{
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+// Condition codes, in encoding order
+enum X86Condition : uint8_t
+{
+    CC_O, CC_NO, CC_B, CC_AE, CC_E, CC_NE, CC_BE, CC_A,
+    CC_S, CC_NS, CC_P, CC_NP, CC_L, CC_GE, CC_LE, CC_G
+};
+
+inline X86Condition inverse(X86Condition condition) { return (X86Condition)(condition ^ 1); }
+
+// Integer operations that share the r, r/m encoding (opcode 8 * kind + 3) and 81 /kind
+enum X86Arithmetic : uint8_t
+{
+    X86_ADD = 0,
+    X86_OR = 1,
+    X86_AND = 4,
+    X86_SUB = 5,
+    X86_XOR = 6,
+    X86_CMP = 7
+};
+
+// Scalar double operations: F2 0F op
+enum X86Sse : uint8_t
+{
+    SSE_ADD = 0x58,
+    SSE_MUL = 0x59,
+    SSE_SUB = 0x5C,
+    SSE_DIV = 0x5E
+};
+
+// A register, or memory at [base + index * 8 + displacement]
+struct X86Operand
+{
+    bool memory = false;
+    uint8_t reg = 0;   // the register, or the base
+    int8_t index = -1; // none when negative
+    int32_t displacement = 0;
+
+    static X86Operand registerOperand(uint8_t reg)
+    {
+        X86Operand operand;
+        operand.reg = reg;
+        return operand;
+    }
+
+    static X86Operand at(uint8_t base, int32_t displacement, int8_t index = -1)
+    {
+        X86Operand operand;
+        operand.memory = true;
+        operand.reg = base;
+        operand.index = index;
+        operand.displacement = displacement;
+        return operand;
+    }
+
+    bool isRegister(uint8_t r) const { return !memory && reg == r; }
+};
+
+class X86Assembler
+{
+public:
+    const vector<uint8_t> &code() const { return bytes; }
+    size_t size() const { return bytes.size(); }
+
+    // --- Labels ---
+
+    uint32_t newLabel()
+    {
+        labels.push_back(unbound);
+        return (uint32_t)labels.size() - 1;
+    }
+
+    void bind(uint32_t label) { labels[label] = (uint32_t)bytes.size(); }
+
+    bool isBound(uint32_t label) const { return labels[label] != unbound; }
+
+    // Fills in every jump and call; all their labels must be bound by now
+    void finish()
+    {
+        for (auto [at, label] : fixups)
+        {
+            if (labels[label] == unbound)
+                throw runtime_error("jump to a label that was never bound");
+            int32_t relative = (int32_t)(labels[label] - (at + 4));
+            memcpy(&bytes[at], &relative, 4);
+        }
+        fixups.clear();
+    }
+
+    // --- Integer instructions ---
+
+    void mov(uint8_t to, const X86Operand &from)
+    {
+        if (from.isRegister(to))
+            return;
+        encode(0, true, {0x8B}, to, from);
+    }
+
+    void store(const X86Operand &to, uint8_t from) { encode(0, true, {0x89}, from, to); }
+
+    // Shortest move of a constant into a register; zero uses xor, which changes the flags
+    void movImmediate(uint8_t to, int64_t value)
+    {
+        if (value == 0)
+            encode(0, false, {0x33}, to, X86Operand::registerOperand(to));
+        else if (value > 0 && value <= UINT32_MAX)
+        {
+            rex(false, 0, 0, to);
+            byte(0xB8 + (to & 7));
+            dword((uint32_t)value);
+        }
+        else if (value >= INT32_MIN && value <= INT32_MAX)
+        {
+            encode(0, true, {0xC7}, 0, X86Operand::registerOperand(to));
+            dword((uint32_t)value);
+        }
+        else
+        {
+            rex(true, 0, 0, to);
+            byte(0xB8 + (to & 7));
+            qword((uint64_t)value);
+        }
+    }
+
+    // A sign-extended 32-bit constant to a register or memory
+    void storeImmediate(const X86Operand &to, int32_t value)
+    {
+        encode(0, true, {0xC7}, 0, to);
+        dword((uint32_t)value);
+    }
+
+    void arithmetic(X86Arithmetic kind, uint8_t to, const X86Operand &from)
+    {
+        encode(0, true, {(uint8_t)(8 * kind + 3)}, to, from);
+    }
+
+    void arithmeticImmediate(X86Arithmetic kind, const X86Operand &to, int32_t value)
+    {
+        if (value >= -128 && value <= 127)
+        {
+            encode(0, true, {0x83}, kind, to);
+            byte((uint8_t)value);
+        }
+        else
+        {
+            encode(0, true, {0x81}, kind, to);
+            dword((uint32_t)value);
+        }
+    }
+
+    void imul(uint8_t to, const X86Operand &from) { encode(0, true, {0x0F, 0xAF}, to, from); }
+
+    void imulImmediate(uint8_t to, const X86Operand &from, int32_t value)
+    {
+        if (value >= -128 && value <= 127)
+        {
+            encode(0, true, {0x6B}, to, from);
+            byte((uint8_t)value);
+        }
+        else
+        {
+            encode(0, true, {0x69}, to, from);
+            dword((uint32_t)value);
+        }
+    }
+
+    void neg(const X86Operand &operand) { encode(0, true, {0xF7}, 3, operand); }
+    void idiv(const X86Operand &divisor) { encode(0, true, {0xF7}, 7, divisor); }
+    void cqo() { bytes.insert(bytes.end(), {0x48, 0x99}); }
+    void test(uint8_t x, const X86Operand &y) { encode(0, true, {0x85}, x, y); }
+    void lea(uint8_t to, const X86Operand &address) { encode(0, true, {0x8D}, to, address); }
+
+    // The low byte of RAX, RCX, RDX or RBX, set from a condition, then widened to 64 bits in to
+    void setcc(X86Condition condition, uint8_t low) { encode(0, false, {0x0F, (uint8_t)(0x90 + condition)}, 0, X86Operand::registerOperand(low)); }
+    void movzxByte(uint8_t to, uint8_t low) { encode(0, false, {0x0F, 0xB6}, to, X86Operand::registerOperand(low)); }
+    void andByte(uint8_t x, uint8_t y) { encode(0, false, {0x22}, x, X86Operand::registerOperand(y)); }
+    void orByte(uint8_t x, uint8_t y) { encode(0, false, {0x0A}, x, X86Operand::registerOperand(y)); }
+
+    void push(uint8_t reg)
+    {
+        rex(false, 0, 0, reg);
+        byte(0x50 + (reg & 7));
+    }
+
+    void pop(uint8_t reg)
+    {
+        rex(false, 0, 0, reg);
+        byte(0x58 + (reg & 7));
+    }
+
+    // --- Control flow ---
+
+    void jmp(uint32_t label)
+    {
+        byte(0xE9);
+        fixup(label);
+    }
+
+    void jcc(X86Condition condition, uint32_t label)
+    {
+        byte(0x0F);
+        byte(0x80 + condition);
+        fixup(label);
+    }
+
+    void call(uint32_t label)
+    {
+        byte(0xE8);
+        fixup(label);
+    }
+
+    // A call to an absolute address, through RAX
+    void callAbsolute(const void *target)
+    {
+        rex(true, 0, 0, RAX);
+        byte(0xB8);
+        qword((uint64_t)(uintptr_t)target);
+        encode(0, false, {0xFF}, 2, X86Operand::registerOperand(RAX));
+    }
+
+    void ret() { byte(0xC3); }
+
+    // --- Scalar double instructions ---
+
+    void movsd(uint8_t to, const X86Operand &from)
+    {
+        if (from.isRegister(to))
+            return;
+        if (from.memory)
+            encode(0xF2, false, {0x0F, 0x10}, to, from);
+        else
+            encode(0, false, {0x0F, 0x28}, to, from); // movaps copies the whole register, without a dependency
+    }
+
+    void storeSd(const X86Operand &to, uint8_t from) { encode(0xF2, false, {0x0F, 0x11}, from, to); }
+
+    void sse(X86Sse kind, uint8_t to, const X86Operand &from) { encode(0xF2, false, {0x0F, kind}, to, from); }
+    void ucomisd(uint8_t x, const X86Operand &y) { encode(0x66, false, {0x0F, 0x2E}, x, y); }
+    void xorpd(uint8_t to, const X86Operand &from) { encode(0x66, false, {0x0F, 0x57}, to, from); }
+    void cvtsi2sd(uint8_t to, const X86Operand &from) { encode(0xF2, true, {0x0F, 0x2A}, to, from); }
+
+    // Bits between a general purpose and an XMM register
+    void movqToXmm(uint8_t to, const X86Operand &from) { encode(0x66, true, {0x0F, 0x6E}, to, from); }
+    void movqFromXmm(const X86Operand &to, uint8_t from) { encode(0x66, true, {0x0F, 0x7E}, from, to); }
+
+private:
+    static constexpr uint32_t unbound = UINT32_MAX;
+
+    void byte(uint8_t value) { bytes.push_back(value); }
+
+    void dword(uint32_t value)
+    {
+        for (int k = 0; k < 4; k++)
+            byte((uint8_t)(value >> (8 * k)));
+    }
+
+    void qword(uint64_t value)
+    {
+        for (int k = 0; k < 8; k++)
+            byte((uint8_t)(value >> (8 * k)));
+    }
+
+    void fixup(uint32_t label)
+    {
+        fixups.push_back({(uint32_t)bytes.size(), label});
+        dword(0);
+    }
+
+    void rex(bool wide, uint8_t reg, uint8_t index, uint8_t base)
+    {
+        uint8_t prefix = (uint8_t)(0x40 | wide << 3 | (reg >> 3) << 2 | (index >> 3) << 1 | base >> 3);
+        if (prefix != 0x40)
+            byte(prefix);
+    }
+
+    // [mandatory prefix] [REX] opcode ModRM [SIB] [displacement]; reg is a register or an opcode extension
+    void encode(uint8_t prefix, bool wide, initializer_list<uint8_t> opcode, uint8_t reg, const X86Operand &rm)
+    {
+        if (prefix != 0)
+            byte(prefix);
+        rex(wide, reg, rm.memory && rm.index >= 0 ? (uint8_t)rm.index : 0, rm.reg);
+        for (uint8_t op : opcode)
+            byte(op);
+        if (!rm.memory)
+        {
+            byte((uint8_t)(0xC0 | (reg & 7) << 3 | (rm.reg & 7)));
+            return;
+        }
+        // RBP and R13 as a base always take a displacement; RSP and R12 always take a SIB byte
+        uint8_t mod = rm.displacement == 0 && (rm.reg & 7) != RBP ? 0
+                      : rm.displacement >= -128 && rm.displacement <= 127 ? 1
+                                                                            : 2;
+        if (rm.index >= 0 || (rm.reg & 7) == RSP)
+        {
+            byte((uint8_t)(mod << 6 | (reg & 7) << 3 | 4));
+            uint8_t index = rm.index >= 0 ? (uint8_t)(rm.index & 7) : 4;
+            byte((uint8_t)((rm.index >= 0 ? 3 : 0) << 6 | index << 3 | (rm.reg & 7)));
+        }
+        else
+            byte((uint8_t)(mod << 6 | (reg & 7) << 3 | (rm.reg & 7)));
+        if (mod == 1)
+            byte((uint8_t)rm.displacement);
+        else if (mod == 2)
+            dword((uint32_t)rm.displacement);
+    }
+
+    vector<uint8_t> bytes;
+    vector<uint32_t> labels;
+    vector<pair<uint32_t, uint32_t>> fixups; // offset of a 32-bit displacement, label
+};
+
+#ifndef _WIN32
+// Code copied into pages mapped readable and executable
+class ExecutableMemory
+{
+public:
+    ExecutableMemory() {}
+    ExecutableMemory(const ExecutableMemory &) = delete;
+    ExecutableMemory &operator=(const ExecutableMemory &) = delete;
+    ~ExecutableMemory() { release(); }
+
+    void load(const vector<uint8_t> &code)
+    {
+        release();
+        size_t page = 4096;
+        length = (code.size() + page - 1) / page * page;
+        void *memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+            throw runtime_error("could not map memory for native code");
+        memcpy(memory, code.data(), code.size());
+        if (mprotect(memory, length, PROT_READ | PROT_EXEC) != 0)
+        {
+            munmap(memory, length);
+            throw runtime_error("could not make native code executable");
+        }
+        start = (uint8_t *)memory;
+    }
+
+    const uint8_t *data() const { return start; }
+
+private:
+    void release()
+    {
+        if (start != nullptr)
+            munmap(start, length);
+        start = nullptr;
+    }
+
+    uint8_t *start = nullptr;
+    size_t length = 0;
+};
+#endif